@@ -0,0 +1,138 @@
+#include "Benchmark.hpp"
+#include "CASLibWrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// set (or remove, for an empty value) an environment variable read by CAS_initialize
+void setVariable(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    if (value.empty())
+        unsetenv(name);
+    else
+        setenv(name, value.c_str(), 1);
+#endif
+}
+
+void selectBackend(const BenchBackend& backend, const unsigned int threads) {
+    setVariable("CAS_BACKEND", backend.backendVariable);
+    setVariable("CAS_CPU_ISA", backend.isaVariable);
+    setVariable("CAS_CPU_THREADS", threads ? std::to_string(threads) : std::string());
+}
+} // namespace
+
+BenchImage BenchImage::synthetic(const std::string& name, const unsigned int rows, const unsigned int cols) {
+    BenchImage image{name, rows, cols, std::vector<unsigned char>(static_cast<std::size_t>(rows) * cols * 4)};
+    std::uint32_t state = 0x9E3779B9u;
+    for (unsigned int y = 0; y < rows; y++) {
+        for (unsigned int x = 0; x < cols; x++) {
+            // xorshift noise over gradients and a checkerboard of 64 pixel squares
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            const unsigned int noise = state & 31, checker = ((x >> 6) ^ (y >> 6)) & 1 ? 96 : 0;
+            unsigned char* p = image.rgba.data() + (static_cast<std::size_t>(y) * cols + x) * 4;
+            p[0] = static_cast<unsigned char>(std::min(255u, x * 160 / cols + noise + checker / 2));
+            p[1] = static_cast<unsigned char>(std::min(255u, y * 160 / rows + noise + checker / 2));
+            p[2] = static_cast<unsigned char>(std::min(255u, 64 + noise + checker));
+            p[3] = static_cast<unsigned char>(255 - (noise << 2));
+        }
+    }
+    return image;
+}
+
+// probe each variant: the library falls back to another engine or to a lower instruction set when the requested one is not available
+std::vector<BenchBackend> BenchBackend::available() {
+    const std::vector<BenchBackend> candidates{{"hip", "gpu", "", false},          {"cpu-avx512", "cpu", "avx512", true}, {"cpu-avx2", "cpu", "avx2", true},
+                                               {"cpu-sse4.1", "cpu", "sse4.1", true}, {"cpu-scalar", "cpu", "scalar", true}};
+    std::vector<BenchBackend> backends;
+    for (const BenchBackend& candidate : candidates) {
+        selectBackend(candidate, 0);
+        void* casObj = CAS_initialize();
+        if (!casObj)
+            continue;
+        if (candidate.name == CAS_getBackendName(casObj))
+            backends.push_back(candidate);
+        CAS_destroy(casObj);
+    }
+    selectBackend({}, 0);
+    return backends;
+}
+
+std::string BenchResult::key() const {
+    return backend + "/" + image + "/" + (hasAlpha ? "rgba" : "rgb") + "/" + (casMode == 0 ? "planar" : "interleaved") + "/t" + std::to_string(threads) + (fast ? "/fast" : "") +
+           (numaNodes ? "/numa" + std::to_string(numaNodes) : "");
+}
+
+BenchSession::BenchSession(const BenchBackend& backend, const unsigned int threads, const unsigned int numaNodes) : backend(backend) {
+    selectBackend(backend, threads);
+    casObj = CAS_initialize();
+    selectBackend({}, 0);
+    this->threads = backend.cpu ? (threads ? threads : std::max(1u, std::thread::hardware_concurrency())) : 0;
+    // the NUMA mode runs one worker per logical processor of the selected nodes
+    if (casObj && backend.cpu && numaNodes) {
+        this->numaNodes = std::min(numaNodes, CAS_getNumaNodeCount());
+        this->threads = CAS_setNumaNodes(casObj, this->numaNodes);
+    }
+}
+
+BenchSession::~BenchSession() {
+    if (casObj)
+        CAS_destroy(casObj);
+}
+
+bool BenchSession::run(const BenchImage& image, const bool hasAlpha, const int casMode, const bool fast, const BenchOptions& options, BenchResult& result) {
+    result = BenchResult{backend.name, image.name, image.rows, image.cols, hasAlpha, casMode, threads, numaNodes, fast};
+    // the 16K inputs need several GB
+    try {
+        output.resize(static_cast<std::size_t>(image.rows) * image.cols * (hasAlpha ? 4 : 3));
+        CAS_supplyImage(casObj, image.rgba.data(), hasAlpha, image.rows, image.cols);
+    } catch (const std::exception&) { return false; }
+    const auto sharpen = [&](unsigned char* target) { return CAS_sharpenImageInto(casObj, casMode, 0.5f, 1.0f, target, 0) == CAS_STATUS_OK; };
+    if (CAS_setPrecision(casObj, fast ? CAS_PRECISION_FAST : CAS_PRECISION_EXACT) != CAS_STATUS_OK)
+        return false;
+    // warm-up: first touch of the buffers, kernel compilation/loading
+    if (!sharpen(output.data()))
+        return false;
+    std::vector<double> samples;
+    const auto start = Clock::now();
+    while (static_cast<int>(samples.size()) < options.minIterations || std::chrono::duration<double>(Clock::now() - start).count() < options.minSeconds) {
+        const auto callStart = Clock::now();
+        if (!sharpen(output.data()))
+            return false;
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - callStart).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    result.iterations = static_cast<int>(samples.size());
+    result.medianNs = samples[samples.size() / 2];
+    result.minNs = samples.front();
+    if (!fast)
+        return true;
+
+    // accuracy of the fast tier: largest difference to the exact output of the same image
+    try {
+        reference.resize(output.size());
+    } catch (const std::exception&) { return false; }
+    CAS_setPrecision(casObj, CAS_PRECISION_EXACT);
+    const bool valid = sharpen(reference.data());
+    for (std::size_t i = 0; valid && i < output.size(); i++)
+        result.maxError = std::max(result.maxError, std::abs(output[i] - reference[i]));
+    return valid;
+}
+
+bool BenchSession::tune(const BenchImage& image, const bool hasAlpha, const int casMode, CASTuning& tuning) {
+    try {
+        CAS_supplyImage(casObj, image.rgba.data(), hasAlpha, image.rows, image.cols);
+    } catch (const std::exception&) { return false; }
+    return CAS_setPrecision(casObj, CAS_PRECISION_EXACT) == CAS_STATUS_OK && CAS_autoTune(casObj, casMode, &tuning) == CAS_STATUS_OK;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "CASLibWrapper.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// interleaved RGBA input of a benchmark case
+struct BenchImage {
+    std::string name;
+    unsigned int rows = 0, cols = 0;
+    std::vector<unsigned char> rgba;
+
+    // deterministic content with edges, gradients and noise, so that every code path of the kernel is exercised
+    static BenchImage synthetic(const std::string& name, const unsigned int rows, const unsigned int cols);
+};
+
+// an engine and kernel variant, selected through the CAS_BACKEND / CAS_CPU_ISA environment variables of the library
+struct BenchBackend {
+    std::string name;
+    std::string backendVariable, isaVariable;
+    bool cpu = false;
+
+    // the variants available on this machine, best CPU instruction set first
+    static std::vector<BenchBackend> available();
+};
+
+struct BenchOptions {
+    // each case runs at least minIterations times and at least minSeconds (after one warm-up call)
+    double minSeconds = 0.5;
+    int minIterations = 3;
+};
+
+struct BenchResult {
+    std::string backend, image;
+    unsigned int rows = 0, cols = 0;
+    bool hasAlpha = false;
+    int casMode = 1;
+    // threads of the CPU engine, 0 for the HIP engine
+    unsigned int threads = 0;
+    // NUMA nodes of the CPU engine (CAS_setNumaNodes), 0: NUMA mode off
+    unsigned int numaNodes = 0;
+    // fast precision tier of the CPU engine, and its largest difference to the exact tier output (LSB)
+    bool fast = false;
+    int maxError = 0;
+    int iterations = 0;
+    // duration of one sharpen call
+    double medianNs = 0.0, minNs = 0.0;
+
+    double pixels() const { return static_cast<double>(rows) * cols; }
+    double megapixelsPerSecond() const { return pixels() / medianNs * 1e3; }
+    double nsPerPixel() const { return medianNs / pixels(); }
+    // bytes read and written per pixel by one call (RGBA input, RGB(A) output): the minimum memory traffic of the kernel
+    double bytesPerPixel() const { return 4.0 + (hasAlpha ? 4.0 : 3.0); }
+    double gigabytesPerSecond() const { return bytesPerPixel() / nsPerPixel(); }
+    // identifies the case across runs (baseline comparison)
+    std::string key() const;
+};
+
+// One CAS instance of a backend variant with a given thread count (0 = default) or NUMA mode (0 = off), runs the cases of the images
+class BenchSession final {
+  private:
+    void* casObj = nullptr;
+    const BenchBackend backend;
+    unsigned int threads, numaNodes = 0;
+    // output buffers, reused across the cases
+    std::vector<unsigned char> output, reference;
+
+  public:
+    BenchSession(const BenchBackend& backend, const unsigned int threads, const unsigned int numaNodes = 0);
+    ~BenchSession();
+
+    BenchSession(const BenchSession&) = delete;
+    BenchSession& operator=(const BenchSession&) = delete;
+    BenchSession(BenchSession&&) = delete;
+    BenchSession& operator=(BenchSession&&) = delete;
+
+    bool valid() const { return casObj != nullptr; }
+    // time the sharpening of one image with the given template instantiation (hasAlpha x casMode) and precision tier, false if the engine failed
+    // the fast tier is also checked against the exact tier output
+    bool run(const BenchImage& image, const bool hasAlpha, const int casMode, const bool fast, const BenchOptions& options, BenchResult& result);
+    // tune the launch parameters of the engine on one image (CAS_autoTune, exact tier), saved in the tuning profile; false if the engine failed or the profile can not be written
+    bool tune(const BenchImage& image, const bool hasAlpha, const int casMode, CASTuning& tuning);
+};
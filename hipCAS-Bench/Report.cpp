@@ -0,0 +1,71 @@
+#include "Report.hpp"
+#include "CASLibWrapper.h"
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSysInfo>
+#include <thread>
+
+namespace bench_report {
+bool write(const QString& path, const std::vector<BenchResult>& results) {
+    QJsonObject machine;
+    machine["cpu"] = QSysInfo::currentCpuArchitecture();
+    machine["os"] = QSysInfo::prettyProductName();
+    machine["hardwareThreads"] = static_cast<int>(std::thread::hardware_concurrency());
+    machine["numaNodes"] = static_cast<int>(CAS_getNumaNodeCount());
+    machine["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    QJsonArray cases;
+    for (const BenchResult& result : results) {
+        QJsonObject item;
+        item["key"] = QString::fromStdString(result.key());
+        item["backend"] = QString::fromStdString(result.backend);
+        item["image"] = QString::fromStdString(result.image);
+        item["rows"] = static_cast<int>(result.rows);
+        item["cols"] = static_cast<int>(result.cols);
+        item["hasAlpha"] = result.hasAlpha;
+        item["casMode"] = result.casMode == 0 ? "planar" : "interleaved";
+        item["threads"] = static_cast<int>(result.threads);
+        item["numaNodes"] = static_cast<int>(result.numaNodes);
+        item["precision"] = result.fast ? "fast" : "exact";
+        if (result.fast)
+            item["maxErrorLsb"] = result.maxError;
+        item["iterations"] = result.iterations;
+        item["medianNs"] = result.medianNs;
+        item["minNs"] = result.minNs;
+        item["mpPerSecond"] = result.megapixelsPerSecond();
+        item["nsPerPixel"] = result.nsPerPixel();
+        item["bytesPerPixel"] = result.bytesPerPixel();
+        item["gbPerSecond"] = result.gigabytesPerSecond();
+        cases.append(item);
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(QJsonDocument(QJsonObject{{"machine", machine}, {"results", cases}}).toJson()) >= 0;
+}
+
+bool compare(const QString& baselinePath, const std::vector<BenchResult>& results, const double thresholdPercent, std::vector<BenchComparison>& comparisons) {
+    QFile file(baselinePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject())
+        return false;
+    QHash<QString, double> baseline;
+    for (const QJsonValue item : document.object()["results"].toArray())
+        baseline.insert(item["key"].toString(), item["mpPerSecond"].toDouble());
+    comparisons.clear();
+    for (const BenchResult& result : results) {
+        const auto it = baseline.constFind(QString::fromStdString(result.key()));
+        if (it == baseline.constEnd() || *it <= 0.0)
+            continue;
+        const double change = (result.megapixelsPerSecond() / *it - 1.0) * 100.0;
+        comparisons.push_back({result, *it, change, change < -thresholdPercent});
+    }
+    return true;
+}
+} // namespace bench_report
@@ -0,0 +1,21 @@
+#pragma once
+#include "Benchmark.hpp"
+#include <QString>
+#include <vector>
+
+// one case of the current run matched with the same case of a baseline report
+struct BenchComparison {
+    BenchResult current;
+    double baselineMegapixelsPerSecond;
+    // throughput change relative to the baseline, negative = slower
+    double changePercent;
+    bool regression;
+};
+
+// Machine-readable reports of a benchmark run: {"machine": {...}, "results": [{"key", "backend", "image", ..., "mpPerSecond", ...}]}
+namespace bench_report {
+bool write(const QString& path, const std::vector<BenchResult>& results);
+// match the results with the cases of a baseline report by key, a case slower by more than thresholdPercent is a regression
+// returns false if the baseline can not be read
+bool compare(const QString& baselinePath, const std::vector<BenchResult>& results, const double thresholdPercent, std::vector<BenchComparison>& comparisons);
+} // namespace bench_report
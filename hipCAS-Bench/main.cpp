@@ -0,0 +1,223 @@
+#include "Benchmark.hpp"
+#include "CASLibWrapper.h"
+#include "Report.hpp"
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QImage>
+#include <QStringList>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+// the sample images shipped with the GUI (copied next to the executable) and the synthetic inputs
+struct ImageSpec {
+    const char* name;
+    unsigned int rows, cols;
+    bool synthetic;
+};
+constexpr ImageSpec imageSpecs[]{{"512", 0, 0, false},   {"480p", 0, 0, false},      {"720p", 0, 0, false},     {"1080p", 0, 0, false},
+                                 {"4k", 0, 0, false},    {"8k", 4320, 7680, true},   {"16k", 8640, 15360, true}};
+
+bool loadImage(const ImageSpec& spec, const QString& samplesDir, BenchImage& image) {
+    if (spec.synthetic) {
+        image = BenchImage::synthetic(spec.name, spec.rows, spec.cols);
+        return true;
+    }
+    const QImage sample = QImage(QDir(samplesDir).filePath(QString(spec.name) + ".png")).convertToFormat(QImage::Format_RGBA8888);
+    if (sample.isNull())
+        return false;
+    image.name = spec.name;
+    image.rows = static_cast<unsigned int>(sample.height());
+    image.cols = static_cast<unsigned int>(sample.width());
+    image.rgba.resize(static_cast<std::size_t>(image.rows) * image.cols * 4);
+    for (unsigned int y = 0; y < image.rows; y++)
+        std::memcpy(image.rgba.data() + static_cast<std::size_t>(y) * image.cols * 4, sample.constScanLine(static_cast<int>(y)), static_cast<std::size_t>(image.cols) * 4);
+    return true;
+}
+
+void printResult(const BenchResult& r) {
+    char precision[16] = "exact";
+    if (r.fast)
+        std::snprintf(precision, sizeof(precision), "fast %d LSB", r.maxError);
+    char placement[16] = "";
+    if (r.numaNodes)
+        std::snprintf(placement, sizeof(placement), " %u nodes", r.numaNodes);
+    std::printf("%-11s %-11s %-6s %-4s %-11s %3u thr%s  %9.1f MP/s  %8.3f ns/px  %2.0f B/px  %7.2f GB/s  (%d runs)\n", r.backend.c_str(), precision, r.image.c_str(),
+                r.hasAlpha ? "rgba" : "rgb", r.casMode == 0 ? "planar" : "interleaved", r.threads, placement, r.megapixelsPerSecond(), r.nsPerPixel(), r.bytesPerPixel(), r.gigabytesPerSecond(),
+                r.iterations);
+    std::fflush(stdout);
+}
+
+void printTuning(const BenchBackend& backend, const ImageSpec& spec, const bool hasAlpha, const int casMode, const CASTuning& tuning) {
+    char parameters[48];
+    if (backend.cpu)
+        std::snprintf(parameters, sizeof(parameters), "%u x %u tiles, %u thr", tuning.tileRows, tuning.tileCols, tuning.threads);
+    else
+        std::snprintf(parameters, sizeof(parameters), "%u x %u blocks", tuning.blockX, tuning.blockY);
+    std::printf("%-11s %-6s %-4s %-11s tuned: %-28s %9.1f MP/s\n", backend.name.c_str(), spec.name, hasAlpha ? "rgba" : "rgb", casMode == 0 ? "planar" : "interleaved", parameters,
+                tuning.megapixelsPerSecond);
+    std::fflush(stdout);
+}
+
+// thread counts of a scaling curve: powers of two up to the hardware threads, and the hardware threads
+std::vector<unsigned int> threadCounts() {
+    const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> counts;
+    for (unsigned int threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+    return counts;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cas-bench");
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark every hipCAS engine and kernel variant over the sample images and synthetic 8K/16K inputs");
+    parser.addHelpOption();
+    const QCommandLineOption samplesOption("samples", "Directory of the sample images (default: samples next to the executable).", "dir");
+    const QCommandLineOption imagesOption("images", "Comma separated images to run (default: 512,480p,720p,1080p,4k,8k,16k).", "list");
+    const QCommandLineOption backendsOption("backends", "Comma separated variants to run, e.g. hip,cpu-avx2 (default: every variant available).", "list");
+    const QCommandLineOption minTimeOption("min-time", "Minimum measuring time per case in seconds (default 0.5).", "seconds", "0.5");
+    const QCommandLineOption iterationsOption("iterations", "Minimum number of timed calls per case (default 3).", "count", "3");
+    const QCommandLineOption scalingImageOption("scaling-image", "Image of the CPU thread scaling curves (default 4k).", "name", "4k");
+    const QCommandLineOption noScalingOption("no-scaling", "Skip the CPU thread scaling curves.");
+    const QCommandLineOption numaImageOption("numa-image", "Image of the CPU NUMA scaling curve (default 16k).", "name", "16k");
+    const QCommandLineOption noNumaOption("no-numa", "Skip the CPU NUMA scaling curve.");
+    const QCommandLineOption noFastOption("no-fast", "Skip the fast (fixed point) precision tier of the CPU engine.");
+    const QCommandLineOption jsonOption("json", "Write the results as JSON to this file.", "file");
+    const QCommandLineOption baselineOption("baseline", "Compare the throughput with a JSON report of a previous run.", "file");
+    const QCommandLineOption thresholdOption("threshold", "Slowdown in percent flagged as a regression (default 5).", "percent", "5");
+    const QCommandLineOption tuneOption("tune", "Tune the launch parameters of every variant on the images instead (CAS_autoTune), saved in the tuning profile (zero: the default).");
+    parser.addOptions({samplesOption, imagesOption, backendsOption, minTimeOption, iterationsOption, scalingImageOption, noScalingOption, numaImageOption, noNumaOption,
+                       noFastOption, jsonOption, baselineOption, thresholdOption, tuneOption});
+    parser.process(app);
+
+    const QString samplesDir = parser.isSet(samplesOption) ? parser.value(samplesOption) : QDir(QCoreApplication::applicationDirPath()).filePath("samples");
+    const QStringList imageFilter = parser.value(imagesOption).split(',', Qt::SkipEmptyParts);
+    const QStringList backendFilter = parser.value(backendsOption).split(',', Qt::SkipEmptyParts);
+    BenchOptions options;
+    options.minSeconds = std::max(0.0, parser.value(minTimeOption).toDouble());
+    options.minIterations = std::max(1, parser.value(iterationsOption).toInt());
+    const QString scalingImage = parser.value(scalingImageOption);
+    const QString numaImage = parser.value(numaImageOption);
+
+    std::vector<BenchBackend> backends;
+    for (const BenchBackend& backend : BenchBackend::available()) {
+        if (backendFilter.isEmpty() || backendFilter.contains(QString::fromStdString(backend.name)))
+            backends.push_back(backend);
+    }
+    if (backends.empty()) {
+        std::fprintf(stderr, "no engine variant to run\n");
+        return 1;
+    }
+
+    // every variant x every template instantiation (hasAlpha x casMode) x every precision tier of the variant x every image; one image is held in memory at a time
+    std::vector<BenchResult> results;
+    for (const ImageSpec& spec : imageSpecs) {
+        if (!imageFilter.isEmpty() && !imageFilter.contains(QLatin1String(spec.name)))
+            continue;
+        BenchImage image;
+        if (!loadImage(spec, samplesDir, image)) {
+            std::fprintf(stderr, "can not load the sample %s from %s\n", spec.name, qPrintable(samplesDir));
+            continue;
+        }
+        // tuning: every variant x every template instantiation, each one a profile entry of the resolution of the image
+        if (parser.isSet(tuneOption)) {
+            for (const BenchBackend& backend : backends) {
+                BenchSession session(backend, 0);
+                for (const bool hasAlpha : {false, true}) {
+                    for (const int casMode : {1, 0}) {
+                        CASTuning tuning{};
+                        if (session.valid() && session.tune(image, hasAlpha, casMode, tuning))
+                            printTuning(backend, spec, hasAlpha, casMode, tuning);
+                        else
+                            std::fprintf(stderr, "%s can not be tuned on %s\n", backend.name.c_str(), spec.name);
+                    }
+                }
+            }
+            continue;
+        }
+        for (const BenchBackend& backend : backends) {
+            BenchSession session(backend, 0);
+            if (!session.valid())
+                continue;
+            for (const bool fast : {false, true}) {
+                if (fast && (!backend.cpu || parser.isSet(noFastOption)))
+                    continue;
+                for (const bool hasAlpha : {false, true}) {
+                    for (const int casMode : {1, 0}) {
+                        BenchResult result;
+                        if (!session.run(image, hasAlpha, casMode, fast, options, result)) {
+                            std::fprintf(stderr, "%s failed on %s\n", backend.name.c_str(), spec.name);
+                            continue;
+                        }
+                        printResult(result);
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+
+        // thread scaling of each CPU variant: interleaved RGB output, the GUI's path
+        if (!parser.isSet(noScalingOption) && scalingImage == spec.name) {
+            for (const BenchBackend& backend : backends) {
+                if (!backend.cpu)
+                    continue;
+                for (const unsigned int threads : threadCounts()) {
+                    BenchSession session(backend, threads);
+                    BenchResult result;
+                    if (!session.valid() || !session.run(image, false, 1, false, options, result))
+                        continue;
+                    printResult(result);
+                    // the run with all threads is already part of the main table
+                    if (threads != std::max(1u, std::thread::hardware_concurrency()))
+                        results.push_back(result);
+                }
+            }
+        }
+
+        // NUMA mode of the best CPU variant on 1 to all nodes (node-local bands, pinned workers, first-touch buffers), to compare with its run in the main table
+        const auto bestCpu = std::find_if(backends.begin(), backends.end(), [](const BenchBackend& backend) { return backend.cpu; });
+        if (!parser.isSet(noNumaOption) && numaImage == spec.name && bestCpu != backends.end()) {
+            for (unsigned int nodes = 1; nodes <= CAS_getNumaNodeCount(); nodes++) {
+                BenchSession session(*bestCpu, 0, nodes);
+                BenchResult result;
+                if (!session.valid() || !session.run(image, false, 1, false, options, result))
+                    continue;
+                printResult(result);
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (parser.isSet(jsonOption) && !bench_report::write(parser.value(jsonOption), results)) {
+        std::fprintf(stderr, "can not write %s\n", qPrintable(parser.value(jsonOption)));
+        return 1;
+    }
+    if (!parser.isSet(baselineOption))
+        return 0;
+
+    // baseline comparison: the exit code is 2 if any case regressed beyond the threshold
+    const double threshold = parser.value(thresholdOption).toDouble();
+    std::vector<BenchComparison> comparisons;
+    if (!bench_report::compare(parser.value(baselineOption), results, threshold, comparisons)) {
+        std::fprintf(stderr, "can not read the baseline %s\n", qPrintable(parser.value(baselineOption)));
+        return 1;
+    }
+    int regressions = 0;
+    std::printf("\ncomparison with %s (threshold %.1f%%):\n", qPrintable(parser.value(baselineOption)), threshold);
+    for (const BenchComparison& comparison : comparisons) {
+        std::printf("%-45s %9.1f -> %9.1f MP/s  %+6.1f%%%s\n", comparison.current.key().c_str(), comparison.baselineMegapixelsPerSecond, comparison.current.megapixelsPerSecond(),
+                    comparison.changePercent, comparison.regression ? "  REGRESSION" : "");
+        regressions += comparison.regression;
+    }
+    std::printf("%zu cases compared, %d regressions\n", comparisons.size(), regressions);
+    return regressions ? 2 : 0;
+}
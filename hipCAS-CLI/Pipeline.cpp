@@ -0,0 +1,210 @@
+#include "bounded_queue.hpp"
+#include "CASLibWrapper.h"
+#include "Pipeline.hpp"
+#include <QBuffer>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct DecodedImage {
+    qsizetype index;
+    QImage image;
+    // CASPixelFormat of image, CASSampleFormat and QImage format of the output
+    int pixelFormat;
+    int sampleFormat;
+    QImage::Format outputFormat;
+    bool hasAlpha;
+};
+
+struct SharpenedImage {
+    qsizetype index;
+    QImage image;
+};
+
+// accumulates the busy time of a stage across its threads
+class StageTimer {
+  private:
+    std::atomic<long long> nanoseconds{0};
+
+  public:
+    template <class F>
+    auto measure(F&& work) {
+        const auto start = Clock::now();
+        auto result = work();
+        nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        return result;
+    }
+    double seconds() const { return nanoseconds.load() * 1e-9; }
+};
+
+// the image in a format CAS reads natively, converted only when it has none (e.g. indexed, premultiplied or 16-bit gray images)
+// 16-bit and float images keep their precision: they are read as RGBA (opaque for RGBX) and written to an output of the same sample type
+DecodedImage casInput(const qsizetype index, const QImage& image) {
+    // a file that did not decode (or a failed conversion)
+    if (image.isNull())
+        return {index, image, CAS_FORMAT_RGBA8, CAS_SAMPLE_SRGB8, QImage::Format_Invalid, false};
+    const bool hasAlpha = image.hasAlphaChannel();
+    const QImage::Format output8 = hasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888;
+    switch (image.format()) {
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888: return {index, image, CAS_FORMAT_RGBA8, CAS_SAMPLE_SRGB8, output8, hasAlpha};
+    case QImage::Format_RGB888: return {index, image, CAS_FORMAT_RGB8, CAS_SAMPLE_SRGB8, output8, false};
+    case QImage::Format_BGR888: return {index, image, CAS_FORMAT_BGR8, CAS_SAMPLE_SRGB8, output8, false};
+    case QImage::Format_Grayscale8: return {index, image, CAS_FORMAT_GRAY8, CAS_SAMPLE_SRGB8, output8, false};
+    // 32-bit ARGB words are BGRA in memory on little-endian hosts
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32:
+        if (Q_BYTE_ORDER == Q_LITTLE_ENDIAN)
+            return {index, image, CAS_FORMAT_BGRA8, CAS_SAMPLE_SRGB8, output8, hasAlpha};
+        break;
+    case QImage::Format_RGBA64:
+    case QImage::Format_RGBX64: return {index, image, CAS_FORMAT_RGBA16, CAS_SAMPLE_UNORM16, image.format(), true};
+    case QImage::Format_RGBA16FPx4:
+    case QImage::Format_RGBX16FPx4: return {index, image, CAS_FORMAT_RGBA16F, CAS_SAMPLE_HALF, image.format(), true};
+    case QImage::Format_RGBA32FPx4:
+    case QImage::Format_RGBX32FPx4: return {index, image, CAS_FORMAT_RGBA32F, CAS_SAMPLE_FLOAT, image.format(), true};
+    case QImage::Format_RGBA64_Premultiplied: return casInput(index, image.convertToFormat(QImage::Format_RGBA64));
+    case QImage::Format_RGBA16FPx4_Premultiplied: return casInput(index, image.convertToFormat(QImage::Format_RGBA16FPx4));
+    case QImage::Format_RGBA32FPx4_Premultiplied: return casInput(index, image.convertToFormat(QImage::Format_RGBA32FPx4));
+    default: break;
+    }
+    // more than 8 bits per channel (e.g. 16-bit gray, 10-bit RGB): 16-bit RGBA
+    if (image.depth() > 32 || image.format() == QImage::Format_Grayscale16 || image.pixelFormat().redSize() > 8)
+        return casInput(index, image.convertToFormat(hasAlpha ? QImage::Format_RGBA64 : QImage::Format_RGBX64));
+    return casInput(index, image.convertToFormat(hasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888));
+}
+} // namespace
+
+// output file: <outputDir or input dir>/<base name><suffix>.<format or input extension>
+QString Pipeline::outputPath(const QString& inputPath) const {
+    const QFileInfo input(inputPath);
+    const QString dir = options.outputDir.isEmpty() ? input.absolutePath() : options.outputDir;
+    const QString extension = options.format.isEmpty() ? input.suffix() : options.format;
+    return QDir(dir).filePath(input.completeBaseName() + options.suffix + "." + extension);
+}
+
+// read an image through a memory mapping of the file (no intermediate file buffer), with the same EXIF orientation handling as the GUI
+QImage Pipeline::decodeFile(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+    uchar* mapped = file.size() > 0 ? file.map(0, file.size()) : nullptr;
+    // fall back to a plain read where the file can not be mapped
+    QByteArray bytes = mapped ? QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), file.size()) : file.readAll();
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    QImage image = reader.read();
+    if (mapped)
+        file.unmap(mapped);
+    return image;
+}
+
+PipelineStats Pipeline::run(const QStringList& files) {
+    PipelineStats stats;
+    BoundedQueue<DecodedImage> decoded(options.queueCapacity);
+    BoundedQueue<SharpenedImage> sharpened(options.queueCapacity);
+    StageTimer decodeTimer, sharpenTimer, encodeTimer;
+    std::atomic<qsizetype> nextFile{0};
+    std::atomic<int> activeDecoders{std::max(1, options.decodeThreads)}, failures{0};
+    std::atomic<long long> pixels{0};
+    const auto start = Clock::now();
+
+    // decode stage: each thread takes the next file, the last one to finish closes the queue
+    std::vector<std::jthread> decoders;
+    for (int i = 0; i < std::max(1, options.decodeThreads); i++) {
+        decoders.emplace_back([&] {
+            qsizetype index;
+            while ((index = nextFile++) < files.size()) {
+                DecodedImage item = decodeTimer.measure([&] { return casInput(index, decodeFile(files[index])); });
+                if (item.image.isNull()) {
+                    std::fprintf(stderr, "failed to decode %s\n", qPrintable(files[index]));
+                    failures++;
+                    continue;
+                }
+                decoded.push(std::move(item));
+            }
+            if (--activeDecoders == 0)
+                decoded.close();
+        });
+    }
+
+    // encode stage
+    std::vector<std::jthread> encoders;
+    for (int i = 0; i < std::max(1, options.encodeThreads); i++) {
+        encoders.emplace_back([&] {
+            while (auto item = sharpened.pop()) {
+                const QString path = outputPath(files[item->index]);
+                const bool written = encodeTimer.measure([&] {
+                    QImageWriter writer(path);
+                    if (options.quality >= 0)
+                        writer.setQuality(options.quality);
+                    return writer.write(item->image);
+                });
+                if (!written) {
+                    std::fprintf(stderr, "failed to write %s\n", qPrintable(path));
+                    failures++;
+                }
+            }
+        });
+    }
+
+    // sharpen stage, on this thread: one CAS instance, the engine itself uses all cores (or the GPU)
+    void* casObj = CAS_initialize();
+    while (auto item = decoded.pop()) {
+        QImage& input = item->image;
+        QImage output(input.size(), item->outputFormat);
+        const int status = sharpenTimer.measure([&] {
+            if (!casObj || output.isNull())
+                return static_cast<int>(CAS_STATUS_FAILED);
+            const int supplied = CAS_supplyImageFormat(casObj, input.constBits(), item->pixelFormat, static_cast<unsigned int>(input.bytesPerLine()), item->hasAlpha, input.height(),
+                                                       input.width());
+            if (supplied != CAS_STATUS_OK)
+                return supplied;
+            if (const int formatStatus = CAS_setOutputFormat(casObj, item->sampleFormat); formatStatus != CAS_STATUS_OK)
+                return formatStatus;
+            // casMode 1: interleaved RGB(A), written straight into the rows of the output image
+            return CAS_sharpenImageInto(casObj, 1, options.sharpenStrength, options.contrastAdaption, output.bits(), static_cast<unsigned int>(output.bytesPerLine()));
+        });
+        if (status != CAS_STATUS_OK) {
+            std::fprintf(stderr, "failed to sharpen %s\n", qPrintable(files[item->index]));
+            failures++;
+            continue;
+        }
+        pixels += static_cast<long long>(input.width()) * input.height();
+        sharpened.push(SharpenedImage{item->index, std::move(output)});
+    }
+    sharpened.close();
+    encoders.clear();
+    decoders.clear();
+    if (casObj) {
+        if (options.libraryStats) {
+            // the terminator goes to the null byte that follows the data of a QByteArray
+            stats.libraryStats.resize(static_cast<qsizetype>(CAS_getStatsJson(casObj, nullptr, 0)));
+            CAS_getStatsJson(casObj, stats.libraryStats.data(), static_cast<unsigned int>(stats.libraryStats.size()) + 1);
+        }
+        CAS_destroy(casObj);
+    }
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.failures = failures;
+    stats.images = static_cast<int>(files.size()) - stats.failures;
+    stats.megapixels = pixels.load() * 1e-6;
+    stats.decodeSeconds = decodeTimer.seconds();
+    stats.sharpenSeconds = sharpenTimer.seconds();
+    stats.encodeSeconds = encodeTimer.seconds();
+    return stats;
+}
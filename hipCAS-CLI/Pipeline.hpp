@@ -0,0 +1,53 @@
+#pragma once
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <cstddef>
+
+struct PipelineOptions {
+    float sharpenStrength = 1.0f;
+    float contrastAdaption = 1.0f;
+    // output directory, empty: next to each input file
+    QString outputDir;
+    // appended to the base name of the output files
+    QString suffix = "_cas";
+    // output format (file extension), empty: same as the input
+    QString format;
+    // encoder quality (0-100), -1: default of the format
+    int quality = -1;
+    // threads of the decode stage and of the encode stage
+    int decodeThreads = 2;
+    int encodeThreads = 2;
+    // images buffered between two stages
+    std::size_t queueCapacity = 4;
+    // collect the per stage counters of the library (CAS_getStatsJson)
+    bool libraryStats = false;
+};
+
+struct PipelineStats {
+    int images = 0;
+    int failures = 0;
+    double megapixels = 0.0;
+    double seconds = 0.0;
+    // time spent working in each stage, summed over its threads
+    double decodeSeconds = 0.0, sharpenSeconds = 0.0, encodeSeconds = 0.0;
+    // JSON counters of the CAS instance (libraryStats option)
+    QByteArray libraryStats;
+};
+
+// Batch sharpening pipeline: decode -> sharpen -> encode stages connected by bounded queues
+// decoding and encoding run on their own threads and overlap with the sharpening of the previous/next images
+class Pipeline final {
+  private:
+    const PipelineOptions options;
+
+    QString outputPath(const QString& inputPath) const;
+    static QImage decodeFile(const QString& path);
+
+  public:
+    explicit Pipeline(const PipelineOptions& options) : options(options) {}
+
+    // sharpen every file, blocks until the last one is written
+    PipelineStats run(const QStringList& files);
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking FIFO queue with a fixed capacity, connects two pipeline stages
+// push blocks while the queue is full (back pressure on the producer stage), pop blocks while it is empty
+// after close(), pop drains the remaining items and then returns nullopt
+template <class T>
+class BoundedQueue final {
+  private:
+    std::mutex mutex;
+    std::condition_variable notFull, notEmpty;
+    std::deque<T> items;
+    const std::size_t capacity;
+    bool closed = false;
+
+  public:
+    explicit BoundedQueue(const std::size_t capacity) : capacity(std::max<std::size_t>(1, capacity)) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+    BoundedQueue(BoundedQueue&&) = delete;
+    BoundedQueue& operator=(BoundedQueue&&) = delete;
+
+    // returns false if the queue was closed meanwhile (the item is dropped)
+    bool push(T item) {
+        std::unique_lock lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty())
+            return std::nullopt;
+        T item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return item;
+    }
+
+    // no more items will be pushed
+    void close() {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
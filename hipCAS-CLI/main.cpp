@@ -0,0 +1,93 @@
+#include "Pipeline.hpp"
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QStringList>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+// expand the inputs: files are taken as is, directories contribute their readable images, and patterns with wildcards are matched in their directory
+static QStringList collectInputs(const QStringList& inputs, const bool recursive) {
+    QStringList imageFilters;
+    for (const QByteArray& format : QImageReader::supportedImageFormats())
+        imageFilters << "*." + QString::fromLatin1(format);
+    QStringList files;
+    for (const QString& input : inputs) {
+        const QFileInfo info(input);
+        if (info.isDir()) {
+            QDirIterator it(input, imageFilters, QDir::Files, recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+            QStringList dirFiles;
+            while (it.hasNext())
+                dirFiles << it.next();
+            dirFiles.sort();
+            files << dirFiles;
+        } else if (input.contains('*') || input.contains('?') || input.contains('[')) {
+            // globs are not expanded by the Windows shell
+            for (const QFileInfo& match : QDir(info.path()).entryInfoList({info.fileName()}, QDir::Files, QDir::Name))
+                files << match.filePath();
+        } else if (info.isFile())
+            files << input;
+        else
+            std::fprintf(stderr, "no such file or directory: %s\n", qPrintable(input));
+    }
+    files.removeDuplicates();
+    return files;
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cas-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Sharpen images with Contrast Adaptive Sharpening (hipCAS)");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Image files, directories or wildcard patterns (e.g. photos/*.jpg).", "inputs...");
+    const QCommandLineOption sharpenOption({"s", "sharpen"}, "Sharpen strength (0-10, default 1).", "value", "1.0");
+    const QCommandLineOption contrastOption({"c", "contrast"}, "Contrast adaption (0-1, default 1).", "value", "1.0");
+    const QCommandLineOption outputOption({"o", "output"}, "Output directory (default: next to each input).", "dir");
+    const QCommandLineOption suffixOption("suffix", "Suffix of the output file names (default _cas).", "text", "_cas");
+    const QCommandLineOption formatOption({"f", "format"}, "Output format, e.g. png or jpg (default: same as the input).", "ext");
+    const QCommandLineOption qualityOption({"q", "quality"}, "Encoder quality 0-100 (default: format default).", "value", "-1");
+    const QCommandLineOption recursiveOption({"r", "recursive"}, "Search directories recursively.");
+    const QCommandLineOption jobsOption({"j", "jobs"}, "Threads of the decode stage and of the encode stage (default: half the hardware threads).", "count");
+    const QCommandLineOption queueOption("queue", "Images buffered between two stages (default 4).", "count", "4");
+    const QCommandLineOption statsOption("stats", "Print the per stage counters of the library (JSON) at the end.");
+    parser.addOptions({sharpenOption, contrastOption, outputOption, suffixOption, formatOption, qualityOption, recursiveOption, jobsOption, queueOption, statsOption});
+    parser.process(app);
+
+    const QStringList files = collectInputs(parser.positionalArguments(), parser.isSet(recursiveOption));
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "no input images\n");
+        parser.showHelp(1);
+    }
+
+    PipelineOptions options;
+    options.sharpenStrength = std::clamp(parser.value(sharpenOption).toFloat(), 0.0f, 10.0f);
+    options.contrastAdaption = std::clamp(parser.value(contrastOption).toFloat(), 0.0f, 1.0f);
+    options.outputDir = parser.value(outputOption);
+    options.suffix = parser.value(suffixOption);
+    options.format = parser.value(formatOption);
+    options.quality = parser.value(qualityOption).toInt();
+    const int jobs = parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : static_cast<int>(std::thread::hardware_concurrency() / 2);
+    options.decodeThreads = options.encodeThreads = std::max(1, jobs);
+    options.queueCapacity = static_cast<std::size_t>(std::max(1, parser.value(queueOption).toInt()));
+    options.libraryStats = parser.isSet(statsOption);
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        std::fprintf(stderr, "can not create the output directory %s\n", qPrintable(options.outputDir));
+        return 1;
+    }
+
+    // run the pipeline and print the aggregate throughput
+    const PipelineStats stats = Pipeline(options).run(files);
+    std::printf("%d images (%d failed), %.1f MP in %.2f s: %.2f images/s, %.1f MP/s\n", stats.images, stats.failures, stats.megapixels, stats.seconds,
+                stats.images / std::max(stats.seconds, 1e-9), stats.megapixels / std::max(stats.seconds, 1e-9));
+    std::printf("busy time per stage: decode %.2f s, sharpen %.2f s, encode %.2f s\n", stats.decodeSeconds, stats.sharpenSeconds, stats.encodeSeconds);
+    if (options.libraryStats)
+        std::printf("library: %s\n", stats.libraryStats.constData());
+    return stats.failures ? 1 : 0;
+}
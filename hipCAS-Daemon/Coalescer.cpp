@@ -0,0 +1,80 @@
+#include "Coalescer.hpp"
+#include "CASLibWrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <vector>
+
+Coalescer::Coalescer(void* casContext, const CoalescerOptions& options) : options(options), session(CAS_createSession(casContext)) {
+    if (!session)
+        throw std::runtime_error("can not create the batch session");
+    dispatcher = std::jthread([this](std::stop_token stopToken) { dispatch(stopToken); });
+}
+
+// the connections are gone: nothing is queued anymore
+Coalescer::~Coalescer() {
+    {
+        std::lock_guard lock(mutex);
+        dispatcher.request_stop();
+    }
+    queued.notify_all();
+    dispatcher.join();
+    CAS_destroy(session);
+}
+
+int Coalescer::sharpen(CASImageDesc& image, const int precision) {
+    Pending request{&image, precision, false};
+    std::unique_lock lock(mutex);
+    pending.push_back(&request);
+    queued.notify_one();
+    completed.wait(lock, [&] { return request.done; });
+    return image.status;
+}
+
+void Coalescer::dispatch(std::stop_token stopToken) {
+    std::unique_lock lock(mutex);
+    while (true) {
+        queued.wait(lock, [&] { return stopToken.stop_requested() || !pending.empty(); });
+        if (pending.empty())
+            return;
+        const auto ready = [&] {
+            return stopToken.stop_requested() || pending.size() >= options.maxImages || pending.size() >= clients.load(std::memory_order_relaxed);
+        };
+        queued.wait_for(lock, options.window, ready);
+        const std::size_t count = std::min<std::size_t>(pending.size(), options.maxImages);
+        const std::vector<Pending*> batch(pending.begin(), pending.begin() + count);
+        pending.erase(pending.begin(), pending.begin() + count);
+        lock.unlock();
+        sharpenBatch(batch);
+        lock.lock();
+        for (Pending* request : batch)
+            request->done = true;
+        completed.notify_all();
+    }
+}
+
+// one CAS_sharpenBatch per precision tier of the batch (the tier is a setting of the session)
+void Coalescer::sharpenBatch(const std::vector<Pending*>& batch) {
+    std::map<int, std::vector<Pending*>> tiers;
+    for (Pending* request : batch)
+        tiers[request->precision].push_back(request);
+    std::vector<CASImageDesc> descriptors;
+    for (const auto& [precision, requests] : tiers) {
+        descriptors.clear();
+        for (const Pending* request : requests)
+            descriptors.push_back(*request->image);
+        if (CAS_setPrecision(session, precision) != CAS_STATUS_OK) {
+            for (Pending* request : requests)
+                request->image->status = CAS_STATUS_INVALID_ARGUMENT;
+            continue;
+        }
+        CAS_sharpenBatch(session, descriptors.data(), static_cast<unsigned int>(descriptors.size()));
+        for (std::size_t i = 0; i < requests.size(); i++)
+            *requests[i]->image = descriptors[i];
+    }
+    batches.fetch_add(1, std::memory_order_relaxed);
+    images.fetch_add(batch.size(), std::memory_order_relaxed);
+}
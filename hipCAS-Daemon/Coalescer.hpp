@@ -0,0 +1,64 @@
+#pragma once
+#include "CASLibWrapper.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+struct CoalescerOptions {
+    // images up to this many pixels are coalesced, larger ones are sharpened by the session of their connection
+    unsigned long long smallPixels = 512 * 512;
+    // images of one batch
+    unsigned int maxImages = 32;
+    // how long the first queued image waits for others (0: only the ones already queued)
+    std::chrono::microseconds window{200};
+};
+
+// Gathers the small whole-image calls of all connections into batches sharpened by one session (CAS_sharpenBatch): the engine spreads a batch
+// over its thread pool at once instead of running many short calls one after the other, each with its own start and end of the parallel work
+// A batch starts when it is full, when every connected client has an image queued, or when its first image has waited for the window
+class Coalescer final {
+  private:
+    struct Pending {
+        CASImageDesc* image;
+        int precision;
+        bool done;
+    };
+
+    const CoalescerOptions options;
+    void* session;
+    std::mutex mutex;
+    std::condition_variable queued, completed;
+    std::vector<Pending*> pending;
+    std::atomic<unsigned int> clients{0};
+    std::atomic<unsigned long long> batches{0}, images{0};
+    std::jthread dispatcher;
+
+    void dispatch(std::stop_token stopToken);
+    void sharpenBatch(const std::vector<Pending*>& batch);
+
+  public:
+    // a session of the daemon's context, throws std::runtime_error when it can not be created
+    Coalescer(void* casContext, const CoalescerOptions& options);
+    ~Coalescer();
+
+    Coalescer(const Coalescer& other) = delete;
+    Coalescer(Coalescer&& other) noexcept = delete;
+    Coalescer& operator=(Coalescer&& other) noexcept = delete;
+    Coalescer& operator=(const Coalescer& other) = delete;
+
+    // whether an image is small enough to be coalesced
+    bool accepts(const unsigned int rows, const unsigned int cols) const { return static_cast<unsigned long long>(rows) * cols <= options.smallPixels; }
+    // sharpen an image (a CASImageDesc of CAS_sharpenBatch, in the CASPrecision tier) with the next batch, blocks until it is done. Returns its CASStatus
+    int sharpen(CASImageDesc& image, const int precision);
+
+    // connected clients, the batches do not wait for more images than there are clients
+    void addClient() { clients.fetch_add(1, std::memory_order_relaxed); }
+    void removeClient() { clients.fetch_sub(1, std::memory_order_relaxed); }
+
+    unsigned long long batchCount() const { return batches.load(std::memory_order_relaxed); }
+    unsigned long long imageCount() const { return images.load(std::memory_order_relaxed); }
+};
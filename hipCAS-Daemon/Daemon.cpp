@@ -0,0 +1,339 @@
+#include "CASLibWrapper.h"
+#include "Daemon.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace cas_remote;
+
+// rows of stride bytes at offset inside a segment (the product can not overflow)
+static bool containsRows(const remote_utils::SharedMapping& segment, const unsigned long long offset, const unsigned long long stride, const unsigned long long rows) {
+    unsigned long long bytes;
+    return !__builtin_mul_overflow(stride, rows, &bytes) && segment.data() && segment.contains(offset, bytes);
+}
+
+// bytes of one 8-bit output row of a batch image or stream
+static unsigned long long rowBytes8(const bool hasAlpha, const int casMode, const unsigned int cols) {
+    return casMode == 0 ? cols : static_cast<unsigned long long>(cols) * (hasAlpha ? 4 : 3);
+}
+
+Connection::Connection(const int socket, Coalescer& coalescer, void* casContext, const std::string& engineName)
+    : socket(socket), coalescer(coalescer), context(casContext), engineName(engineName) {
+    coalescer.addClient();
+}
+
+Connection::~Connection() {
+    coalescer.removeClient();
+    if (stream)
+        CAS_streamEnd(stream);
+    if (session)
+        CAS_destroy(session);
+}
+
+// sessions are cheap, a client that only coalesces or streams never needs one
+void* Connection::casSession() {
+    if (!session)
+        session = CAS_createSession(context);
+    return session;
+}
+
+// supply the image of the input segment to the session unless it already has this version: a frame of the same shape replaces the pixels only
+int Connection::upload(const Image& image) {
+    if (image.version == 0 || image.stride == 0 || image.stride > UINT_MAX || !containsRows(segments[SEGMENT_INPUT], 0, image.stride, imageRows(image)))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    if (image.version == uploaded.version)
+        return CAS_STATUS_OK;
+    const unsigned int stride = static_cast<unsigned int>(image.stride);
+    const bool sameShape = uploaded.version != 0 && image.rows == uploaded.rows && image.cols == uploaded.cols && image.pixelFormat == uploaded.pixelFormat &&
+                           image.hasAlpha == uploaded.hasAlpha;
+    const int status = sameShape ? CAS_supplyFrame(session, segments[SEGMENT_INPUT].data(), stride)
+                                 : CAS_supplyImageFormat(session, segments[SEGMENT_INPUT].data(), image.pixelFormat, stride, image.hasAlpha, image.rows, image.cols);
+    uploaded = status == CAS_STATUS_OK ? image : Image{};
+    return status;
+}
+
+// the output rows of a call (width x height pixels) at its offset and stride in the output segment, the library checks that the stride holds a row
+bool Connection::containsOutput(const Request& request, const bool hasAlpha, const unsigned int width, const unsigned int height) const {
+    return width > 0 && request.outputStride > 0 && request.outputStride <= UINT_MAX &&
+           containsRows(segments[SEGMENT_OUTPUT], request.outputOffset, request.outputStride, outputRows(hasAlpha, request.casMode, height));
+}
+
+// the other calls writing into the output segment (or replacing it) overwrite the frame the sequence mode keeps there for the next whole image call
+void Connection::overwriteOutput() {
+    if (sequenceTile > 0 && session)
+        CAS_invalidateCache(session);
+}
+
+// the client sizes its segments, sealed so that they can not shrink under the mapping
+int Connection::map(const Request& request, const int receivedFd) {
+    if (receivedFd < 0)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    int status = CAS_STATUS_INVALID_ARGUMENT;
+    if (request.segment < SEGMENT_COUNT && request.value > 0 && remote_utils::holdsSharedMemory(receivedFd, request.value))
+        status = segments[request.segment].map(receivedFd, request.value) ? CAS_STATUS_OK : CAS_STATUS_FAILED;
+    close(receivedFd);
+    return status;
+}
+
+// small packed RGBA images with the default settings go to the next batch, the others are sharpened by the session of the connection
+int Connection::sharpen(const Request& request, Reply& reply) {
+    const Image& image = request.image;
+    if (image.version == 0 || (request.casMode != 0 && request.casMode != 1) || !containsOutput(request, image.hasAlpha, image.cols, image.rows))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    unsigned char* output = segments[SEGMENT_OUTPUT].data() + request.outputOffset;
+    const bool packed = image.pixelFormat == CAS_FORMAT_RGBA8 && image.stride == static_cast<unsigned long long>(image.cols) * 4 &&
+                        request.outputStride == rowBytes8(image.hasAlpha, request.casMode, image.cols);
+    if (packed && sampleFormat == CAS_SAMPLE_SRGB8 && cacheBudget == 0 && numaNodes == 0 && sequenceTile == 0 && coalescer.accepts(image.rows, image.cols) &&
+        containsRows(segments[SEGMENT_INPUT], 0, image.stride, image.rows)) {
+        CASImageDesc desc{segments[SEGMENT_INPUT].data(), output, image.rows, image.cols, image.hasAlpha, request.casMode, request.sharpenStrength, request.contrastAdaption,
+                          CAS_STATUS_FAILED, 0.0};
+        return coalescer.sharpen(desc, precision);
+    }
+    if (const int status = upload(image); status != CAS_STATUS_OK)
+        return status;
+    const int status = CAS_sharpenImageInto(session, request.casMode, request.sharpenStrength, request.contrastAdaption, output, static_cast<unsigned int>(request.outputStride));
+    if (status == CAS_STATUS_OK && sequenceTile > 0) {
+        CASStats stats;
+        CAS_getStats(session, &stats);
+        reply.value = stats.lastSequenceTiles;
+        reply.skippedTiles = static_cast<unsigned int>(stats.lastSkippedTiles);
+    }
+    return status;
+}
+
+// the descriptors are copied before they are checked: the client can not change them meanwhile
+int Connection::sharpenBatch(const Request& request) {
+    remote_utils::SharedMapping& segment = segments[SEGMENT_OUTPUT];
+    if (request.count == 0 || !containsRows(segment, request.outputOffset, sizeof(BatchImage), request.count))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    std::vector<BatchImage> batch(request.count);
+    std::memcpy(batch.data(), segment.data() + request.outputOffset, sizeof(BatchImage) * batch.size());
+    std::vector<CASImageDesc> images(batch.size());
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        const BatchImage& image = batch[i];
+        const bool valid = (image.casMode == 0 || image.casMode == 1) && containsRows(segment, image.inputOffset, static_cast<unsigned long long>(image.cols) * 4, image.rows) &&
+                           containsRows(segment, image.outputOffset, rowBytes8(image.hasAlpha, image.casMode, image.cols), outputRows(image.hasAlpha, image.casMode, image.rows));
+        // null buffers: the library reports an invalid image
+        images[i] = {valid ? segment.data() + image.inputOffset : nullptr, valid ? segment.data() + image.outputOffset : nullptr, image.rows, image.cols, image.hasAlpha,
+                     image.casMode, image.sharpenStrength, image.contrastAdaption, CAS_STATUS_FAILED, 0.0};
+    }
+    CAS_sharpenBatch(session, images.data(), request.count);
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        batch[i].status = images[i].status;
+        batch[i].elapsedMs = images[i].elapsedMs;
+    }
+    std::memcpy(segment.data() + request.outputOffset, batch.data(), sizeof(BatchImage) * batch.size());
+    return CAS_STATUS_OK;
+}
+
+int Connection::set(const Request& request, Reply& reply) {
+    switch (request.setting) {
+    case SET_PRECISION: {
+        const int status = CAS_setPrecision(session, static_cast<int>(request.value));
+        if (status == CAS_STATUS_OK)
+            precision = static_cast<int>(request.value);
+        return status;
+    }
+    case SET_OUTPUT_FORMAT: {
+        const int status = CAS_setOutputFormat(session, static_cast<int>(request.value));
+        if (status == CAS_STATUS_OK)
+            sampleFormat = static_cast<int>(request.value);
+        return status;
+    }
+    case SET_TILE_SIZE: CAS_setTileSize(session, request.height, request.width); return CAS_STATUS_OK;
+    case SET_CACHE_BUDGET:
+        CAS_setCacheBudget(session, request.value);
+        cacheBudget = request.value;
+        return CAS_STATUS_OK;
+    case SET_NUMA_NODES:
+        reply.value = CAS_setNumaNodes(session, static_cast<unsigned int>(std::min<unsigned long long>(request.value, UINT_MAX)));
+        numaNodes = request.value;
+        return CAS_STATUS_OK;
+    case SET_SEQUENCE_MODE: {
+        const int status = request.value <= UINT_MAX ? CAS_setSequenceMode(session, static_cast<unsigned int>(request.value)) : CAS_STATUS_INVALID_ARGUMENT;
+        if (status == CAS_STATUS_OK)
+            sequenceTile = request.value;
+        return status;
+    }
+    default: return CAS_STATUS_INVALID_ARGUMENT;
+    }
+}
+
+// a new stream ends the previous one of the connection, the rows are packed at the start of the segments
+int Connection::streamCall(const Request& request, Reply& reply) {
+    switch (request.op) {
+    case OP_STREAM_BEGIN:
+        if (stream)
+            CAS_streamEnd(stream);
+        stream = CAS_streamBegin(request.height, request.width, request.image.hasAlpha, request.casMode, request.sharpenStrength, request.contrastAdaption);
+        streamCols = request.width;
+        streamAlpha = request.image.hasAlpha != 0;
+        streamMode = request.casMode;
+        return stream ? CAS_STATUS_OK : CAS_STATUS_INVALID_ARGUMENT;
+    case OP_STREAM_PUSH:
+        if (!stream || !containsRows(segments[SEGMENT_INPUT], 0, static_cast<unsigned long long>(streamCols) * 4, request.count))
+            return CAS_STATUS_INVALID_ARGUMENT;
+        reply.value = CAS_streamPush(stream, segments[SEGMENT_INPUT].data(), request.count, 0);
+        return CAS_STATUS_OK;
+    default:
+        if (!stream || !containsRows(segments[SEGMENT_OUTPUT], 0, rowBytes8(streamAlpha, streamMode, streamCols), outputRows(streamAlpha, streamMode, request.count)))
+            return CAS_STATUS_INVALID_ARGUMENT;
+        reply.value = CAS_streamPull(stream, segments[SEGMENT_OUTPUT].data(), request.count, 0);
+        return CAS_STATUS_OK;
+    }
+}
+
+Reply Connection::handle(const Request& request, const int receivedFd) {
+    Reply reply{};
+    if (request.op == OP_MAP) {
+        if (request.segment == SEGMENT_OUTPUT)
+            overwriteOutput();
+        reply.status = map(request, receivedFd);
+        return reply;
+    }
+    if (receivedFd >= 0)
+        close(receivedFd);
+    if (request.op == OP_HELLO) {
+        reply.status = request.value == protocolVersion ? CAS_STATUS_OK : CAS_STATUS_INVALID_ARGUMENT;
+        engineName.copy(reply.name, sizeof(reply.name) - 1);
+        return reply;
+    }
+    if (request.op >= OP_STREAM_BEGIN && request.op <= OP_STREAM_PULL) {
+        if (request.op == OP_STREAM_PULL)
+            overwriteOutput();
+        reply.status = streamCall(request, reply);
+        return reply;
+    }
+    // the other calls act on the session (a coalesced call creates it in vain, it is cheap)
+    if (!casSession()) {
+        reply.status = CAS_STATUS_FAILED;
+        return reply;
+    }
+    switch (request.op) {
+    case OP_SET: reply.status = set(request, reply); break;
+    case OP_SHARPEN: reply.status = sharpen(request, reply); break;
+    case OP_REGION:
+        overwriteOutput();
+        if ((reply.status = upload(request.image)) == CAS_STATUS_OK)
+            reply.status = containsOutput(request, request.image.hasAlpha, request.width, request.height)
+                               ? CAS_sharpenRegion(session, request.casMode, request.sharpenStrength, request.contrastAdaption, request.x, request.y, request.width,
+                                                   request.height, segments[SEGMENT_OUTPUT].data() + request.outputOffset, static_cast<unsigned int>(request.outputStride))
+                               : CAS_STATUS_INVALID_ARGUMENT;
+        break;
+    case OP_SCALED:
+        overwriteOutput();
+        if ((reply.status = upload(request.image)) == CAS_STATUS_OK)
+            reply.status = containsOutput(request, request.image.hasAlpha, request.width, request.count)
+                               ? CAS_sharpenScaledRows(session, request.casMode, request.sharpenStrength, request.contrastAdaption, request.height, request.width, request.y,
+                                                       request.count, segments[SEGMENT_OUTPUT].data() + request.outputOffset, static_cast<unsigned int>(request.outputStride))
+                               : CAS_STATUS_INVALID_ARGUMENT;
+        break;
+    case OP_BATCH:
+        overwriteOutput();
+        reply.status = sharpenBatch(request);
+        break;
+    case OP_TILE_WORKING_SET:
+        if ((reply.status = upload(request.image)) == CAS_STATUS_OK)
+            reply.value = CAS_getTileWorkingSet(session);
+        break;
+    case OP_INVALIDATE_CACHE: CAS_invalidateCache(session); break;
+    default: reply.status = CAS_STATUS_INVALID_ARGUMENT;
+    }
+    return reply;
+}
+
+unsigned long long Connection::serve() {
+    unsigned long long calls = 0;
+    Request request;
+    int receivedFd;
+    while (remote_utils::receiveAll(socket, &request, sizeof(request), &receivedFd)) {
+        Reply reply{};
+        try {
+            reply = handle(request, receivedFd);
+        } catch (const std::exception&) { reply.status = CAS_STATUS_FAILED; }
+        calls++;
+        if (!remote_utils::sendAll(socket, &reply, sizeof(reply)))
+            break;
+    }
+    return calls;
+}
+
+Daemon::Daemon(const DaemonOptions& options) : options(options), context(CAS_createContext()) {
+    if (!context)
+        throw std::runtime_error("can not initialize the CAS engine");
+    try {
+        void* probe = CAS_createSession(context);
+        if (!probe)
+            throw std::runtime_error("can not create a CAS session");
+        engineName = CAS_getBackendName(probe);
+        CAS_destroy(probe);
+        coalescer = std::make_unique<Coalescer>(context, options.coalescing);
+        listenSocket = remote_utils::listenSocket(options.socketPath);
+    } catch (...) {
+        coalescer.reset();
+        CAS_destroyContext(context);
+        throw;
+    }
+}
+
+Daemon::~Daemon() {
+    remote_utils::closeSocket(listenSocket);
+    unlink(options.socketPath.c_str());
+    coalescer.reset();
+    CAS_destroyContext(context);
+}
+
+// one thread per client: they mostly wait for their client or for the engine, whose one thread pool (or device) does the work
+void Daemon::accept() {
+    const int socket = remote_utils::acceptSocket(listenSocket);
+    if (socket < 0)
+        return;
+    Client& client = clients.emplace_back();
+    client.socket = socket;
+    connections++;
+    client.thread = std::thread([this, &client] {
+        try {
+            Connection connection(client.socket, *coalescer, context, engineName);
+            calls += connection.serve();
+        } catch (const std::exception&) {}
+        client.finished = true;
+    });
+}
+
+void Daemon::reap() {
+    for (auto it = clients.begin(); it != clients.end();) {
+        if (!it->finished) {
+            ++it;
+            continue;
+        }
+        it->thread.join();
+        remote_utils::closeSocket(it->socket);
+        it = clients.erase(it);
+    }
+}
+
+void Daemon::run(const std::atomic<bool>& stop) {
+    pollfd listening{listenSocket, POLLIN, 0};
+    while (!stop) {
+        const int ready = poll(&listening, 1, 200);
+        reap();
+        if (ready > 0 && (listening.revents & POLLIN))
+            accept();
+    }
+    for (Client& client : clients)
+        remote_utils::shutdownSocket(client.socket);
+    for (Client& client : clients) {
+        client.thread.join();
+        remote_utils::closeSocket(client.socket);
+    }
+    clients.clear();
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "CASRemoteProtocol.hpp"
+#include "Coalescer.hpp"
+#include "remote_utils.hpp"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+struct DaemonOptions {
+    std::string socketPath;
+    CoalescerOptions coalescing;
+};
+
+// One client connection: a session of the daemon's context (created by the first call that needs it), the shared memory segments of the client
+// and the row stream of a CAS_streamBegin. Its calls run on the thread of the connection
+class Connection final {
+  private:
+    const int socket;
+    Coalescer& coalescer;
+    void* const context;
+    const std::string& engineName;
+    void* session{nullptr};
+    // row stream and its shape
+    void* stream{nullptr};
+    unsigned int streamCols{0};
+    bool streamAlpha{false};
+    int streamMode{0};
+    remote_utils::SharedMapping segments[cas_remote::SEGMENT_COUNT];
+    // image of the input segment last supplied to the session
+    cas_remote::Image uploaded{};
+    // settings that decide whether a whole-image call may be coalesced (the batches are 8-bit, uncached, without NUMA or sequence mode)
+    int precision{CAS_PRECISION_EXACT}, sampleFormat{CAS_SAMPLE_SRGB8};
+    unsigned long long cacheBudget{0}, numaNodes{0}, sequenceTile{0};
+
+    void* casSession();
+    int upload(const cas_remote::Image& image);
+    bool containsOutput(const cas_remote::Request& request, const bool hasAlpha, const unsigned int width, const unsigned int height) const;
+    void overwriteOutput();
+    cas_remote::Reply handle(const cas_remote::Request& request, const int receivedFd);
+    int map(const cas_remote::Request& request, const int receivedFd);
+    int sharpen(const cas_remote::Request& request, cas_remote::Reply& reply);
+    int sharpenBatch(const cas_remote::Request& request);
+    int set(const cas_remote::Request& request, cas_remote::Reply& reply);
+    int streamCall(const cas_remote::Request& request, cas_remote::Reply& reply);
+
+  public:
+    Connection(const int socket, Coalescer& coalescer, void* casContext, const std::string& engineName);
+    ~Connection();
+
+    Connection(const Connection& other) = delete;
+    Connection(Connection&& other) noexcept = delete;
+    Connection& operator=(Connection&& other) noexcept = delete;
+    Connection& operator=(const Connection& other) = delete;
+
+    // answer the calls until the client disconnects (or the socket is shut down), returns the number of calls
+    unsigned long long serve();
+};
+
+// Local sharpening daemon: one CAS context (one thread pool or device) for the sessions of every client process, on a local stream socket
+class Daemon final {
+  private:
+    struct Client {
+        int socket;
+        std::atomic<bool> finished{false};
+        std::thread thread;
+    };
+
+    const DaemonOptions options;
+    void* context;
+    std::string engineName;
+    std::unique_ptr<Coalescer> coalescer;
+    int listenSocket{-1};
+    std::list<Client> clients;
+    std::atomic<unsigned long long> connections{0}, calls{0};
+
+    void accept();
+    // join the threads of the clients that have disconnected
+    void reap();
+
+  public:
+    // creates the context and listens on the socket, throws std::runtime_error
+    explicit Daemon(const DaemonOptions& options);
+    ~Daemon();
+
+    Daemon(const Daemon& other) = delete;
+    Daemon(Daemon&& other) noexcept = delete;
+    Daemon& operator=(Daemon&& other) noexcept = delete;
+    Daemon& operator=(const Daemon& other) = delete;
+
+    // serve the clients until stop is set, then disconnect them
+    void run(const std::atomic<bool>& stop);
+
+    const std::string& engine() const { return engineName; }
+    unsigned long long connectionCount() const { return connections.load(); }
+    unsigned long long callCount() const { return calls.load(); }
+    unsigned long long batchCount() const { return coalescer->batchCount(); }
+    unsigned long long coalescedCount() const { return coalescer->imageCount(); }
+};
@@ -0,0 +1,96 @@
+#include "Daemon.hpp"
+#include "remote_utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+static std::atomic<bool> stopRequested{false};
+
+static void requestStop(int) { stopRequested.store(true); }
+
+static void printUsage() {
+    std::fputs("Usage: cas-daemon [options]\n"
+               "Serve Contrast Adaptive Sharpening (hipCAS) to the processes linked to the client library (libhipCAS-Client) on a local socket:\n"
+               "one engine and thread pool for all of them, with the small images of concurrent calls sharpened in shared batches.\n\n"
+               "Options:\n"
+               "  --socket <path>          Socket path (default: CAS_DAEMON_SOCKET, else hipcas.sock in XDG_RUNTIME_DIR, else hipcas.sock in /tmp/hipcas-<uid>).\n"
+               "  --backend <cpu|gpu>      Engine of the daemon (default: the GPU when one is available).\n"
+               "  --threads <count>        Worker threads of the CPU engine (default: hardware threads).\n"
+               "  --small <pixels>         Largest image that is coalesced (default 262144, 0 = none).\n"
+               "  --batch <count>          Images of one batch (default 32).\n"
+               "  --window <microseconds>  How long an image waits for others (default 200).\n"
+               "  --quiet                  Do not print the statistics.\n"
+               "  -h, --help               Show this help.\n",
+               stderr);
+}
+
+int main(int argc, char* argv[]) {
+    DaemonOptions options;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg(argv[i]);
+        // options with a value
+        const auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value of %s\n", argv[i]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "--socket")
+            options.socketPath = value();
+        else if (arg == "--backend") {
+            const std::string_view backend = value();
+            if (backend != "cpu" && backend != "gpu") {
+                std::fputs("--backend expects cpu or gpu\n", stderr);
+                return 2;
+            }
+            // the library reads the engine and its thread count from the environment when the context is created
+            setenv("CAS_BACKEND", backend.data(), 1);
+        } else if (arg == "--threads")
+            setenv("CAS_CPU_THREADS", value().data(), 1);
+        else if (arg == "--small")
+            options.coalescing.smallPixels = std::strtoull(value().data(), nullptr, 10);
+        else if (arg == "--batch")
+            options.coalescing.maxImages = static_cast<unsigned int>(std::max(1, std::atoi(value().data())));
+        else if (arg == "--window")
+            options.coalescing.window = std::chrono::microseconds(std::max(0, std::atoi(value().data())));
+        else if (arg == "--quiet")
+            quiet = true;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            printUsage();
+            return 2;
+        }
+    }
+
+    // a client that disconnects mid-reply is a failed send, not the end of the daemon
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    try {
+        if (options.socketPath.empty())
+            options.socketPath = remote_utils::defaultSocketPath();
+        Daemon daemon(options);
+        if (!quiet)
+            std::fprintf(stderr, "cas-daemon: %s engine on %s\n", daemon.engine().c_str(), options.socketPath.c_str());
+        daemon.run(stopRequested);
+        if (!quiet)
+            std::fprintf(stderr, "cas-daemon: %llu connections, %llu calls, %llu images coalesced in %llu batches\n", daemon.connectionCount(), daemon.callCount(),
+                         daemon.coalescedCount(), daemon.batchCount());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "cas-daemon: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,9 @@
+#include <cmath>
 #include <Qlabel>
 #include <QPixmap>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
 #include <Qt>
 #include <QtMinMax>
 #include <QWheelEvent>
@@ -33,4 +37,19 @@ void ZoomableLabel::wheelEvent(QWheelEvent* event) {
 void ZoomableLabel::scaleImage() {
     if (!originalPixmap.isNull())
         setPixmap(originalPixmap.scaled(originalPixmap.size() * scaleFactor, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-}
\ No newline at end of file
+}
+// the scaled pixmap is centered in the contents of the label and shows the whole source image
+QRect ZoomableLabel::sourceRect(const QRect& area, const QSize& sourceSize) const {
+    const QSize shown = originalPixmap.size() * scaleFactor;
+    if (shown.isEmpty() || sourceSize.isEmpty())
+        return {};
+    const QRect content = contentsRect();
+    const QPoint origin(content.x() + (content.width() - shown.width()) / 2, content.y() + (content.height() - shown.height()) / 2);
+    const QRect visible = area.translated(-origin).intersected(QRect(QPoint(0, 0), shown));
+    if (visible.isEmpty())
+        return {};
+    const double scaleX = static_cast<double>(sourceSize.width()) / shown.width(), scaleY = static_cast<double>(sourceSize.height()) / shown.height();
+    const QPoint topLeft(static_cast<int>(std::floor(visible.left() * scaleX)), static_cast<int>(std::floor(visible.top() * scaleY)));
+    const QPoint bottomRight(static_cast<int>(std::ceil((visible.right() + 1) * scaleX)) - 1, static_cast<int>(std::ceil((visible.bottom() + 1) * scaleY)) - 1);
+    return QRect(topLeft, bottomRight).intersected(QRect(QPoint(0, 0), sourceSize));
+}
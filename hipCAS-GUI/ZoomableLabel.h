@@ -2,6 +2,8 @@
 
 #include <QLabel>
 #include <QPixmap>
+#include <QRect>
+#include <QSize>
 #include <QWheelEvent>
 #include <QWidget>
 
@@ -14,6 +16,8 @@ class ZoomableLabel : public QLabel {
     explicit ZoomableLabel(QWidget* parent = nullptr);
     void setImage(const QPixmap& pixmap);
     void updateImage(const QPixmap& pixmap); // does not reset the zoom factor
+    // rectangle of a source image of the given size shown in the area (label coordinates) of the label, empty if none of the image is in it
+    QRect sourceRect(const QRect& area, const QSize& sourceSize) const;
 
   protected:
     void wheelEvent(QWheelEvent* event) override;
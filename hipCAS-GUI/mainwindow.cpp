@@ -1,6 +1,8 @@
 #include "CASLibWrapper.h"
 #include "mainwindow.h"
 #include "widget_utils.hpp"
+#include <cmath>
+#include <cstddef>
 #include <functional>
 #include <QApplication>
 #include <QFileDialog>
@@ -13,12 +15,15 @@
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QMetaObject>
+#include <QPainter>
 #include <QPixmap>
 #include <QScreen>
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QSlider>
 #include <QString>
+#include <QThreadPool>
 #include <QtGlobal>
 #include <QTimer>
 #include <QtMinMax>
@@ -29,20 +34,53 @@
 
 inline static float clampSlider(const int sliderValue, const float maxLimit) { return qBound(0.0f, static_cast<float>(sliderValue) / 100.0f, maxLimit); }
 
+// supply an image to CAS in its own pixel format and row stride when CAS reads it natively, converted to RGBA otherwise (e.g. indexed or premultiplied images)
+static int supplyImage(void* cas, const QImage& image, const bool hasAlpha) {
+    int pixelFormat = -1;
+    switch (image.format()) {
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888: pixelFormat = CAS_FORMAT_RGBA8; break;
+    case QImage::Format_RGB888: pixelFormat = CAS_FORMAT_RGB8; break;
+    case QImage::Format_BGR888: pixelFormat = CAS_FORMAT_BGR8; break;
+    case QImage::Format_Grayscale8: pixelFormat = CAS_FORMAT_GRAY8; break;
+    // 32-bit ARGB words are BGRA in memory on little-endian hosts
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32: pixelFormat = Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? CAS_FORMAT_BGRA8 : -1; break;
+    default: break;
+    }
+    // the format has no alpha channel to read (RGBX, RGB32)
+    const bool readAlpha = hasAlpha && image.hasAlphaChannel();
+    if (pixelFormat < 0) {
+        const QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+        return CAS_supplyImageFormat(cas, rgba.constBits(), CAS_FORMAT_RGBA8, static_cast<unsigned int>(rgba.bytesPerLine()), readAlpha, rgba.height(), rgba.width());
+    }
+    return CAS_supplyImageFormat(cas, image.constBits(), pixelFormat, static_cast<unsigned int>(image.bytesPerLine()), readAlpha, image.height(), image.width());
+}
+
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent), sharpenStrength(new QSlider(Qt::Horizontal)), contrastAdaption(new QSlider(Qt::Horizontal)), imageView(new ZoomableLabel), scrollArea(new QScrollArea),
-      sharpenStrengthLabel(new QLabel("Sharpen Strength")), contrastAdaptionLabel(new QLabel("Contrast Adaption")), casObj(CAS_initialize()),
+      sharpenStrengthLabel(new QLabel("Sharpen Strength")), contrastAdaptionLabel(new QLabel("Contrast Adaption")), casContext(CAS_createContext()),
+      casObj(CAS_createSession(casContext)),
       // 80% of the screen size
-      targetImageSize(QGuiApplication::primaryScreen()->availableGeometry().size() * 0.8), throttleTimer(new QTimer(this)) {
+      targetImageSize(QGuiApplication::primaryScreen()->availableGeometry().size() * 0.8), throttleTimer(new QTimer(this)), casPreview(CAS_createSession(casContext)),
+      fullResolutionTimer(new QTimer(this)), previewInterval(qMax(1, qRound(1000.0 / qMax(1.0, QGuiApplication::primaryScreen()->refreshRate())))) {
     // check if DLL is loaded correctly
-    if (!casObj) {
+    if (!casObj || !casPreview) {
         QMessageBox::critical(this, "Error", "Failed to initialize CAS DLL library.");
         QTimer::singleShot(0, qApp, &QCoreApplication::quit);
         return;
     }
-    // setup sharpening timer
+    // cache the parameter independent part of the kernel: slider changes only run the cheap weight/lerp/encode stage
+    CAS_setCacheBudget(casObj, casCacheBudget);
+    CAS_setCacheBudget(casPreview, casCacheBudget);
+    // setup sharpening timers
     throttleTimer->setSingleShot(true); // run once, then stop until triggered again
     connect(throttleTimer, &QTimer::timeout, this, &MainWindow::performSharpening);
+    fullResolutionTimer->setSingleShot(true);
+    connect(fullResolutionTimer, &QTimer::timeout, this, &MainWindow::startFullResolution);
+    // one worker thread, kept alive between the passes
+    fullResolutionWorker.setMaxThreadCount(1);
+    fullResolutionWorker.setExpiryTimeout(-1);
 
     // setup sliders
     setupSlider(sharpenStrength, sharpenStrengthLabel, 0, 1000);
@@ -55,8 +93,14 @@ MainWindow::MainWindow(QWidget* parent)
     setupMainWidget();
 }
 
-// destroy DLL's memory
-MainWindow::~MainWindow() { CAS_destroy(casObj); }
+// stop the full resolution pass, then destroy DLL's memory
+MainWindow::~MainWindow() {
+    cancelFullResolution();
+    fullResolutionWorker.waitForDone();
+    CAS_destroy(casObj);
+    CAS_destroy(casPreview);
+    CAS_destroyContext(casContext);
+}
 
 // setup CAS parameter sliders
 void MainWindow::setupSlider(QSlider* slider, QLabel* label, const int value, const int maxValue) const {
@@ -66,6 +110,7 @@ void MainWindow::setupSlider(QSlider* slider, QLabel* label, const int value, co
     label->setFixedWidth(130);
     WidgetUtils::setVisibility(false, slider, label);
     connect(slider, &QSlider::valueChanged, this, &MainWindow::sliderValueChanged);
+    connect(slider, &QSlider::sliderReleased, this, &MainWindow::sliderReleased);
 }
 
 // setup menus
@@ -107,6 +152,11 @@ void MainWindow::setupMainWidget() {
     scrollArea->setAlignment(Qt::AlignCenter);
     scrollArea->setWidgetResizable(true);
     scrollArea->setWidget(imageView);
+    // zooming changes the scroll ranges, panning the scroll values
+    for (const QScrollBar* scrollBar : {scrollArea->horizontalScrollBar(), scrollArea->verticalScrollBar()}) {
+        connect(scrollBar, &QScrollBar::valueChanged, this, &MainWindow::viewScrolled);
+        connect(scrollBar, &QScrollBar::rangeChanged, this, &MainWindow::viewScrolled);
+    }
 
     mainLayout->addWidget(scrollArea);
     // central Widget
@@ -125,25 +175,138 @@ void MainWindow::addSliderLayout(QVBoxLayout* mainLayout, QSlider* slider, QLabe
 
 // updates the Image label to show the passed-in QImage
 void MainWindow::updateImageView(const QImage& image, const bool resetScale) {
-    QPixmap pixmap = QPixmap::fromImage(image);
-    WidgetUtils::scalePixmap(pixmap, targetImageSize);
-    resetScale ? imageView->setImage(pixmap) : imageView->updateImage(pixmap);
-    scrollArea->setMinimumSize(pixmap.size() * 1.07);
+    displayPixmap = QPixmap::fromImage(image);
+    WidgetUtils::scalePixmap(displayPixmap, targetImageSize);
+    resetScale ? imageView->setImage(displayPixmap) : imageView->updateImage(displayPixmap);
+    scrollArea->setMinimumSize(displayPixmap.size() * 1.07);
+}
+
+// updates the Image label after a pass wrote the rect of the sharpened image: only that part is scaled to the display size and painted into the shown pixmap,
+// so the cost follows the rect instead of the image (the preview and the scaled pass show images of the display size, hence the same pixmap size)
+void MainWindow::updateImageViewRect(const QRect& rect) {
+    const QSize shown = sharpenedImage.size().scaled(targetImageSize, Qt::KeepAspectRatio).boundedTo(sharpenedImage.size());
+    if (displayPixmap.size() != shown) {
+        updateImageView(sharpenedImage, false);
+        return;
+    }
+    // display pixels touched by the rect, and the source pixels they cover
+    const double scaleX = static_cast<double>(shown.width()) / sharpenedImage.width(), scaleY = static_cast<double>(shown.height()) / sharpenedImage.height();
+    const QRect target = QRect(QPoint(static_cast<int>(std::floor(rect.left() * scaleX)), static_cast<int>(std::floor(rect.top() * scaleY))),
+                               QPoint(static_cast<int>(std::ceil((rect.right() + 1) * scaleX)) - 1, static_cast<int>(std::ceil((rect.bottom() + 1) * scaleY)) - 1))
+                             .intersected(displayPixmap.rect());
+    const QRect source = QRect(QPoint(static_cast<int>(std::floor(target.left() / scaleX)), static_cast<int>(std::floor(target.top() / scaleY))),
+                               QPoint(static_cast<int>(std::ceil((target.right() + 1) / scaleX)) - 1, static_cast<int>(std::ceil((target.bottom() + 1) / scaleY)) - 1))
+                             .intersected(sharpenedImage.rect());
+    if (target.isEmpty() || source.isEmpty())
+        return;
+    {
+        QPainter painter(&displayPixmap);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(target.topLeft(), sharpenedImage.copy(source).scaled(target.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+    imageView->updateImage(displayPixmap);
 }
 
-// main CAS sharpening method, calls the DLL and updates the display to show the new image
+// part of the image inside the scroll area viewport (with a small margin), the whole image when it is not zoomed in past the viewport
+QRect MainWindow::visibleImageRect() const {
+    const QRect fullImage(QPoint(0, 0), sharpenedImage.size());
+    const QRect viewport(QPoint(scrollArea->horizontalScrollBar()->value(), scrollArea->verticalScrollBar()->value()), scrollArea->viewport()->size());
+    const QRect visible = imageView->sourceRect(viewport, sharpenedImage.size());
+    if (visible.isEmpty())
+        return fullImage;
+    return visible.adjusted(-visibleMargin, -visibleMargin, visibleMargin, visibleMargin).intersected(fullImage);
+}
+
+// parameter change: sharpen the preview and show it, the full resolution pass follows once the user stops
+// images that are not larger than the display have no preview, their full resolution pass starts right away
 void MainWindow::performSharpening() {
-    // apply CAS from DLL and update UI
-    const int sharpenedImageChannels = userImageHasAlpha ? 4 : 3;
-    const auto sharpenedImageFormat = userImageHasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888;
-    const uchar* casData = CAS_sharpenImage(casObj, 1, clampSlider(sharpenStrength->value(), 10.0f), clampSlider(contrastAdaption->value(), 1.0f));
-    // check if CAS returned valid data
-    if (!casData) {
+    if (previewImage.isNull()) {
+        startFullResolution();
+        return;
+    }
+    const int status = CAS_sharpenImageInto(casPreview, 1, clampSlider(sharpenStrength->value(), 10.0f), clampSlider(contrastAdaption->value(), 1.0f), previewSharpened.bits(),
+                                            static_cast<unsigned int>(previewSharpened.bytesPerLine()));
+    if (status != CAS_STATUS_OK) {
         QMessageBox::critical(this, "Error", "CAS failed to process the image.");
         return;
     }
-    sharpenedImage = QImage(casData, userImage.width(), userImage.height(), userImage.width() * sharpenedImageChannels, sharpenedImageFormat);
-    updateImageView(sharpenedImage, false);
+    updateImageView(previewSharpened, false);
+}
+
+// sharpen the visible part of the image (the whole image when it is not zoomed in) at full resolution on the worker thread, band by band, until a newer request makes it stale
+// CAS writes straight into the rows of the sharpened image (QImage rows are 32-bit aligned, hence the explicit stride)
+// the whole view of an image larger than the display is sharpened and downscaled to the display size instead (scaling mode), in bands of output rows
+// full width bands fill the intermediates cache of casObj from the top, the passes after a complete one read it
+void MainWindow::startFullResolution() {
+    if (sharpenedImage.isNull())
+        return;
+    // a pending preview would replace the full resolution result
+    throttleTimer->stop();
+    const unsigned int generation = ++sharpenGeneration;
+    const QRect rect = visibleImageRect();
+    const bool scaledCall = !scaledSharpened.isNull() && rect == QRect(QPoint(0, 0), sharpenedImage.size());
+    const float strength = clampSlider(sharpenStrength->value(), 10.0f), adaption = clampSlider(contrastAdaption->value(), 1.0f);
+    // bits() detaches the image here, on the GUI thread: the worker only writes its pixels
+    unsigned char* output = sharpenedImage.bits();
+    const std::size_t stride = static_cast<std::size_t>(sharpenedImage.bytesPerLine()), pixelBytes = static_cast<std::size_t>(sharpenedImage.depth() / 8);
+    unsigned char* scaledOutput = scaledCall ? scaledSharpened.bits() : nullptr;
+    const QSize scaledSize = scaledSharpened.size();
+    const std::size_t scaledStride = static_cast<std::size_t>(scaledSharpened.bytesPerLine());
+    fullResolutionWorker.start([=, this] {
+        bool ok = true;
+        if (scaledCall) {
+            for (int y = 0; ok && y < scaledSize.height() && sharpenGeneration == generation; y += fullResolutionBandRows) {
+                const int bandRows = qMin(fullResolutionBandRows, scaledSize.height() - y);
+                ok = CAS_sharpenScaledRows(casObj, 1, strength, adaption, scaledSize.height(), scaledSize.width(), y, bandRows, scaledOutput + y * scaledStride,
+                                           static_cast<unsigned int>(scaledStride)) == CAS_STATUS_OK;
+            }
+        } else {
+            for (int y = rect.top(); ok && y <= rect.bottom() && sharpenGeneration == generation; y += fullResolutionBandRows) {
+                const int bandRows = qMin(fullResolutionBandRows, rect.bottom() + 1 - y);
+                ok = CAS_sharpenRegion(casObj, 1, strength, adaption, rect.x(), y, rect.width(), bandRows, output + y * stride + rect.x() * pixelBytes,
+                                       static_cast<unsigned int>(stride)) == CAS_STATUS_OK;
+            }
+        }
+        QMetaObject::invokeMethod(this, [=, this] { fullResolutionDone(generation, rect, ok, scaledCall); }, Qt::QueuedConnection);
+    });
+}
+
+// result of a full resolution pass, back on the GUI thread: shown unless a newer request made it stale
+// a scaled pass leaves the full resolution image unsharpened
+void MainWindow::fullResolutionDone(const unsigned int generation, const QRect& rect, const bool ok, const bool scaled) {
+    if (generation != sharpenGeneration)
+        return;
+    if (!ok) {
+        QMessageBox::critical(this, "Error", "CAS failed to process the image.");
+        return;
+    }
+    sharpenedPartial = scaled || rect != QRect(QPoint(0, 0), sharpenedImage.size());
+    scaled ? updateImageView(scaledSharpened, false) : updateImageViewRect(rect);
+}
+
+// make the running and the queued full resolution passes stale, they stop before their next band
+void MainWindow::cancelFullResolution() {
+    ++sharpenGeneration;
+    fullResolutionTimer->stop();
+}
+
+// copy of the image downscaled to the display size (see updateImageView) for the preview, and the output of the scaled full resolution pass,
+// none when the image is not larger than the display or the preview instance can not take it (casPreview would keep the size of the previous image)
+void MainWindow::preparePreview() {
+    previewImage = QImage();
+    previewSharpened = QImage();
+    scaledSharpened = QImage();
+    if (userImage.width() <= targetImageSize.width() && userImage.height() <= targetImageSize.height())
+        return;
+    previewImage = userImage.scaled(targetImageSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    previewSharpened = previewImage.convertToFormat(userImageHasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+    scaledSharpened = QImage(previewImage.size(), previewSharpened.format());
+    if (supplyImage(casPreview, previewImage, userImageHasAlpha) != CAS_STATUS_OK) {
+        // without a preview every change runs the full resolution pass
+        previewImage = QImage();
+        previewSharpened = QImage();
+        scaledSharpened = QImage();
+    }
 }
 
 // open an image and display it to the user. Reinitialize CAS with the new dimensions
@@ -159,14 +322,22 @@ void MainWindow::openImage() {
         return;
     }
 
+    // the running pass writes into the previous image
+    cancelFullResolution();
+    fullResolutionWorker.waitForDone();
+    // suppply image to re-initialize internal CAS memory, the image keeps its own pixel format (CAS reads the common ones as they are)
+    const bool hasAlpha = readerImage.hasAlphaChannel();
+    if (supplyImage(casObj, readerImage, hasAlpha) != CAS_STATUS_OK) {
+        QMessageBox::critical(this, "Open Image", "CAS failed to load the image.");
+        return;
+    }
     userImage = std::move(readerImage);
-    sharpenedImage = QImage(userImage);
+    userImageHasAlpha = hasAlpha;
 
-    // convert to RGBA interleaved format
-    userImageHasAlpha = userImage.hasAlphaChannel();
-    userImage = userImage.convertToFormat(QImage::Format_RGBA8888);
-    // suppply image to re-initialize internal CAS memory
-    CAS_supplyImage(casObj, userImage.constBits(), userImageHasAlpha, userImage.height(), userImage.width());
+    // output image in the CAS output format, sharpened in place on each parameter change (the original until then)
+    sharpenedImage = userImage.convertToFormat(userImageHasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+    sharpenedPartial = false;
+    preparePreview();
 
     // only scale down if the image is larger than the target size
     updateImageView(userImage, true);
@@ -186,6 +357,18 @@ void MainWindow::saveImage() {
     const QString fileName = QFileDialog::getSaveFileName(this, "Save Image", QString(), imageDialogFilterText);
     if (fileName.isEmpty())
         return;
+    // the saved image needs all of it with the current parameters: the view may only show the preview or the visible part
+    cancelFullResolution();
+    fullResolutionWorker.waitForDone();
+    if (sharpenedPartial) {
+        if (CAS_sharpenImageInto(casObj, 1, clampSlider(sharpenStrength->value(), 10.0f), clampSlider(contrastAdaption->value(), 1.0f), sharpenedImage.bits(),
+                                 static_cast<unsigned int>(sharpenedImage.bytesPerLine())) != CAS_STATUS_OK) {
+            QMessageBox::critical(this, "Save Image", "CAS failed to process the image.");
+            return;
+        }
+        sharpenedPartial = false;
+        updateImageView(sharpenedImage, false);
+    }
 
     if (!sharpenedImage.save(fileName))
         QMessageBox::critical(this, "Save Image", "Failed to save the image.");
@@ -193,11 +376,30 @@ void MainWindow::saveImage() {
         QMessageBox::information(this, "Save Image", "Image saved successfully.");
 }
 
-// event handler when a slider is changed, checks if the timer is active, skip redundant (too fast) HIP calls, else, it restarts the timer
+// event handler when a slider is changed: the running full resolution pass is stale, the preview is throttled to the display refresh (calls are skipped while the timer is active)
+// and the full resolution pass starts once the user stops changing the value
 void MainWindow::sliderValueChanged() {
+    cancelFullResolution();
+    sharpenedPartial = true;
+    if (!previewImage.isNull())
+        fullResolutionTimer->start(fullResolutionDelay);
     if (throttleTimer->isActive())
         return;
-    throttleTimer->start(50);
+    throttleTimer->start(previewImage.isNull() ? throttleInterval : previewInterval);
+}
+
+// the user let go of the slider: full resolution right away
+void MainWindow::sliderReleased() {
+    if (!fullResolutionTimer->isActive())
+        return;
+    fullResolutionTimer->stop();
+    startFullResolution();
+}
+
+// scrolling or zooming shows parts of the image that were not sharpened with the current parameters
+void MainWindow::viewScrolled() {
+    if (sharpenedPartial)
+        fullResolutionTimer->start(throttleInterval);
 }
 
 void MainWindow::sendZoomEvent(const int delta) {
@@ -5,15 +5,19 @@
 #include <QLabel>
 #include <QMainWindow>
 #include <QMouseEvent>
+#include <QPixmap>
 #include <QPoint>
+#include <QRect>
 #include <QScrollArea>
 #include <QSize>
 #include <QSlider>
 #include <QString>
+#include <QThreadPool>
 #include <QVBoxLayout>
 #include <QTimer>
 #include <QWidget>
 #include <ZoomableLabel.h>
+#include <atomic>
 
 // Main GUI Window class
 // holds all widgets and GUI logic
@@ -29,6 +33,8 @@ class MainWindow : public QMainWindow {
     void saveImage();
     void sliderValueChanged();
     void sendZoomEvent(const int delta);
+    void viewScrolled();
+    void sliderReleased();
 
   protected:
     void mousePressEvent(QMouseEvent* event) override;
@@ -37,23 +43,58 @@ class MainWindow : public QMainWindow {
 
   private:
     const QString imageDialogFilterText{"Images (*.png *.jpg *.bmp *.webp *.tiff)"};
+    // memory budget of the CAS intermediates cache (enough for 8K images on the HIP engine)
+    const unsigned long long casCacheBudget{1ull << 30};
     void setupMenu();
     void setupSlider(QSlider* slider, QLabel* label, const int value, const int maxValue = 100) const;
     void setupImageView();
     void setupMainWidget();
     void addSliderLayout(QVBoxLayout* mainLayout, QSlider* slider, QLabel* label);
     void updateImageView(const QImage& image, const bool resetScale);
+    void updateImageViewRect(const QRect& rect);
     void performSharpening();
+    void startFullResolution();
+    void fullResolutionDone(const unsigned int generation, const QRect& rect, const bool ok, const bool scaled);
+    void cancelFullResolution();
+    void preparePreview();
+    QRect visibleImageRect() const;
 
     QImage userImage, sharpenedImage;
+    // the image shown by the view, downscaled to the display size
+    QPixmap displayPixmap;
     QSlider *sharpenStrength, *contrastAdaption;
     ZoomableLabel* imageView;
     QScrollArea* scrollArea;
     QLabel *sharpenStrengthLabel, *contrastAdaptionLabel;
+    // casObj and casPreview are two sessions of one CAS context: the preview and the full resolution pass share its thread pool (or device)
+    void* casContext;
     void* casObj;
     QAction *openImageAction, *saveImageAction;
     const QSize targetImageSize;
     bool userImageHasAlpha;
+    // the sharpened image is not entirely sharpened with the current parameters: only its visible part, or its full resolution pass is pending
+    bool sharpenedPartial{false};
+    // source pixels sharpened around the visible part: the smooth scaling of the view samples its neighbours
+    const int visibleMargin{2};
     QPoint lastMousePos;
     QTimer* throttleTimer;
+    // parameter changes closer than this (ms) are coalesced
+    const int throttleInterval{50};
+
+    // progressive preview: while the parameters change, a copy of the image downscaled to the display size is sharpened by its own CAS session,
+    // the full resolution pass runs on a worker thread once the user stops, in bands of rows, and is abandoned between two bands when a new value arrives
+    void* casPreview;
+    QImage previewImage, previewSharpened;
+    // whole view of an image larger than the display: sharpened and downscaled to the display size on the worker thread, in bands of output rows
+    QImage scaledSharpened;
+    QTimer* fullResolutionTimer;
+    // a single thread: the passes run in order and casObj is only used by one thread at a time (the GUI thread waits for it before using casObj)
+    QThreadPool fullResolutionWorker;
+    // incremented by every new request, a pass of an older generation is stale
+    std::atomic<unsigned int> sharpenGeneration{0};
+    // idle time after the last change (ms) before the full resolution pass when the slider is not released
+    const int fullResolutionDelay{250};
+    const int fullResolutionBandRows{256};
+    // preview throttle (ms): one frame of the display
+    int previewInterval;
 };
\ No newline at end of file
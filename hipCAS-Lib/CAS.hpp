@@ -1,54 +1,68 @@
 #pragma once
 #include "hip/hip_runtime.h"
 #include "hip_math.hpp"
+#include "include/CASLibWrapper.h"
 #include <hip/hip_fp16.h>
+#include <type_traits>
 
 constexpr int RGB = 0;
 constexpr int RGBA = 1;
 
-// Main CAS kernel
-// Template: hasAlpha: whether the input image has an alpha channel
-//			 casMode: whether the output image should be written as interleaved RGBA or planar RGB
-// Params:   texObj: input (sRGB) texture object
-//		     sharpenStrength: sharpening strength
-//		     contrastAdaption: contrast adaption
-//		     casOutput: output buffer
-//		     height: height of the input texture
-//		     width: width of the input texture
-// Returns:  None
-template <class T, bool hasAlpha, int casMode>
-__global__ void cas(hipTextureObject_t texObj, const float sharpenStrength, const float contrastAdaption, T* casOutput, const unsigned int height, const unsigned int width) {
-    const int x = blockIdx.x * blockDim.x + threadIdx.x;
-    const int y = blockIdx.y * blockDim.y + threadIdx.y;
-    const int outputIndex = (y * width) + x;
+// cache modes of the CAS kernel (see CASImpl cached mode)
+// CACHE_NONE: full kernel, CACHE_FILL: full kernel that also stores the intermediates, CACHE_USE: only the parameter dependent stage, from the stored intermediates
+constexpr int CACHE_NONE = 0;
+constexpr int CACHE_FILL = 1;
+constexpr int CACHE_USE = 2;
 
-    if (x >= width || y >= height)
-        return;
+// parameter independent intermediates of one pixel: amplitude (from the soft min/max) and the cross filter sum, RGB each
+// packed in 12 bytes instead of two padded half3
+struct CASIntermediate {
+    half2 ampRG, ampBWindowR, windowGB;
+};
+
+// encode a linear color channel into an output sample: 8-bit sRGB, 16-bit unsigned normalized, half or float (linear)
+template <class Sample>
+inline __device__ Sample encodeColor(const half linearColor) {
+    if constexpr (std::is_same_v<Sample, unsigned char>)
+        return sRGBToUchar(linearColor);
+    else if constexpr (std::is_same_v<Sample, unsigned short>)
+        return static_cast<unsigned short>(__float2uint_rn(__saturatef(__half2float(linearColor)) * 65535.0f));
+    else if constexpr (std::is_same_v<Sample, half>)
+        return linearColor;
+    else
+        return __half2float(linearColor);
+}
+
+// encode an alpha value (never sRGB) into an output sample
+template <class Sample>
+inline __device__ Sample encodeAlpha(const half alpha) {
+    if constexpr (std::is_same_v<Sample, unsigned char>)
+        return halfToUchar(alpha);
+    else
+        return encodeColor<Sample>(alpha);
+}
 
+// fetch a texel clamped to [0,1]: the float and half textures of the linear formats are read as is
+inline __device__ float4 fetchTexel(hipTextureObject_t texObj, const int x, const int y) {
+    const float4 texel = tex2D<float4>(texObj, x, y);
+    return make_float4(__saturatef(texel.x), __saturatef(texel.y), __saturatef(texel.z), __saturatef(texel.w));
+}
+
+// parameter independent stage of the texel (x, y) with center value e: amplitude (from the soft min/max) and cross filter sum, RGB each,
+// and the green range of its 3x3 neighborhood when greenRange is given (edge thinning of the scaling filter)
+inline __device__ void casNeighborhood(hipTextureObject_t texObj, const int x, const int y, const half3 e, half3& ampRGB, half3& filterWindow, half* greenRange = nullptr) {
     // fetch a 3x3 neighborhood around the pixel 'e', a = a, d = d, ....i = i
     //  a b c
     //  d(e)f
     //  g h i
-    const half4 currentPixel = make_half4(tex2D<float4>(texObj, x, y));
-    // speedup if alpha is zero -> just write the alpha value only and return
-    if constexpr (hasAlpha) {
-        if (__high2half(currentPixel.y) == __float2half(0.0f)) {
-            if constexpr (casMode == RGB)
-                casOutput[width * height * 3 + outputIndex] = 0;
-            else
-                casOutput[outputIndex] = make_uchar4(0, 0, 0, 0);
-            return;
-        }
-    }
-    const half3 e = make_half3(currentPixel);
-    const half3 a = make_half3(tex2D<float4>(texObj, x - 1, y - 1));
-    const half3 b = make_half3(tex2D<float4>(texObj, x, y - 1));
-    const half3 c = make_half3(tex2D<float4>(texObj, x + 1, y - 1));
-    const half3 d = make_half3(tex2D<float4>(texObj, x - 1, y));
-    const half3 f = make_half3(tex2D<float4>(texObj, x + 1, y));
-    const half3 g = make_half3(tex2D<float4>(texObj, x - 1, y + 1));
-    const half3 h = make_half3(tex2D<float4>(texObj, x, y + 1));
-    const half3 i = make_half3(tex2D<float4>(texObj, x + 1, y + 1));
+    const half3 a = make_half3(fetchTexel(texObj, x - 1, y - 1));
+    const half3 b = make_half3(fetchTexel(texObj, x, y - 1));
+    const half3 c = make_half3(fetchTexel(texObj, x + 1, y - 1));
+    const half3 d = make_half3(fetchTexel(texObj, x - 1, y));
+    const half3 f = make_half3(fetchTexel(texObj, x + 1, y));
+    const half3 g = make_half3(fetchTexel(texObj, x - 1, y + 1));
+    const half3 h = make_half3(fetchTexel(texObj, x, y + 1));
+    const half3 i = make_half3(fetchTexel(texObj, x + 1, y + 1));
 
     // Soft min and max.
     //  a b c             b
@@ -62,44 +76,262 @@ __global__ void cas(hipTextureObject_t texObj, const float sharpenStrength, cons
     half3 mxRGB = hmax3(hmax3(hmax3(d, e), hmax3(f, b)), h);
     const half3 mxRGB2 = hmax3(mxRGB, hmax3(hmax3(a, c), hmax3(g, i)));
     mxRGB += mxRGB2;
+    if (greenRange)
+        *greenRange = __high2half(mxRGB2.x) - __high2half(mnRGB2.x);
 
     // Smooth minimum distance to signal limit divided by smooth max.
-    const half3 ampRGB = h3rsqrt(saturateh(hmin3(mnRGB, __float2half(2.0f) - mxRGB) * h3rcp(mxRGB)));
-
-    // Shaping amount of sharpening.
-    const half3 wRGB = -h3rcp(ampRGB * (__float2half(-3.0f) * __float2half(contrastAdaption) + __float2half(8.0f)));
-    const half3 rcpWeightRGB = h3rcp(__float2half(4.0f) * wRGB + __float2half(1.0f));
+    ampRGB = h3rsqrt(saturateh(hmin3(mnRGB, __float2half(2.0f) - mxRGB) * h3rcp(mxRGB)));
 
     //						  0 w 0
     //  Filter shape:		  w 1 w
     //						  0 w 0
-    const half3 filterWindow = (b + d) + (f + h);
+    filterWindow = (b + d) + (f + h);
+}
+
+// Shaping amount of sharpening (the negative weight of the cross), from the amplitude
+inline __device__ half3 casPeak(const half3 ampRGB, const float contrastAdaption) {
+    return -h3rcp(ampRGB * (__float2half(-3.0f) * __float2half(contrastAdaption) + __float2half(8.0f)));
+}
+
+// parameter dependent stage: filter of the center value e and lerp by the sharpening strength
+inline __device__ half3 casShape(const half3 e, const half3 ampRGB, const half3 filterWindow, const float sharpenStrength, const float contrastAdaption) {
+    const half3 wRGB = casPeak(ampRGB, contrastAdaption);
+    const half3 rcpWeightRGB = h3rcp(__float2half(4.0f) * wRGB + __float2half(1.0f));
+
     const half3 outColor = saturateh((filterWindow * wRGB + e) * rcpWeightRGB);
-    const half3 sharpenedValues = lerph(e, outColor, __float2half(sharpenStrength));
+    return lerph(e, outColor, __float2half(sharpenStrength));
+}
 
-    // convert to uchar sRGB
-    const unsigned char colorR = halfToUchar(sRGB(__low2half(sharpenedValues.x)));
-    const unsigned char colorG = halfToUchar(sRGB(__high2half(sharpenedValues.x)));
-    const unsigned char colorB = halfToUchar(sRGB(sharpenedValues.y));
+// count a pixel skipped by the alpha early-out with one atomic per wavefront (warp): its lowest active lane adds the number of active lanes
+inline __device__ void countSkipped(unsigned long long* counter) {
+#ifdef __HIP_PLATFORM_NVIDIA__
+    const unsigned long long lanes = __activemask();
+#else
+    const unsigned long long lanes = __ballot(1);
+#endif
+    const unsigned int lane = (threadIdx.y * blockDim.x + threadIdx.x) % warpSize;
+    if (lane == static_cast<unsigned int>(__ffsll(static_cast<long long>(lanes)) - 1))
+        atomicAdd(counter, static_cast<unsigned long long>(__popcll(lanes)));
+}
 
-    // Write to global memory based on template params
-    // If hasAlpha is true, write the alpha channel as well
-    // if casMode == 0 -> write planar RGB (slower, strided writes)
+// Write one output pixel to global memory based on template params
+// If hasAlpha is true, write the alpha channel as well
+// if casMode == 0 -> write planar RGB (slower, strided writes), planeSize pixels per plane
+template <class Sample, bool hasAlpha, int casMode>
+inline __device__ void storePixel(Sample* casOutput, const int outputIndex, const int planeSize, const Sample colorR, const Sample colorG, const Sample colorB, const Sample alpha) {
     if constexpr (casMode == RGB) {
         casOutput[outputIndex] = colorR;
-        casOutput[width * height + outputIndex] = colorG;
-        casOutput[width * height * 2 + outputIndex] = colorB;
+        casOutput[planeSize + outputIndex] = colorG;
+        casOutput[planeSize * 2 + outputIndex] = colorB;
         if constexpr (hasAlpha)
-            casOutput[width * height * 3 + outputIndex] = halfToUchar(__high2half(currentPixel.y));
+            casOutput[planeSize * 3 + outputIndex] = alpha;
     }
     // write interleaved RGBA
-    else {
+    else if constexpr (std::is_same_v<Sample, unsigned char>) {
         // if alpha is needed, we fully utilize the memory coalescing by writing 4 bytes at once (1 memory transaction)
         if constexpr (hasAlpha)
-            casOutput[outputIndex] = make_uchar4(colorR, colorG, colorB, halfToUchar(__high2half(currentPixel.y)));
+            reinterpret_cast<uchar4*>(casOutput)[outputIndex] = make_uchar4(colorR, colorG, colorB, alpha);
         else
             // uchar3 won't help with coalescing versus unsigned char* because of same alignment (1 byte)
             // the compiler issues three memory transactions, but it is far better than writing an extra uchar and transfering it to the host
-            casOutput[outputIndex] = make_uchar3(colorR, colorG, colorB);
+            reinterpret_cast<uchar3*>(casOutput)[outputIndex] = make_uchar3(colorR, colorG, colorB);
+    }
+    // wider samples: one sample per channel
+    else {
+        Sample* pixel = casOutput + outputIndex * (hasAlpha ? 4 : 3);
+        pixel[0] = colorR;
+        pixel[1] = colorG;
+        pixel[2] = colorB;
+        if constexpr (hasAlpha)
+            pixel[3] = alpha;
+    }
+}
+
+// Main CAS kernel
+// Template: Sample: output sample type (unsigned char: 8-bit sRGB, unsigned short: 16-bit unorm, half, float: linear)
+//           hasAlpha: whether the input image has an alpha channel
+//			 casMode: whether the output image should be written as interleaved RGBA or planar RGB
+//			 cacheMode: whether the intermediates are computed, computed and stored, or loaded from the cache
+// Params:   texObj: input texture object (sRGB, or linear for the 16-bit and float formats), read as linear floats
+//		     sharpenStrength: sharpening strength
+//		     contrastAdaption: contrast adaption
+//		     casOutput: output buffer (height * width pixels of the sharpened rectangle, packed samples)
+//		     height: height of the sharpened rectangle
+//		     width: width of the sharpened rectangle
+//		     originX, originY: texel of the top-left corner of the rectangle (0, 0 for the whole texture)
+//		     imageWidth: width of the input texture, row stride of the cache
+//		     cache: per pixel intermediates of the whole texture, unused for CACHE_NONE
+//		     alphaSkipped: device counter of the pixels skipped by the alpha early-out (nullptr = not counted)
+// Returns:  None
+template <class Sample, bool hasAlpha, int casMode, int cacheMode = CACHE_NONE>
+__global__ void cas(hipTextureObject_t texObj, const float sharpenStrength, const float contrastAdaption, Sample* casOutput, const unsigned int height, const unsigned int width,
+                    const unsigned int originX, const unsigned int originY, const unsigned int imageWidth, CASIntermediate* cache = nullptr,
+                    unsigned long long* alphaSkipped = nullptr) {
+    const int outX = blockIdx.x * blockDim.x + threadIdx.x;
+    const int outY = blockIdx.y * blockDim.y + threadIdx.y;
+    const int outputIndex = (outY * width) + outX;
+
+    if (outX >= width || outY >= height)
+        return;
+    // texel of the pixel, the neighborhood reads the halo of a region from the full texture
+    const int x = outX + originX;
+    const int y = outY + originY;
+    const int cacheIndex = (y * imageWidth) + x;
+
+    const half4 currentPixel = make_half4(fetchTexel(texObj, x, y));
+    // speedup if alpha is zero -> just write the alpha value only and return
+    if constexpr (hasAlpha) {
+        if (__high2half(currentPixel.y) == __float2half(0.0f)) {
+            if (alphaSkipped)
+                countSkipped(alphaSkipped);
+            const Sample zero = encodeAlpha<Sample>(__float2half(0.0f));
+            if constexpr (casMode == RGB)
+                casOutput[width * height * 3 + outputIndex] = zero;
+            else if constexpr (std::is_same_v<Sample, unsigned char>)
+                reinterpret_cast<uchar4*>(casOutput)[outputIndex] = make_uchar4(0, 0, 0, 0);
+            else
+                for (int channel = 0; channel < 4; ++channel)
+                    casOutput[outputIndex * 4 + channel] = zero;
+            return;
+        }
+    }
+    const half3 e = make_half3(currentPixel);
+    half3 ampRGB, filterWindow;
+    if constexpr (cacheMode == CACHE_USE) {
+        const CASIntermediate cached = cache[cacheIndex];
+        ampRGB = make_half3(cached.ampRG, __low2half(cached.ampBWindowR));
+        filterWindow = make_half3(__halves2half2(__high2half(cached.ampBWindowR), __low2half(cached.windowGB)), __high2half(cached.windowGB));
+    } else {
+        casNeighborhood(texObj, x, y, e, ampRGB, filterWindow);
+        if constexpr (cacheMode == CACHE_FILL)
+            cache[cacheIndex] = CASIntermediate{ampRGB.x, __halves2half2(ampRGB.y, __low2half(filterWindow.x)), __halves2half2(__high2half(filterWindow.x), filterWindow.y)};
+    }
+
+    const half3 sharpenedValues = casShape(e, ampRGB, filterWindow, sharpenStrength, contrastAdaption);
+
+    // convert to the output samples (uchar sRGB by default)
+    const Sample colorR = encodeColor<Sample>(__low2half(sharpenedValues.x));
+    const Sample colorG = encodeColor<Sample>(__high2half(sharpenedValues.x));
+    const Sample colorB = encodeColor<Sample>(sharpenedValues.y);
+    storePixel<Sample, hasAlpha, casMode>(casOutput, outputIndex, width * height, colorR, colorG, colorB, encodeAlpha<Sample>(__high2half(currentPixel.y)));
+}
+
+// Scaled CAS kernel (scaling mode): sharpens the whole texture and resizes it in the same pass, each output pixel reads its footprint from the texture
+// (same filters as the CPU engine, see CASCpuScaled.hpp)
+// Template: Sample, hasAlpha, casMode: see cas
+//           area: downscaling, the coverage weighted average of the sharpened texels under the output pixel (premultiplied by alpha), else upscaling with the
+//                 CAS scaling filter: the sharpening filters of the 4 texels around the output position blended with bilinear weights, thinned along edges
+// Params:   texObj, sharpenStrength, contrastAdaption: see cas
+//           casOutput: output buffer (rowCount * outWidth pixels, packed samples)
+//           outHeight, outWidth: size of the resized image
+//           firstRow, rowCount: rows of the resized image computed by the grid
+//           height, width: size of the input texture
+// Returns:  None
+template <class Sample, bool hasAlpha, int casMode, bool area>
+__global__ void casScaled(hipTextureObject_t texObj, const float sharpenStrength, const float contrastAdaption, Sample* casOutput, const unsigned int outHeight,
+                          const unsigned int outWidth, const unsigned int firstRow, const unsigned int rowCount, const unsigned int height, const unsigned int width) {
+    const int outX = blockIdx.x * blockDim.x + threadIdx.x;
+    const int outY = firstRow + blockIdx.y * blockDim.y + threadIdx.y;
+    if (outX >= outWidth || outY >= firstRow + rowCount)
+        return;
+    const float scaleX = static_cast<float>(width) / outWidth, scaleY = static_cast<float>(height) / outHeight;
+    float color[3] = {0.0f, 0.0f, 0.0f};
+    float alpha = 0.0f;
+    if constexpr (area) {
+        // footprint [lo, hi) of the output pixel, each texel weighted by its coverage
+        const float loX = outX * scaleX, hiX = fminf((outX + 1) * scaleX, static_cast<float>(width));
+        const float loY = outY * scaleY, hiY = fminf((outY + 1) * scaleY, static_cast<float>(height));
+        const int firstX = min(static_cast<int>(loX), static_cast<int>(width) - 1), endX = max(min(static_cast<int>(ceilf(hiX)), static_cast<int>(width)), firstX + 1);
+        const int firstY = min(static_cast<int>(loY), static_cast<int>(height) - 1), endY = max(min(static_cast<int>(ceilf(hiY)), static_cast<int>(height)), firstY + 1);
+        float coverageSum = 0.0f;
+        for (int y = firstY; y < endY; y++) {
+            const float coverageY = fmaxf(0.0f, fminf(y + 1.0f, hiY) - fmaxf(static_cast<float>(y), loY));
+            for (int x = firstX; x < endX; x++) {
+                const float coverage = coverageY * fmaxf(0.0f, fminf(x + 1.0f, hiX) - fmaxf(static_cast<float>(x), loX));
+                const float4 texel = fetchTexel(texObj, x, y);
+                const half3 e = make_half3(texel);
+                half3 ampRGB, filterWindow;
+                casNeighborhood(texObj, x, y, e, ampRGB, filterWindow);
+                const half3 sharpened = casShape(e, ampRGB, filterWindow, sharpenStrength, contrastAdaption);
+                // premultiplied by alpha: transparent texels do not bleed their color
+                const float weight = hasAlpha ? coverage * texel.w : coverage;
+                color[0] += weight * __low2float(sharpened.x);
+                color[1] += weight * __high2float(sharpened.x);
+                color[2] += weight * __half2float(sharpened.y);
+                alpha += weight;
+                coverageSum += coverage;
+            }
+        }
+        const float rcpWeight = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+        for (int channel = 0; channel < 3; channel++)
+            color[channel] *= rcpWeight;
+        alpha = coverageSum > 0.0f ? alpha / coverageSum : 0.0f;
+    } else {
+        // position of the output pixel in the texture (pixel centers aligned), clamped to the image: corners f g / j k and their bilinear weights s t / u v
+        const float positionX = fminf(fmaxf((outX + 0.5f) * scaleX - 0.5f, 0.0f), width - 1.0f), positionY = fminf(fmaxf((outY + 0.5f) * scaleY - 0.5f, 0.0f), height - 1.0f);
+        const int x0 = min(static_cast<int>(positionX), static_cast<int>(width) - 1), y0 = min(static_cast<int>(positionY), static_cast<int>(height) - 1);
+        const int cornersX[2] = {x0, min(x0 + 1, static_cast<int>(width) - 1)}, cornersY[2] = {y0, min(y0 + 1, static_cast<int>(height) - 1)};
+        const float fx = positionX - x0, fy = positionY - y0;
+        const float bilinear[4] = {(1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy};
+        float sum[3] = {0.0f, 0.0f, 0.0f}, weight[3] = {0.0f, 0.0f, 0.0f};
+        for (int q = 0; q < 4; q++) {
+            const int x = cornersX[q & 1], y = cornersY[q >> 1];
+            const float4 texel = fetchTexel(texObj, x, y);
+            const half3 e = make_half3(texel);
+            half3 ampRGB, filterWindow;
+            half greenRange;
+            casNeighborhood(texObj, x, y, e, ampRGB, filterWindow, &greenRange);
+            const half3 wRGB = casPeak(ampRGB, contrastAdaption);
+            // thin edges to hide the bilinear interpolation
+            const float thinned = bilinear[q] / (1.0f / 32.0f + __half2float(greenRange));
+            const float values[3] = {texel.x, texel.y, texel.z};
+            const float windows[3] = {__low2float(filterWindow.x), __high2float(filterWindow.x), __half2float(filterWindow.y)};
+            const float peaks[3] = {__low2float(wRGB.x), __high2float(wRGB.x), __half2float(wRGB.y)};
+            for (int channel = 0; channel < 3; channel++) {
+                sum[channel] += thinned * (values[channel] + peaks[channel] * windows[channel]);
+                weight[channel] += thinned * (4.0f * peaks[channel] + 1.0f);
+                color[channel] += bilinear[q] * values[channel];
+            }
+            alpha += bilinear[q] * texel.w;
+        }
+        // lerp from the plain bilinear value by the sharpening strength
+        for (int channel = 0; channel < 3; channel++)
+            color[channel] += sharpenStrength * (__saturatef(sum[channel] / weight[channel]) - color[channel]);
+    }
+    const int outputIndex = (outY - firstRow) * outWidth + outX;
+    const half alphaValue = __float2half(alpha);
+    if constexpr (hasAlpha) {
+        if (alphaValue == __float2half(0.0f)) {
+            const Sample zero = encodeAlpha<Sample>(alphaValue);
+            storePixel<Sample, hasAlpha, casMode>(casOutput, outputIndex, outWidth * rowCount, zero, zero, zero, zero);
+            return;
+        }
+    }
+    storePixel<Sample, hasAlpha, casMode>(casOutput, outputIndex, outWidth * rowCount, encodeColor<Sample>(__float2half(color[0])), encodeColor<Sample>(__float2half(color[1])),
+                                          encodeColor<Sample>(__float2half(color[2])), encodeAlpha<Sample>(alphaValue));
+}
+
+// Input expansion kernel: converts an image uploaded in its own pixel format into the RGBA layout of the texture (on the device, the host transfers only its own bytes)
+// Params:   input: pixels in a CASPixelFormat, rowBytes bytes per row, the planes of the planar formats are consecutive blocks of rows rows
+//           pixelFormat: CASPixelFormat of the input
+//           rgba: packed RGBA output, rows * cols pixels (opaque when the format has no alpha)
+// Returns:  None
+__global__ void expandToRgba(const unsigned char* input, const size_t rowBytes, const int pixelFormat, uchar4* rgba, const unsigned int rows, const unsigned int cols) {
+    const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= cols || y >= rows)
+        return;
+    const unsigned char* row = input + y * rowBytes;
+    const size_t planeSize = rowBytes * rows;
+    uchar4 pixel;
+    switch (pixelFormat) {
+    case CAS_FORMAT_BGRA8: pixel = make_uchar4(row[x * 4 + 2], row[x * 4 + 1], row[x * 4], row[x * 4 + 3]); break;
+    case CAS_FORMAT_RGB8: pixel = make_uchar4(row[x * 3], row[x * 3 + 1], row[x * 3 + 2], 255); break;
+    case CAS_FORMAT_BGR8: pixel = make_uchar4(row[x * 3 + 2], row[x * 3 + 1], row[x * 3], 255); break;
+    case CAS_FORMAT_GRAY8: pixel = make_uchar4(row[x], row[x], row[x], 255); break;
+    case CAS_FORMAT_PLANAR_RGB8: pixel = make_uchar4(row[x], row[planeSize + x], row[planeSize * 2 + x], 255); break;
+    case CAS_FORMAT_PLANAR_RGBA8: pixel = make_uchar4(row[x], row[planeSize + x], row[planeSize * 2 + x], row[planeSize * 3 + x]); break;
+    default: pixel = make_uchar4(row[x * 4], row[x * 4 + 1], row[x * 4 + 2], row[x * 4 + 3]); break;
     }
+    rgba[static_cast<size_t>(y) * cols + x] = pixel;
 }
@@ -0,0 +1,159 @@
+#include "CASAsync.hpp"
+#include "CASBackend.hpp"
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+CASAsync::CASAsync(CASBackend& backend) : backend(backend), worker(&CASAsync::run, this) {}
+
+CASAsync::~CASAsync() {
+    std::deque<std::pair<unsigned int, Job>> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        cancelled.swap(queue);
+    }
+    changed.notify_all();
+    worker.join();
+    for (const auto& [ticket, job] : cancelled)
+        if (job.callback)
+            job.callback(job.userData, ticket, CAS_STATUS_CANCELLED);
+}
+
+int CASAsync::freeBuffer() const { return bufferOwner[0] == 0 ? 0 : bufferOwner[1] == 0 ? 1 : -1; }
+
+// call the callback of a completed or cancelled job without holding the lock, then wake the callers waiting for it (the callback may have released the ticket)
+void CASAsync::notify(std::unique_lock<std::mutex>& lock, const unsigned int ticket, const Job& job, const int status) {
+    if (job.callback) {
+        lock.unlock();
+        job.callback(job.userData, ticket, status);
+        lock.lock();
+    }
+    const auto it = tickets.find(ticket);
+    if (it != tickets.end())
+        it->second.notified = true;
+    changed.notify_all();
+}
+
+// worker loop: run the oldest job once it can (a caller-owned output, or a free internal buffer), the callbacks are called without holding the lock
+void CASAsync::run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return stopping || (!queue.empty() && (queue.front().second.output || freeBuffer() >= 0)); });
+        if (stopping)
+            return;
+        const auto [ticket, job] = queue.front();
+        queue.pop_front();
+        const int buffer = job.output ? -1 : freeBuffer();
+        if (buffer >= 0)
+            bufferOwner[buffer] = ticket;
+        tickets[ticket].buffer = buffer;
+        lock.unlock();
+
+        int status = CAS_STATUS_OK;
+        try {
+            if (job.inputFrame)
+                backend.supplyFrame(job.inputFrame, job.inputStride);
+            unsigned char* output = job.output;
+            std::size_t outputStride = job.outputStride;
+            // internal buffer: packed rows, the layout of CAS_sharpenImage
+            if (buffer >= 0) {
+                outputStride = CASBackend::rowBytes(backend.imageHasAlpha(), job.casMode, backend.imageCols(), backend.outputFormat());
+                const std::size_t outputRows = static_cast<std::size_t>(backend.imageRows()) * (job.casMode == PLANAR_RGB ? (backend.imageHasAlpha() ? 4 : 3) : 1);
+                buffers[buffer].resize(outputStride * outputRows);
+                output = buffers[buffer].data();
+            }
+            backend.sharpenImageInto(job.casMode, job.sharpenStrength, job.contrastAdaption, output, outputStride);
+        } catch (const std::exception&) { status = CAS_STATUS_FAILED; }
+
+        lock.lock();
+        TicketState& state = tickets[ticket];
+        state.status = status;
+        // a failed job holds no result
+        if (status != CAS_STATUS_OK && buffer >= 0) {
+            bufferOwner[buffer] = 0;
+            state.buffer = -1;
+        }
+        // the freed buffer may let the next job run
+        changed.notify_all();
+        notify(lock, ticket, job, status);
+    }
+}
+
+unsigned int CASAsync::submit(const Job& job) {
+    std::lock_guard lock(mutex);
+    const unsigned int ticket = nextTicket++;
+    // 0 is never a valid ticket
+    if (nextTicket == 0)
+        nextTicket = 1;
+    tickets[ticket] = TicketState{CAS_STATUS_PENDING, -1, false};
+    queue.emplace_back(ticket, job);
+    changed.notify_all();
+    return ticket;
+}
+
+int CASAsync::poll(const unsigned int ticket) {
+    std::lock_guard lock(mutex);
+    const auto it = tickets.find(ticket);
+    return it == tickets.end() ? CAS_STATUS_INVALID_ARGUMENT : it->second.status;
+}
+
+int CASAsync::wait(const unsigned int ticket) {
+    std::unique_lock lock(mutex);
+    int status = CAS_STATUS_PENDING;
+    changed.wait(lock, [&] {
+        const auto it = tickets.find(ticket);
+        if (it == tickets.end()) {
+            status = CAS_STATUS_INVALID_ARGUMENT;
+            return true;
+        }
+        status = it->second.status;
+        return it->second.notified;
+    });
+    return status;
+}
+
+int CASAsync::cancel(const unsigned int ticket) {
+    std::unique_lock lock(mutex);
+    const auto it = tickets.find(ticket);
+    if (it == tickets.end())
+        return CAS_STATUS_INVALID_ARGUMENT;
+    for (auto queued = queue.begin(); queued != queue.end(); ++queued) {
+        if (queued->first != ticket)
+            continue;
+        const Job job = queued->second;
+        queue.erase(queued);
+        it->second.status = CAS_STATUS_CANCELLED;
+        // the next job may be able to run now
+        changed.notify_all();
+        notify(lock, ticket, job, CAS_STATUS_CANCELLED);
+        return CAS_STATUS_CANCELLED;
+    }
+    return it->second.status;
+}
+
+const unsigned char* CASAsync::result(const unsigned int ticket) {
+    std::lock_guard lock(mutex);
+    const auto it = tickets.find(ticket);
+    if (it == tickets.end() || it->second.status != CAS_STATUS_OK || it->second.buffer < 0)
+        return nullptr;
+    return buffers[it->second.buffer].data();
+}
+
+int CASAsync::release(const unsigned int ticket) {
+    std::lock_guard lock(mutex);
+    const auto it = tickets.find(ticket);
+    if (it == tickets.end())
+        return CAS_STATUS_INVALID_ARGUMENT;
+    const int status = it->second.status;
+    if (status == CAS_STATUS_PENDING)
+        return status;
+    if (it->second.buffer >= 0) {
+        bufferOwner[it->second.buffer] = 0;
+        // a queued job may be waiting for this buffer
+        changed.notify_all();
+    }
+    tickets.erase(it);
+    return status;
+}
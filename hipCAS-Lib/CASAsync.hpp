@@ -0,0 +1,80 @@
+#pragma once
+#include "include/CASLibWrapper.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CASBackend;
+
+// Asynchronous jobs of one CAS instance: submitted jobs are queued and run in submission order by a worker thread, each one is identified by a ticket
+// Jobs without a caller-owned output write into one of two internal buffers (double buffering): one result can be read while the next job is computing.
+// A job waits for a free buffer when both hold results that have not been released yet.
+class CASAsync {
+  public:
+    struct Job {
+        int casMode;
+        float sharpenStrength, contrastAdaption;
+        // next frame of the supplied image, uploaded by the job (nullptr = the supplied image as is)
+        const unsigned char* inputFrame;
+        std::size_t inputStride;
+        // caller-owned output (nullptr = an internal buffer)
+        unsigned char* output;
+        std::size_t outputStride;
+        CASCompletionCallback callback;
+        void* userData;
+    };
+
+  private:
+    // state of a ticket until it is released: CASStatus, CAS_STATUS_PENDING while queued or running; internal buffer of its result (-1 = none);
+    // whether its callback has returned (the status is set before the callback, so that it can read the result, waiting callers are woken after it)
+    struct TicketState {
+        int status;
+        int buffer;
+        bool notified;
+    };
+
+    CASBackend& backend;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::pair<unsigned int, Job>> queue;
+    std::unordered_map<unsigned int, TicketState> tickets;
+    std::vector<unsigned char> buffers[2];
+    // ticket whose result is in each internal buffer, 0 = free
+    unsigned int bufferOwner[2]{0, 0};
+    unsigned int nextTicket{1};
+    bool stopping{false};
+    // started last, once everything it uses is initialized
+    std::thread worker;
+
+    int freeBuffer() const;
+    void notify(std::unique_lock<std::mutex>& lock, const unsigned int ticket, const Job& job, const int status);
+    void run();
+
+  public:
+    explicit CASAsync(CASBackend& backend);
+    // cancels the queued jobs and waits for the running one
+    ~CASAsync();
+
+    // delete move/copy ctors/operators, not useful for a DLL class
+    CASAsync(const CASAsync& other) = delete;
+    CASAsync(CASAsync&& other) noexcept = delete;
+    CASAsync& operator=(CASAsync&& other) noexcept = delete;
+    CASAsync& operator=(const CASAsync& other) = delete;
+
+    // queue a job, returns its ticket
+    unsigned int submit(const Job& job);
+    // status of a ticket, CAS_STATUS_INVALID_ARGUMENT for an unknown (or released) one
+    int poll(const unsigned int ticket);
+    // block until the job of the ticket has completed and its callback has returned, returns its status
+    int wait(const unsigned int ticket);
+    // drop a queued job (its callback is called from here), no effect on a running or completed one, returns the status of the ticket
+    int cancel(const unsigned int ticket);
+    // internal buffer holding the result of a completed job, nullptr if it has none
+    const unsigned char* result(const unsigned int ticket);
+    // forget a completed ticket and give its internal buffer back, returns its status (CAS_STATUS_PENDING: not completed, not released)
+    int release(const unsigned int ticket);
+};
@@ -0,0 +1,119 @@
+#include "CASAsync.hpp"
+#include "CASBackend.hpp"
+#include "CASContext.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+CASBackend::CASBackend() = default;
+CASBackend::~CASBackend() = default;
+
+CASAsync& CASBackend::jobs() {
+    std::call_once(asyncJobsCreated, [this] { asyncJobs = std::make_unique<CASAsync>(*this); });
+    return *asyncJobs;
+}
+
+void CASBackend::stopJobs() { asyncJobs.reset(); }
+
+bool CASBackend::isValid(const CASImageDesc& image) {
+    return image.inputImage && image.outputImage && image.rows > 0 && image.cols > 0 && (image.casMode == PLANAR_RGB || image.casMode == INTERLEAVED_RGBA);
+}
+
+// the images go through a second session of the context, which keeps the 8-bit sRGB output of batches and its buffers between them
+// its counters are added to those of this instance after each batch
+unsigned int CASBackend::sharpenBatch(CASImageDesc* images, const unsigned int count) {
+    if (!batchSession)
+        batchSession.reset(sharedContext().createSession());
+    CASBackend& session = *batchSession;
+    session.resetStats();
+    unsigned int failed = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        CASImageDesc& image = images[i];
+        image.elapsedMs = 0.0;
+        if (!isValid(image)) {
+            image.status = CAS_STATUS_INVALID_ARGUMENT;
+            failed++;
+            continue;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            session.reinitializeMemory(image.hasAlpha, image.inputImage, CAS_FORMAT_RGBA8, static_cast<std::size_t>(image.cols) * 4, image.rows, image.cols);
+            session.sharpenImageInto(image.casMode, image.sharpenStrength, image.contrastAdaption, image.outputImage, rowBytes(image.hasAlpha, image.casMode, image.cols, CAS_SAMPLE_SRGB8));
+            image.status = CAS_STATUS_OK;
+        } catch (const std::exception&) {
+            image.status = CAS_STATUS_FAILED;
+            failed++;
+        }
+        image.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    counters.add(session.stats());
+    return failed;
+}
+
+// the profile is only searched again when the image class changes or the profile does
+const CASTuning& CASBackend::tuning(const int casMode) const {
+    if (trialTuning)
+        return *trialTuning;
+    TuningLookup& lookup = tuningLookups[casMode == PLANAR_RGB ? 0 : 1];
+    CASTuningProfile& profile = sharedContext().tuningProfile();
+    const unsigned int version = profile.version();
+    if (!lookup.valid || lookup.version != version || lookup.rows != imageRows() || lookup.cols != imageCols() || lookup.hasAlpha != imageHasAlpha()) {
+        lookup = TuningLookup{true, version, imageRows(), imageCols(), imageHasAlpha(), CASTuning{}};
+        profile.find(CASTuningKey{name(), CASTuningProfile::bucket(imageRows(), imageCols()), imageHasAlpha(), casMode}, lookup.tuning);
+    }
+    return lookup.tuning;
+}
+
+// every candidate sharpens the whole image into a scratch buffer: one warm-up call, then the median of at least 3 calls and 50 ms
+// a candidate replaces the best one when it is more than 2% faster (timing noise), the defaults are timed first
+bool CASBackend::autoTune(const int casMode, CASTuning& result) {
+    using Clock = std::chrono::steady_clock;
+    if (tuningCandidates(0, CASTuning{}).empty())
+        return false;
+    const unsigned int rows = imageRows(), cols = imageCols();
+    const std::size_t stride = rowBytes(imageHasAlpha(), casMode, cols, outputFormat());
+    std::vector<unsigned char> output(stride * (casMode == PLANAR_RGB ? rows * (imageHasAlpha() ? 4 : 3) : rows));
+    const auto measure = [&](CASTuning& candidate) {
+        trialTuning = candidate;
+        sharpenImageInto(casMode, 1.0f, 1.0f, output.data(), stride);
+        std::vector<double> seconds;
+        const Clock::time_point start = Clock::now();
+        while (seconds.size() < 3 || Clock::now() - start < std::chrono::milliseconds(50)) {
+            const Clock::time_point callStart = Clock::now();
+            sharpenImageInto(casMode, 1.0f, 1.0f, output.data(), stride);
+            seconds.push_back(std::chrono::duration<double>(Clock::now() - callStart).count());
+        }
+        std::nth_element(seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end());
+        candidate.megapixelsPerSecond = static_cast<double>(rows) * cols / seconds[seconds.size() / 2] * 1e-6;
+    };
+    const auto sameParameters = [](const CASTuning& a, const CASTuning& b) {
+        return a.tileRows == b.tileRows && a.tileCols == b.tileCols && a.threads == b.threads && a.blockX == b.blockX && a.blockY == b.blockY;
+    };
+    CASTuning best{};
+    try {
+        measure(best);
+        for (unsigned int axis = 0;; axis++) {
+            std::vector<CASTuning> candidates = tuningCandidates(axis, best);
+            if (candidates.empty())
+                break;
+            const CASTuning current = best;
+            for (CASTuning& candidate : candidates) {
+                if (sameParameters(candidate, current))
+                    continue;
+                measure(candidate);
+                if (candidate.megapixelsPerSecond > best.megapixelsPerSecond * 1.02)
+                    best = candidate;
+            }
+        }
+    } catch (...) {
+        trialTuning.reset();
+        throw;
+    }
+    trialTuning.reset();
+    sharedContext().tuningProfile().set(CASTuningKey{name(), CASTuningProfile::bucket(rows, cols), imageHasAlpha(), casMode}, best);
+    result = best;
+    return true;
+}
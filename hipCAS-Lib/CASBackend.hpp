@@ -0,0 +1,166 @@
+#pragma once
+#include "CASCounters.hpp"
+#include "include/CASLibWrapper.h"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+class CASAsync;
+class CASContext;
+
+enum CASMode { PLANAR_RGB, INTERLEAVED_RGBA };
+
+// Common interface of the CAS execution engines (HIP device or native CPU), used by the C API
+class CASBackend {
+  private:
+    std::unique_ptr<CASAsync> asyncJobs;
+    std::once_flag asyncJobsCreated;
+    // candidate timed by autoTune, used instead of the profile
+    std::optional<CASTuning> trialTuning;
+    // last profile lookup of each casMode: the image class and profile version it is valid for
+    struct TuningLookup {
+        bool valid = false;
+        unsigned int version = 0, rows = 0, cols = 0;
+        bool hasAlpha = false;
+        CASTuning tuning{};
+    };
+    mutable std::array<TuningLookup, 2> tuningLookups;
+    // session of the same context running the batches of the default sharpenBatch, so that the supplied image of this one stays; created on first use
+    std::unique_ptr<CASBackend> batchSession;
+
+  public:
+    // out of line: the job queue is an incomplete type here
+    CASBackend();
+    virtual ~CASBackend();
+
+    // (re)initialize the internal memory with the new image and upload its (sRGB) pixels, in a CASPixelFormat with inputStride bytes between two rows (of a plane)
+    virtual void reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                                    const unsigned int cols) = 0;
+    // replace the pixels of the supplied image (same size, alpha and pixel format) with a new frame, inputStride bytes between two rows, without reallocating anything
+    virtual void supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) = 0;
+    // sharpen the last supplied image, returns a host buffer owned by the backend
+    virtual const unsigned char* sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) = 0;
+    // sharpen the last supplied image into a caller-owned buffer, outputStride bytes between two rows (planar: row y of plane p starts at (p * rows + y) * outputStride)
+    virtual void sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) = 0;
+    // sharpen only the rectangle [x, x + width) x [y, y + height) of the last supplied image (its one pixel halo is read from the full image) into a caller-owned buffer
+    // laid out like a width x height image, outputStride bytes between two rows (planar: row i of plane p starts at (p * height + i) * outputStride)
+    virtual void sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                                   const unsigned int height, unsigned char* output, const std::size_t outputStride) = 0;
+    // sharpen the last supplied image and resize it to outputRows x outputCols in the same pass (scaling mode, any factor), only the rows [firstRow, firstRow + rowCount)
+    // of the resized image, into a caller-owned buffer laid out like a rowCount x outputCols image, outputStride bytes between two rows
+    // (planar: row i of plane p starts at (p * rowCount + i) * outputStride)
+    virtual void sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                                   const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) = 0;
+    // engine and kernel variant, e.g. "hip" or "cpu-avx2"
+    virtual const char* name() const = 0;
+    // context this instance is a session of (its thread pool or device and the buffer pools)
+    virtual CASContext& sharedContext() const = 0;
+    // rows and columns of the supplied image, zero before the first one
+    virtual unsigned int imageRows() const = 0;
+    virtual unsigned int imageCols() const = 0;
+    virtual bool imageHasAlpha() const = 0;
+    virtual int imageFormat() const = 0;
+
+    // tiling of the work (rows x columns per tile, 0 = automatic), ignored by engines without tiling
+    virtual void setTileSize(const unsigned int /*tileRows*/, const unsigned int /*tileCols*/) {}
+    // working set (bytes) of one tile for the supplied image, 0 for engines without tiling
+    virtual std::size_t tileWorkingSetBytes() const { return 0; }
+
+    // sample format of the sharpened output (CASSampleFormat)
+    virtual void setOutputFormat(const int sampleFormat) = 0;
+    virtual int outputFormat() const = 0;
+
+    // precision tier (CASPrecision), ignored by engines without a fast tier
+    virtual void setPrecision(const int /*precision*/) {}
+
+    // memory budget (bytes) of the cached mode, 0 disables it: when the intermediates of the supplied image fit, the first sharpenImage stores them
+    // and the following calls only run the parameter dependent stage, until the image changes or the cache is invalidated
+    virtual void setCacheBudget(const std::size_t /*bytes*/) {}
+    // drop the stored intermediates, the next sharpenImage recomputes them (and the outputs kept by the sequence mode)
+    virtual void invalidateCache() {}
+
+    // sequence mode (tiles of tileSize x tileSize pixels, 0 = off): the whole image calls only sharpen the tiles whose input, with its halo, changed since the frame
+    // held by the output buffer, ignored by engines without it
+    virtual void setSequenceMode(const unsigned int /*tileSize*/) {}
+
+    // launch parameters of the calls on the supplied image in casMode (zero fields: engine defaults): the entry of the context profile, the candidate under test while tuning
+    const CASTuning& tuning(const int casMode) const;
+    // time the candidates of tuningCandidates on the supplied image, one parameter after the other, and adopt the fastest in the context profile (not saved)
+    // false for engines without launch parameters
+    bool autoTune(const int casMode, CASTuning& result);
+
+    // NUMA mode of engines with a thread pool (0 = off, n = pinned workers on the first n nodes, each sharpening a node-local band of rows),
+    // returns the threads sharpening an image in the selected mode, 0 for engines without it
+    virtual unsigned int setNumaNodes(const unsigned int /*nodeCount*/) { return 0; }
+
+    // sharpen every image of a batch into its output buffer, sets the status and timing of each one, returns the number of failures
+    // the default runs them one after the other through reinitializeMemory/sharpenImageInto of a second session of the context (the supplied image stays)
+    virtual unsigned int sharpenBatch(CASImageDesc* images, const unsigned int count);
+
+    // instrumentation of this instance (CAS_getStats), updated by the engine methods
+    const CASCounters& stats() const { return counters; }
+    void resetStats() { counters.reset(); }
+
+    // asynchronous job queue of this instance, created (with its worker thread) on first use
+    CASAsync& jobs();
+    // stop the job queue: must run while the engine is still complete, before its destruction
+    void stopJobs();
+
+    // bytes of one output sample of a CASSampleFormat, 0 for an unknown format
+    static std::size_t sampleBytes(const int sampleFormat) {
+        switch (sampleFormat) {
+        case CAS_SAMPLE_SRGB8: return 1;
+        case CAS_SAMPLE_UNORM16:
+        case CAS_SAMPLE_HALF: return 2;
+        case CAS_SAMPLE_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+    // bytes of one output row without padding: one plane row (planar) or one row of RGB(A) pixels (interleaved)
+    static std::size_t rowBytes(const bool hasAlpha, const int casMode, const unsigned int cols, const int sampleFormat) {
+        return (casMode == PLANAR_RGB ? cols : static_cast<std::size_t>(cols) * (hasAlpha ? 4 : 3)) * sampleBytes(sampleFormat);
+    }
+
+    // bytes of one input row without padding (one plane row for the planar formats) of a CASPixelFormat, 0 for an unknown format
+    static std::size_t inputRowBytes(const int pixelFormat, const unsigned int cols) {
+        switch (pixelFormat) {
+        case CAS_FORMAT_RGBA8:
+        case CAS_FORMAT_BGRA8: return static_cast<std::size_t>(cols) * 4;
+        case CAS_FORMAT_RGB8:
+        case CAS_FORMAT_BGR8: return static_cast<std::size_t>(cols) * 3;
+        case CAS_FORMAT_GRAY8:
+        case CAS_FORMAT_PLANAR_RGB8:
+        case CAS_FORMAT_PLANAR_RGBA8: return cols;
+        case CAS_FORMAT_RGBA16:
+        case CAS_FORMAT_RGBA16F: return static_cast<std::size_t>(cols) * 8;
+        case CAS_FORMAT_RGBA32F: return static_cast<std::size_t>(cols) * 16;
+        default: return 0;
+        }
+    }
+    // number of planes of a CASPixelFormat (1 for the interleaved ones)
+    static unsigned int inputPlanes(const int pixelFormat) {
+        return pixelFormat == CAS_FORMAT_PLANAR_RGB8 ? 3 : pixelFormat == CAS_FORMAT_PLANAR_RGBA8 ? 4 : 1;
+    }
+    // whether a CASPixelFormat has an alpha channel
+    static bool formatHasAlpha(const int pixelFormat) {
+        return pixelFormat == CAS_FORMAT_RGBA8 || pixelFormat == CAS_FORMAT_BGRA8 || pixelFormat == CAS_FORMAT_PLANAR_RGBA8 || isLinearFormat(pixelFormat);
+    }
+    // whether a CASPixelFormat holds linear samples (wider than 8 bits, no sRGB transfer)
+    static bool isLinearFormat(const int pixelFormat) {
+        return pixelFormat == CAS_FORMAT_RGBA16 || pixelFormat == CAS_FORMAT_RGBA16F || pixelFormat == CAS_FORMAT_RGBA32F;
+    }
+
+  protected:
+    CASCounters counters;
+
+    // true while autoTune times a candidate: the engines run the whole kernel (no cached mode, no sequence mode) with tuning() over their own tile size
+    bool tuningRun() const { return trialTuning.has_value(); }
+    // candidates of one launch parameter (axis 0, 1... of the engine, zero is its default), the other fields copied from best; empty after the last axis
+    virtual std::vector<CASTuning> tuningCandidates(const unsigned int /*axis*/, const CASTuning& /*best*/) const { return {}; }
+
+    // checks the pointers, dimensions and mode of a batch image
+    static bool isValid(const CASImageDesc& image);
+};
@@ -0,0 +1,121 @@
+#include "CASBufferPool.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+
+CASBufferPool::CASBufferPool(Allocate allocate, Deallocate deallocate, const std::size_t limit)
+    : allocate(std::move(allocate)), deallocate(std::move(deallocate)), limit(limit) {}
+
+CASBufferPool::~CASBufferPool() { trimLocked(0); }
+
+std::size_t CASBufferPool::sizeClass(const std::size_t bytes) { return std::bit_ceil(std::max<std::size_t>(bytes, 4096)); }
+
+void* CASBufferPool::acquire(const std::size_t key, const std::size_t bytes, bool& allocated) {
+    {
+        std::lock_guard lock(mutex);
+        const auto it = idle.find(key);
+        if (it != idle.end() && !it->second.buffers.empty()) {
+            void* buffer = it->second.buffers.back();
+            it->second.buffers.pop_back();
+            idleBytes -= bytes;
+            idleBuffers--;
+            hits++;
+            allocated = false;
+            return buffer;
+        }
+        misses++;
+    }
+    // allocate outside the lock: the other sessions keep using the pool meanwhile
+    void* buffer = allocate(key);
+    if (!buffer)
+        throw std::bad_alloc();
+    allocated = true;
+    return buffer;
+}
+
+void CASBufferPool::release(void* buffer, const std::size_t key, const std::size_t bytes) {
+    if (!buffer)
+        return;
+    {
+        std::lock_guard lock(mutex);
+        if (idleBytes + bytes <= limit) {
+            IdleClass& idleClass = idle[key];
+            idleClass.bytes = bytes;
+            idleClass.buffers.push_back(buffer);
+            idleBytes += bytes;
+            idleBuffers++;
+            return;
+        }
+        trimmedBytes += bytes;
+    }
+    deallocate(buffer);
+}
+
+void CASBufferPool::trimLocked(const std::size_t bytes) {
+    for (auto it = idle.rbegin(); it != idle.rend() && idleBytes > bytes; ++it) {
+        IdleClass& idleClass = it->second;
+        while (!idleClass.buffers.empty() && idleBytes > bytes) {
+            deallocate(idleClass.buffers.back());
+            idleClass.buffers.pop_back();
+            idleBytes -= idleClass.bytes;
+            idleBuffers--;
+            trimmedBytes += idleClass.bytes;
+        }
+    }
+}
+
+void CASBufferPool::setLimit(const std::size_t bytes) {
+    std::lock_guard lock(mutex);
+    limit = bytes;
+    trimLocked(limit);
+}
+
+void CASBufferPool::trim(const std::size_t bytes) {
+    std::lock_guard lock(mutex);
+    trimLocked(bytes);
+}
+
+void CASBufferPool::read(CASPoolStats& stats) const {
+    std::lock_guard lock(mutex);
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.idleBuffers = idleBuffers;
+    stats.idleBytes = idleBytes;
+    stats.limitBytes = limit;
+    stats.trimmedBytes = trimmedBytes;
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : pool(std::exchange(other.pool, nullptr)), pointer(std::exchange(other.pointer, nullptr)), key(std::exchange(other.key, 0)), bytes(std::exchange(other.bytes, 0)) {}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool = std::exchange(other.pool, nullptr);
+        pointer = std::exchange(other.pointer, nullptr);
+        key = std::exchange(other.key, 0);
+        bytes = std::exchange(other.bytes, 0);
+    }
+    return *this;
+}
+
+bool PooledBuffer::acquire(CASBufferPool& pool, const std::size_t key, const std::size_t bytes) {
+    reset();
+    bool allocated = false;
+    pointer = pool.acquire(key, bytes, allocated);
+    this->pool = &pool;
+    this->key = key;
+    this->bytes = bytes;
+    return allocated;
+}
+
+void PooledBuffer::reset() {
+    if (pool)
+        pool->release(pointer, key, bytes);
+    pool = nullptr;
+    pointer = nullptr;
+    key = bytes = 0;
+}
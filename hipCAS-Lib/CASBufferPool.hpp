@@ -0,0 +1,90 @@
+#pragma once
+#include "include/CASLibWrapper.h"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Pool of the internal buffers of one memory kind (host, pinned, device, texture arrays), shared by the sessions of a context
+// Released buffers are kept idle by class (the power-of-two size class of a byte buffer, the exact shape of a texture array) and handed out again by the
+// next acquire of the same class, so a workload alternating between a few resolutions stops allocating after its first images.
+// The idle bytes are bounded by a high-water limit: a release beyond it frees the buffer, and a lower limit trims the idle ones (largest classes first).
+class CASBufferPool {
+  public:
+    // allocate(key) returns a new buffer of the class key (nullptr on failure), deallocate frees one
+    using Allocate = std::function<void*(std::size_t)>;
+    using Deallocate = std::function<void(void*)>;
+
+  private:
+    const Allocate allocate;
+    const Deallocate deallocate;
+    mutable std::mutex mutex;
+    // idle buffers by class, with the bytes of one buffer of the class
+    struct IdleClass {
+        std::size_t bytes = 0;
+        std::vector<void*> buffers;
+    };
+    std::map<std::size_t, IdleClass> idle;
+    std::size_t idleBytes{0}, idleBuffers{0}, limit;
+    unsigned long long hits{0}, misses{0}, trimmedBytes{0};
+
+    // free idle buffers (largest classes first) until at most bytes are idle, under the lock
+    void trimLocked(const std::size_t bytes);
+
+  public:
+    // the default limit keeps the buffers of a few 4K images of every kind
+    static constexpr std::size_t defaultLimit = std::size_t(1) << 30;
+
+    CASBufferPool(Allocate allocate, Deallocate deallocate, const std::size_t limit = defaultLimit);
+    // frees the idle buffers, the acquired ones must have been released
+    ~CASBufferPool();
+
+    CASBufferPool(const CASBufferPool& other) = delete;
+    CASBufferPool(CASBufferPool&& other) noexcept = delete;
+    CASBufferPool& operator=(CASBufferPool&& other) noexcept = delete;
+    CASBufferPool& operator=(const CASBufferPool& other) = delete;
+
+    // class of a byte buffer: the next power of two, at least 4KB
+    static std::size_t sizeClass(const std::size_t bytes);
+
+    // an idle buffer of the class key (bytes each), else a new one; allocated tells whether it is new. Throws std::bad_alloc when the allocation fails
+    void* acquire(const std::size_t key, const std::size_t bytes, bool& allocated);
+    // give a buffer of acquire(key, bytes) back, it is freed when the idle bytes would exceed the limit
+    void release(void* buffer, const std::size_t key, const std::size_t bytes);
+
+    void setLimit(const std::size_t bytes);
+    void trim(const std::size_t bytes);
+    void read(CASPoolStats& stats) const;
+};
+
+// Buffer of a pool, given back when replaced, reset or destroyed
+class PooledBuffer {
+  private:
+    CASBufferPool* pool{nullptr};
+    void* pointer{nullptr};
+    std::size_t key{0}, bytes{0};
+
+  public:
+    PooledBuffer() = default;
+    ~PooledBuffer() { reset(); }
+
+    PooledBuffer(const PooledBuffer& other) = delete;
+    PooledBuffer& operator=(const PooledBuffer& other) = delete;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    // take a buffer of the class key from a pool (the previous one is given back first, so it can be taken again), true when the pool allocated it
+    bool acquire(CASBufferPool& pool, const std::size_t key, const std::size_t bytes);
+    // byte buffer of at least bytes, in its size class
+    bool acquireBytes(CASBufferPool& pool, const std::size_t bytes) { return acquire(pool, CASBufferPool::sizeClass(bytes), CASBufferPool::sizeClass(bytes)); }
+    void reset();
+
+    template <class T = unsigned char>
+    T* data() const {
+        return static_cast<T*>(pointer);
+    }
+    void* get() const { return pointer; }
+    std::size_t capacity() const { return bytes; }
+    explicit operator bool() const { return pointer != nullptr; }
+};
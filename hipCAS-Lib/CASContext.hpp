@@ -0,0 +1,34 @@
+#pragma once
+#include "CASBackend.hpp"
+#include "CASBufferPool.hpp"
+#include "CASTuning.hpp"
+#include "include/CASLibWrapper.h"
+#include <array>
+#include <memory>
+
+// Shared state of the CAS sessions of one engine (device, thread pool, kernels), created once and used by any number of threads at once
+// A session (CASBackend) holds the state of one image: sessions of the same context can sharpen on different threads concurrently, without locking each other,
+// while one session is used by one thread at a time. Sessions share the ownership of their context, it lives until the last one is destroyed.
+class CASContext {
+  protected:
+    // buffer pools of the memory kinds the engine uses (null for the others), shared by the sessions; declared first, destroyed after the engine state
+    std::array<std::unique_ptr<CASBufferPool>, CAS_MEMORY_KIND_COUNT> pools;
+    CASTuningProfile tuning;
+
+  public:
+    CASContext() = default;
+    virtual ~CASContext() = default;
+
+    CASContext(const CASContext& other) = delete;
+    CASContext(CASContext&& other) noexcept = delete;
+    CASContext& operator=(CASContext&& other) noexcept = delete;
+    CASContext& operator=(const CASContext& other) = delete;
+
+    // new session of this context, owned by the caller
+    virtual CASBackend* createSession() = 0;
+
+    // pool of a CASMemoryKind, nullptr when the engine does not use that kind (or an unknown kind)
+    CASBufferPool* pool(const int memoryKind) const { return memoryKind >= 0 && memoryKind < CAS_MEMORY_KIND_COUNT ? pools[memoryKind].get() : nullptr; }
+    // launch parameters tuned for the image classes of the sessions (CAS_autoTune), loaded from the profile file when the context is created
+    CASTuningProfile& tuningProfile() { return tuning; }
+};
@@ -0,0 +1,77 @@
+#include "CASCounters.hpp"
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+namespace {
+constexpr const char* stageNames[CAS_STAGE_COUNT] = {"allocate", "upload", "convert", "kernel", "download"};
+
+double milliseconds(const std::atomic<std::uint64_t>& ns) { return static_cast<double>(ns.load(std::memory_order_relaxed)) * 1e-6; }
+} // namespace
+
+void CASCounters::read(CASStats& stats) const {
+    for (int stage = 0; stage < CAS_STAGE_COUNT; stage++) {
+        stats.stages[stage].calls = stages[stage].calls.load(std::memory_order_relaxed);
+        stats.stages[stage].totalMs = milliseconds(stages[stage].totalNs);
+        stats.stages[stage].lastMs = milliseconds(stages[stage].lastNs);
+    }
+    stats.bytesIn = bytesIn.load(std::memory_order_relaxed);
+    stats.bytesOut = bytesOut.load(std::memory_order_relaxed);
+    stats.allocations = allocations.load(std::memory_order_relaxed);
+    stats.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+    stats.pixels = pixels.load(std::memory_order_relaxed);
+    stats.alphaSkippedPixels = alphaSkippedPixels.load(std::memory_order_relaxed);
+    stats.sequenceTiles = sequenceTiles.load(std::memory_order_relaxed);
+    stats.skippedTiles = skippedTiles.load(std::memory_order_relaxed);
+    stats.lastSequenceTiles = lastSequenceTiles.load(std::memory_order_relaxed);
+    stats.lastSkippedTiles = lastSkippedTiles.load(std::memory_order_relaxed);
+}
+
+void CASCounters::reset() {
+    for (Stage& stage : stages) {
+        stage.calls.store(0, std::memory_order_relaxed);
+        stage.totalNs.store(0, std::memory_order_relaxed);
+        stage.lastNs.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<std::uint64_t>* counter : {&bytesIn, &bytesOut, &allocations, &allocatedBytes, &pixels, &alphaSkippedPixels, &sequenceTiles, &skippedTiles, &lastSequenceTiles,
+                                                 &lastSkippedTiles})
+        counter->store(0, std::memory_order_relaxed);
+}
+
+void CASCounters::add(const CASCounters& other) {
+    for (int stage = 0; stage < CAS_STAGE_COUNT; stage++) {
+        const std::uint64_t calls = other.stages[stage].calls.load(std::memory_order_relaxed);
+        if (calls == 0)
+            continue;
+        stages[stage].calls.fetch_add(calls, std::memory_order_relaxed);
+        stages[stage].totalNs.fetch_add(other.stages[stage].totalNs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        stages[stage].lastNs.store(other.stages[stage].lastNs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    bytesIn.fetch_add(other.bytesIn.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytesOut.fetch_add(other.bytesOut.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    allocations.fetch_add(other.allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    allocatedBytes.fetch_add(other.allocatedBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    pixels.fetch_add(other.pixels.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    alphaSkippedPixels.fetch_add(other.alphaSkippedPixels.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// one line: {"backend": ..., "stages": {"<name>": {"calls": ..., "totalMs": ..., "lastMs": ...}, ...}, "bytesIn": ..., ...}
+std::string CASCounters::json(const char* backendName) const {
+    CASStats stats;
+    read(stats);
+    char field[160];
+    std::string text = std::string("{\"backend\": \"") + backendName + "\", \"stages\": {";
+    for (int stage = 0; stage < CAS_STAGE_COUNT; stage++) {
+        std::snprintf(field, sizeof(field), "%s\"%s\": {\"calls\": %llu, \"totalMs\": %.3f, \"lastMs\": %.3f}", stage ? ", " : "", stageNames[stage], stats.stages[stage].calls,
+                      stats.stages[stage].totalMs, stats.stages[stage].lastMs);
+        text += field;
+    }
+    std::snprintf(field, sizeof(field), "}, \"bytesIn\": %llu, \"bytesOut\": %llu, \"allocations\": %llu, \"allocatedBytes\": %llu, ", stats.bytesIn, stats.bytesOut,
+                  stats.allocations, stats.allocatedBytes);
+    text += field;
+    std::snprintf(field, sizeof(field), "\"pixels\": %llu, \"alphaSkippedPixels\": %llu, ", stats.pixels, stats.alphaSkippedPixels);
+    text += field;
+    std::snprintf(field, sizeof(field), "\"sequenceTiles\": %llu, \"skippedTiles\": %llu, \"lastSequenceTiles\": %llu, \"lastSkippedTiles\": %llu}", stats.sequenceTiles,
+                  stats.skippedTiles, stats.lastSequenceTiles, stats.lastSkippedTiles);
+    return text + field;
+}
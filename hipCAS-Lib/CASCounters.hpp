@@ -0,0 +1,69 @@
+#pragma once
+#include "include/CASLibWrapper.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Instrumentation of one CAS instance (CAS_getStats): per stage runs, cumulative and last duration, bytes moved, allocations and pixels
+// Always on: a stage costs two clock reads and a few relaxed atomic adds. The engine methods may run on the job worker while the counters are read
+// from another thread, each counter is consistent on its own but a reading is not a snapshot of all of them
+class CASCounters {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // adds the time from its construction to its destruction to a stage
+    class StageTimer {
+      private:
+        CASCounters& counters;
+        const int stage;
+        const Clock::time_point start;
+
+      public:
+        StageTimer(CASCounters& counters, const int stage) : counters(counters), stage(stage), start(Clock::now()) {}
+        ~StageTimer() { counters.addStage(stage, Clock::now() - start); }
+        StageTimer(const StageTimer& other) = delete;
+        StageTimer& operator=(const StageTimer& other) = delete;
+    };
+
+  private:
+    struct Stage {
+        std::atomic<std::uint64_t> calls{0}, totalNs{0}, lastNs{0};
+    };
+    Stage stages[CAS_STAGE_COUNT];
+    std::atomic<std::uint64_t> bytesIn{0}, bytesOut{0}, allocations{0}, allocatedBytes{0}, pixels{0}, alphaSkippedPixels{0};
+    std::atomic<std::uint64_t> sequenceTiles{0}, skippedTiles{0}, lastSequenceTiles{0}, lastSkippedTiles{0};
+
+  public:
+    // time the enclosing scope as a CASStage
+    StageTimer time(const int stage) { return StageTimer(*this, stage); }
+    void addStage(const int stage, const Clock::duration elapsed) {
+        const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        stages[stage].calls.fetch_add(1, std::memory_order_relaxed);
+        stages[stage].totalNs.fetch_add(ns, std::memory_order_relaxed);
+        stages[stage].lastNs.store(ns, std::memory_order_relaxed);
+    }
+    void countIn(const std::size_t bytes) { bytesIn.fetch_add(bytes, std::memory_order_relaxed); }
+    void countOut(const std::size_t bytes) { bytesOut.fetch_add(bytes, std::memory_order_relaxed); }
+    void countAllocation(const std::size_t bytes) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void countPixels(const std::size_t count) { pixels.fetch_add(count, std::memory_order_relaxed); }
+    void countAlphaSkipped(const std::size_t count) { alphaSkippedPixels.fetch_add(count, std::memory_order_relaxed); }
+    // tiles of a whole image call in sequence mode, and those of them that kept their output
+    void countTiles(const std::size_t tiles, const std::size_t skipped) {
+        sequenceTiles.fetch_add(tiles, std::memory_order_relaxed);
+        skippedTiles.fetch_add(skipped, std::memory_order_relaxed);
+        lastSequenceTiles.store(tiles, std::memory_order_relaxed);
+        lastSkippedTiles.store(skipped, std::memory_order_relaxed);
+    }
+
+    void read(CASStats& stats) const;
+    void reset();
+    // add the counters of another instance (its last durations replace those of its stages that ran)
+    void add(const CASCounters& other);
+    // the counters as a JSON object, with the engine name
+    std::string json(const char* backendName) const;
+};
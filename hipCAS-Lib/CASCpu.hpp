@@ -0,0 +1,513 @@
+#pragma once
+#include "CASBackend.hpp"
+#include "cpu_math.hpp"
+#include "cpu_utils.hpp"
+#include "srgb_lut.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Native CPU implementation of the CAS kernel (same algorithm as the device kernel in CAS.hpp, in fp32)
+namespace cas_cpu {
+
+// fp16 output sample (IEEE 754 half bits), a distinct type from the 16-bit unorm samples
+struct half16 {
+    std::uint16_t bits;
+};
+
+// interleaved output pixels of a sample type (counterparts of uchar3/uchar4)
+template <class Out>
+struct rgbPixel {
+    Out r, g, b;
+};
+template <class Out>
+struct rgbaPixel {
+    Out r, g, b, a;
+};
+
+// the vectorized kernels process whole vectors, rows are padded so that the last vector never reads or writes out of bounds
+constexpr unsigned int simdPadding = 16;
+
+// One channel of one row of the sliding window: the linear values (readable at [-1, width], the halo columns are zero outside the image)
+// and their horizontal 3-tap min/max, computed once per row and reused by the three output rows that need them
+struct RingRow {
+    float *value, *hmin, *hmax;
+};
+
+// Row kernel: sharpens one channel of one output row from the window rows above, at and below it
+// All arrays may be read (and out written) up to width + simdPadding
+using RowKernel = void (*)(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+// Horizontal kernel: computes the 3-tap min/max partials of a window row
+using HorizontalKernel = void (*)(const float* value, float* hmin, float* hmax, const unsigned int width);
+
+// Analyze kernel (cached mode): parameter independent stage of one channel of one row, amplitude and cross filter sum of each pixel
+using AnalyzeKernel = void (*)(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width);
+// Apply kernel (cached mode): parameter dependent stage of one channel of one row, from the center values and the stored intermediates
+using ApplyKernel = void (*)(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+
+struct Kernels {
+    HorizontalKernel horizontal;
+    RowKernel row;
+    AnalyzeKernel analyze;
+    ApplyKernel apply;
+};
+
+// whether a tile runs the full kernel, the full kernel storing the intermediates, or only the stage after them
+enum class CacheMode { None, Fill, Use };
+
+// Per-thread working memory of a tile (a band of rows of a column strip):
+// a ring of three window rows (3 channels, values and partials), the sharpened linear output row and two rows of intermediates (cached mode)
+class TileBuffer {
+  private:
+    std::vector<float> storage;
+    std::size_t stride = 0;
+
+  public:
+    // running total of the pixels written as transparent by the alpha early-out of the tiles using this buffer
+    std::size_t alphaSkipped = 0;
+
+    // number of floats per array: the strip, its two halo columns and the vector padding
+    static std::size_t arrayStride(const unsigned int tileWidth) { return tileWidth + 2 + simdPadding; }
+    // ring of 3 rows x 3 channels x 3 arrays, plus 3 output channels and the amplitude/filter window rows
+    static constexpr std::size_t arrayCount = 3 * 3 * 3 + 3 + 2;
+    static std::size_t workingSetBytes(const unsigned int tileWidth) { return arrayCount * arrayStride(tileWidth) * sizeof(float); }
+
+    void resize(const unsigned int tileWidth) {
+        stride = arrayStride(tileWidth);
+        if (storage.size() < arrayCount * stride)
+            storage.resize(arrayCount * stride);
+    }
+    RingRow row(const unsigned int slot, const unsigned int channel) {
+        float* base = storage.data() + (slot * 3 + channel) * 3 * stride;
+        return RingRow{base + 1, base + stride, base + stride * 2};
+    }
+    float* output(const unsigned int channel) { return storage.data() + (27 + channel) * stride; }
+    float* amp() { return storage.data() + 30 * stride; }
+    float* filterWindow() { return storage.data() + 31 * stride; }
+};
+
+// Parameter independent intermediates of a whole image (cached mode): amplitude and cross filter sum planes of each channel
+// the planes are padded so that vectors reading the end of the last row stay in bounds
+class IntermediateCache {
+  private:
+    std::vector<float> storage;
+    std::size_t planeSize = 0;
+
+  public:
+    static std::size_t bytes(const unsigned int rows, const unsigned int cols) { return 6 * (static_cast<std::size_t>(rows) * cols + simdPadding) * sizeof(float); }
+
+    // returns whether the storage had to grow (a new allocation)
+    bool resize(const unsigned int rows, const unsigned int cols) {
+        planeSize = static_cast<std::size_t>(rows) * cols + simdPadding;
+        const bool grows = 6 * planeSize > storage.capacity();
+        storage.resize(6 * planeSize);
+        return grows;
+    }
+    void release() {
+        storage = {};
+        planeSize = 0;
+    }
+    bool empty() const { return storage.empty(); }
+    float* amp(const unsigned int channel) { return storage.data() + channel * 2 * planeSize; }
+    float* filterWindow(const unsigned int channel) { return amp(channel) + planeSize; }
+};
+
+// Destination of the sharpened rows: image row y of plane p is written at data + (p * planeRows + y - firstRow) * stride, image column x at pixel x - firstCol
+// (a whole image: firstRow = 0 and planeRows = height, a stream: the rows of the chunk being pulled, a region: its rows and columns)
+struct OutputView {
+    unsigned char* data;
+    std::size_t stride;
+    unsigned int firstRow, planeRows;
+    unsigned int firstCol = 0;
+};
+
+// sample encoding of an input pixel format: 8-bit sRGB codes, or linear 16-bit unorm, fp16 or fp32 values
+enum class InputSample { Srgb8, Unorm16, Half, Float };
+
+// Source of the tiles, read in its own pixel format: row y starts at data + y * stride, the samples of pixel x at x * pixelStep plus the byte offset of their channel
+// (the byte order of an interleaved pixel, or the start of the plane: the planes of the planar formats are consecutive blocks of rows)
+struct InputView {
+    const unsigned char* data;
+    std::size_t stride;
+    std::size_t pixelStep;
+    std::size_t red, green, blue, alpha;
+    InputSample sample = InputSample::Srgb8;
+
+    const unsigned char* row(const int y) const { return data + static_cast<std::ptrdiff_t>(y) * static_cast<std::ptrdiff_t>(stride); }
+};
+
+// view of an image of rows rows in a CASPixelFormat (the alpha offset is only read when the image has alpha)
+inline InputView inputView(const unsigned char* data, const int pixelFormat, const std::size_t stride, const unsigned int rows) {
+    const std::size_t planeSize = stride * rows;
+    switch (pixelFormat) {
+    case CAS_FORMAT_BGRA8: return InputView{data, stride, 4, 2, 1, 0, 3};
+    case CAS_FORMAT_RGB8: return InputView{data, stride, 3, 0, 1, 2, 0};
+    case CAS_FORMAT_BGR8: return InputView{data, stride, 3, 2, 1, 0, 0};
+    case CAS_FORMAT_GRAY8: return InputView{data, stride, 1, 0, 0, 0, 0};
+    case CAS_FORMAT_PLANAR_RGB8:
+    case CAS_FORMAT_PLANAR_RGBA8: return InputView{data, stride, 1, 0, planeSize, planeSize * 2, planeSize * 3};
+    case CAS_FORMAT_RGBA16: return InputView{data, stride, 8, 0, 2, 4, 6, InputSample::Unorm16};
+    case CAS_FORMAT_RGBA16F: return InputView{data, stride, 8, 0, 2, 4, 6, InputSample::Half};
+    case CAS_FORMAT_RGBA32F: return InputView{data, stride, 16, 0, 4, 8, 12, InputSample::Float};
+    default: return InputView{data, stride, 4, 0, 1, 2, 3};
+    }
+}
+
+// widest column strip whose tile working set fits in cacheBytes (rounded to whole vectors), the full width if it fits
+inline unsigned int autoTileWidth(const unsigned int width, const std::size_t cacheBytes) {
+    const std::size_t bytesPerColumn = TileBuffer::workingSetBytes(1) - TileBuffer::workingSetBytes(0);
+    const std::size_t fixedBytes = TileBuffer::workingSetBytes(0);
+    const std::size_t columns = cacheBytes > fixedBytes ? (cacheBytes - fixedBytes) / bytesPerColumn : 0;
+    const unsigned int tileWidth = std::max(64u, static_cast<unsigned int>(columns) / simdPadding * simdPadding);
+    return std::min(width, tileWidth);
+}
+
+// per-sample conversions of the fp32 (exact) and 16-bit fixed point (fast) tiers
+inline void decodeSample(const unsigned char sRGBCode, float& value) { value = srgb_lut::decode(sRGBCode); }
+inline void decodeSample(const unsigned char sRGBCode, std::int16_t& value) { value = srgb_lut::decodeFixed(sRGBCode); }
+inline void linearSample(const float linearColor, float& value) { value = cpu_math::saturate(linearColor); }
+inline void linearSample(const float linearColor, std::int16_t& value) { value = static_cast<std::int16_t>(cpu_math::saturate(linearColor) * srgb_lut::fixedOne + 0.5f); }
+inline unsigned char encodeSample(const float value) { return srgb_lut::encode(value); }
+inline unsigned char encodeSample(const std::int16_t value) { return srgb_lut::encodeFixed(value); }
+
+// linear value of a wide input sample (unaligned reads: the caller's rows need no alignment)
+template <InputSample sample>
+inline float loadLinear(const unsigned char* bytes) {
+    if constexpr (sample == InputSample::Unorm16) {
+        std::uint16_t code;
+        std::memcpy(&code, bytes, sizeof(code));
+        return code * (1.0f / 65535.0f);
+    } else if constexpr (sample == InputSample::Half) {
+        std::uint16_t bits;
+        std::memcpy(&bits, bytes, sizeof(bits));
+        return cpu_math::halfToFloat(bits);
+    } else {
+        float value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+}
+
+// one input sample into a window value: 8-bit codes through the sRGB table, the linear formats as they are (clamped to [0,1])
+template <InputSample sample, class Value>
+inline void decodeInput(const unsigned char* bytes, Value& value) {
+    if constexpr (sample == InputSample::Srgb8)
+        decodeSample(*bytes, value);
+    else
+        linearSample(loadLinear<sample>(bytes), value);
+}
+
+template <InputSample sample, class Row>
+void decodeRowAs(const InputView& input, const unsigned int height, const unsigned int width, const int y, const unsigned int colBegin, const unsigned int colEnd, const Row& r,
+                 const Row& g, const Row& b) {
+    const int count = static_cast<int>(colEnd - colBegin);
+    const unsigned char* src = input.row(y);
+    for (int x = -1; x <= count; x++) {
+        const int imageX = static_cast<int>(colBegin) + x;
+        if (y < 0 || y >= static_cast<int>(height) || imageX < 0 || imageX >= static_cast<int>(width)) {
+            r.value[x] = g.value[x] = b.value[x] = 0;
+            continue;
+        }
+        const unsigned char* pixel = src + imageX * input.pixelStep;
+        decodeInput<sample>(pixel + input.red, r.value[x]);
+        decodeInput<sample>(pixel + input.green, g.value[x]);
+        decodeInput<sample>(pixel + input.blue, b.value[x]);
+    }
+}
+
+// decode the source columns [colBegin - 1, colEnd] of image row y into a window slot, pixels outside the image are zero (texture border addressing)
+// Template: Row: RingRow or its fixed point counterpart
+// Params:   input: source image, sRGB or linear samples
+//           y: image row, may be -1 or height for the top/bottom halo
+//           r, g, b: window rows of the slot
+template <class Row>
+void decodeRow(const InputView& input, const unsigned int height, const unsigned int width, const int y, const unsigned int colBegin, const unsigned int colEnd, const Row& r,
+               const Row& g, const Row& b) {
+    switch (input.sample) {
+    case InputSample::Unorm16: decodeRowAs<InputSample::Unorm16>(input, height, width, y, colBegin, colEnd, r, g, b); break;
+    case InputSample::Half: decodeRowAs<InputSample::Half>(input, height, width, y, colBegin, colEnd, r, g, b); break;
+    case InputSample::Float: decodeRowAs<InputSample::Float>(input, height, width, y, colBegin, colEnd, r, g, b); break;
+    default: decodeRowAs<InputSample::Srgb8>(input, height, width, y, colBegin, colEnd, r, g, b); break;
+    }
+}
+
+// smooth minimum distance to signal limit divided by smooth max, of a single channel of a pixel (parameter independent stage)
+// b and h are the cross above and below the pixel, the min/max values the horizontal partials of the three rows (see the device kernel)
+inline float casAmplitude(const float upMin, const float upMax, const float b, const float midMin, const float midMax, const float downMin, const float downMax, const float h) {
+    using namespace cpu_math;
+    // Soft min and max, 2.0x bigger (factored out the extra multiply).
+    // min(d, e, f, b, h) is the middle row partial with the center column, the 3x3 min adds the partials of the other rows
+    float mn = min3(midMin, b, h);
+    const float mn2 = min3(mn, upMin, downMin);
+    mn += mn2;
+    float mx = max3(midMax, b, h);
+    const float mx2 = max3(mx, upMax, downMax);
+    mx += mx2;
+
+    // Smooth minimum distance to signal limit divided by smooth max.
+    return 1.0f / std::sqrt(saturate(std::min(mn, 2.0f - mx) / mx));
+}
+
+// shaping of the sharpening amount, filter and lerp of a single channel of the pixel 'e' (parameter dependent stage)
+//  Filter shape:  0 w 0
+//                 w 1 w
+//                 0 w 0
+// filterWindow is the sum of the cross around 'e'
+inline float casApply(const float e, const float amp, const float filterWindow, const float sharpenStrength, const float contrastAdaption) {
+    using namespace cpu_math;
+    // Shaping amount of sharpening.
+    const float w = -1.0f / (amp * (-3.0f * contrastAdaption + 8.0f));
+    const float rcpWeight = 1.0f / (4.0f * w + 1.0f);
+    const float outColor = saturate((filterWindow * w + e) * rcpWeight);
+    return lerp(e, outColor, sharpenStrength);
+}
+
+// scalar horizontal kernel
+inline void horizontalMinMax(const float* value, float* hmin, float* hmax, const unsigned int width) {
+    for (int x = 0; x < static_cast<int>(width); x++) {
+        hmin[x] = cpu_math::min3(value[x - 1], value[x], value[x + 1]);
+        hmax[x] = cpu_math::max3(value[x - 1], value[x], value[x + 1]);
+    }
+}
+
+// scalar row kernel
+inline void casRow(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    for (int x = 0; x < static_cast<int>(width); x++) {
+        const float amp = casAmplitude(up.hmin[x], up.hmax[x], up.value[x], mid.hmin[x], mid.hmax[x], down.hmin[x], down.hmax[x], down.value[x]);
+        const float filterWindow = (up.value[x] + mid.value[x - 1]) + (mid.value[x + 1] + down.value[x]);
+        out[x] = casApply(mid.value[x], amp, filterWindow, sharpenStrength, contrastAdaption);
+    }
+}
+
+// scalar analyze kernel
+inline void casAnalyze(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width) {
+    for (int x = 0; x < static_cast<int>(width); x++) {
+        amp[x] = casAmplitude(up.hmin[x], up.hmax[x], up.value[x], mid.hmin[x], mid.hmax[x], down.hmin[x], down.hmax[x], down.value[x]);
+        filterWindow[x] = (up.value[x] + mid.value[x - 1]) + (mid.value[x + 1] + down.value[x]);
+    }
+}
+
+// scalar apply kernel
+inline void casApplyRow(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    for (unsigned int x = 0; x < width; x++)
+        out[x] = casApply(e[x], amp[x], filterWindow[x], sharpenStrength, contrastAdaption);
+}
+
+// vectorized kernels, each ISA is built in its own translation unit (CASCpu_sse41.cpp, CASCpu_avx2.cpp, CASCpu_avx512.cpp)
+void horizontalMinMaxSse41(const float* value, float* hmin, float* hmax, const unsigned int width);
+void horizontalMinMaxAvx2(const float* value, float* hmin, float* hmax, const unsigned int width);
+void horizontalMinMaxAvx512(const float* value, float* hmin, float* hmax, const unsigned int width);
+void casRowSse41(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casRowAvx2(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casRowAvx512(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casAnalyzeSse41(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width);
+void casAnalyzeAvx2(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width);
+void casAnalyzeAvx512(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width);
+void casApplySse41(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casApplyAvx2(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casApplyAvx512(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+
+// returns the kernels of the given instruction set
+inline Kernels kernels(const cpu_utils::Isa isa) {
+    switch (isa) {
+#if CAS_X86
+    case cpu_utils::Isa::SSE41: return Kernels{horizontalMinMaxSse41, casRowSse41, casAnalyzeSse41, casApplySse41};
+    case cpu_utils::Isa::AVX2: return Kernels{horizontalMinMaxAvx2, casRowAvx2, casAnalyzeAvx2, casApplyAvx2};
+    case cpu_utils::Isa::AVX512: return Kernels{horizontalMinMaxAvx512, casRowAvx512, casAnalyzeAvx512, casApplyAvx512};
+#endif
+    default: return Kernels{horizontalMinMax, casRow, casAnalyze, casApplyRow};
+    }
+}
+
+// output sample of a linear value in [0,1] without any transfer function (alpha, and the colors of the linear formats)
+template <class Out>
+inline Out encodeLinear(const float value) {
+    if constexpr (std::is_same_v<Out, unsigned char>)
+        return static_cast<unsigned char>(cpu_math::saturate(value) * 255.0f + 0.5f);
+    else if constexpr (std::is_same_v<Out, std::uint16_t>)
+        return static_cast<std::uint16_t>(cpu_math::saturate(value) * 65535.0f + 0.5f);
+    else if constexpr (std::is_same_v<Out, half16>)
+        return half16{cpu_math::floatToHalf(value)};
+    else
+        return value;
+}
+
+// output sample of a sharpened linear value: 8-bit sRGB (through the encode table), or linear 16-bit unorm, fp16 or fp32
+template <class Out, class Sample>
+inline Out encodeColor(const Sample value) {
+    if constexpr (std::is_same_v<Out, unsigned char>)
+        return encodeSample(value);
+    else
+        return encodeLinear<Out>(value);
+}
+
+inline bool isZero(const unsigned char sample) { return sample == 0; }
+inline bool isZero(const std::uint16_t sample) { return sample == 0; }
+inline bool isZero(const half16 sample) { return (sample.bits & 0x7fffu) == 0; }
+inline bool isZero(const float sample) { return sample == 0.0f; }
+
+// alpha of an input pixel as an output sample (alpha is linear in every format), 8-bit to 8-bit is copied as is
+template <class Out>
+inline Out readAlpha(const InputView& input, const unsigned char* bytes) {
+    switch (input.sample) {
+    case InputSample::Unorm16: return encodeLinear<Out>(loadLinear<InputSample::Unorm16>(bytes));
+    case InputSample::Half: return encodeLinear<Out>(loadLinear<InputSample::Half>(bytes));
+    case InputSample::Float: return encodeLinear<Out>(loadLinear<InputSample::Float>(bytes));
+    default:
+        if constexpr (std::is_same_v<Out, unsigned char>)
+            return *bytes;
+        else
+            return encodeLinear<Out>(*bytes * (1.0f / 255.0f));
+    }
+}
+
+// convert a row of sharpened linear values to the output samples and write it to the output
+// Template: Out: output sample, unsigned char (sRGB), std::uint16_t (linear unorm), half16 or float (linear)
+//           hasAlpha: whether the input image has an alpha channel
+//           casMode: whether the output image should be written as interleaved RGBA or planar RGB
+//           Sample: float or 16-bit fixed point linear values
+// Params:   r, g, b: sharpened linear channels of the columns [colBegin, colEnd)
+//           input: source image, used for the alpha channel
+//           casOutput: output rows
+//           y: image row
+// Returns:  number of pixels skipped by the alpha early-out
+template <class Out, bool hasAlpha, int casMode, class Sample>
+unsigned int writeRow(const Sample* r, const Sample* g, const Sample* b, const InputView& input, const OutputView& casOutput, const unsigned int y, const unsigned int colBegin,
+              const unsigned int colEnd) {
+    const std::size_t planeSize = casOutput.stride * casOutput.planeRows;
+    unsigned char* outputRow = casOutput.data + casOutput.stride * (y - casOutput.firstRow);
+    const auto plane = [&](const int index) { return reinterpret_cast<Out*>(outputRow + planeSize * index); };
+    const unsigned char* alphaRow = hasAlpha ? input.row(static_cast<int>(y)) + input.alpha : nullptr;
+    unsigned int skipped = 0;
+    for (unsigned int x = colBegin; x < colEnd; x++) {
+        Out alpha{};
+        const unsigned int outputX = x - casOutput.firstCol;
+        // alpha is zero -> just write a transparent pixel
+        if constexpr (hasAlpha) {
+            alpha = readAlpha<Out>(input, alphaRow + x * input.pixelStep);
+            if (isZero(alpha)) {
+                if constexpr (casMode == PLANAR_RGB) {
+                    for (int index = 0; index < 4; index++)
+                        plane(index)[outputX] = Out{};
+                } else
+                    reinterpret_cast<rgbaPixel<Out>*>(outputRow)[outputX] = rgbaPixel<Out>{};
+                skipped++;
+                continue;
+            }
+        }
+        const Out colorR = encodeColor<Out>(r[x - colBegin]);
+        const Out colorG = encodeColor<Out>(g[x - colBegin]);
+        const Out colorB = encodeColor<Out>(b[x - colBegin]);
+
+        // write planar RGB(A) or interleaved RGB(A)
+        if constexpr (casMode == PLANAR_RGB) {
+            plane(0)[outputX] = colorR;
+            plane(1)[outputX] = colorG;
+            plane(2)[outputX] = colorB;
+            if constexpr (hasAlpha)
+                plane(3)[outputX] = alpha;
+        } else {
+            if constexpr (hasAlpha)
+                reinterpret_cast<rgbaPixel<Out>*>(outputRow)[outputX] = rgbaPixel<Out>{colorR, colorG, colorB, alpha};
+            else
+                reinterpret_cast<rgbPixel<Out>*>(outputRow)[outputX] = rgbPixel<Out>{colorR, colorG, colorB};
+        }
+    }
+    return skipped;
+}
+
+// Main CPU CAS kernel, processes one tile: the output rows [rowBegin, rowEnd) of the columns [colBegin, colEnd)
+// Each source pixel of the tile is decoded once into a sliding window of three rows, together with its horizontal min/max partials
+// Template: Out: output sample (see writeRow)
+//           hasAlpha: whether the input image has an alpha channel
+//           casMode: whether the output image should be written as interleaved RGBA or planar RGB
+// Params:   input: source image
+//           sharpenStrength: sharpening strength
+//           contrastAdaption: contrast adaption
+//           casOutput: output rows, see OutputView
+//           height: height of the input image
+//           width: width of the input image
+//           kernels: kernels of the selected instruction set
+//           tile: per-thread working memory, resized for the strip width
+//           cache: intermediates of the whole image, written (Fill) or read instead of the window (Use), unused for CacheMode::None
+// Returns:  None
+template <class Out, bool hasAlpha, int casMode>
+void cas(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height, const unsigned int width,
+         const unsigned int rowBegin, const unsigned int rowEnd, const unsigned int colBegin, const unsigned int colEnd, const Kernels& kernels, TileBuffer& tile,
+         IntermediateCache* cache = nullptr, const CacheMode cacheMode = CacheMode::None) {
+    const unsigned int tileWidth = colEnd - colBegin;
+    tile.resize(tileWidth);
+    const auto writeOutput = [&](const unsigned int y) {
+        tile.alphaSkipped += writeRow<Out, hasAlpha, casMode>(tile.output(0), tile.output(1), tile.output(2), input, casOutput, y, colBegin, colEnd);
+    };
+    // cached: only the center pixels are decoded, no window
+    if (cacheMode == CacheMode::Use) {
+        for (unsigned int y = rowBegin; y < rowEnd; y++) {
+            decodeRow(input, height, width, static_cast<int>(y), colBegin, colEnd, tile.row(0, 0), tile.row(0, 1), tile.row(0, 2));
+            const std::size_t offset = static_cast<std::size_t>(y) * width + colBegin;
+            for (unsigned int channel = 0; channel < 3; channel++)
+                kernels.apply(tile.row(0, channel).value, cache->amp(channel) + offset, cache->filterWindow(channel) + offset, tile.output(channel), tileWidth, sharpenStrength,
+                              contrastAdaption);
+            writeOutput(y);
+        }
+        return;
+    }
+    // decode an image row into a window slot and compute its partials
+    const auto loadRow = [&](const unsigned int slot, const int y) {
+        const RingRow r = tile.row(slot, 0), g = tile.row(slot, 1), b = tile.row(slot, 2);
+        decodeRow(input, height, width, y, colBegin, colEnd, r, g, b);
+        for (const RingRow& channel : {r, g, b})
+            kernels.horizontal(channel.value, channel.hmin, channel.hmax, tileWidth);
+    };
+    loadRow(0, static_cast<int>(rowBegin) - 1);
+    loadRow(1, static_cast<int>(rowBegin));
+    for (unsigned int y = rowBegin; y < rowEnd; y++) {
+        // the slot of the oldest row (no longer needed) receives the row below
+        const unsigned int up = (y - rowBegin) % 3, mid = (y - rowBegin + 1) % 3, down = (y - rowBegin + 2) % 3;
+        loadRow(down, static_cast<int>(y) + 1);
+        for (unsigned int channel = 0; channel < 3; channel++) {
+            const RingRow upRow = tile.row(up, channel), midRow = tile.row(mid, channel), downRow = tile.row(down, channel);
+            if (cacheMode == CacheMode::None) {
+                kernels.row(upRow, midRow, downRow, tile.output(channel), tileWidth, sharpenStrength, contrastAdaption);
+                continue;
+            }
+            // two stages through the tile rows of intermediates (whole vectors would overwrite the next strip in the cache), same result as the row kernel
+            kernels.analyze(upRow, midRow, downRow, tile.amp(), tile.filterWindow(), tileWidth);
+            const std::size_t offset = static_cast<std::size_t>(y) * width + colBegin;
+            std::copy_n(tile.amp(), tileWidth, cache->amp(channel) + offset);
+            std::copy_n(tile.filterWindow(), tileWidth, cache->filterWindow(channel) + offset);
+            kernels.apply(midRow.value, tile.amp(), tile.filterWindow(), tile.output(channel), tileWidth, sharpenStrength, contrastAdaption);
+        }
+        writeOutput(y);
+    }
+}
+
+// sharpens the rows [rowBegin, rowEnd) x columns [colBegin, colEnd) of an image, instantiation of cas for an output sample/alpha/mode combination
+using TileFunction = void (*)(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height,
+                              const unsigned int width, const unsigned int rowBegin, const unsigned int rowEnd, const unsigned int colBegin, const unsigned int colEnd, const Kernels& kernels,
+                              TileBuffer& tile, IntermediateCache* cache, const CacheMode cacheMode);
+
+template <class Out>
+inline TileFunction tileFunction(const bool hasAlpha, const int casMode) {
+    if (hasAlpha && casMode == PLANAR_RGB)
+        return cas<Out, true, PLANAR_RGB>;
+    if (hasAlpha && casMode == INTERLEAVED_RGBA)
+        return cas<Out, true, INTERLEAVED_RGBA>;
+    if (!hasAlpha && casMode == PLANAR_RGB)
+        return cas<Out, false, PLANAR_RGB>;
+    return cas<Out, false, INTERLEAVED_RGBA>;
+}
+
+// tile function of an output CASSampleFormat
+inline TileFunction tileFunction(const bool hasAlpha, const int casMode, const int sampleFormat) {
+    switch (sampleFormat) {
+    case CAS_SAMPLE_UNORM16: return tileFunction<std::uint16_t>(hasAlpha, casMode);
+    case CAS_SAMPLE_HALF: return tileFunction<half16>(hasAlpha, casMode);
+    case CAS_SAMPLE_FLOAT: return tileFunction<float>(hasAlpha, casMode);
+    default: return tileFunction<unsigned char>(hasAlpha, casMode);
+    }
+}
+} // namespace cas_cpu
@@ -0,0 +1,179 @@
+#pragma once
+#include "CASCpu.hpp"
+#include "srgb_lut.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fast precision tier of the native CPU engine: the CAS kernel in 16-bit fixed point, twice as many lanes per vector as fp32
+// The linear values are Q15 (see srgb_lut::fixedOne). The soft min/max are integer min/max,
+// and the filter and lerp are rewritten around the center pixel so that every value stays in [-1, 1]:
+//   outColor = (filterWindow * w + e) / (4w + 1) = e + k * (e - filterWindow / 4),  k = t / (1 - t),  t = 4 * sqrt(ratio) / adaption
+// Only the sharpening term is fp32: k (Newton-refined rcp, sqrt) times e - filterWindow / 4 from the exact 16-bit pair sums of the cross, rounded to Q15 once.
+// From strength 1 on, lerp(e, saturate(e + term), strength) = saturate(e + term * strength): the strength scales k, so the rounding errors are not amplified by it.
+// The measured differences to the exact (fp32) tier are in the CPU engine section of the README.
+namespace cas_cpu {
+
+using fixed = std::int16_t;
+
+// fixed point counterpart of RingRow (values readable at [-1, width], zero halo)
+struct FixedRow {
+    fixed *value, *hmin, *hmax;
+};
+
+// fixed point counterparts of RowKernel and HorizontalKernel, all arrays may be read (and out written) up to width + fixedPadding
+using FixedRowKernel = void (*)(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength,
+                                const float contrastAdaption);
+using FixedHorizontalKernel = void (*)(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width);
+
+struct FixedKernels {
+    FixedHorizontalKernel horizontal;
+    FixedRowKernel row;
+};
+
+// one vector of the widest fixed point kernel
+constexpr unsigned int fixedPadding = 32;
+
+// Parameters of the fixed point row kernels: a strength of at least 1 scales k, a lower one is a Q15 fraction of the sharpened difference (rounding multiply)
+struct FixedParams {
+    float adaption;
+    float amountScale;
+    bool interpolate;
+    fixed strengthFraction;
+
+    static FixedParams make(const float sharpenStrength, const float contrastAdaption) {
+        // above 64 every non-zero difference saturates anyway
+        const float strength = std::min(std::max(sharpenStrength, 0.0f), 64.0f);
+        const bool interpolate = strength < 1.0f;
+        return FixedParams{-3.0f * contrastAdaption + 8.0f, interpolate ? 1.0f : strength, interpolate, static_cast<fixed>(interpolate ? std::lround(strength * srgb_lut::fixedOne) : 0)};
+    }
+};
+
+// Per-thread working memory of a fixed point tile, same layout as TileBuffer without the cached mode rows
+class FixedTileBuffer {
+  private:
+    std::vector<fixed> storage;
+    std::size_t stride = 0;
+
+  public:
+    // see TileBuffer::alphaSkipped
+    std::size_t alphaSkipped = 0;
+
+    static std::size_t arrayStride(const unsigned int tileWidth) { return tileWidth + 2 + fixedPadding; }
+    static constexpr std::size_t arrayCount = 3 * 3 * 3 + 3;
+    static std::size_t workingSetBytes(const unsigned int tileWidth) { return arrayCount * arrayStride(tileWidth) * sizeof(fixed); }
+
+    void resize(const unsigned int tileWidth) {
+        stride = arrayStride(tileWidth);
+        if (storage.size() < arrayCount * stride)
+            storage.resize(arrayCount * stride);
+    }
+    FixedRow row(const unsigned int slot, const unsigned int channel) {
+        fixed* base = storage.data() + (slot * 3 + channel) * 3 * stride;
+        return FixedRow{base + 1, base + stride, base + stride * 2};
+    }
+    fixed* output(const unsigned int channel) { return storage.data() + (27 + channel) * stride; }
+};
+
+// Q15 rounding multiply, scalar counterpart of pmulhrsw
+inline int mulRound(const int a, const int b) { return (a * b + (1 << 14)) >> 15; }
+
+// sharpening amount k of the min/max sums (Q15, up to 2 * fixedOne each) times the amount scale of the parameters
+inline float fixedAmount(const int mn, const int mx, const FixedParams& params) {
+    const float ratio = cpu_math::saturate(static_cast<float>(std::min(mn, 2 * srgb_lut::fixedOne - mx)) / static_cast<float>(mx));
+    const float t = 4.0f * std::sqrt(ratio);
+    return t / (params.adaption - t) * params.amountScale;
+}
+
+// filter and lerp of one channel of the pixel 'e' with the amount k and the sum of the cross around it (filterWindow), see the file comment
+// (the sharpening term is rounded to nearest even and saturated to 16 bits like the cvtps/packs of the vectorized kernels)
+inline fixed fixedApply(const int e, const float k, const int filterWindow, const FixedParams& params) {
+    const float difference = static_cast<float>(e) - static_cast<float>(filterWindow) * 0.25f;
+    const int sharp = static_cast<int>(std::clamp(std::nearbyint(difference * k), -32768.0f, 32767.0f));
+    const int outColor = std::clamp(e + sharp, 0, srgb_lut::fixedOne);
+    if (!params.interpolate)
+        return static_cast<fixed>(outColor);
+    return static_cast<fixed>(e + mulRound(outColor - e, params.strengthFraction));
+}
+
+// scalar fixed point horizontal kernel
+inline void horizontalMinMaxFixed(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width) {
+    for (int x = 0; x < static_cast<int>(width); x++) {
+        hmin[x] = std::min(std::min(value[x - 1], value[x]), value[x + 1]);
+        hmax[x] = std::max(std::max(value[x - 1], value[x]), value[x + 1]);
+    }
+}
+
+// scalar fixed point row kernel, the reference of the vectorized ones (which use the rcp/rsqrt approximations for k)
+inline void casRowFixed(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength,
+                        const float contrastAdaption) {
+    const FixedParams params = FixedParams::make(sharpenStrength, contrastAdaption);
+    for (int x = 0; x < static_cast<int>(width); x++) {
+        const int b = up.value[x], h = down.value[x], d = mid.value[x - 1], e = mid.value[x], f = mid.value[x + 1];
+        int mn = std::min<int>(mid.hmin[x], std::min(b, h));
+        const int mn2 = std::min<int>(mn, std::min(up.hmin[x], down.hmin[x]));
+        mn += mn2;
+        int mx = std::max<int>(mid.hmax[x], std::max(b, h));
+        const int mx2 = std::max<int>(mx, std::max(up.hmax[x], down.hmax[x]));
+        mx += mx2;
+        out[x] = fixedApply(e, fixedAmount(mn, mx, params), b + d + f + h, params);
+    }
+}
+
+// vectorized fixed point kernels (CASCpu_sse41.cpp, CASCpu_avx2.cpp), the AVX-512 tier uses the AVX2 ones (16-bit lanes need AVX-512BW)
+void horizontalMinMaxFixedSse41(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width);
+void horizontalMinMaxFixedAvx2(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width);
+void casRowFixedSse41(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+void casRowFixedAvx2(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption);
+
+// returns the fixed point kernels of the given instruction set
+inline FixedKernels fixedKernels(const cpu_utils::Isa isa) {
+    switch (isa) {
+#if CAS_X86
+    case cpu_utils::Isa::SSE41: return FixedKernels{horizontalMinMaxFixedSse41, casRowFixedSse41};
+    case cpu_utils::Isa::AVX2:
+    case cpu_utils::Isa::AVX512: return FixedKernels{horizontalMinMaxFixedAvx2, casRowFixedAvx2};
+#endif
+    default: return FixedKernels{horizontalMinMaxFixed, casRowFixed};
+    }
+}
+
+// fixed point tile, same structure as cas (without the cached mode)
+template <class Out, bool hasAlpha, int casMode>
+void casFixed(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height, const unsigned int width,
+              const unsigned int rowBegin, const unsigned int rowEnd, const unsigned int colBegin, const unsigned int colEnd, const FixedKernels& kernels, FixedTileBuffer& tile) {
+    const unsigned int tileWidth = colEnd - colBegin;
+    tile.resize(tileWidth);
+    const auto loadRow = [&](const unsigned int slot, const int y) {
+        const FixedRow r = tile.row(slot, 0), g = tile.row(slot, 1), b = tile.row(slot, 2);
+        decodeRow(input, height, width, y, colBegin, colEnd, r, g, b);
+        for (const FixedRow& channel : {r, g, b})
+            kernels.horizontal(channel.value, channel.hmin, channel.hmax, tileWidth);
+    };
+    loadRow(0, static_cast<int>(rowBegin) - 1);
+    loadRow(1, static_cast<int>(rowBegin));
+    for (unsigned int y = rowBegin; y < rowEnd; y++) {
+        const unsigned int up = (y - rowBegin) % 3, mid = (y - rowBegin + 1) % 3, down = (y - rowBegin + 2) % 3;
+        loadRow(down, static_cast<int>(y) + 1);
+        for (unsigned int channel = 0; channel < 3; channel++)
+            kernels.row(tile.row(up, channel), tile.row(mid, channel), tile.row(down, channel), tile.output(channel), tileWidth, sharpenStrength, contrastAdaption);
+        tile.alphaSkipped += writeRow<Out, hasAlpha, casMode>(tile.output(0), tile.output(1), tile.output(2), input, casOutput, y, colBegin, colEnd);
+    }
+}
+
+using FixedTileFunction = void (*)(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height,
+                                   const unsigned int width, const unsigned int rowBegin, const unsigned int rowEnd, const unsigned int colBegin, const unsigned int colEnd,
+                                   const FixedKernels& kernels, FixedTileBuffer& tile);
+
+inline FixedTileFunction fixedTileFunction(const bool hasAlpha, const int casMode) {
+    if (hasAlpha && casMode == PLANAR_RGB)
+        return casFixed<unsigned char, true, PLANAR_RGB>;
+    if (hasAlpha && casMode == INTERLEAVED_RGBA)
+        return casFixed<unsigned char, true, INTERLEAVED_RGBA>;
+    if (!hasAlpha && casMode == PLANAR_RGB)
+        return casFixed<unsigned char, false, PLANAR_RGB>;
+    return casFixed<unsigned char, false, INTERLEAVED_RGBA>;
+}
+} // namespace cas_cpu
@@ -0,0 +1,67 @@
+#pragma once
+
+// Vectorized fixed point CAS kernels (fast precision tier, see CASCpuFixed.hpp), shared by CASCpu_sse41.cpp and CASCpu_avx2.cpp
+// Each unit defines its 16-bit vector type I (I::width lanes, I::Float the fp32 vector of half as many lanes) and its helpers before including this file:
+// load/store/splat, unsigned min/max, wrapping +/-, saturating addSaturate, the Q15 rounding mulRound, clampUnit (signed clamp to [0, fixedOne])
+// and the widenLow/widenHigh (unsigned) conversions of the 16-bit lanes to two fp32 vectors and narrow, their rounding and saturating inverse (the fp32 vectors also need sqrt).
+// Everything is in an anonymous namespace, see CASCpuSimd.hpp.
+namespace {
+
+// horizontal 3-tap min/max partials of a window row, see cas_cpu::FixedHorizontalKernel
+template <class I>
+inline void horizontalMinMaxFixedSimd(const cas_cpu::fixed* value, cas_cpu::fixed* hmin, cas_cpu::fixed* hmax, const unsigned int width) {
+    for (unsigned int x = 0; x < width; x += I::width) {
+        const I left = load<I>(value + x - 1), center = load<I>(value + x), right = load<I>(value + x + 1);
+        store(hmin + x, min(min(left, center), right));
+        store(hmax + x, max(max(left, center), right));
+    }
+}
+
+// rcp refined by one Newton-Raphson step (about 22 bits): the 12-bit rcp alone costs up to 1 more LSB at strong edges
+template <class V>
+inline V reciprocal(const V x) {
+    const V estimate = rcp(x);
+    return estimate * fnmadd(x, estimate, set1<V>(2.0f));
+}
+
+// sharpening term k * (e - filterWindow / 4) of the min/max sums and the pair sums of the cross, rounded to Q15 and saturated, see cas_cpu::fixedAmount and cas_cpu::fixedApply
+template <class I>
+inline I fixedSharpen(const I mn, const I mx, const I e, const I crossPair0, const I crossPair1, const typename I::Float adaption, const typename I::Float amountScale) {
+    using V = typename I::Float;
+    const auto sharpen = [adaption, amountScale](const V mn, const V mx, const V e, const V crossPair0, const V crossPair1) {
+        const V ratio = saturate(mn * reciprocal(mx));
+        const V t = set1<V>(4.0f) * sqrt(ratio);
+        return (e - (crossPair0 + crossPair1) * set1<V>(0.25f)) * (t * reciprocal(adaption - t) * amountScale);
+    };
+    // all sums are unsigned (up to 2 * fixedOne)
+    const I limited = min(mn, splat<I>(2 * srgb_lut::fixedOne) - mx);
+    return narrow(sharpen(widenLow(limited), widenLow(mx), widenLow(e), widenLow(crossPair0), widenLow(crossPair1)),
+                  sharpen(widenHigh(limited), widenHigh(mx), widenHigh(e), widenHigh(crossPair0), widenHigh(crossPair1)));
+}
+
+// sharpen one channel of one row, see cas_cpu::FixedRowKernel and cas_cpu::fixedApply
+template <class I>
+inline void casRowFixedSimd(const cas_cpu::FixedRow& up, const cas_cpu::FixedRow& mid, const cas_cpu::FixedRow& down, cas_cpu::fixed* out, const unsigned int width,
+                            const float sharpenStrength, const float contrastAdaption) {
+    using V = typename I::Float;
+    const cas_cpu::FixedParams params = cas_cpu::FixedParams::make(sharpenStrength, contrastAdaption);
+    const V adaption = set1<V>(params.adaption), amountScale = set1<V>(params.amountScale);
+    const I fraction = splat<I>(params.strengthFraction);
+    for (unsigned int x = 0; x < width; x += I::width) {
+        const I b = load<I>(up.value + x), h = load<I>(down.value + x);
+        const I d = load<I>(mid.value + x - 1), e = load<I>(mid.value + x), f = load<I>(mid.value + x + 1);
+        I mn = min(load<I>(mid.hmin + x), min(b, h));
+        const I mn2 = min(mn, min(load<I>(up.hmin + x), load<I>(down.hmin + x)));
+        mn = mn + mn2;
+        I mx = max(load<I>(mid.hmax + x), max(b, h));
+        const I mx2 = max(mx, max(load<I>(up.hmax + x), load<I>(down.hmax + x)));
+        mx = mx + mx2;
+
+        // outColor = e + k * (e - filterWindow / 4): the saturating pack and add clamp to the same value as the exact sum
+        const I sharp = fixedSharpen(mn, mx, e, b + d, f + h, adaption, amountScale);
+        const I outColor = clampUnit(addSaturate(e, sharp));
+        // lerp(e, outColor, strength) below strength 1 (above it the strength is part of k): rounded fraction of the difference, between e and outColor
+        store(out + x, params.interpolate ? e + mulRound(outColor - e, fraction) : outColor);
+    }
+}
+} // namespace
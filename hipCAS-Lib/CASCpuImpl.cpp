@@ -0,0 +1,512 @@
+#include "CASCpu.hpp"
+#include "CASCpuImpl.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+// the thread pool uses all hardware threads and the row kernel the best instruction set of this CPU, the image buffers are cache line aligned
+CASCpuContext::CASCpuContext() : isa(cpu_utils::selectIsa()), kernels(cas_cpu::kernels(isa)), fixedKernels(cas_cpu::fixedKernels(isa)), engineName(std::string("cpu-") + cpu_utils::isaName(isa)) {
+    pools[CAS_MEMORY_HOST] = std::make_unique<CASBufferPool>([](const std::size_t bytes) { return ::operator new(bytes, std::align_val_t{64}, std::nothrow); },
+                                                             [](void* buffer) { ::operator delete(buffer, std::align_val_t{64}); });
+}
+
+CASBackend* CASCpuContext::createSession() { return new CASCpuImpl(shared_from_this()); }
+
+// initialize empty CAS instance, no image buffer is allocated before the first image
+CASCpuImpl::CASCpuImpl(std::shared_ptr<CASCpuContext> context)
+    : context(std::move(context)), hasAlpha(false), pixelFormat(CAS_FORMAT_RGBA8), rows(0), cols(0), threadPool(this->context->threadPool), kernels(this->context->kernels),
+      fixedKernels(this->context->fixedKernels), tileRows(0), tileCols(0) {}
+
+// copy the input image (in its own pixel format) and resize the output buffer based on the provided image dimensions (same dimensions: the buffers are reused, only the pixels are copied)
+void CASCpuImpl::reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                                    const unsigned int cols) {
+    // the tiles of another shape do not match the ones kept by the sequence mode
+    if (rows != this->rows || cols != this->cols || hasAlpha != this->hasAlpha || pixelFormat != this->pixelFormat)
+        sequenceOutputs.clear();
+    // the shape is committed once the input buffer holds it: a failed allocation (the previous buffer is already given back) leaves the instance without an image
+    try {
+        resizeBuffer(inputBuffer, inputRowBytes(pixelFormat, cols) * rows * inputPlanes(pixelFormat));
+    } catch (...) {
+        this->rows = this->cols = 0;
+        sequenceOutputs.clear();
+        cachedRows = 0;
+        frameHashesValid = false;
+        throw;
+    }
+    this->rows = rows;
+    this->cols = cols;
+    this->hasAlpha = hasAlpha;
+    this->pixelFormat = pixelFormat;
+    copyInput(hostRgbPtr, inputStride);
+}
+
+// an internal buffer smaller than bytes is exchanged for one of the host pool (its size class), counted as an allocation when the pool had to allocate it
+void CASCpuImpl::resizeBuffer(PooledBuffer& buffer, const std::size_t bytes) {
+    if (bytes <= buffer.capacity())
+        return;
+    const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+    if (buffer.acquireBytes(*context->pool(CAS_MEMORY_HOST), bytes))
+        counters.countAllocation(buffer.capacity());
+}
+
+// copy a new frame into the input buffer
+void CASCpuImpl::supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) { copyInput(hostRgbPtr, inputStride); }
+
+// copy the pixels into the packed input buffer
+void CASCpuImpl::copyInput(const unsigned char* hostRgbPtr, const std::size_t inputStride) {
+    const auto timer = counters.time(CAS_STAGE_UPLOAD);
+    counters.countIn(inputRowBytes(pixelFormat, cols) * rows * inputPlanes(pixelFormat));
+    copyRows(hostRgbPtr, inputStride);
+    cachedRows = 0;
+    frameHashesValid = false;
+}
+
+// row by row when the rows are padded (the planes of the planar formats are consecutive blocks of rows)
+// in NUMA mode, the workers of each node copy the rows of its band in every plane: a new buffer gets its pages on the node that sharpens them
+void CASCpuImpl::copyRows(const unsigned char* hostRgbPtr, const std::size_t inputStride) {
+    const std::size_t rowBytes = inputRowBytes(pixelFormat, cols);
+    const unsigned int planes = inputPlanes(pixelFormat);
+    if (numaPools) {
+        // rows per chunk of the parallel copy
+        constexpr unsigned int copyGrain = 16;
+        numaPools->run([&](const unsigned int node, cpu_utils::ThreadPool& pool) {
+            const auto [rowBegin, rowEnd] = numaPools->band(node, rows);
+            const unsigned int bandRows = rowEnd - rowBegin;
+            pool.parallelFor(bandRows * planes, copyGrain, [&](const unsigned int begin, const unsigned int end) {
+                for (unsigned int i = begin; i < end; i++) {
+                    const std::size_t y = static_cast<std::size_t>(i / bandRows) * rows + rowBegin + i % bandRows;
+                    std::memcpy(inputBuffer.data() + y * rowBytes, hostRgbPtr + y * inputStride, rowBytes);
+                }
+            });
+        });
+        return;
+    }
+    const std::size_t inputRows = static_cast<std::size_t>(rows) * planes;
+    if (inputStride == rowBytes)
+        std::memcpy(inputBuffer.data(), hostRgbPtr, rowBytes * inputRows);
+    else
+        for (std::size_t y = 0; y < inputRows; y++)
+            std::memcpy(inputBuffer.data() + y * rowBytes, hostRgbPtr + y * inputStride, rowBytes);
+}
+
+// output pixels and bytes of a sharpening call of width x height pixels
+void CASCpuImpl::countOutput(const int casMode, const unsigned int width, const unsigned int height) {
+    const std::size_t planes = casMode == PLANAR_RGB ? (hasAlpha ? 4 : 3) : 1;
+    counters.countPixels(static_cast<std::size_t>(width) * height);
+    counters.countOut(rowBytes(hasAlpha, casMode, width, sampleFormat) * planes * height);
+}
+
+// set the tile size, zero rows or columns select the tuned or default ones
+void CASCpuImpl::setTileSize(const unsigned int tileRows, const unsigned int tileCols) {
+    this->tileRows = tileRows;
+    this->tileCols = tileCols;
+}
+
+// the tile size set by setTileSize wins over the tuned one, except for the candidates timed by autoTune
+CASCpuImpl::Tiling CASCpuImpl::tiling(const int casMode) const {
+    const CASTuning& tuned = tuning(casMode);
+    const bool explicitSize = !tuningRun();
+    return Tiling{explicitSize && tileRows ? tileRows : tuned.tileRows ? tuned.tileRows : defaultTileRows, explicitSize && tileCols ? tileCols : tuned.tileCols, tuned.threads};
+}
+
+// width of the column strips for an image of the given width, zero columns selects the widest strip that fits the cache budget
+unsigned int CASCpuImpl::tileWidth(const unsigned int width, const unsigned int columns) const {
+    return std::max(1u, columns ? std::min(columns, width) : cas_cpu::autoTileWidth(width, tileCacheBytes));
+}
+
+std::size_t CASCpuImpl::tileWorkingSetBytes() const {
+    const unsigned int width = tileWidth(cols, tiling(INTERLEAVED_RGBA).cols);
+    return fastPrecision ? cas_cpu::FixedTileBuffer::workingSetBytes(width) : cas_cpu::TileBuffer::workingSetBytes(width);
+}
+
+// tile rows, then tile columns (narrower than the image), then threads (powers of two below the pool size), zero first: the default
+std::vector<CASTuning> CASCpuImpl::tuningCandidates(const unsigned int axis, const CASTuning& best) const {
+    std::vector<CASTuning> candidates;
+    CASTuning candidate = best;
+    switch (axis) {
+    case 0:
+        for (const unsigned int rowsPerTile : {0u, 16u, 32u, 128u, 256u}) {
+            candidate.tileRows = rowsPerTile;
+            if (rowsPerTile < rows)
+                candidates.push_back(candidate);
+        }
+        break;
+    case 1:
+        for (const unsigned int colsPerTile : {0u, 128u, 256u, 512u, 1024u}) {
+            candidate.tileCols = colsPerTile;
+            if (colsPerTile < cols)
+                candidates.push_back(candidate);
+        }
+        break;
+    case 2:
+        candidate.threads = 0;
+        candidates.push_back(candidate);
+        for (unsigned int threads = 1; threads < threadPool.size(); threads *= 2) {
+            candidate.threads = threads;
+            candidates.push_back(candidate);
+        }
+        break;
+    default: break;
+    }
+    return candidates;
+}
+
+// a smaller budget releases a cache that does not fit anymore
+void CASCpuImpl::setCacheBudget(const std::size_t bytes) {
+    cacheBudget = bytes;
+    if (cas_cpu::IntermediateCache::bytes(rows, cols) > cacheBudget) {
+        cache.release();
+        cachedRows = 0;
+    }
+}
+
+void CASCpuImpl::invalidateCache() {
+    cachedRows = 0;
+    sequenceOutputs.clear();
+}
+
+// a new tile size starts over: the next frame is hashed and sharpened whole
+void CASCpuImpl::setSequenceMode(const unsigned int tileSize) {
+    sequenceTile = tileSize;
+    sequenceOutputs.clear();
+    frameHashesValid = false;
+    if (tileSize == 0)
+        std::vector<std::uint64_t>().swap(frameHashes);
+}
+
+// calls the CPU CAS kernel on the input image, return sharpened image as unsigned char buffer (owned by this CAS instance, sized for the output sample format)
+const unsigned char* CASCpuImpl::sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) {
+    const unsigned char* previous = outputBuffer.data();
+    resizeBuffer(outputBuffer, static_cast<std::size_t>(rows) * cols * (hasAlpha ? 4 : 3) * sampleBytes(sampleFormat));
+    if (outputBuffer.data() != previous)
+        forgetSequenceOutput(previous);
+    sharpenImageInto(casMode, sharpenStrength, contrastAdaption, outputBuffer.data(), rowBytes(hasAlpha, casMode, cols, sampleFormat));
+    return outputBuffer.data();
+}
+
+// calls the CPU CAS kernel on the input image, the tiles write directly into the output rows
+void CASCpuImpl::sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) {
+    sharpenRect(casMode, sharpenStrength, contrastAdaption, cas_cpu::OutputView{output, outputStride, 0, rows}, 0, 0, cols, rows);
+}
+
+// calls the CPU CAS kernel on a rectangle of the input image only, the tiles read its halo from the full image and write into the rows of the region
+void CASCpuImpl::sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                                   const unsigned int height, unsigned char* output, const std::size_t outputStride) {
+    sharpenRect(casMode, sharpenStrength, contrastAdaption, cas_cpu::OutputView{output, outputStride, y, height, x}, x, y, width, height);
+}
+
+// run the tile function of the precision tier and output format on count tiles over the threads of a pool, tileRect(i) gives the rows and columns of tile i
+// the fast precision tier runs the fixed point tile, without the cached mode (8-bit output only, the wider outputs keep the fp32 tile)
+void CASCpuImpl::sharpenTiles(cpu_utils::ThreadPool& pool, const unsigned int count, const unsigned int threads, const std::function<TileRect(unsigned int)>& tileRect,
+                              const int casMode, const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput,
+                              const cas_cpu::CacheMode cacheMode) {
+    const cas_cpu::InputView input = cas_cpu::inputView(inputBuffer.data(), pixelFormat, inputRowBytes(pixelFormat, cols), rows);
+    if (fastPrecision && sampleFormat == CAS_SAMPLE_SRGB8) {
+        const cas_cpu::FixedTileFunction function = cas_cpu::fixedTileFunction(hasAlpha, casMode);
+        pool.parallelFor(count, 1, [&](const unsigned int tileBegin, const unsigned int tileEnd) {
+            thread_local cas_cpu::FixedTileBuffer tile;
+            const std::size_t skipped = tile.alphaSkipped;
+            for (unsigned int tileIndex = tileBegin; tileIndex < tileEnd; tileIndex++) {
+                const TileRect rect = tileRect(tileIndex);
+                function(input, sharpenStrength, contrastAdaption, casOutput, rows, cols, rect.rowBegin, rect.rowEnd, rect.colBegin, rect.colEnd, fixedKernels, tile);
+            }
+            counters.countAlphaSkipped(tile.alphaSkipped - skipped);
+        }, threads);
+        return;
+    }
+    const cas_cpu::TileFunction function = cas_cpu::tileFunction(hasAlpha, casMode, sampleFormat);
+    pool.parallelFor(count, 1, [&](const unsigned int tileBegin, const unsigned int tileEnd) {
+        thread_local cas_cpu::TileBuffer tile;
+        const std::size_t skipped = tile.alphaSkipped;
+        for (unsigned int tileIndex = tileBegin; tileIndex < tileEnd; tileIndex++) {
+            const TileRect rect = tileRect(tileIndex);
+            function(input, sharpenStrength, contrastAdaption, casOutput, rows, cols, rect.rowBegin, rect.rowEnd, rect.colBegin, rect.colEnd, kernels, tile, &cache, cacheMode);
+        }
+        counters.countAlphaSkipped(tile.alphaSkipped - skipped);
+    }, threads);
+}
+
+// sharpen the rectangle [x, x + width) x [y, y + height) of the input image
+// the rectangle is split in tiles (bands of rows of column strips), each tile is sharpened by one thread with its own sliding window
+// in cached mode, the first whole image call also stores the intermediates and the next calls (whole image or region) only run the weight/lerp/encode stage from them.
+// Regions of whole rows fill it too, from the top: a band that starts at or above the first row not cached yet extends the cached rows (the cache is read once they cover
+// the image), the other regions leave it as it is. The whole image calls of the sequence mode only sharpen the changed tiles instead
+void CASCpuImpl::sharpenRect(const int casMode, const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput, const unsigned int x,
+                             const unsigned int y, const unsigned int width, const unsigned int height) {
+    const bool wholeImage = width == cols && height == rows, wholeRows = x == 0 && width == cols;
+    if (sequenceTile > 0 && wholeImage && !tuningRun()) {
+        sharpenSequence(casMode, sharpenStrength, contrastAdaption, casOutput);
+        return;
+    }
+    const Tiling tiles = tiling(casMode);
+    const unsigned int stripWidth = tileWidth(width, tiles.cols);
+    const unsigned int strips = (width + stripWidth - 1) / stripWidth;
+    countOutput(casMode, width, height);
+    const bool fixed = fastPrecision && sampleFormat == CAS_SAMPLE_SRGB8;
+    cas_cpu::CacheMode cacheMode = cas_cpu::CacheMode::None;
+    if (!fixed && !tuningRun() && cacheBudget > 0 && cas_cpu::IntermediateCache::bytes(rows, cols) <= cacheBudget) {
+        if (cachedRows == rows)
+            cacheMode = cas_cpu::CacheMode::Use;
+        else if (wholeRows && y <= cachedRows) {
+            if (cachedRows == 0) {
+                const auto allocateTimer = counters.time(CAS_STAGE_ALLOCATE);
+                if (cache.resize(rows, cols))
+                    counters.countAllocation(cas_cpu::IntermediateCache::bytes(rows, cols));
+            }
+            cacheMode = cas_cpu::CacheMode::Fill;
+        }
+    }
+    // tiles of the rows [rowBegin, rowEnd) of the rectangle on (some of) the threads of a pool
+    const auto sharpenRows = [&](cpu_utils::ThreadPool& pool, const unsigned int threads, const unsigned int rowBegin, const unsigned int rowEnd) {
+        const unsigned int bands = (rowEnd - rowBegin + tiles.rows - 1) / tiles.rows;
+        sharpenTiles(
+            pool, bands * strips, threads,
+            [&](const unsigned int tileIndex) {
+                const unsigned int bandBegin = rowBegin + (tileIndex / strips) * tiles.rows, colBegin = x + (tileIndex % strips) * stripWidth;
+                return TileRect{bandBegin, std::min(rowEnd, bandBegin + tiles.rows), colBegin, std::min(x + width, colBegin + stripWidth)};
+            },
+            casMode, sharpenStrength, contrastAdaption, casOutput, cacheMode);
+    };
+    const auto timer = counters.time(CAS_STAGE_KERNEL);
+    if (numaPools) {
+        // each node sharpens the part of the rectangle within its band of the image, reading and writing node-local rows, with all its pinned workers
+        numaPools->run([&](const unsigned int node, cpu_utils::ThreadPool& pool) {
+            const auto [bandBegin, bandEnd] = numaPools->band(node, rows);
+            const unsigned int rowBegin = std::max(y, bandBegin), rowEnd = std::min(y + height, bandEnd);
+            if (rowBegin < rowEnd)
+                sharpenRows(pool, 0, rowBegin, rowEnd);
+        });
+    } else
+        sharpenRows(threadPool, tiles.threads, y, y + height);
+    if (cacheMode == cas_cpu::CacheMode::Fill)
+        cachedRows = std::max(cachedRows, y + height);
+}
+
+// tiles of the sequence mode, row by row
+CASCpuImpl::TileRect CASCpuImpl::sequenceTileRect(const unsigned int tile) const {
+    const unsigned int tilesX = (cols + sequenceTile - 1) / sequenceTile;
+    const unsigned int rowBegin = (tile / tilesX) * sequenceTile, colBegin = (tile % tilesX) * sequenceTile;
+    return TileRect{rowBegin, std::min(rows, rowBegin + sequenceTile), colBegin, std::min(cols, colBegin + sequenceTile)};
+}
+
+// run fn on a list of sequence tiles, in NUMA mode each node takes the tiles that start in its band
+void CASCpuImpl::runSequenceTiles(const std::vector<unsigned int>& tiles, const std::function<void(cpu_utils::ThreadPool&, const std::vector<unsigned int>&)>& fn) {
+    if (!numaPools) {
+        fn(threadPool, tiles);
+        return;
+    }
+    numaPools->run([&](const unsigned int node, cpu_utils::ThreadPool& pool) {
+        const auto [bandBegin, bandEnd] = numaPools->band(node, rows);
+        std::vector<unsigned int> nodeTiles;
+        for (const unsigned int tile : tiles) {
+            const unsigned int rowBegin = sequenceTileRect(tile).rowBegin;
+            if (rowBegin >= bandBegin && rowBegin < bandEnd)
+                nodeTiles.push_back(tile);
+        }
+        fn(pool, nodeTiles);
+    });
+}
+
+// hash of every tile of the supplied frame with its one pixel halo (the input a tile reads), in every plane
+void CASCpuImpl::hashFrame() {
+    const unsigned int tilesX = (cols + sequenceTile - 1) / sequenceTile, tilesY = (rows + sequenceTile - 1) / sequenceTile;
+    std::vector<unsigned int> tiles(static_cast<std::size_t>(tilesX) * tilesY);
+    std::iota(tiles.begin(), tiles.end(), 0u);
+    frameHashes.resize(tiles.size());
+    const std::size_t rowBytes = inputRowBytes(pixelFormat, cols), pixelBytes = inputRowBytes(pixelFormat, 1);
+    const unsigned int planes = inputPlanes(pixelFormat);
+    runSequenceTiles(tiles, [&](cpu_utils::ThreadPool& pool, const std::vector<unsigned int>& list) {
+        pool.parallelFor(static_cast<unsigned int>(list.size()), 1, [&](const unsigned int begin, const unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                const TileRect rect = sequenceTileRect(list[i]);
+                const unsigned int rowBegin = rect.rowBegin > 0 ? rect.rowBegin - 1 : 0, rowEnd = std::min(rows, rect.rowEnd + 1);
+                const unsigned int colBegin = rect.colBegin > 0 ? rect.colBegin - 1 : 0, colEnd = std::min(cols, rect.colEnd + 1);
+                std::uint64_t hash = 0;
+                for (unsigned int plane = 0; plane < planes; plane++)
+                    for (unsigned int y = rowBegin; y < rowEnd; y++)
+                        hash = cpu_utils::hashBytes(inputBuffer.data() + (static_cast<std::size_t>(plane) * rows + y) * rowBytes + colBegin * pixelBytes,
+                                                    (colEnd - colBegin) * pixelBytes, hash);
+                frameHashes[list[i]] = hash;
+            }
+        });
+    });
+    frameHashesValid = true;
+}
+
+// an output buffer given back or replaced no longer holds its frame
+void CASCpuImpl::forgetSequenceOutput(const unsigned char* data) {
+    std::erase_if(sequenceOutputs, [data](const SequenceOutput& output) { return output.data == data; });
+}
+
+// whole image call in sequence mode: the output buffer holds the frame of its last call (if it is one of the kept buffers), with the same parameters
+// its tiles whose hash is unchanged keep their output, the others are sharpened. The buffer is recorded again once all of them are written
+void CASCpuImpl::sharpenSequence(const int casMode, const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput) {
+    const bool fixed = fastPrecision && sampleFormat == CAS_SAMPLE_SRGB8;
+    const auto timer = counters.time(CAS_STAGE_KERNEL);
+    if (!frameHashesValid)
+        hashFrame();
+    const auto kept = std::find_if(sequenceOutputs.begin(), sequenceOutputs.end(), [&](const SequenceOutput& output) { return output.data == casOutput.data; });
+    SequenceOutput output{casOutput.data, casOutput.stride, casMode, sampleFormat, sharpenStrength, contrastAdaption, fixed, {}};
+    bool reuse = false;
+    if (kept != sequenceOutputs.end()) {
+        reuse = kept->stride == output.stride && kept->casMode == casMode && kept->sampleFormat == sampleFormat && kept->sharpenStrength == sharpenStrength &&
+                kept->contrastAdaption == contrastAdaption && kept->fixed == fixed && kept->tileHashes.size() == frameHashes.size();
+        output.tileHashes = std::move(kept->tileHashes);
+        sequenceOutputs.erase(kept);
+    }
+    std::vector<unsigned int> dirty;
+    for (unsigned int tile = 0; tile < frameHashes.size(); tile++)
+        if (!reuse || output.tileHashes[tile] != frameHashes[tile])
+            dirty.push_back(tile);
+    runSequenceTiles(dirty, [&](cpu_utils::ThreadPool& pool, const std::vector<unsigned int>& list) {
+        sharpenTiles(
+            pool, static_cast<unsigned int>(list.size()), 0, [&](const unsigned int i) { return sequenceTileRect(list[i]); }, casMode, sharpenStrength, contrastAdaption,
+            casOutput, cas_cpu::CacheMode::None);
+    });
+    for (const unsigned int tile : dirty) {
+        const TileRect rect = sequenceTileRect(tile);
+        countOutput(casMode, rect.colEnd - rect.colBegin, rect.rowEnd - rect.rowBegin);
+    }
+    counters.countTiles(frameHashes.size(), frameHashes.size() - dirty.size());
+    output.tileHashes = frameHashes;
+    if (sequenceOutputs.size() == maxSequenceOutputs)
+        sequenceOutputs.erase(sequenceOutputs.begin());
+    sequenceOutputs.push_back(std::move(output));
+}
+
+// sharpen and resize the input image in one pass, the output rows [firstRow, firstRow + rowCount) are split in tiles like sharpenRect: each tile reads the source rows and
+// columns of its footprint. The output strips cover about the source columns of a regular strip, the bands about tileRows source rows (the exact fp32 kernels in both
+// precision tiers, no cached mode)
+void CASCpuImpl::sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                                   const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) {
+    const float scaleX = static_cast<float>(cols) / outputCols, scaleY = static_cast<float>(rows) / outputRows;
+    const Tiling tiles = tiling(casMode);
+    const unsigned int stripWidth = std::clamp(static_cast<unsigned int>(tileWidth(cols, tiles.cols) / scaleX), 1u, outputCols);
+    const unsigned int bandRows = std::clamp(static_cast<unsigned int>(tiles.rows / scaleY), 1u, rowCount);
+    const unsigned int strips = (outputCols + stripWidth - 1) / stripWidth;
+    const unsigned int bands = (rowCount + bandRows - 1) / bandRows;
+    const unsigned int rowEnd = firstRow + rowCount;
+    const cas_cpu::InputView input = cas_cpu::inputView(inputBuffer.data(), pixelFormat, inputRowBytes(pixelFormat, cols), rows);
+    const cas_cpu::OutputView casOutput{output, outputStride, firstRow, rowCount};
+    const cas_cpu::ScaledTileFunction function = cas_cpu::scaledTileFunction(hasAlpha, casMode, sampleFormat);
+    const auto timer = counters.time(CAS_STAGE_KERNEL);
+    countOutput(casMode, outputCols, rowCount);
+    threadPool.parallelFor(bands * strips, 1, [&](const unsigned int tileBegin, const unsigned int tileEnd) {
+        thread_local cas_cpu::TileBuffer tile;
+        thread_local cas_cpu::ScaleBuffer scale;
+        for (unsigned int tileIndex = tileBegin; tileIndex < tileEnd; tileIndex++) {
+            const unsigned int rowBegin = firstRow + (tileIndex / strips) * bandRows, colBegin = (tileIndex % strips) * stripWidth;
+            function(input, sharpenStrength, contrastAdaption, casOutput, rows, cols, outputRows, outputCols, rowBegin, std::min(rowEnd, rowBegin + bandRows), colBegin,
+                     std::min(outputCols, colBegin + stripWidth), kernels, tile, scale);
+        }
+    }, tiles.threads);
+}
+
+// sharpen a band of rows of a batch image, strip by strip, in the selected precision tier, returns the pixels skipped by the alpha early-out
+std::size_t CASCpuImpl::sharpenBand(const CASImageDesc& image, const unsigned int rowBegin, const unsigned int rowEnd) const {
+    const unsigned int stripWidth = tileWidth(image.cols, tileCols);
+    const cas_cpu::OutputView casOutput{image.outputImage, rowBytes(image.hasAlpha, image.casMode, image.cols, CAS_SAMPLE_SRGB8), 0, image.rows};
+    const cas_cpu::InputView input = cas_cpu::inputView(image.inputImage, CAS_FORMAT_RGBA8, static_cast<std::size_t>(image.cols) * 4, image.rows);
+    if (fastPrecision) {
+        thread_local cas_cpu::FixedTileBuffer tile;
+        const std::size_t skipped = tile.alphaSkipped;
+        const cas_cpu::FixedTileFunction function = cas_cpu::fixedTileFunction(image.hasAlpha, image.casMode);
+        for (unsigned int colBegin = 0; colBegin < image.cols; colBegin += stripWidth)
+            function(input, image.sharpenStrength, image.contrastAdaption, casOutput, image.rows, image.cols, rowBegin, rowEnd, colBegin,
+                     std::min(image.cols, colBegin + stripWidth), fixedKernels, tile);
+        return tile.alphaSkipped - skipped;
+    }
+    thread_local cas_cpu::TileBuffer tile;
+    const std::size_t skipped = tile.alphaSkipped;
+    const cas_cpu::TileFunction function = cas_cpu::tileFunction(image.hasAlpha, image.casMode, CAS_SAMPLE_SRGB8);
+    for (unsigned int colBegin = 0; colBegin < image.cols; colBegin += stripWidth)
+        function(input, image.sharpenStrength, image.contrastAdaption, casOutput, image.rows, image.cols, rowBegin, rowEnd, colBegin,
+                 std::min(image.cols, colBegin + stripWidth), kernels, tile, nullptr, cas_cpu::CacheMode::None);
+    return tile.alphaSkipped - skipped;
+}
+
+// every image becomes one task, or one task per band of rows when it is large, the tasks are spread over the work-stealing pool
+// the biggest images are queued first: idle workers steal the oldest tasks, so the long ones start early and the small ones fill the gaps
+unsigned int CASCpuImpl::sharpenBatch(CASImageDesc* images, const unsigned int count) {
+    using Clock = std::chrono::steady_clock;
+    // progress of one image, shared by its band tasks
+    struct ImageState {
+        std::atomic<unsigned int> remainingBands{0};
+        std::atomic<bool> failed{false};
+        std::atomic<Clock::rep> start{0};
+    };
+    std::vector<ImageState> states(count);
+    std::vector<unsigned int> order;
+    order.reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        images[i].elapsedMs = 0.0;
+        images[i].status = isValid(images[i]) ? CAS_STATUS_OK : CAS_STATUS_INVALID_ARGUMENT;
+        if (images[i].status == CAS_STATUS_OK)
+            order.push_back(i);
+    }
+    const auto pixels = [images](const unsigned int i) { return static_cast<std::size_t>(images[i].rows) * images[i].cols; };
+    std::stable_sort(order.begin(), order.end(), [&pixels](const unsigned int a, const unsigned int b) { return pixels(a) > pixels(b); });
+
+    // the batch is one run of the kernel stage
+    const auto timer = counters.time(CAS_STAGE_KERNEL);
+    for (const unsigned int i : order) {
+        counters.countPixels(pixels(i));
+        counters.countOut(pixels(i) * (images[i].hasAlpha ? 4 : 3));
+    }
+    // the images of a batch are not tuned: the tile size set by setTileSize, else the default
+    const unsigned int bandUnit = tileRows ? tileRows : defaultTileRows;
+    cpu_utils::TaskGroup group(threadPool);
+    for (const unsigned int i : order) {
+        CASImageDesc& image = images[i];
+        ImageState& state = states[i];
+        // whole tile bands, at least batchBandPixels per band
+        const std::size_t minBandRows = (batchBandPixels + image.cols - 1) / image.cols;
+        const unsigned int bandRows = static_cast<unsigned int>(std::min<std::size_t>(image.rows, (minBandRows + bandUnit - 1) / bandUnit * bandUnit));
+        const unsigned int bands = (image.rows + bandRows - 1) / bandRows;
+        state.remainingBands = bands;
+        for (unsigned int band = 0; band < bands; band++) {
+            const unsigned int rowBegin = band * bandRows, rowEnd = std::min(image.rows, rowBegin + bandRows);
+            group.run([this, &image, &state, rowBegin, rowEnd] {
+                const Clock::rep now = Clock::now().time_since_epoch().count();
+                Clock::rep expected = 0;
+                state.start.compare_exchange_strong(expected, now);
+                try {
+                    counters.countAlphaSkipped(sharpenBand(image, rowBegin, rowEnd));
+                } catch (const std::exception&) { state.failed = true; }
+                // the last band finishes the image
+                if (state.remainingBands.fetch_sub(1) == 1) {
+                    const Clock::duration elapsed = Clock::now().time_since_epoch() - Clock::duration(state.start.load());
+                    image.elapsedMs = std::chrono::duration<double, std::milli>(elapsed).count();
+                    image.status = state.failed ? CAS_STATUS_FAILED : CAS_STATUS_OK;
+                }
+            });
+        }
+    }
+    group.wait();
+    return static_cast<unsigned int>(std::count_if(images, images + count, [](const CASImageDesc& image) { return image.status != CAS_STATUS_OK; }));
+}
+
+// a new mode copies the supplied image into another buffer with the workers of the mode and gives the output buffer back (the next sharpenImage takes one)
+// a new buffer gets its pages first touched by the nodes, a buffer reused from the pool keeps the placement of its first use
+unsigned int CASCpuImpl::setNumaNodes(const unsigned int nodeCount) {
+    numaPools.reset();
+    if (nodeCount > 0)
+        numaPools = std::make_unique<cpu_utils::NumaPools>(nodeCount);
+    forgetSequenceOutput(outputBuffer.data());
+    outputBuffer.reset();
+    if (inputBuffer) {
+        PooledBuffer previous = std::move(inputBuffer);
+        inputBuffer.acquire(*context->pool(CAS_MEMORY_HOST), CASBufferPool::sizeClass(previous.capacity()), previous.capacity());
+        copyRows(previous.data(), inputRowBytes(pixelFormat, cols));
+    }
+    return numaPools ? numaPools->threads() : threadPool.size();
+}
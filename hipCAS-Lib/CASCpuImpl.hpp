@@ -0,0 +1,149 @@
+#pragma once
+#include "CASBackend.hpp"
+#include "CASBufferPool.hpp"
+#include "CASContext.hpp"
+#include "CASCpu.hpp"
+#include "CASCpuFixed.hpp"
+#include "CASCpuScaled.hpp"
+#include "cpu_utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared state of the CPU sessions: the thread pool over all hardware threads, the row kernels of the best instruction set of this CPU and the pool of the image buffers
+class CASCpuContext final : public CASContext, public std::enable_shared_from_this<CASCpuContext> {
+  public:
+    // the work-stealing pool accepts parallelFor calls of several sessions at once
+    cpu_utils::ThreadPool threadPool;
+    const cpu_utils::Isa isa;
+    const cas_cpu::Kernels kernels;
+    const cas_cpu::FixedKernels fixedKernels;
+    const std::string engineName;
+
+    CASCpuContext();
+
+    CASBackend* createSession() override;
+};
+
+// Native CPU CAS engine, runs the CAS kernel of CASCpu.hpp on tiles (bands of rows of column strips) across all cores
+// a session of a CASCpuContext: the image buffers, tiling, precision and cache are its own, the pool and kernels belong to the context
+class CASCpuImpl final : public CASBackend {
+  private:
+    const std::shared_ptr<CASCpuContext> context;
+    // input image in its own pixel format (packed rows), read as is by the tiles
+    // from the host pool of the context, never zero filled: in NUMA mode the pages of a new buffer are first touched by the node sharpening them
+    PooledBuffer inputBuffer;
+    PooledBuffer outputBuffer;
+    bool hasAlpha;
+    int pixelFormat;
+    unsigned int rows, cols;
+    cpu_utils::ThreadPool& threadPool;
+    // NUMA mode: pinned workers per node, the whole image and region calls run node-local bands on them (null: off)
+    std::unique_ptr<cpu_utils::NumaPools> numaPools;
+    const cas_cpu::Kernels& kernels;
+    // fast precision tier: 16-bit fixed point kernels, no cached mode, 8-bit output only
+    const cas_cpu::FixedKernels& fixedKernels;
+    bool fastPrecision{false};
+    int sampleFormat{CAS_SAMPLE_SRGB8};
+    // tile size set by setTileSize, 0: the tuned size of the image class (CAS_autoTune), else 64 rows and the automatic width
+    unsigned int tileRows, tileCols;
+    const unsigned int defaultTileRows{64};
+    // cache budget of the automatic tile width: a typical per-core L2
+    const std::size_t tileCacheBytes{256 * 1024};
+
+    // cached mode: intermediates of the supplied image, within the budget
+    cas_cpu::IntermediateCache cache;
+    std::size_t cacheBudget{0};
+    // rows of the cache filled from the top (by whole image calls or regions of whole rows), it is read once they reach the last row
+    unsigned int cachedRows{0};
+    // rows of the bands a batch image is split into: enough pixels per band to amortize scheduling and the window priming
+    const std::size_t batchBandPixels{512 * 1024};
+
+    // sequence mode: square tiles of sequenceTile pixels (0 = off), hashed with their halo once per supplied frame (by the first whole image call)
+    unsigned int sequenceTile{0};
+    std::vector<std::uint64_t> frameHashes;
+    bool frameHashesValid{false};
+    // an output buffer written by a whole image call in sequence mode: the call parameters and the tile hashes of the frame it holds
+    struct SequenceOutput {
+        const unsigned char* data;
+        std::size_t stride;
+        int casMode, sampleFormat;
+        float sharpenStrength, contrastAdaption;
+        bool fixed;
+        std::vector<std::uint64_t> tileHashes;
+    };
+    // the last output buffers, least recently written first
+    std::vector<SequenceOutput> sequenceOutputs;
+    const std::size_t maxSequenceOutputs{8};
+
+    // rows [rowBegin, rowEnd) and columns [colBegin, colEnd) of a tile
+    struct TileRect {
+        unsigned int rowBegin, rowEnd, colBegin, colEnd;
+    };
+
+    // tile rows, tile columns (0 = automatic width) and threads (0 = all) of a call on the supplied image
+    struct Tiling {
+        unsigned int rows, cols, threads;
+    };
+
+    Tiling tiling(const int casMode) const;
+    unsigned int tileWidth(const unsigned int width, const unsigned int columns) const;
+    void resizeBuffer(PooledBuffer& buffer, const std::size_t bytes);
+    void copyInput(const unsigned char* hostRgbPtr, const std::size_t inputStride);
+    void copyRows(const unsigned char* hostRgbPtr, const std::size_t inputStride);
+    void countOutput(const int casMode, const unsigned int width, const unsigned int height);
+    void sharpenTiles(cpu_utils::ThreadPool& pool, const unsigned int count, const unsigned int threads, const std::function<TileRect(unsigned int)>& tileRect, const int casMode,
+                      const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput, const cas_cpu::CacheMode cacheMode);
+    void sharpenRect(const int casMode, const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput, const unsigned int x, const unsigned int y,
+                     const unsigned int width, const unsigned int height);
+    TileRect sequenceTileRect(const unsigned int tile) const;
+    void runSequenceTiles(const std::vector<unsigned int>& tiles, const std::function<void(cpu_utils::ThreadPool&, const std::vector<unsigned int>&)>& fn);
+    void hashFrame();
+    void forgetSequenceOutput(const unsigned char* data);
+    void sharpenSequence(const int casMode, const float sharpenStrength, const float contrastAdaption, const cas_cpu::OutputView& casOutput);
+    std::size_t sharpenBand(const CASImageDesc& image, const unsigned int rowBegin, const unsigned int rowEnd) const;
+
+  protected:
+    std::vector<CASTuning> tuningCandidates(const unsigned int axis, const CASTuning& best) const override;
+
+  public:
+    explicit CASCpuImpl(std::shared_ptr<CASCpuContext> context);
+
+    // instruction set of the selected row kernel (detected at runtime)
+    cpu_utils::Isa instructionSet() const { return context->isa; }
+
+    // delete move/copy ctors/operators, not useful for a DLL class
+    CASCpuImpl(const CASCpuImpl& other) = delete;
+    CASCpuImpl(CASCpuImpl&& other) noexcept = delete;
+    CASCpuImpl& operator=(CASCpuImpl&& other) noexcept = delete;
+    CASCpuImpl& operator=(const CASCpuImpl& other) = delete;
+
+    void reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                            const unsigned int cols) override;
+    void supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) override;
+    const unsigned char* sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) override;
+    void sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                           const unsigned int height, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                           const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) override;
+    void setTileSize(const unsigned int tileRows, const unsigned int tileCols) override;
+    const char* name() const override { return context->engineName.c_str(); }
+    CASContext& sharedContext() const override { return *context; }
+    unsigned int imageRows() const override { return rows; }
+    unsigned int imageCols() const override { return cols; }
+    bool imageHasAlpha() const override { return hasAlpha; }
+    int imageFormat() const override { return pixelFormat; }
+    std::size_t tileWorkingSetBytes() const override;
+    void setPrecision(const int precision) override { fastPrecision = precision == CAS_PRECISION_FAST; }
+    void setOutputFormat(const int sampleFormat) override { this->sampleFormat = sampleFormat; }
+    int outputFormat() const override { return sampleFormat; }
+    void setCacheBudget(const std::size_t bytes) override;
+    void invalidateCache() override;
+    void setSequenceMode(const unsigned int tileSize) override;
+    unsigned int sharpenBatch(CASImageDesc* images, const unsigned int count) override;
+    unsigned int setNumaNodes(const unsigned int nodeCount) override;
+};
@@ -0,0 +1,362 @@
+#pragma once
+#include "CASCpu.hpp"
+#include "cpu_math.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scaling mode of the native CPU engine: sharpens and resizes in one pass, each tile reads its source footprint once and writes the output at another resolution
+// Upscaling runs the CAS scaling filter: the output pixel blends the sharpening filters of the 4 source pixels around its position with bilinear weights,
+// thinned where the source has strong edges (the FidelityFX CAS upscaling path, with the soft 3x3 min/max of the sharpening kernel):
+//   out = saturate(sum(w_q * (e_q + peak_q * window_q)) / sum(w_q * (1 + 4 * peak_q))),  then lerped from the plain bilinear value by the sharpening strength
+// at scale 1 it reduces to the sharpening kernel. Downscaling averages the sharpened source pixels covered by the output pixel instead (area filter, premultiplied
+// by alpha), a wider footprint than the 2x2 of the scaling filter would alias.
+namespace cas_cpu {
+
+// position of an output pixel in the source along one axis (the pixel centers are aligned), clamped to the image:
+// the source pixels on both sides of it and the weight of the second one
+struct BilinearTap {
+    unsigned int first, second;
+    float fraction;
+};
+
+inline BilinearTap bilinearTap(const unsigned int o, const float scale, const unsigned int size) {
+    const float position = std::clamp((o + 0.5f) * scale - 0.5f, 0.0f, static_cast<float>(size - 1));
+    const unsigned int first = std::min(static_cast<unsigned int>(position), size - 1);
+    return BilinearTap{first, std::min(first + 1, size - 1), position - first};
+}
+
+// Footprints of a range of output pixels along one axis for the area filter: output pixel o covers [o * scale, (o + 1) * scale) of the source,
+// each source pixel it touches is weighted by its coverage (the weights of a pixel sum to 1)
+class AreaTaps {
+  private:
+    std::vector<unsigned int> firstTap, tapOffset;
+    std::vector<float> weights;
+
+  public:
+    // footprints of the output pixels [begin, end) in a source of size pixels
+    void build(const unsigned int begin, const unsigned int end, const float scale, const unsigned int size) {
+        firstTap.clear();
+        tapOffset.assign(1, 0);
+        weights.clear();
+        for (unsigned int o = begin; o < end; o++) {
+            const float lo = o * scale, hi = std::min((o + 1) * scale, static_cast<float>(size));
+            const unsigned int first = std::min(static_cast<unsigned int>(lo), size - 1);
+            const unsigned int last = std::clamp(static_cast<unsigned int>(std::ceil(hi)), first + 1, size);
+            float sum = 0.0f;
+            for (unsigned int c = first; c < last; c++) {
+                const float weight = std::max(0.0f, std::min(c + 1.0f, hi) - std::max(static_cast<float>(c), lo));
+                weights.push_back(weight);
+                sum += weight;
+            }
+            // a footprint rounded away entirely keeps its first pixel
+            const std::size_t offset = tapOffset.back();
+            if (sum > 0.0f)
+                for (std::size_t i = offset; i < weights.size(); i++)
+                    weights[i] /= sum;
+            else
+                weights[offset] = 1.0f;
+            firstTap.push_back(first);
+            tapOffset.push_back(static_cast<unsigned int>(weights.size()));
+        }
+    }
+    // source pixels of the index-th output pixel of the range: first(index) .. first(index) + count(index) - 1
+    unsigned int first(const unsigned int index) const { return firstTap[index]; }
+    unsigned int count(const unsigned int index) const { return tapOffset[index + 1] - tapOffset[index]; }
+    const float* weight(const unsigned int index) const { return weights.data() + tapOffset[index]; }
+    unsigned int sourceBegin() const { return firstTap.front(); }
+    unsigned int sourceEnd() const { return firstTap.back() + count(static_cast<unsigned int>(firstTap.size()) - 1); }
+};
+
+// Per-thread working memory of a scaled tile, next to the TileBuffer of its sliding window:
+// scaling filter: two analyzed source rows (center values, filter numerators and denominators of 3 channels, edge thinning and alpha),
+// area filter: one sharpened source row of alpha and the accumulated output row (3 channels and alpha)
+class ScaleBuffer {
+  private:
+    std::vector<float> storage;
+    std::size_t sourceStride = 0, outputStride = 0;
+
+  public:
+    // 2 analyzed rows x 11 arrays, plus the source alpha row
+    static constexpr std::size_t sourceArrays = 2 * 11 + 1;
+    AreaTaps rowTaps, colTaps;
+    std::vector<BilinearTap> bilinearCols;
+    // source row held by each analyzed slot, -1 = none
+    int analyzedRow[2]{-1, -1};
+
+    void resize(const unsigned int sourceWidth, const unsigned int outputWidth) {
+        sourceStride = sourceWidth + simdPadding;
+        outputStride = outputWidth;
+        if (storage.size() < sourceArrays * sourceStride + 4 * outputStride)
+            storage.resize(sourceArrays * sourceStride + 4 * outputStride);
+        analyzedRow[0] = analyzedRow[1] = -1;
+    }
+    float* value(const unsigned int slot, const unsigned int channel) { return storage.data() + (slot * 11 + channel) * sourceStride; }
+    float* numerator(const unsigned int slot, const unsigned int channel) { return value(slot, 3 + channel); }
+    float* denominator(const unsigned int slot, const unsigned int channel) { return value(slot, 6 + channel); }
+    float* thin(const unsigned int slot) { return value(slot, 9); }
+    float* alpha(const unsigned int slot) { return value(slot, 10); }
+    float* sourceAlpha() { return storage.data() + 22 * sourceStride; }
+    float* accumulator(const unsigned int channel) { return storage.data() + sourceArrays * sourceStride + channel * outputStride; }
+};
+
+// linear alpha of the source columns [colBegin, colEnd) of image row y
+inline void decodeAlphaRow(const InputView& input, const int y, const unsigned int colBegin, const unsigned int colEnd, float* alpha) {
+    const unsigned char* row = input.row(y) + input.alpha;
+    for (unsigned int x = colBegin; x < colEnd; x++)
+        alpha[x - colBegin] = readAlpha<float>(input, row + x * input.pixelStep);
+}
+
+// write a row of resized linear values (r, g, b and alpha of the output columns [colBegin, colEnd)) to the output, see writeRow
+template <class Out, bool hasAlpha, int casMode>
+void writeScaledRow(const float* r, const float* g, const float* b, const float* a, const OutputView& casOutput, const unsigned int y, const unsigned int colBegin,
+                    const unsigned int colEnd) {
+    const std::size_t planeSize = casOutput.stride * casOutput.planeRows;
+    unsigned char* outputRow = casOutput.data + casOutput.stride * (y - casOutput.firstRow);
+    const auto plane = [&](const int index) { return reinterpret_cast<Out*>(outputRow + planeSize * index); };
+    for (unsigned int x = colBegin; x < colEnd; x++) {
+        const unsigned int i = x - colBegin, outputX = x - casOutput.firstCol;
+        Out alpha{};
+        if constexpr (hasAlpha) {
+            alpha = encodeLinear<Out>(a[i]);
+            if (isZero(alpha)) {
+                if constexpr (casMode == PLANAR_RGB) {
+                    for (int index = 0; index < 4; index++)
+                        plane(index)[outputX] = Out{};
+                } else
+                    reinterpret_cast<rgbaPixel<Out>*>(outputRow)[outputX] = rgbaPixel<Out>{};
+                continue;
+            }
+        }
+        const Out colorR = encodeColor<Out>(r[i]);
+        const Out colorG = encodeColor<Out>(g[i]);
+        const Out colorB = encodeColor<Out>(b[i]);
+        if constexpr (casMode == PLANAR_RGB) {
+            plane(0)[outputX] = colorR;
+            plane(1)[outputX] = colorG;
+            plane(2)[outputX] = colorB;
+            if constexpr (hasAlpha)
+                plane(3)[outputX] = alpha;
+        } else {
+            if constexpr (hasAlpha)
+                reinterpret_cast<rgbaPixel<Out>*>(outputRow)[outputX] = rgbaPixel<Out>{colorR, colorG, colorB, alpha};
+            else
+                reinterpret_cast<rgbPixel<Out>*>(outputRow)[outputX] = rgbPixel<Out>{colorR, colorG, colorB};
+        }
+    }
+}
+
+// Scaled CPU CAS kernel, processes one tile of the output: the output rows [rowBegin, rowEnd) of the columns [colBegin, colEnd) of an outputHeight x outputWidth image
+// The source rows of its footprint go once through a sliding window (same as cas), in order
+// Template: Out, hasAlpha, casMode: see cas
+// Params:   input, sharpenStrength, contrastAdaption, kernels, tile: see cas
+//           casOutput: output rows of the resized image
+//           height, width: size of the input image
+//           outputHeight, outputWidth: size of the resized image
+//           scale: per-thread working memory of the resize
+// Returns:  None
+template <class Out, bool hasAlpha, int casMode>
+void casScaled(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height, const unsigned int width,
+               const unsigned int outputHeight, const unsigned int outputWidth, const unsigned int rowBegin, const unsigned int rowEnd, const unsigned int colBegin,
+               const unsigned int colEnd, const Kernels& kernels, TileBuffer& tile, ScaleBuffer& scale) {
+    using namespace cpu_math;
+    const float scaleX = static_cast<float>(width) / outputWidth, scaleY = static_cast<float>(height) / outputHeight;
+    const bool area = scaleX > 1.0f || scaleY > 1.0f;
+    const unsigned int tileWidth = colEnd - colBegin;
+
+    // source columns of the tile
+    unsigned int sourceBegin, sourceEnd;
+    if (area) {
+        scale.colTaps.build(colBegin, colEnd, scaleX, width);
+        scale.rowTaps.build(rowBegin, rowEnd, scaleY, height);
+        sourceBegin = scale.colTaps.sourceBegin();
+        sourceEnd = scale.colTaps.sourceEnd();
+    } else {
+        scale.bilinearCols.resize(tileWidth);
+        for (unsigned int x = colBegin; x < colEnd; x++)
+            scale.bilinearCols[x - colBegin] = bilinearTap(x, scaleX, width);
+        sourceBegin = scale.bilinearCols.front().first;
+        sourceEnd = scale.bilinearCols.back().second + 1;
+    }
+    const unsigned int sourceWidth = sourceEnd - sourceBegin;
+    tile.resize(sourceWidth);
+    scale.resize(sourceWidth, tileWidth);
+
+    // sliding window over the source rows: rows center - 1 .. center + 1 are loaded, in the slots of their row index modulo 3
+    int center = 0;
+    bool primed = false;
+    const auto slot = [](const int y) { return static_cast<unsigned int>(y + 3) % 3; };
+    const auto loadRow = [&](const int y) {
+        const RingRow r = tile.row(slot(y), 0), g = tile.row(slot(y), 1), b = tile.row(slot(y), 2);
+        decodeRow(input, height, width, y, sourceBegin, sourceEnd, r, g, b);
+        for (const RingRow& channel : {r, g, b})
+            kernels.horizontal(channel.value, channel.hmin, channel.hmax, sourceWidth);
+    };
+    const auto moveTo = [&](const int y) {
+        if (primed && y == center)
+            return;
+        const int firstNew = primed && y <= center + 2 ? center + 2 : y - 1;
+        for (int next = firstNew; next <= y + 1; next++)
+            loadRow(next);
+        center = y;
+        primed = true;
+    };
+    float* outR = scale.accumulator(0);
+    float* outG = scale.accumulator(1);
+    float* outB = scale.accumulator(2);
+    float* outA = scale.accumulator(3);
+
+    if (area) {
+        // the last sharpened source row, shared by two output rows when a footprint boundary crosses it
+        int sharpenedRow = -1;
+        for (unsigned int y = rowBegin; y < rowEnd; y++) {
+            const unsigned int rowIndex = y - rowBegin;
+            std::fill_n(scale.accumulator(0), 4 * static_cast<std::size_t>(tileWidth), 0.0f);
+            for (unsigned int tap = 0; tap < scale.rowTaps.count(rowIndex); tap++) {
+                const int sourceY = static_cast<int>(scale.rowTaps.first(rowIndex) + tap);
+                const float rowWeight = scale.rowTaps.weight(rowIndex)[tap];
+                if (sourceY != sharpenedRow) {
+                    moveTo(sourceY);
+                    for (unsigned int channel = 0; channel < 3; channel++)
+                        kernels.row(tile.row(slot(sourceY - 1), channel), tile.row(slot(sourceY), channel), tile.row(slot(sourceY + 1), channel), tile.output(channel),
+                                    sourceWidth, sharpenStrength, contrastAdaption);
+                    if constexpr (hasAlpha)
+                        decodeAlphaRow(input, sourceY, sourceBegin, sourceEnd, scale.sourceAlpha());
+                    sharpenedRow = sourceY;
+                }
+                const float* r = tile.output(0);
+                const float* g = tile.output(1);
+                const float* b = tile.output(2);
+                const float* a = scale.sourceAlpha();
+                for (unsigned int i = 0; i < tileWidth; i++) {
+                    const unsigned int first = scale.colTaps.first(i) - sourceBegin;
+                    const float* weight = scale.colTaps.weight(i);
+                    float sumR = 0.0f, sumG = 0.0f, sumB = 0.0f, sumA = 0.0f;
+                    for (unsigned int k = 0; k < scale.colTaps.count(i); k++) {
+                        // premultiplied by alpha: transparent pixels do not bleed their color
+                        const float w = hasAlpha ? weight[k] * a[first + k] : weight[k];
+                        sumR += w * r[first + k];
+                        sumG += w * g[first + k];
+                        sumB += w * b[first + k];
+                        sumA += w;
+                    }
+                    outR[i] += rowWeight * sumR;
+                    outG[i] += rowWeight * sumG;
+                    outB[i] += rowWeight * sumB;
+                    outA[i] += rowWeight * sumA;
+                }
+            }
+            if constexpr (hasAlpha)
+                for (unsigned int i = 0; i < tileWidth; i++) {
+                    const float rcpAlpha = outA[i] > 0.0f ? 1.0f / outA[i] : 0.0f;
+                    outR[i] *= rcpAlpha;
+                    outG[i] *= rcpAlpha;
+                    outB[i] *= rcpAlpha;
+                }
+            writeScaledRow<Out, hasAlpha, casMode>(outR, outG, outB, outA, casOutput, y, colBegin, colEnd);
+        }
+        return;
+    }
+
+    // analyze a source row into the slot of its parity: center values, the filter of each pixel split in numerator e + peak * window and denominator 1 + 4 * peak,
+    // edge thinning (green range of the 3x3 neighborhood) and alpha
+    const float adaption = -3.0f * contrastAdaption + 8.0f;
+    const auto analyzeRow = [&](const int y) {
+        const unsigned int target = static_cast<unsigned int>(y) % 2;
+        if (scale.analyzedRow[target] == y)
+            return;
+        moveTo(y);
+        for (unsigned int channel = 0; channel < 3; channel++) {
+            const RingRow up = tile.row(slot(y - 1), channel), mid = tile.row(slot(y), channel), down = tile.row(slot(y + 1), channel);
+            float* numerator = scale.numerator(target, channel);
+            float* denominator = scale.denominator(target, channel);
+            // amplitude into the numerator row, cross sum into the denominator row, then combined in place
+            kernels.analyze(up, mid, down, numerator, denominator, sourceWidth);
+            std::copy_n(mid.value, sourceWidth, scale.value(target, channel));
+            for (unsigned int x = 0; x < sourceWidth; x++) {
+                const float peak = -1.0f / (numerator[x] * adaption);
+                numerator[x] = mid.value[x] + peak * denominator[x];
+                denominator[x] = 4.0f * peak + 1.0f;
+            }
+        }
+        const RingRow up = tile.row(slot(y - 1), 1), mid = tile.row(slot(y), 1), down = tile.row(slot(y + 1), 1);
+        float* thin = scale.thin(target);
+        for (unsigned int x = 0; x < sourceWidth; x++)
+            thin[x] = 1.0f / (1.0f / 32.0f + max3(up.hmax[x], mid.hmax[x], down.hmax[x]) - min3(up.hmin[x], mid.hmin[x], down.hmin[x]));
+        if constexpr (hasAlpha)
+            decodeAlphaRow(input, y, sourceBegin, sourceEnd, scale.alpha(target));
+        scale.analyzedRow[target] = y;
+    };
+    float* outputs[3] = {outR, outG, outB};
+    for (unsigned int y = rowBegin; y < rowEnd; y++) {
+        const BilinearTap rowTap = bilinearTap(y, scaleY, height);
+        analyzeRow(static_cast<int>(rowTap.first));
+        analyzeRow(static_cast<int>(rowTap.second));
+        const unsigned int top = rowTap.first % 2, bottom = rowTap.second % 2;
+        const float fy = rowTap.fraction;
+        const float* thinTop = scale.thin(top);
+        const float* thinBottom = scale.thin(bottom);
+        // corners f g / j k and their bilinear weights s t / u v, one channel at a time
+        for (unsigned int channel = 0; channel < 3; channel++) {
+            const float* valueTop = scale.value(top, channel);
+            const float* valueBottom = scale.value(bottom, channel);
+            const float* numeratorTop = scale.numerator(top, channel);
+            const float* numeratorBottom = scale.numerator(bottom, channel);
+            const float* denominatorTop = scale.denominator(top, channel);
+            const float* denominatorBottom = scale.denominator(bottom, channel);
+            float* out = outputs[channel];
+            for (unsigned int i = 0; i < tileWidth; i++) {
+                const BilinearTap colTap = scale.bilinearCols[i];
+                const unsigned int left = colTap.first - sourceBegin, right = colTap.second - sourceBegin;
+                const float fx = colTap.fraction;
+                const float s = (1.0f - fx) * (1.0f - fy), t = fx * (1.0f - fy), u = (1.0f - fx) * fy, v = fx * fy;
+                // thin edges to hide the bilinear interpolation
+                const float ts = s * thinTop[left], tt = t * thinTop[right], tu = u * thinBottom[left], tv = v * thinBottom[right];
+                const float sum = ts * numeratorTop[left] + tt * numeratorTop[right] + tu * numeratorBottom[left] + tv * numeratorBottom[right];
+                const float weight = ts * denominatorTop[left] + tt * denominatorTop[right] + tu * denominatorBottom[left] + tv * denominatorBottom[right];
+                const float base = s * valueTop[left] + t * valueTop[right] + u * valueBottom[left] + v * valueBottom[right];
+                out[i] = lerp(base, saturate(sum / weight), sharpenStrength);
+            }
+        }
+        if constexpr (hasAlpha) {
+            const float* alphaTop = scale.alpha(top);
+            const float* alphaBottom = scale.alpha(bottom);
+            for (unsigned int i = 0; i < tileWidth; i++) {
+                const BilinearTap colTap = scale.bilinearCols[i];
+                const unsigned int left = colTap.first - sourceBegin, right = colTap.second - sourceBegin;
+                const float fx = colTap.fraction;
+                outA[i] = lerp(lerp(alphaTop[left], alphaTop[right], fx), lerp(alphaBottom[left], alphaBottom[right], fx), fy);
+            }
+        }
+        writeScaledRow<Out, hasAlpha, casMode>(outR, outG, outB, outA, casOutput, y, colBegin, colEnd);
+    }
+}
+
+// resizes and sharpens the output rows [rowBegin, rowEnd) x columns [colBegin, colEnd), instantiation of casScaled for an output sample/alpha/mode combination
+using ScaledTileFunction = void (*)(const InputView& input, const float sharpenStrength, const float contrastAdaption, const OutputView& casOutput, const unsigned int height,
+                                    const unsigned int width, const unsigned int outputHeight, const unsigned int outputWidth, const unsigned int rowBegin, const unsigned int rowEnd,
+                                    const unsigned int colBegin, const unsigned int colEnd, const Kernels& kernels, TileBuffer& tile, ScaleBuffer& scale);
+
+template <class Out>
+inline ScaledTileFunction scaledTileFunction(const bool hasAlpha, const int casMode) {
+    if (hasAlpha && casMode == PLANAR_RGB)
+        return casScaled<Out, true, PLANAR_RGB>;
+    if (hasAlpha && casMode == INTERLEAVED_RGBA)
+        return casScaled<Out, true, INTERLEAVED_RGBA>;
+    if (!hasAlpha && casMode == PLANAR_RGB)
+        return casScaled<Out, false, PLANAR_RGB>;
+    return casScaled<Out, false, INTERLEAVED_RGBA>;
+}
+
+// scaled tile function of an output CASSampleFormat
+inline ScaledTileFunction scaledTileFunction(const bool hasAlpha, const int casMode, const int sampleFormat) {
+    switch (sampleFormat) {
+    case CAS_SAMPLE_UNORM16: return scaledTileFunction<std::uint16_t>(hasAlpha, casMode);
+    case CAS_SAMPLE_HALF: return scaledTileFunction<half16>(hasAlpha, casMode);
+    case CAS_SAMPLE_FLOAT: return scaledTileFunction<float>(hasAlpha, casMode);
+    default: return scaledTileFunction<unsigned char>(hasAlpha, casMode);
+    }
+}
+} // namespace cas_cpu
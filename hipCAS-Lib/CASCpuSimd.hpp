@@ -0,0 +1,87 @@
+#pragma once
+
+// Vectorized CAS row kernels, shared by the ISA specific translation units (CASCpu_sse41.cpp, CASCpu_avx2.cpp, CASCpu_avx512.cpp)
+// Each unit defines its vector type V (with V::width lanes of fp32) and the load/store/min/max/fma/rcp/rsqrt helpers
+// before including this file, so that every instantiation is compiled for its own target ISA.
+// The approximate rcp/rsqrt instructions (12 bit or better) are as accurate as the half precision math of the device kernel.
+// Everything is in an anonymous namespace: no inline function may be shared (and merged by the linker) between ISAs.
+namespace {
+
+template <class V>
+inline V saturate(const V x) {
+    // max(x, 0) returns 0 for NaN (second operand), same as the scalar saturate
+    return min(max(x, set1<V>(0.0f)), set1<V>(1.0f));
+}
+
+// horizontal 3-tap min/max partials of a window row, see cas_cpu::HorizontalKernel
+template <class V>
+inline void horizontalMinMaxSimd(const float* value, float* hmin, float* hmax, const unsigned int width) {
+    for (unsigned int x = 0; x < width; x += V::width) {
+        const V left = load<V>(value + x - 1), center = load<V>(value + x), right = load<V>(value + x + 1);
+        store(hmin + x, min(min(left, center), right));
+        store(hmax + x, max(max(left, center), right));
+    }
+}
+
+// smooth minimum distance to signal limit divided by smooth max, from the cross and the horizontal partials of the three rows
+template <class V>
+inline V amplitude(const cas_cpu::RingRow& up, const cas_cpu::RingRow& mid, const cas_cpu::RingRow& down, const V b, const V h, const unsigned int x) {
+    const V two = set1<V>(2.0f);
+    // Soft min and max, 2.0x bigger (factored out the extra multiply).
+    V mn = min(load<V>(mid.hmin + x), min(b, h));
+    const V mn2 = min(mn, min(load<V>(up.hmin + x), load<V>(down.hmin + x)));
+    mn = mn + mn2;
+    V mx = max(load<V>(mid.hmax + x), max(b, h));
+    const V mx2 = max(mx, max(load<V>(up.hmax + x), load<V>(down.hmax + x)));
+    mx = mx + mx2;
+    return rsqrt(saturate(min(mn, two - mx) * rcp(mx)));
+}
+
+// parameter dependent stage: shaping of the sharpening amount, filter and lerp with the center pixel
+template <class V>
+inline V sharpen(const V e, const V amp, const V filterWindow, const V adaption, const V strength) {
+    const V four = set1<V>(4.0f), one = set1<V>(1.0f), zero = set1<V>(0.0f);
+    const V w = zero - rcp(amp * adaption);
+    const V rcpWeight = rcp(fmadd(four, w, one));
+    const V outColor = saturate(fmadd(filterWindow, w, e) * rcpWeight);
+    // lerp(e, outColor, strength) = strength * outColor + (e - strength * e)
+    return fmadd(strength, outColor, fnmadd(strength, e, e));
+}
+
+// sharpen one channel of one row, see cas_cpu::RowKernel
+template <class V>
+inline void casRowSimd(const cas_cpu::RingRow& up, const cas_cpu::RingRow& mid, const cas_cpu::RingRow& down, float* out, const unsigned int width, const float sharpenStrength,
+                       const float contrastAdaption) {
+    const V adaption = set1<V>(-3.0f * contrastAdaption + 8.0f);
+    const V strength = set1<V>(sharpenStrength);
+    for (unsigned int x = 0; x < width; x += V::width) {
+        //    b
+        //  d(e)f  and the horizontal partials of the three rows
+        //    h
+        const V b = load<V>(up.value + x), h = load<V>(down.value + x);
+        const V d = load<V>(mid.value + x - 1), e = load<V>(mid.value + x), f = load<V>(mid.value + x + 1);
+        // Filter shape: cross of w around the center pixel
+        store(out + x, sharpen(e, amplitude(up, mid, down, b, h, x), (b + d) + (f + h), adaption, strength));
+    }
+}
+
+// parameter independent stage of one channel of one row, see cas_cpu::AnalyzeKernel
+template <class V>
+inline void casAnalyzeSimd(const cas_cpu::RingRow& up, const cas_cpu::RingRow& mid, const cas_cpu::RingRow& down, float* amp, float* filterWindow, const unsigned int width) {
+    for (unsigned int x = 0; x < width; x += V::width) {
+        const V b = load<V>(up.value + x), h = load<V>(down.value + x);
+        const V d = load<V>(mid.value + x - 1), f = load<V>(mid.value + x + 1);
+        store(amp + x, amplitude(up, mid, down, b, h, x));
+        store(filterWindow + x, (b + d) + (f + h));
+    }
+}
+
+// parameter dependent stage of one channel of one row, see cas_cpu::ApplyKernel
+template <class V>
+inline void casApplySimd(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    const V adaption = set1<V>(-3.0f * contrastAdaption + 8.0f);
+    const V strength = set1<V>(sharpenStrength);
+    for (unsigned int x = 0; x < width; x += V::width)
+        store(out + x, sharpen(load<V>(e + x), load<V>(amp + x), load<V>(filterWindow + x), adaption, strength));
+}
+} // namespace
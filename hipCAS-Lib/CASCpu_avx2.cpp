@@ -0,0 +1,98 @@
+#include "CASCpu.hpp"
+#include "CASCpuFixed.hpp"
+#if CAS_X86
+#include <immintrin.h>
+
+// AVX2 build of the vectorized CAS row kernels, 8 lanes per iteration (16 for the fixed point ones)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace {
+struct F32x8 {
+    static constexpr unsigned int width = 8;
+    __m256 v;
+};
+
+template <class V>
+V set1(const float x);
+template <>
+inline F32x8 set1<F32x8>(const float x) { return {_mm256_set1_ps(x)}; }
+template <class V>
+V load(const float* p);
+template <>
+inline F32x8 load<F32x8>(const float* p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float* p, const F32x8 x) { _mm256_storeu_ps(p, x.v); }
+
+inline F32x8 operator+(const F32x8 a, const F32x8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline F32x8 operator-(const F32x8 a, const F32x8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline F32x8 operator*(const F32x8 a, const F32x8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline F32x8 min(const F32x8 a, const F32x8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline F32x8 max(const F32x8 a, const F32x8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline F32x8 fmadd(const F32x8 a, const F32x8 b, const F32x8 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+inline F32x8 fnmadd(const F32x8 a, const F32x8 b, const F32x8 c) { return {_mm256_fnmadd_ps(a.v, b.v, c.v)}; }
+inline F32x8 rcp(const F32x8 a) { return {_mm256_rcp_ps(a.v)}; }
+inline F32x8 sqrt(const F32x8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline F32x8 rsqrt(const F32x8 a) { return {_mm256_rsqrt_ps(a.v)}; }
+
+// 16-bit fixed point lanes of the fast precision tier
+struct I16x16 {
+    static constexpr unsigned int width = 16;
+    using Float = F32x8;
+    __m256i v;
+};
+
+template <class V>
+V load(const cas_cpu::fixed* p);
+template <>
+inline I16x16 load<I16x16>(const cas_cpu::fixed* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+inline void store(cas_cpu::fixed* p, const I16x16 x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x.v); }
+template <class V>
+V splat(const int x);
+template <>
+inline I16x16 splat<I16x16>(const int x) { return {_mm256_set1_epi16(static_cast<short>(x))}; }
+
+inline I16x16 operator+(const I16x16 a, const I16x16 b) { return {_mm256_add_epi16(a.v, b.v)}; }
+inline I16x16 operator-(const I16x16 a, const I16x16 b) { return {_mm256_sub_epi16(a.v, b.v)}; }
+inline I16x16 min(const I16x16 a, const I16x16 b) { return {_mm256_min_epu16(a.v, b.v)}; }
+inline I16x16 max(const I16x16 a, const I16x16 b) { return {_mm256_max_epu16(a.v, b.v)}; }
+inline I16x16 addSaturate(const I16x16 a, const I16x16 b) { return {_mm256_adds_epi16(a.v, b.v)}; }
+inline I16x16 mulRound(const I16x16 a, const I16x16 b) { return {_mm256_mulhrs_epi16(a.v, b.v)}; }
+inline I16x16 clampUnit(const I16x16 a) { return {_mm256_min_epi16(_mm256_max_epi16(a.v, _mm256_setzero_si256()), _mm256_set1_epi16(srgb_lut::fixedOne))}; }
+inline F32x8 widenLow(const I16x16 a) { return {_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(a.v)))}; }
+inline F32x8 widenHigh(const I16x16 a) { return {_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(a.v, 1)))}; }
+// packs saturates to [-32768, 32767] and interleaves the 128-bit lanes, the permute restores the order
+inline I16x16 narrow(const F32x8 low, const F32x8 high) { return {_mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_cvtps_epi32(low.v), _mm256_cvtps_epi32(high.v)), 0xD8)}; }
+} // namespace
+
+#include "CASCpuSimd.hpp"
+#include "CASCpuFixedSimd.hpp"
+
+namespace cas_cpu {
+void horizontalMinMaxAvx2(const float* value, float* hmin, float* hmax, const unsigned int width) { horizontalMinMaxSimd<F32x8>(value, hmin, hmax, width); }
+
+void casRowAvx2(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casRowSimd<F32x8>(up, mid, down, out, width, sharpenStrength, contrastAdaption);
+}
+
+void casAnalyzeAvx2(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width) {
+    casAnalyzeSimd<F32x8>(up, mid, down, amp, filterWindow, width);
+}
+
+void casApplyAvx2(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casApplySimd<F32x8>(e, amp, filterWindow, out, width, sharpenStrength, contrastAdaption);
+}
+
+void horizontalMinMaxFixedAvx2(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width) { horizontalMinMaxFixedSimd<I16x16>(value, hmin, hmax, width); }
+
+void casRowFixedAvx2(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casRowFixedSimd<I16x16>(up, mid, down, out, width, sharpenStrength, contrastAdaption);
+}
+} // namespace cas_cpu
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
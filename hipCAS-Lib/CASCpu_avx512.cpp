@@ -0,0 +1,65 @@
+#include "CASCpu.hpp"
+#if CAS_X86
+#include <immintrin.h>
+
+// AVX-512 build of the vectorized CAS row kernels, 16 lanes per iteration
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+#endif
+
+namespace {
+struct F32x16 {
+    static constexpr unsigned int width = 16;
+    __m512 v;
+};
+
+template <class V>
+V set1(const float x);
+template <>
+inline F32x16 set1<F32x16>(const float x) { return {_mm512_set1_ps(x)}; }
+template <class V>
+V load(const float* p);
+template <>
+inline F32x16 load<F32x16>(const float* p) { return {_mm512_loadu_ps(p)}; }
+inline void store(float* p, const F32x16 x) { _mm512_storeu_ps(p, x.v); }
+
+// the min/max and approximation intrinsics are the zero-masked forms with every lane set: the unmasked ones pass an undefined vector through,
+// which GCC 12 reports as maybe uninitialized; the full mask compiles to the same unmasked instructions
+constexpr __mmask16 allLanes = 0xFFFF;
+
+inline F32x16 operator+(const F32x16 a, const F32x16 b) { return {_mm512_add_ps(a.v, b.v)}; }
+inline F32x16 operator-(const F32x16 a, const F32x16 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+inline F32x16 operator*(const F32x16 a, const F32x16 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+inline F32x16 min(const F32x16 a, const F32x16 b) { return {_mm512_maskz_min_ps(allLanes, a.v, b.v)}; }
+inline F32x16 max(const F32x16 a, const F32x16 b) { return {_mm512_maskz_max_ps(allLanes, a.v, b.v)}; }
+inline F32x16 fmadd(const F32x16 a, const F32x16 b, const F32x16 c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+inline F32x16 fnmadd(const F32x16 a, const F32x16 b, const F32x16 c) { return {_mm512_fnmadd_ps(a.v, b.v, c.v)}; }
+// 14 bit approximations
+inline F32x16 rcp(const F32x16 a) { return {_mm512_maskz_rcp14_ps(allLanes, a.v)}; }
+inline F32x16 rsqrt(const F32x16 a) { return {_mm512_maskz_rsqrt14_ps(allLanes, a.v)}; }
+} // namespace
+
+#include "CASCpuSimd.hpp"
+
+namespace cas_cpu {
+void horizontalMinMaxAvx512(const float* value, float* hmin, float* hmax, const unsigned int width) { horizontalMinMaxSimd<F32x16>(value, hmin, hmax, width); }
+
+void casRowAvx512(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casRowSimd<F32x16>(up, mid, down, out, width, sharpenStrength, contrastAdaption);
+}
+
+void casAnalyzeAvx512(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width) {
+    casAnalyzeSimd<F32x16>(up, mid, down, amp, filterWindow, width);
+}
+
+void casApplyAvx512(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casApplySimd<F32x16>(e, amp, filterWindow, out, width, sharpenStrength, contrastAdaption);
+}
+} // namespace cas_cpu
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
@@ -0,0 +1,99 @@
+#include "CASCpu.hpp"
+#include "CASCpuFixed.hpp"
+#if CAS_X86
+#include <immintrin.h>
+
+// SSE4.1 build of the vectorized CAS row kernels, 4 lanes per iteration (8 for the fixed point ones)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse4.1")
+#endif
+
+namespace {
+struct F32x4 {
+    static constexpr unsigned int width = 4;
+    __m128 v;
+};
+
+template <class V>
+V set1(const float x);
+template <>
+inline F32x4 set1<F32x4>(const float x) { return {_mm_set1_ps(x)}; }
+template <class V>
+V load(const float* p);
+template <>
+inline F32x4 load<F32x4>(const float* p) { return {_mm_loadu_ps(p)}; }
+inline void store(float* p, const F32x4 x) { _mm_storeu_ps(p, x.v); }
+
+inline F32x4 operator+(const F32x4 a, const F32x4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline F32x4 operator-(const F32x4 a, const F32x4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline F32x4 operator*(const F32x4 a, const F32x4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline F32x4 min(const F32x4 a, const F32x4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline F32x4 max(const F32x4 a, const F32x4 b) { return {_mm_max_ps(a.v, b.v)}; }
+// no FMA before AVX2, use separate multiply and add
+inline F32x4 fmadd(const F32x4 a, const F32x4 b, const F32x4 c) { return a * b + c; }
+inline F32x4 fnmadd(const F32x4 a, const F32x4 b, const F32x4 c) { return c - a * b; }
+inline F32x4 rcp(const F32x4 a) { return {_mm_rcp_ps(a.v)}; }
+inline F32x4 sqrt(const F32x4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline F32x4 rsqrt(const F32x4 a) { return {_mm_rsqrt_ps(a.v)}; }
+
+// 16-bit fixed point lanes of the fast precision tier
+struct I16x8 {
+    static constexpr unsigned int width = 8;
+    using Float = F32x4;
+    __m128i v;
+};
+
+template <class V>
+V load(const cas_cpu::fixed* p);
+template <>
+inline I16x8 load<I16x8>(const cas_cpu::fixed* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+inline void store(cas_cpu::fixed* p, const I16x8 x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x.v); }
+template <class V>
+V splat(const int x);
+template <>
+inline I16x8 splat<I16x8>(const int x) { return {_mm_set1_epi16(static_cast<short>(x))}; }
+
+inline I16x8 operator+(const I16x8 a, const I16x8 b) { return {_mm_add_epi16(a.v, b.v)}; }
+inline I16x8 operator-(const I16x8 a, const I16x8 b) { return {_mm_sub_epi16(a.v, b.v)}; }
+inline I16x8 min(const I16x8 a, const I16x8 b) { return {_mm_min_epu16(a.v, b.v)}; }
+inline I16x8 max(const I16x8 a, const I16x8 b) { return {_mm_max_epu16(a.v, b.v)}; }
+inline I16x8 addSaturate(const I16x8 a, const I16x8 b) { return {_mm_adds_epi16(a.v, b.v)}; }
+inline I16x8 mulRound(const I16x8 a, const I16x8 b) { return {_mm_mulhrs_epi16(a.v, b.v)}; }
+inline I16x8 clampUnit(const I16x8 a) { return {_mm_min_epi16(_mm_max_epi16(a.v, _mm_setzero_si128()), _mm_set1_epi16(srgb_lut::fixedOne))}; }
+inline F32x4 widenLow(const I16x8 a) { return {_mm_cvtepi32_ps(_mm_cvtepu16_epi32(a.v))}; }
+inline F32x4 widenHigh(const I16x8 a) { return {_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(a.v, 8)))}; }
+// packs saturates to [-32768, 32767]
+inline I16x8 narrow(const F32x4 low, const F32x4 high) { return {_mm_packs_epi32(_mm_cvtps_epi32(low.v), _mm_cvtps_epi32(high.v))}; }
+} // namespace
+
+#include "CASCpuSimd.hpp"
+#include "CASCpuFixedSimd.hpp"
+
+namespace cas_cpu {
+void horizontalMinMaxSse41(const float* value, float* hmin, float* hmax, const unsigned int width) { horizontalMinMaxSimd<F32x4>(value, hmin, hmax, width); }
+
+void casRowSse41(const RingRow& up, const RingRow& mid, const RingRow& down, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casRowSimd<F32x4>(up, mid, down, out, width, sharpenStrength, contrastAdaption);
+}
+
+void casAnalyzeSse41(const RingRow& up, const RingRow& mid, const RingRow& down, float* amp, float* filterWindow, const unsigned int width) {
+    casAnalyzeSimd<F32x4>(up, mid, down, amp, filterWindow, width);
+}
+
+void casApplySse41(const float* e, const float* amp, const float* filterWindow, float* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casApplySimd<F32x4>(e, amp, filterWindow, out, width, sharpenStrength, contrastAdaption);
+}
+
+void horizontalMinMaxFixedSse41(const fixed* value, fixed* hmin, fixed* hmax, const unsigned int width) { horizontalMinMaxFixedSimd<I16x8>(value, hmin, hmax, width); }
+
+void casRowFixedSse41(const FixedRow& up, const FixedRow& mid, const FixedRow& down, fixed* out, const unsigned int width, const float sharpenStrength, const float contrastAdaption) {
+    casRowFixedSimd<I16x8>(up, mid, down, out, width, sharpenStrength, contrastAdaption);
+}
+} // namespace cas_cpu
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+#endif
@@ -1,64 +1,359 @@
 ﻿#include "CAS.hpp"
 #include "CASImpl.hpp"
 #include "hip_utils.hpp"
+#include <algorithm>
+#include <chrono>
 #include <hip/hip_runtime.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
-// initialize empty CAS instance
-CASImpl::CASImpl() : texObj(0), texArray(nullptr), casOutputBuffer(nullptr), hostOutputBuffer(nullptr), hasAlpha(false), rows(0), cols(0), totalBytes(0) {}
+// the first runtime call creates the primary context of the device
+CASHipContext::CASHipContext() : device([] {
+    int current = 0;
+    hipGetDevice(&current);
+    hipFree(nullptr);
+    return current;
+}()) {
+    pools[CAS_MEMORY_PINNED] = std::make_unique<CASBufferPool>(
+        [](const std::size_t bytes) {
+            void* buffer = nullptr;
+            return hipHostAlloc(&buffer, bytes, hipHostMallocDefault) == hipSuccess ? buffer : nullptr;
+        },
+        [](void* buffer) { hipHostFree(buffer); });
+    pools[CAS_MEMORY_DEVICE] = std::make_unique<CASBufferPool>(
+        [](const std::size_t bytes) {
+            void* buffer = nullptr;
+            return hipMalloc(&buffer, bytes) == hipSuccess ? buffer : nullptr;
+        },
+        [](void* buffer) { hipFree(buffer); });
+    pools[CAS_MEMORY_TEXTURE] = std::make_unique<CASBufferPool>(
+        [](const std::size_t key) { return static_cast<void*>(hip_utils::hipMallocArray((key >> 16) & 0xFFFFFF, key >> 40, static_cast<int>(key & 0xFFFF))); },
+        [](void* array) { hipFreeArray(static_cast<hipArray_t>(array)); });
+}
+
+CASBackend* CASHipContext::createSession() { return new CASImpl(shared_from_this()); }
+
+// initialize empty CAS instance, with its stream (on the device of the context) and the events timing the device stages
+CASImpl::CASImpl(std::shared_ptr<CASHipContext> context) : context(std::move(context)), stream(nullptr), texObj(0), hasAlpha(false), pixelFormat(CAS_FORMAT_RGBA8),
+      sampleFormat(CAS_SAMPLE_SRGB8), rows(0), cols(0), totalBytes(0), cacheBudget(0), cachedRows(0) {
+    hipSetDevice(this->context->device);
+    hipStreamCreateWithFlags(&stream, hipStreamNonBlocking);
+    hipEventCreate(&stageStart);
+    hipEventCreate(&stageStop);
+}
 
 // destructor, destroy everything
-CASImpl::~CASImpl() { destroyBuffers(); }
+CASImpl::~CASImpl() {
+    destroyBuffers();
+    hipEventDestroy(stageStart);
+    hipEventDestroy(stageStop);
+    hipStreamDestroy(stream);
+}
 
-// initialize buffers and texture data based on the provided image dimensions
+// take a buffer of at least bytes from a pool of the context (its size class), counted as an allocation when the pool had to allocate it
+void CASImpl::acquire(PooledBuffer& buffer, const int memoryKind, const std::size_t bytes) {
+    if (buffer.acquireBytes(*context->pool(memoryKind), bytes))
+        counters.countAllocation(buffer.capacity());
+}
+
+// initialize buffers and texture data based on the provided image dimensions, from the pools of the context
 void CASImpl::initializeMemory() {
-    totalBytes = rows * cols * (hasAlpha ? sizeof(uchar4) : sizeof(uchar3));
-    // initialize CAS output buffers and pinned memory for output
-    hipMalloc(&casOutputBuffer, totalBytes);
-    hipHostAlloc(&hostOutputBuffer, totalBytes, hipHostMallocDefault);
-    // initialize texture
-    auto textureData = hip_utils::createTextureData(rows, cols);
-    texObj = textureData.first;
-    texArray = textureData.second;
-}
-
-// destory and re-initialize memory objects
-void CASImpl::reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const unsigned int rows, const unsigned int cols) {
-    this->rows = rows;
-    this->cols = cols;
-    this->hasAlpha = hasAlpha;
-    destroyBuffers();
-    initializeMemory();
-    hip_utils::copyDataToHipArray(hostRgbPtr, rows, cols, texArray);
+    const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+    allocateOutput();
+    // texture array of the exact shape (texels: uchar4 for every 8-bit format), the texture object is created for the pixel format of the image
+    const int texelFormat = isLinearFormat(pixelFormat) ? pixelFormat : CAS_FORMAT_RGBA8;
+    const std::size_t textureBytes = static_cast<std::size_t>(rows) * cols * inputRowBytes(texelFormat, 1);
+    if (texArray.acquire(*context->pool(CAS_MEMORY_TEXTURE), CASHipContext::textureKey(rows, cols, texelFormat), textureBytes))
+        counters.countAllocation(textureBytes);
+    texObj = hip_utils::createTextureObject(hip_utils::createResourceDescriptor(textureArray()), hip_utils::createTextureDescriptor(pixelFormat));
+    // staging buffers of the device side conversion
+    if (pixelFormat != CAS_FORMAT_RGBA8 && !isLinearFormat(pixelFormat)) {
+        acquire(inputStaging, CAS_MEMORY_DEVICE, inputRowBytes(pixelFormat, cols) * rows * inputPlanes(pixelFormat));
+        acquire(rgbaStaging, CAS_MEMORY_DEVICE, static_cast<std::size_t>(rows) * cols * sizeof(uchar4));
+    }
+    if (hasAlpha)
+        acquire(alphaSkippedCounter, CAS_MEMORY_DEVICE, sizeof(unsigned long long));
 }
 
-// delete all buffers
-void CASImpl::destroyBuffers() {
-    static constexpr auto destroy = [](auto& resource, auto& deleter) {
-        if (resource) {
-            deleter(resource);
-            resource = {};
+// initialize CAS output buffers and pinned memory for output, in the output sample format
+void CASImpl::allocateOutput() {
+    totalBytes = static_cast<unsigned long long>(rows) * cols * (hasAlpha ? 4 : 3) * sampleBytes(sampleFormat);
+    acquire(casOutputBuffer, CAS_MEMORY_DEVICE, totalBytes);
+    acquire(hostOutputBuffer, CAS_MEMORY_PINNED, totalBytes);
+}
+
+// a different sample size reallocates the output buffers of the supplied image (the texture is kept)
+void CASImpl::setOutputFormat(const int sampleFormat) {
+    if (sampleFormat == this->sampleFormat)
+        return;
+    this->sampleFormat = sampleFormat;
+    if (casOutputBuffer) {
+        const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+        allocateOutput();
+    }
+}
+
+// destory and re-initialize memory objects, an image of the same dimensions, alpha and pixel format reuses them and only uploads its pixels
+void CASImpl::reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                                 const unsigned int cols) {
+    if (!texArray || rows != this->rows || cols != this->cols || hasAlpha != this->hasAlpha || pixelFormat != this->pixelFormat) {
+        this->rows = rows;
+        this->cols = cols;
+        this->hasAlpha = hasAlpha;
+        this->pixelFormat = pixelFormat;
+        destroyBuffers();
+        // a failed allocation leaves the instance without an image, not with the new shape over missing buffers
+        try {
+            initializeMemory();
+        } catch (...) {
+            destroyBuffers();
+            this->rows = this->cols = 0;
+            throw;
         }
-    };
-    destroy(casOutputBuffer, hipFree);
-    destroy(texObj, hipDestroyTextureObject);
-    destroy(texArray, hipFreeArray);
-    destroy(hostOutputBuffer, hipHostFree);
+    }
+    uploadInput(hostRgbPtr, inputStride);
+}
+
+// upload a new frame into the existing texture
+void CASImpl::supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) { uploadInput(hostRgbPtr, inputStride); }
+
+// upload the pixels into the texture, the strided copies handle padded rows
+// RGBA and the 16-bit/float formats are copied as is, the other formats transfer their own (smaller) rows and are expanded to RGBA on the device
+void CASImpl::uploadInput(const unsigned char* hostRgbPtr, const std::size_t inputStride) {
+    counters.countIn(inputRowBytes(pixelFormat, cols) * rows * inputPlanes(pixelFormat));
+    if (pixelFormat == CAS_FORMAT_RGBA8 || isLinearFormat(pixelFormat)) {
+        const auto timer = counters.time(CAS_STAGE_UPLOAD);
+        hip_utils::copyDataToHipArray(hostRgbPtr, rows, cols, inputRowBytes(pixelFormat, 1), textureArray(), inputStride, stream);
+    } else {
+        const std::size_t rowBytes = inputRowBytes(pixelFormat, cols);
+        {
+            const auto timer = counters.time(CAS_STAGE_UPLOAD);
+            hipMemcpy2DAsync(inputStaging.get(), rowBytes, hostRgbPtr, inputStride, rowBytes, static_cast<std::size_t>(rows) * inputPlanes(pixelFormat), hipMemcpyHostToDevice, stream);
+            hipStreamSynchronize(stream);
+        }
+        hipEventRecord(stageStart, stream);
+        expandToRgba<<<hip_utils::gridSizeCalculate(defaultBlockSize, rows, cols), defaultBlockSize, 0, stream>>>(inputStaging.data(), rowBytes, pixelFormat, rgbaStaging.data<uchar4>(), rows, cols);
+        const std::size_t rgbaRowBytes = static_cast<std::size_t>(cols) * sizeof(uchar4);
+        hipMemcpy2DToArrayAsync(textureArray(), 0, 0, rgbaStaging.get(), rgbaRowBytes, rgbaRowBytes, rows, hipMemcpyDeviceToDevice, stream);
+        hipEventRecord(stageStop, stream);
+        addDeviceStage(CAS_STAGE_CONVERT);
+    }
+    cachedRows = 0;
+}
+
+// wait for the device work recorded between stageStart and stageStop and add its duration to a stage
+void CASImpl::addDeviceStage(const int stage) {
+    hipEventSynchronize(stageStop);
+    float milliseconds = 0.0f;
+    hipEventElapsedTime(&milliseconds, stageStart, stageStop);
+    counters.addStage(stage, std::chrono::duration_cast<CASCounters::Clock::duration>(std::chrono::duration<float, std::milli>(milliseconds)));
+}
+
+// wait for the sharpening kernel (its device time is the kernel stage) and count the output, pixels skipped by the alpha early-out included
+void CASImpl::finishKernel(const int casMode, const unsigned int width, const unsigned int height) {
+    addDeviceStage(CAS_STAGE_KERNEL);
+    counters.countPixels(static_cast<std::size_t>(width) * height);
+    counters.countOut(rowBytes(hasAlpha, casMode, width, sampleFormat) * (casMode == PLANAR_RGB ? (hasAlpha ? 4 : 3) : 1) * height);
+    if (alphaSkippedCounter) {
+        unsigned long long skipped = 0;
+        hipMemcpyAsync(&skipped, alphaSkippedCounter.get(), sizeof(skipped), hipMemcpyDeviceToHost, stream);
+        hipStreamSynchronize(stream);
+        counters.countAlphaSkipped(skipped);
+    }
+}
+
+// destroy the texture object and give every buffer back to the pools (the work of this session on them is complete: every call waits for its stream)
+void CASImpl::destroyBuffers() {
+    if (texObj) {
+        hipDestroyTextureObject(texObj);
+        texObj = 0;
+    }
+    for (PooledBuffer* buffer : {&texArray, &casOutputBuffer, &hostOutputBuffer, &cacheBuffer, &inputStaging, &rgbaStaging, &scaledOutputBuffer, &alphaSkippedCounter})
+        buffer->reset();
+    cachedRows = 0;
+}
+
+// device memory of the intermediates of the supplied image
+std::size_t CASImpl::cacheBytes() const { return static_cast<std::size_t>(rows) * cols * sizeof(CASIntermediate); }
+
+// a smaller budget releases a cache that does not fit anymore
+void CASImpl::setCacheBudget(const std::size_t bytes) {
+    cacheBudget = bytes;
+    if (cacheBuffer && cacheBytes() > cacheBudget) {
+        cacheBuffer.reset();
+        cachedRows = 0;
+    }
+}
+
+void CASImpl::invalidateCache() { cachedRows = 0; }
+
+// thread block of the CAS kernels on the supplied image in casMode: the tuned one, else 16 x 16
+dim3 CASImpl::blockSize(const int casMode) const {
+    const CASTuning& tuned = tuning(casMode);
+    return tuned.blockX && tuned.blockY ? dim3(tuned.blockX, tuned.blockY) : defaultBlockSize;
+}
+
+// one axis: the thread block, from 64 to 512 threads, wide blocks favour the coalesced row accesses of the interleaved output
+std::vector<CASTuning> CASImpl::tuningCandidates(const unsigned int axis, const CASTuning& best) const {
+    std::vector<CASTuning> candidates;
+    if (axis > 0)
+        return candidates;
+    constexpr unsigned int blocks[][2]{{0, 0}, {8, 8}, {16, 8}, {32, 4}, {32, 8}, {64, 4}, {32, 16}, {64, 8}};
+    for (const auto& block : blocks) {
+        CASTuning candidate = best;
+        candidate.blockX = block[0];
+        candidate.blockY = block[1];
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+// enqueue CAS kernel with Alpha channel output or not, or RGB planar or interleaved output based on param casMode
+// the grid covers the rectangle [x, x + width) x [y, y + height) of the texture only, its output is packed at the start of the device buffer
+template <class Sample, int cacheMode>
+void CASImpl::launchCasAs(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                          const unsigned int height) {
+    const dim3 blockSize = this->blockSize(casMode);
+    const dim3 gridSize = hip_utils::gridSizeCalculate(blockSize, height, width);
+    Sample* output = casOutputBuffer.data<Sample>();
+    CASIntermediate* cache = cacheBuffer.data<CASIntermediate>();
+    unsigned long long* alphaSkipped = alphaSkippedCounter.data<unsigned long long>();
+    if (hasAlpha && casMode == PLANAR_RGB)
+        cas<Sample, true, PLANAR_RGB, cacheMode><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, height, width, x, y, cols, cache,
+                                                                                     alphaSkipped);
+    else if (hasAlpha && casMode == INTERLEAVED_RGBA)
+        cas<Sample, true, INTERLEAVED_RGBA, cacheMode><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, height, width, x, y, cols, cache,
+                                                                                           alphaSkipped);
+    else if (!hasAlpha && casMode == PLANAR_RGB)
+        cas<Sample, false, PLANAR_RGB, cacheMode><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, height, width, x, y, cols, cache);
+    else
+        cas<Sample, false, INTERLEAVED_RGBA, cacheMode><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, height, width, x, y, cols, cache);
+}
+
+// dispatch on the output sample format
+template <int cacheMode>
+void CASImpl::launchCas(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                        const unsigned int height) {
+    switch (sampleFormat) {
+    case CAS_SAMPLE_UNORM16: launchCasAs<unsigned short, cacheMode>(casMode, sharpenStrength, contrastAdaption, x, y, width, height); break;
+    case CAS_SAMPLE_HALF: launchCasAs<half, cacheMode>(casMode, sharpenStrength, contrastAdaption, x, y, width, height); break;
+    case CAS_SAMPLE_FLOAT: launchCasAs<float, cacheMode>(casMode, sharpenStrength, contrastAdaption, x, y, width, height); break;
+    default: launchCasAs<unsigned char, cacheMode>(casMode, sharpenStrength, contrastAdaption, x, y, width, height); break;
+    }
+}
+
+// run the CAS kernel on a rectangle of the texture data into the device output buffer, timed by the stage events (see finishKernel)
+// in cached mode, the first whole image call also stores the intermediates and the next calls (whole image or region) only run the weight/lerp/encode stage from them
+// regions of whole rows fill it too, from the top: a band that starts at or above the first row not cached yet extends the cached rows (the cache is read once they cover
+// the image), the other regions leave it as it is
+void CASImpl::runCas(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                     const unsigned int height) {
+    const bool fills = x == 0 && width == cols && y <= cachedRows;
+    const bool useCache = !tuningRun() && cacheBudget > 0 && cacheBytes() <= cacheBudget;
+    if (useCache && fills && !cacheBuffer) {
+        const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+        // without device memory for it, the call runs uncached
+        try {
+            acquire(cacheBuffer, CAS_MEMORY_DEVICE, cacheBytes());
+        } catch (const std::bad_alloc&) {}
+    }
+    if (alphaSkippedCounter)
+        hipMemsetAsync(alphaSkippedCounter.get(), 0, sizeof(unsigned long long), stream);
+    hipEventRecord(stageStart, stream);
+    if (useCache && cacheBuffer && cachedRows == rows)
+        launchCas<CACHE_USE>(casMode, sharpenStrength, contrastAdaption, x, y, width, height);
+    else if (useCache && cacheBuffer && fills) {
+        launchCas<CACHE_FILL>(casMode, sharpenStrength, contrastAdaption, x, y, width, height);
+        cachedRows = std::max(cachedRows, y + height);
+    } else
+        launchCas<CACHE_NONE>(casMode, sharpenStrength, contrastAdaption, x, y, width, height);
+    hipEventRecord(stageStop, stream);
 }
 
 // calls CAS kernel on the texture data, return sharpened image as unsigned char buffer (pinned memory of this CAS instance)
 const unsigned char* CASImpl::sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) {
-    const dim3 gridSize = hip_utils::gridSizeCalculate(blockSize, rows, cols);
-    // enqueue CAS kernel with Alpha channel output or not, or RGB planar or interleaved output based on param casMode
+    runCas(casMode, sharpenStrength, contrastAdaption, 0, 0, cols, rows);
+    finishKernel(casMode, cols, rows);
+    // copy from GPU to HOST
+    const auto timer = counters.time(CAS_STAGE_DOWNLOAD);
+    hipMemcpyAsync(hostOutputBuffer.get(), casOutputBuffer.get(), totalBytes, hipMemcpyDeviceToHost, stream);
+    hipStreamSynchronize(stream);
+    return hostOutputBuffer.data();
+}
+
+// calls CAS kernel on the texture data and copies the result straight into the caller's rows (no pinned staging copy)
+void CASImpl::sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) {
+    sharpenRegionInto(casMode, sharpenStrength, contrastAdaption, 0, 0, cols, rows, output, outputStride);
+}
+
+// calls CAS kernel on a rectangle of the texture data only (the kernel reads its halo from the full texture) and copies it into the caller's rows
+void CASImpl::sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                                const unsigned int height, unsigned char* output, const std::size_t outputStride) {
+    runCas(casMode, sharpenStrength, contrastAdaption, x, y, width, height);
+    finishKernel(casMode, width, height);
+    // the planes of the planar output are consecutive blocks of rows
+    const std::size_t widthBytes = rowBytes(hasAlpha, casMode, width, sampleFormat);
+    const std::size_t outputRows = casMode == PLANAR_RGB ? static_cast<std::size_t>(height) * (hasAlpha ? 4 : 3) : height;
+    const auto timer = counters.time(CAS_STAGE_DOWNLOAD);
+    hipMemcpy2DAsync(output, outputStride, casOutputBuffer.get(), widthBytes, widthBytes, outputRows, hipMemcpyDeviceToHost, stream);
+    hipStreamSynchronize(stream);
+}
+
+// enqueue the scaled CAS kernel with Alpha channel output or not, or RGB planar or interleaved output based on param casMode, area averaging or upscaling filter
+template <class Sample, bool area>
+void CASImpl::launchScaledAs(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                             const unsigned int firstRow, const unsigned int rowCount) {
+    const dim3 blockSize = this->blockSize(casMode);
+    const dim3 gridSize = hip_utils::gridSizeCalculate(blockSize, rowCount, outputCols);
+    Sample* output = scaledOutputBuffer.data<Sample>();
     if (hasAlpha && casMode == PLANAR_RGB)
-        cas<unsigned char, true, PLANAR_RGB><<<gridSize, blockSize>>>(texObj, sharpenStrength, contrastAdaption, reinterpret_cast<unsigned char*>(casOutputBuffer), rows, cols);
+        casScaled<Sample, true, PLANAR_RGB, area><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, outputRows, outputCols, firstRow, rowCount, rows, cols);
     else if (hasAlpha && casMode == INTERLEAVED_RGBA)
-        cas<uchar4, true, INTERLEAVED_RGBA><<<gridSize, blockSize>>>(texObj, sharpenStrength, contrastAdaption, reinterpret_cast<uchar4*>(casOutputBuffer), rows, cols);
+        casScaled<Sample, true, INTERLEAVED_RGBA, area><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, outputRows, outputCols, firstRow, rowCount, rows, cols);
     else if (!hasAlpha && casMode == PLANAR_RGB)
-        cas<unsigned char, false, PLANAR_RGB><<<gridSize, blockSize>>>(texObj, sharpenStrength, contrastAdaption, reinterpret_cast<unsigned char*>(casOutputBuffer), rows, cols);
+        casScaled<Sample, false, PLANAR_RGB, area><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, outputRows, outputCols, firstRow, rowCount, rows, cols);
     else
-        cas<uchar3, false, INTERLEAVED_RGBA><<<gridSize, blockSize>>>(texObj, sharpenStrength, contrastAdaption, reinterpret_cast<uchar3*>(casOutputBuffer), rows, cols);
+        casScaled<Sample, false, INTERLEAVED_RGBA, area><<<gridSize, blockSize, 0, stream>>>(texObj, sharpenStrength, contrastAdaption, output, outputRows, outputCols, firstRow, rowCount, rows, cols);
+}
 
-    // copy from GPU to HOST
-    hipMemcpy(hostOutputBuffer, casOutputBuffer, totalBytes, hipMemcpyDeviceToHost);
-    return hostOutputBuffer;
+// sharpens the texture and resizes it to outputCols x outputRows in one pass (no cache, the intermediates are per source pixel), the grid covers the output rows
+// [firstRow, firstRow + rowCount) only, copied into the caller's rows. The device output of the resized rows is kept between calls and only grows
+void CASImpl::sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                                const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) {
+    const std::size_t widthBytes = rowBytes(hasAlpha, casMode, outputCols, sampleFormat);
+    const std::size_t planeRows = casMode == PLANAR_RGB ? static_cast<std::size_t>(rowCount) * (hasAlpha ? 4 : 3) : rowCount;
+    if (widthBytes * planeRows > scaledOutputBuffer.capacity()) {
+        const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+        acquire(scaledOutputBuffer, CAS_MEMORY_DEVICE, widthBytes * planeRows);
+    }
+    // area averaging when either dimension shrinks, else the upscaling filter
+    const bool area = outputCols < cols || outputRows < rows;
+    hipEventRecord(stageStart, stream);
+    switch (sampleFormat) {
+    case CAS_SAMPLE_UNORM16:
+        area ? launchScaledAs<unsigned short, true>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount)
+             : launchScaledAs<unsigned short, false>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount);
+        break;
+    case CAS_SAMPLE_HALF:
+        area ? launchScaledAs<half, true>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount)
+             : launchScaledAs<half, false>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount);
+        break;
+    case CAS_SAMPLE_FLOAT:
+        area ? launchScaledAs<float, true>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount)
+             : launchScaledAs<float, false>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount);
+        break;
+    default:
+        area ? launchScaledAs<unsigned char, true>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount)
+             : launchScaledAs<unsigned char, false>(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount);
+        break;
+    }
+    hipEventRecord(stageStop, stream);
+    addDeviceStage(CAS_STAGE_KERNEL);
+    counters.countPixels(static_cast<std::size_t>(rowCount) * outputCols);
+    counters.countOut(widthBytes * planeRows);
+    const auto timer = counters.time(CAS_STAGE_DOWNLOAD);
+    hipMemcpy2DAsync(output, outputStride, scaledOutputBuffer.get(), widthBytes, widthBytes, planeRows, hipMemcpyDeviceToHost, stream);
+    hipStreamSynchronize(stream);
 }
@@ -1,26 +1,88 @@
 #pragma once
+#include "CASBackend.hpp"
+#include "CASBufferPool.hpp"
+#include "CASContext.hpp"
+#include <cstddef>
 #include <hip/hip_runtime.h>
+#include <memory>
+#include <vector>
 
-enum CASMode { PLANAR_RGB, INTERLEAVED_RGBA };
+struct CASIntermediate;
+
+// Shared state of the HIP sessions: the device (current one of the creating thread), initialized once, so that a new session only creates its stream and events,
+// and the pools of the pinned, device and texture array buffers of the sessions
+class CASHipContext final : public CASContext, public std::enable_shared_from_this<CASHipContext> {
+  public:
+    const int device;
+
+    CASHipContext();
+
+    // pool class of a texture array: its shape and texel format (rows and columns below 2^24)
+    static std::size_t textureKey(const unsigned int rows, const unsigned int cols, const int texelFormat) {
+        return (static_cast<std::size_t>(rows) << 40) | (static_cast<std::size_t>(cols) << 16) | static_cast<std::size_t>(texelFormat);
+    }
+
+    CASBackend* createSession() override;
+};
 
 // Main class responsible for managing HIP memory and calling the CAS kernel to sharpen the input image
-class CASImpl {
+// a session of a CASHipContext: its copies and kernels run on its own stream, so the sessions of several threads overlap on the device
+class CASImpl final : public CASBackend {
   private:
+    const std::shared_ptr<CASHipContext> context;
+    hipStream_t stream;
+    // every buffer comes from (and goes back to) a pool of the context
     hipTextureObject_t texObj;
-    hipArray_t texArray;
-    void* casOutputBuffer;
-    unsigned char* hostOutputBuffer;
+    PooledBuffer texArray;
+    PooledBuffer casOutputBuffer;
+    PooledBuffer hostOutputBuffer;
     bool hasAlpha;
+    int pixelFormat;
+    // CASSampleFormat of the output buffers
+    int sampleFormat;
     unsigned int rows, cols;
     unsigned long long totalBytes;
-    const dim3 blockSize{16, 16};
+    // thread block of the format conversion, and of the CAS kernels without a tuned one
+    const dim3 defaultBlockSize{16, 16};
+    // cached mode: device buffer of the per-pixel intermediates, allocated on first use within the budget
+    PooledBuffer cacheBuffer;
+    std::size_t cacheBudget;
+    // rows of the cache filled from the top (by whole image calls or regions of whole rows), it is read once they reach the last row
+    unsigned int cachedRows;
+    // 8-bit pixel formats other than RGBA: the image is uploaded in its own layout (inputStaging) and expanded on the device (rgbaStaging) before the copy into the texture
+    PooledBuffer inputStaging;
+    PooledBuffer rgbaStaging;
+    // scaling mode: device output of the resized image, grown on demand
+    PooledBuffer scaledOutputBuffer;
+    // instrumentation: events around the device work of a stage, device counter of the pixels skipped by the alpha early-out (images with alpha)
+    hipEvent_t stageStart, stageStop;
+    PooledBuffer alphaSkippedCounter;
 
+    dim3 blockSize(const int casMode) const;
     void initializeMemory();
+    void allocateOutput();
     void destroyBuffers();
+    void acquire(PooledBuffer& buffer, const int memoryKind, const std::size_t bytes);
+    hipArray_t textureArray() const { return static_cast<hipArray_t>(texArray.get()); }
+    void uploadInput(const unsigned char* hostRgbPtr, const std::size_t inputStride);
+    std::size_t cacheBytes() const;
+    void addDeviceStage(const int stage);
+    void finishKernel(const int casMode, const unsigned int width, const unsigned int height);
+    template <class Sample, int cacheMode>
+    void launchCasAs(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                     const unsigned int height);
+    template <int cacheMode>
+    void launchCas(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                   const unsigned int height);
+    template <class Sample, bool area>
+    void launchScaledAs(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                        const unsigned int firstRow, const unsigned int rowCount);
+    void runCas(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                const unsigned int height);
 
   public:
-    CASImpl();
-    ~CASImpl();
+    explicit CASImpl(std::shared_ptr<CASHipContext> context);
+    ~CASImpl() override;
 
     // delete move/copy ctors/operators, not useful for a DLL class
     CASImpl(const CASImpl& other) = delete;
@@ -28,6 +90,26 @@ class CASImpl {
     CASImpl& operator=(CASImpl&& other) noexcept = delete;
     CASImpl& operator=(const CASImpl& other) = delete;
 
-    void reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const unsigned int rows, const unsigned int cols);
-    const unsigned char* sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption);
+    void reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                            const unsigned int cols) override;
+    void supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) override;
+    const char* name() const override { return "hip"; }
+    CASContext& sharedContext() const override { return *context; }
+    const unsigned char* sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) override;
+    void sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                           const unsigned int height, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                           const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) override;
+    unsigned int imageRows() const override { return rows; }
+    unsigned int imageCols() const override { return cols; }
+    bool imageHasAlpha() const override { return hasAlpha; }
+    int imageFormat() const override { return pixelFormat; }
+    void setOutputFormat(const int sampleFormat) override;
+    int outputFormat() const override { return sampleFormat; }
+    void setCacheBudget(const std::size_t bytes) override;
+    void invalidateCache() override;
+
+  protected:
+    std::vector<CASTuning> tuningCandidates(const unsigned int axis, const CASTuning& best) const override;
 };
\ No newline at end of file
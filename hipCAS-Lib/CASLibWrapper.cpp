@@ -1,28 +1,420 @@
-#include "CASImpl.hpp"
+#include "CASAsync.hpp"
+#include "CASBackend.hpp"
+#include "CASBufferPool.hpp"
+#include "CASContext.hpp"
+#include "cpu_utils.hpp"
 #include "include/CASLibWrapper.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#ifdef CAS_REMOTE
+#include "CASRemoteImpl.hpp"
+#include "remote_utils.hpp"
+#else
+#include "CASCpuImpl.hpp"
+#include "CASStream.hpp"
+#endif
+#if !defined(CAS_CPU_ONLY) && !defined(CAS_REMOTE)
+#include "CASImpl.hpp"
+#include "hip_utils.hpp"
+#endif
+
+#ifdef CAS_REMOTE
+// client library: the row streams run in the daemon as well
+using CASStreamEngine = CASRemoteStream;
+#else
+using CASStreamEngine = CASStream;
+#endif
+
+// select the CAS engine: the CAS_BACKEND environment variable ("gpu" or "cpu") forces one,
+// else the HIP engine is used when a device is present, with the native CPU engine as fallback
+// the client library (CAS_REMOTE) only has the remote engine, connected to the daemon of remote_utils::defaultSocketPath
+static std::shared_ptr<CASContext> createEngineContext() {
+#if defined(CAS_REMOTE)
+    return std::make_shared<CASRemoteContext>(remote_utils::defaultSocketPath());
+#elif defined(CAS_CPU_ONLY)
+    return std::make_shared<CASCpuContext>();
+#else
+    const char* backend = std::getenv("CAS_BACKEND");
+    if (backend && std::string_view(backend) == "cpu")
+        return std::make_shared<CASCpuContext>();
+    if (backend && std::string_view(backend) == "gpu")
+        return std::make_shared<CASHipContext>();
+    return hip_utils::isDeviceAvailable() ? std::static_pointer_cast<CASContext>(std::make_shared<CASHipContext>()) : std::make_shared<CASCpuContext>();
+#endif
+}
+
+// the local engines start with the tuning profile of the user (the daemon tunes its own engine)
+static std::shared_ptr<CASContext> createContext() {
+    std::shared_ptr<CASContext> context = createEngineContext();
+#ifndef CAS_REMOTE
+    context->tuningProfile().load(CASTuningProfile::defaultPath());
+#endif
+    return context;
+}
+
+// checked output stride of a sharpening call, 0 for an invalid one: 0 selects packed rows, else at least one row of whole samples of the output format,
+// the output must be aligned to the sample size as well
+static std::size_t checkedOutputStride(const CASBackend* cas, const int casMode, const unsigned int cols, const unsigned char* output, const unsigned int outputStride) {
+    const std::size_t sampleBytes = CASBackend::sampleBytes(cas->outputFormat());
+    const std::size_t minimumStride = CASBackend::rowBytes(cas->imageHasAlpha(), casMode, cols, cas->outputFormat());
+    const std::size_t stride = outputStride ? outputStride : minimumStride;
+    if (stride < minimumStride || stride % sampleBytes != 0 || reinterpret_cast<std::uintptr_t>(output) % sampleBytes != 0)
+        return 0;
+    return stride;
+}
 
 // Implementation of the CAS DLL API
 extern "C" {
 
+// a session of its own context
 CAS_API void* CAS_initialize() {
     try {
-        return new CASImpl();
+        return createContext()->createSession();
+    } catch (const std::exception&) { return nullptr; }
+}
+
+// the handle owns a reference to the context, its sessions own the others
+CAS_API void* CAS_createContext() {
+    try {
+        return new std::shared_ptr<CASContext>(createContext());
+    } catch (const std::exception&) { return nullptr; }
+}
+
+CAS_API void* CAS_createSession(void* casContext) {
+    if (!casContext)
+        return nullptr;
+    try {
+        return (*static_cast<std::shared_ptr<CASContext>*>(casContext))->createSession();
     } catch (const std::exception&) { return nullptr; }
 }
 
+CAS_API void CAS_destroyContext(void* casContext) { delete static_cast<std::shared_ptr<CASContext>*>(casContext); }
+
+CAS_API int CAS_getPoolStats(void* casImpl, const int memoryKind, CASPoolStats* stats) {
+    if (!casImpl || !stats || memoryKind < 0 || memoryKind >= CAS_MEMORY_KIND_COUNT)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    *stats = CASPoolStats{};
+    if (const CASBufferPool* pool = static_cast<const CASBackend*>(casImpl)->sharedContext().pool(memoryKind))
+        pool->read(*stats);
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_setPoolLimit(void* casImpl, const int memoryKind, const unsigned long long bytes) {
+    if (!casImpl || memoryKind < 0 || memoryKind >= CAS_MEMORY_KIND_COUNT)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    if (CASBufferPool* pool = static_cast<const CASBackend*>(casImpl)->sharedContext().pool(memoryKind))
+        pool->setLimit(static_cast<std::size_t>(bytes));
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_trimPool(void* casImpl, const int memoryKind, const unsigned long long keepBytes) {
+    if (!casImpl || memoryKind < 0 || memoryKind >= CAS_MEMORY_KIND_COUNT)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    if (CASBufferPool* pool = static_cast<const CASBackend*>(casImpl)->sharedContext().pool(memoryKind))
+        pool->trim(static_cast<std::size_t>(keepBytes));
+    return CAS_STATUS_OK;
+}
+
 CAS_API void CAS_supplyImage(void* casImpl, const unsigned char* inputImage, const int hasAlpha, const unsigned int rows, const unsigned int cols) {
-    CASImpl* cas = static_cast<CASImpl*>(casImpl);
-    cas->reinitializeMemory(hasAlpha, inputImage, rows, cols);
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    // no exception crosses the C API: the engines give up the image when its buffers can not be allocated, the next calls see an empty instance
+    try {
+        cas->reinitializeMemory(hasAlpha, inputImage, CAS_FORMAT_RGBA8, static_cast<std::size_t>(cols) * 4, rows, cols);
+    } catch (const std::exception&) {}
+}
+
+CAS_API int CAS_supplyImageFormat(void* casImpl, const unsigned char* inputImage, const int pixelFormat, const unsigned int inputStride, const int hasAlpha,
+                                  const unsigned int rows, const unsigned int cols) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    const std::size_t minimumStride = CASBackend::inputRowBytes(pixelFormat, cols);
+    if (!inputImage || rows == 0 || cols == 0 || minimumStride == 0 || (inputStride && inputStride < minimumStride) || (hasAlpha && !CASBackend::formatHasAlpha(pixelFormat)))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        cas->reinitializeMemory(hasAlpha, inputImage, pixelFormat, inputStride ? inputStride : minimumStride, rows, cols);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_supplyFrame(void* casImpl, const unsigned char* inputFrame, const unsigned int inputStride) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    const std::size_t minimumStride = CASBackend::inputRowBytes(cas->imageFormat(), cas->imageCols());
+    if (!inputFrame || cas->imageRows() == 0 || (inputStride && inputStride < minimumStride))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        cas->supplyFrame(inputFrame, inputStride ? inputStride : minimumStride);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
 }
 
 CAS_API const unsigned char* CAS_sharpenImage(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption) {
-    CASImpl* cas = static_cast<CASImpl*>(casImpl);
-    return cas->sharpenImage(casMode, sharpenStrength, contrastAdaption);
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    try {
+        return cas->sharpenImage(casMode, sharpenStrength, contrastAdaption);
+    } catch (const std::exception&) { return nullptr; }
+}
+
+CAS_API int CAS_sharpenImageInto(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* outputImage,
+                                 const unsigned int outputStride) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    if (!outputImage || cas->imageRows() == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    const std::size_t stride = checkedOutputStride(cas, casMode, cas->imageCols(), outputImage, outputStride);
+    if (stride == 0)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        cas->sharpenImageInto(casMode, sharpenStrength, contrastAdaption, outputImage, stride);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_sharpenRegion(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y,
+                              const unsigned int width, const unsigned int height, unsigned char* outputImage, const unsigned int outputStride) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    if (!outputImage || cas->imageRows() == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    // non-empty and inside the image (written so that it can not overflow)
+    if (width == 0 || height == 0 || x >= cas->imageCols() || y >= cas->imageRows() || width > cas->imageCols() - x || height > cas->imageRows() - y)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    const std::size_t stride = checkedOutputStride(cas, casMode, width, outputImage, outputStride);
+    if (stride == 0)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        cas->sharpenRegionInto(casMode, sharpenStrength, contrastAdaption, x, y, width, height, outputImage, stride);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_sharpenScaledInto(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows,
+                                  const unsigned int outputCols, unsigned char* outputImage, const unsigned int outputStride) {
+    return CAS_sharpenScaledRows(casImpl, casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, 0, outputRows, outputImage, outputStride);
+}
+
+CAS_API int CAS_sharpenScaledRows(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows,
+                                  const unsigned int outputCols, const unsigned int firstRow, const unsigned int rowCount, unsigned char* outputImage,
+                                  const unsigned int outputStride) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    if (!outputImage || cas->imageRows() == 0 || outputRows == 0 || outputCols == 0 || rowCount == 0 || firstRow >= outputRows || rowCount > outputRows - firstRow ||
+        (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    const std::size_t stride = checkedOutputStride(cas, casMode, outputCols, outputImage, outputStride);
+    if (stride == 0)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        cas->sharpenScaledInto(casMode, sharpenStrength, contrastAdaption, outputRows, outputCols, firstRow, rowCount, outputImage, stride);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API const char* CAS_getBackendName(void* casImpl) {
+    const CASBackend* cas = static_cast<const CASBackend*>(casImpl);
+    return cas->name();
+}
+
+CAS_API int CAS_setPrecision(void* casImpl, const int precision) {
+    if (precision != CAS_PRECISION_EXACT && precision != CAS_PRECISION_FAST)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    cas->setPrecision(precision);
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_setOutputFormat(void* casImpl, const int sampleFormat) {
+    if (CASBackend::sampleBytes(sampleFormat) == 0)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    try {
+        cas->setOutputFormat(sampleFormat);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API void CAS_setTileSize(void* casImpl, const unsigned int tileRows, const unsigned int tileCols) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    cas->setTileSize(tileRows, tileCols);
+}
+
+CAS_API unsigned long long CAS_getTileWorkingSet(void* casImpl) {
+    const CASBackend* cas = static_cast<const CASBackend*>(casImpl);
+    return cas->tileWorkingSetBytes();
+}
+
+CAS_API void CAS_setCacheBudget(void* casImpl, const unsigned long long bytes) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    cas->setCacheBudget(static_cast<std::size_t>(bytes));
+}
+
+CAS_API void CAS_invalidateCache(void* casImpl) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    cas->invalidateCache();
+}
+
+CAS_API int CAS_setSequenceMode(void* casImpl, const unsigned int tileSize) {
+    if (tileSize > 0 && tileSize < 8)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    try {
+        cas->setSequenceMode(tileSize);
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+    return CAS_STATUS_OK;
+}
+
+CAS_API int CAS_autoTune(void* casImpl, const int casMode, CASTuning* tuning) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    if (!cas || cas->imageRows() == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    try {
+        CASTuning result{};
+        if (!cas->autoTune(casMode, result))
+            return CAS_STATUS_FAILED;
+        if (tuning)
+            *tuning = result;
+        return cas->sharedContext().tuningProfile().save() ? CAS_STATUS_OK : CAS_STATUS_FAILED;
+    } catch (const std::exception&) { return CAS_STATUS_FAILED; }
+}
+
+CAS_API int CAS_getTuning(void* casImpl, const int casMode, CASTuning* tuning) {
+    const CASBackend* cas = static_cast<const CASBackend*>(casImpl);
+    if (!cas || !tuning || cas->imageRows() == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return CAS_STATUS_INVALID_ARGUMENT;
+    *tuning = cas->tuning(casMode);
+    return CAS_STATUS_OK;
+}
+
+CAS_API unsigned int CAS_getNumaNodeCount() {
+    try {
+        return static_cast<unsigned int>(cpu_utils::numaNodes().size());
+    } catch (const std::exception&) { return 1; }
+}
+
+CAS_API unsigned int CAS_setNumaNodes(void* casImpl, const unsigned int nodeCount) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    try {
+        return cas->setNumaNodes(nodeCount);
+    } catch (const std::exception&) { return 0; }
+}
+
+CAS_API unsigned int CAS_sharpenBatch(void* casImpl, CASImageDesc* images, const unsigned int count) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    // the engine could not schedule the batch (its tasks have finished when the exception arrives here): no image counts as sharpened
+    try {
+        return cas->sharpenBatch(images, count);
+    } catch (const std::exception&) {
+        for (unsigned int i = 0; i < count; i++)
+            images[i].status = CAS_STATUS_FAILED;
+        return count;
+    }
+}
+
+CAS_API void* CAS_streamBegin(const unsigned int rows, const unsigned int cols, const int hasAlpha, const int casMode, const float sharpenStrength, const float contrastAdaption) {
+    if (rows == 0 || cols == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return nullptr;
+    try {
+        return new CASStreamEngine(rows, cols, hasAlpha, casMode, sharpenStrength, contrastAdaption);
+    } catch (const std::exception&) { return nullptr; }
+}
+
+// a failed push or pull moves no row: the rows stay to push or pull again, and a stream left unfinished ends with CAS_STATUS_FAILED
+CAS_API unsigned int CAS_streamPush(void* casStream, const unsigned char* inputRows, const unsigned int count, const unsigned int inputStride) {
+    CASStreamEngine* stream = static_cast<CASStreamEngine*>(casStream);
+    try {
+        return stream->push(inputRows, count, inputStride ? inputStride : stream->inputRowBytes());
+    } catch (const std::exception&) { return 0; }
+}
+
+CAS_API unsigned int CAS_streamPull(void* casStream, unsigned char* outputRows, const unsigned int maxRows, const unsigned int outputStride) {
+    CASStreamEngine* stream = static_cast<CASStreamEngine*>(casStream);
+    try {
+        return stream->pull(outputRows, maxRows, outputStride ? outputStride : stream->outputRowBytes());
+    } catch (const std::exception&) { return 0; }
+}
+
+CAS_API int CAS_streamEnd(void* casStream) {
+    CASStreamEngine* stream = static_cast<CASStreamEngine*>(casStream);
+    bool finished = false;
+    try {
+        finished = stream->finished();
+    } catch (const std::exception&) {}
+    delete stream;
+    return finished ? CAS_STATUS_OK : CAS_STATUS_FAILED;
+}
+
+CAS_API unsigned int CAS_submit(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned char* inputFrame,
+                                const unsigned int inputStride, unsigned char* outputImage, const unsigned int outputStride, CASCompletionCallback callback, void* userData) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    if (cas->imageRows() == 0 || (casMode != PLANAR_RGB && casMode != INTERLEAVED_RGBA))
+        return 0;
+    const std::size_t minimumInputStride = CASBackend::inputRowBytes(cas->imageFormat(), cas->imageCols());
+    const std::size_t stride = checkedOutputStride(cas, casMode, cas->imageCols(), outputImage, outputStride);
+    if ((inputStride && inputStride < minimumInputStride) || stride == 0)
+        return 0;
+    try {
+        return cas->jobs().submit(CASAsync::Job{casMode, sharpenStrength, contrastAdaption, inputFrame, inputStride ? inputStride : minimumInputStride, outputImage, stride,
+                                                callback, userData});
+    } catch (const std::exception&) { return 0; }
+}
+
+CAS_API int CAS_poll(void* casImpl, const unsigned int ticket) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    return cas->jobs().poll(ticket);
+}
+
+CAS_API int CAS_wait(void* casImpl, const unsigned int ticket) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    return cas->jobs().wait(ticket);
+}
+
+CAS_API int CAS_cancel(void* casImpl, const unsigned int ticket) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    return cas->jobs().cancel(ticket);
+}
+
+CAS_API const unsigned char* CAS_getResult(void* casImpl, const unsigned int ticket) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    return cas->jobs().result(ticket);
+}
+
+CAS_API int CAS_releaseResult(void* casImpl, const unsigned int ticket) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    return cas->jobs().release(ticket);
+}
+
+CAS_API int CAS_getStats(void* casImpl, CASStats* stats) {
+    if (!stats)
+        return CAS_STATUS_INVALID_ARGUMENT;
+    const CASBackend* cas = static_cast<const CASBackend*>(casImpl);
+    cas->stats().read(*stats);
+    return CAS_STATUS_OK;
+}
+
+CAS_API unsigned int CAS_getStatsJson(void* casImpl, char* buffer, const unsigned int size) {
+    const CASBackend* cas = static_cast<const CASBackend*>(casImpl);
+    try {
+        const std::string json = cas->stats().json(cas->name());
+        if (buffer && size > 0) {
+            const std::size_t copied = std::min<std::size_t>(json.size(), size - 1);
+            std::memcpy(buffer, json.data(), copied);
+            buffer[copied] = '\0';
+        }
+        return static_cast<unsigned int>(json.size());
+    } catch (const std::exception&) { return 0; }
+}
+
+CAS_API void CAS_resetStats(void* casImpl) {
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    cas->resetStats();
 }
 
 CAS_API void CAS_destroy(void* casImpl) {
-    CASImpl* cas = static_cast<CASImpl*>(casImpl);
+    CASBackend* cas = static_cast<CASBackend*>(casImpl);
+    // the worker thread uses the engine: stop it first
+    cas->stopJobs();
     delete cas;
 }
 }
\ No newline at end of file
@@ -0,0 +1,381 @@
+#include "CASRemoteImpl.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// copy rows of rowBytes between two strided buffers
+static void copyRows(unsigned char* destination, const std::size_t destinationStride, const unsigned char* source, const std::size_t sourceStride, const std::size_t rowBytes,
+                     const std::size_t rows) {
+    if (destinationStride == rowBytes && sourceStride == rowBytes) {
+        std::memcpy(destination, source, rowBytes * rows);
+        return;
+    }
+    for (std::size_t y = 0; y < rows; y++)
+        std::memcpy(destination + y * destinationStride, source + y * sourceStride, rowBytes);
+}
+
+CASRemoteChannel::CASRemoteChannel(const std::string& socketPath) : socket(remote_utils::connectSocket(socketPath)) {
+    if (socket < 0)
+        throw std::runtime_error("no CAS daemon on " + socketPath);
+    cas_remote::Request hello{};
+    hello.op = cas_remote::OP_HELLO;
+    hello.value = cas_remote::protocolVersion;
+    try {
+        const cas_remote::Reply reply = call(hello);
+        if (reply.status != CAS_STATUS_OK)
+            throw std::runtime_error("CAS daemon of another protocol version on " + socketPath);
+        daemonEngine.assign(reply.name, strnlen(reply.name, sizeof(reply.name)));
+    } catch (...) {
+        remote_utils::closeSocket(socket);
+        throw;
+    }
+}
+
+// closing the connection ends its session in the daemon
+CASRemoteChannel::~CASRemoteChannel() { remote_utils::closeSocket(socket); }
+
+cas_remote::Reply CASRemoteChannel::call(const cas_remote::Request& request, const int passedFd) {
+    cas_remote::Reply reply{};
+    if (!remote_utils::sendAll(socket, &request, sizeof(request), passedFd) || !remote_utils::receiveAll(socket, &reply, sizeof(reply)))
+        throw std::runtime_error("CAS daemon connection lost");
+    return reply;
+}
+
+// at least 64KB: the first images and rows do not grow it step by step
+bool CASRemoteChannel::reserve(const cas_remote::Segment segment, const std::size_t bytes) {
+    if (bytes <= segments[segment].size())
+        return false;
+    const std::size_t size = std::bit_ceil(std::max<std::size_t>(bytes, 64 * 1024));
+    const int fd = remote_utils::createSharedMemory(size);
+    cas_remote::Request map{};
+    map.op = cas_remote::OP_MAP;
+    map.segment = segment;
+    map.value = size;
+    try {
+        if (!segments[segment].map(fd, size))
+            throw std::bad_alloc();
+        if (call(map, fd).status != CAS_STATUS_OK)
+            throw std::runtime_error("CAS daemon could not map a segment");
+    } catch (...) {
+        segments[segment].reset();
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return true;
+}
+
+CASRemoteContext::CASRemoteContext(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+CASBackend* CASRemoteContext::createSession() { return new CASRemoteImpl(shared_from_this()); }
+
+// connects a session of its own in the daemon, the engine name is the one of the daemon with a "remote-" prefix
+CASRemoteImpl::CASRemoteImpl(std::shared_ptr<CASRemoteContext> context) : context(std::move(context)), channel(this->context->socketPath), engineName("remote-" + channel.engine()) {}
+
+cas_remote::Request CASRemoteImpl::request(const cas_remote::Op op) const {
+    cas_remote::Request request{};
+    request.op = op;
+    request.image = image;
+    return request;
+}
+
+cas_remote::Reply CASRemoteImpl::checkedCall(const cas_remote::Request& request) const {
+    const cas_remote::Reply reply = channel.call(request);
+    if (reply.status != CAS_STATUS_OK)
+        throw std::runtime_error("CAS daemon call failed");
+    return reply;
+}
+
+// a grown segment is a new shared memory object, counted as an allocation
+void CASRemoteImpl::reserve(const cas_remote::Segment segment, const std::size_t bytes) {
+    if (bytes <= channel.capacity(segment))
+        return;
+    const auto timer = counters.time(CAS_STAGE_ALLOCATE);
+    channel.reserve(segment, bytes);
+    counters.countAllocation(channel.capacity(segment));
+}
+
+// the upload is the copy into the input segment (packed rows), the daemon takes the new version of the image with the next call that needs it
+void CASRemoteImpl::copyInput(const unsigned char* hostRgbPtr, const std::size_t inputStride) {
+    const auto timer = counters.time(CAS_STAGE_UPLOAD);
+    const std::size_t rowBytes = image.stride;
+    const std::size_t inputRows = cas_remote::imageRows(image);
+    copyRows(channel.data(cas_remote::SEGMENT_INPUT), rowBytes, hostRgbPtr, inputStride, rowBytes, inputRows);
+    counters.countIn(rowBytes * inputRows);
+    image.version++;
+}
+
+void CASRemoteImpl::reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                                       const unsigned int cols) {
+    cas_remote::Image supplied = image;
+    supplied.rows = rows;
+    supplied.cols = cols;
+    supplied.pixelFormat = pixelFormat;
+    supplied.hasAlpha = hasAlpha;
+    supplied.stride = inputRowBytes(pixelFormat, cols);
+    // the requests describe the new image once the input segment holds it: a failed reservation (the previous segment is already unmapped) leaves no image
+    try {
+        reserve(cas_remote::SEGMENT_INPUT, supplied.stride * cas_remote::imageRows(supplied));
+    } catch (...) {
+        image.rows = image.cols = 0;
+        throw;
+    }
+    image = supplied;
+    copyInput(hostRgbPtr, inputStride);
+}
+
+void CASRemoteImpl::supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) { copyInput(hostRgbPtr, inputStride); }
+
+// the daemon writes width x height packed at the start of the output segment, copied to output (if any) with the caller's stride
+void CASRemoteImpl::sharpenInto(cas_remote::Request request, const unsigned int width, const unsigned int height, unsigned char* output, const std::size_t outputStride) {
+    const std::size_t rowBytes = CASBackend::rowBytes(image.hasAlpha, request.casMode, width, sampleFormat);
+    const std::size_t outputRows = cas_remote::outputRows(image.hasAlpha, request.casMode, height);
+    reserve(cas_remote::SEGMENT_OUTPUT, rowBytes * outputRows);
+    request.outputOffset = 0;
+    request.outputStride = rowBytes;
+    {
+        const auto timer = counters.time(CAS_STAGE_KERNEL);
+        const cas_remote::Reply reply = checkedCall(request);
+        // the whole image calls of the sequence mode report their tiles
+        if (reply.value > 0)
+            counters.countTiles(reply.value, reply.skippedTiles);
+    }
+    counters.countPixels(static_cast<std::size_t>(width) * height);
+    counters.countOut(rowBytes * outputRows);
+    if (output) {
+        const auto timer = counters.time(CAS_STAGE_DOWNLOAD);
+        copyRows(output, outputStride, channel.data(cas_remote::SEGMENT_OUTPUT), rowBytes, rowBytes, outputRows);
+    }
+}
+
+// the result stays in the output segment, valid until the next call of this session
+const unsigned char* CASRemoteImpl::sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) {
+    cas_remote::Request request = this->request(cas_remote::OP_SHARPEN);
+    request.casMode = casMode;
+    request.sharpenStrength = sharpenStrength;
+    request.contrastAdaption = contrastAdaption;
+    try {
+        sharpenInto(request, image.cols, image.rows, nullptr, 0);
+    } catch (const std::exception&) { return nullptr; }
+    return channel.data(cas_remote::SEGMENT_OUTPUT);
+}
+
+void CASRemoteImpl::sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) {
+    cas_remote::Request request = this->request(cas_remote::OP_SHARPEN);
+    request.casMode = casMode;
+    request.sharpenStrength = sharpenStrength;
+    request.contrastAdaption = contrastAdaption;
+    sharpenInto(request, image.cols, image.rows, output, outputStride);
+}
+
+void CASRemoteImpl::sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y,
+                                      const unsigned int width, const unsigned int height, unsigned char* output, const std::size_t outputStride) {
+    cas_remote::Request request = this->request(cas_remote::OP_REGION);
+    request.casMode = casMode;
+    request.sharpenStrength = sharpenStrength;
+    request.contrastAdaption = contrastAdaption;
+    request.x = x;
+    request.y = y;
+    request.width = width;
+    request.height = height;
+    sharpenInto(request, width, height, output, outputStride);
+}
+
+void CASRemoteImpl::sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                                      const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) {
+    cas_remote::Request request = this->request(cas_remote::OP_SCALED);
+    request.casMode = casMode;
+    request.sharpenStrength = sharpenStrength;
+    request.contrastAdaption = contrastAdaption;
+    request.width = outputCols;
+    request.height = outputRows;
+    request.y = firstRow;
+    request.count = rowCount;
+    sharpenInto(request, outputCols, rowCount, output, outputStride);
+}
+
+// the setters without a status ignore a lost daemon, the next call that has one reports it
+void CASRemoteImpl::setTileSize(const unsigned int tileRows, const unsigned int tileCols) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_TILE_SIZE;
+    request.height = tileRows;
+    request.width = tileCols;
+    try {
+        channel.call(request);
+    } catch (const std::exception&) {}
+}
+
+std::size_t CASRemoteImpl::tileWorkingSetBytes() const {
+    try {
+        return static_cast<std::size_t>(checkedCall(request(cas_remote::OP_TILE_WORKING_SET)).value);
+    } catch (const std::exception&) { return 0; }
+}
+
+void CASRemoteImpl::setOutputFormat(const int sampleFormat) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_OUTPUT_FORMAT;
+    request.value = static_cast<unsigned int>(sampleFormat);
+    checkedCall(request);
+    this->sampleFormat = sampleFormat;
+}
+
+void CASRemoteImpl::setPrecision(const int precision) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_PRECISION;
+    request.value = static_cast<unsigned int>(precision);
+    try {
+        channel.call(request);
+    } catch (const std::exception&) {}
+}
+
+void CASRemoteImpl::setCacheBudget(const std::size_t bytes) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_CACHE_BUDGET;
+    request.value = bytes;
+    try {
+        channel.call(request);
+    } catch (const std::exception&) {}
+}
+
+void CASRemoteImpl::invalidateCache() {
+    try {
+        channel.call(request(cas_remote::OP_INVALIDATE_CACHE));
+    } catch (const std::exception&) {}
+}
+
+void CASRemoteImpl::setSequenceMode(const unsigned int tileSize) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_SEQUENCE_MODE;
+    request.value = tileSize;
+    checkedCall(request);
+}
+
+unsigned int CASRemoteImpl::setNumaNodes(const unsigned int nodeCount) {
+    cas_remote::Request request = this->request(cas_remote::OP_SET);
+    request.setting = cas_remote::SET_NUMA_NODES;
+    request.value = nodeCount;
+    return static_cast<unsigned int>(checkedCall(request).value);
+}
+
+// one call for the whole batch: the descriptors, then the inputs and the outputs of the valid images (64 bytes aligned) in the output segment
+unsigned int CASRemoteImpl::sharpenBatch(CASImageDesc* images, const unsigned int count) {
+    static constexpr auto align = [](const std::size_t bytes) { return (bytes + 63) & ~std::size_t(63); };
+    unsigned int failed = 0;
+    std::vector<unsigned int> sent;
+    for (unsigned int i = 0; i < count; i++) {
+        images[i].elapsedMs = 0.0;
+        if (isValid(images[i]))
+            sent.push_back(i);
+        else {
+            images[i].status = CAS_STATUS_INVALID_ARGUMENT;
+            failed++;
+        }
+    }
+    if (sent.empty())
+        return failed;
+    std::vector<cas_remote::BatchImage> batch(sent.size());
+    std::size_t bytes = align(sizeof(cas_remote::BatchImage) * sent.size());
+    for (std::size_t i = 0; i < sent.size(); i++) {
+        const CASImageDesc& image = images[sent[i]];
+        batch[i] = {bytes, 0, image.rows, image.cols, image.hasAlpha, image.casMode, image.sharpenStrength, image.contrastAdaption, CAS_STATUS_FAILED, 0, 0.0};
+        bytes += align(static_cast<std::size_t>(image.rows) * image.cols * 4);
+    }
+    for (cas_remote::BatchImage& image : batch) {
+        image.outputOffset = bytes;
+        bytes += align(rowBytes(image.hasAlpha, image.casMode, image.cols, CAS_SAMPLE_SRGB8) * cas_remote::outputRows(image.hasAlpha, image.casMode, image.rows));
+    }
+    try {
+        reserve(cas_remote::SEGMENT_OUTPUT, bytes);
+        unsigned char* segment = channel.data(cas_remote::SEGMENT_OUTPUT);
+        {
+            const auto timer = counters.time(CAS_STAGE_UPLOAD);
+            for (std::size_t i = 0; i < sent.size(); i++) {
+                const std::size_t inputBytes = static_cast<std::size_t>(batch[i].rows) * batch[i].cols * 4;
+                std::memcpy(segment + batch[i].inputOffset, images[sent[i]].inputImage, inputBytes);
+                counters.countIn(inputBytes);
+            }
+            std::memcpy(segment, batch.data(), sizeof(cas_remote::BatchImage) * batch.size());
+        }
+        cas_remote::Request request = this->request(cas_remote::OP_BATCH);
+        request.count = static_cast<unsigned int>(sent.size());
+        request.outputOffset = 0;
+        {
+            const auto timer = counters.time(CAS_STAGE_KERNEL);
+            channel.call(request);
+        }
+        std::memcpy(batch.data(), segment, sizeof(cas_remote::BatchImage) * batch.size());
+        const auto timer = counters.time(CAS_STAGE_DOWNLOAD);
+        for (std::size_t i = 0; i < sent.size(); i++) {
+            CASImageDesc& image = images[sent[i]];
+            image.status = batch[i].status;
+            image.elapsedMs = batch[i].elapsedMs;
+            if (image.status != CAS_STATUS_OK) {
+                failed++;
+                continue;
+            }
+            const std::size_t outputBytes = rowBytes(image.hasAlpha, image.casMode, image.cols, CAS_SAMPLE_SRGB8) * cas_remote::outputRows(image.hasAlpha, image.casMode, image.rows);
+            std::memcpy(image.outputImage, segment + batch[i].outputOffset, outputBytes);
+            counters.countPixels(static_cast<std::size_t>(image.rows) * image.cols);
+            counters.countOut(outputBytes);
+        }
+    } catch (const std::exception&) {
+        // the copies back can not throw: none of the sent images has completed
+        for (const unsigned int i : sent)
+            images[i].status = CAS_STATUS_FAILED;
+        failed += static_cast<unsigned int>(sent.size());
+    }
+    return failed;
+}
+
+CASRemoteStream::CASRemoteStream(const unsigned int rows, const unsigned int cols, const bool hasAlpha, const int casMode, const float sharpenStrength,
+                                 const float contrastAdaption)
+    : channel(remote_utils::defaultSocketPath()), rows(rows), cols(cols), hasAlpha(hasAlpha), casMode(casMode) {
+    cas_remote::Request request{};
+    request.op = cas_remote::OP_STREAM_BEGIN;
+    request.height = rows;
+    request.width = cols;
+    request.image.hasAlpha = hasAlpha;
+    request.casMode = casMode;
+    request.sharpenStrength = sharpenStrength;
+    request.contrastAdaption = contrastAdaption;
+    if (channel.call(request).status != CAS_STATUS_OK)
+        throw std::invalid_argument("CAS daemon refused the stream");
+}
+
+unsigned int CASRemoteStream::push(const unsigned char* rgbaRows, const unsigned int count, const std::size_t inputStride) {
+    if (count == 0)
+        return 0;
+    try {
+        channel.reserve(cas_remote::SEGMENT_INPUT, inputRowBytes() * count);
+        copyRows(channel.data(cas_remote::SEGMENT_INPUT), inputRowBytes(), rgbaRows, inputStride, inputRowBytes(), count);
+        cas_remote::Request request{};
+        request.op = cas_remote::OP_STREAM_PUSH;
+        request.count = count;
+        return static_cast<unsigned int>(channel.call(request).value);
+    } catch (const std::exception&) { return 0; }
+}
+
+// planar chunks are plane by plane in the segment as in the output: rows * planes rows of the same size either way
+unsigned int CASRemoteStream::pull(unsigned char* output, const unsigned int maxRows, const std::size_t outputStride) {
+    if (maxRows == 0)
+        return 0;
+    try {
+        channel.reserve(cas_remote::SEGMENT_OUTPUT, outputRowBytes() * cas_remote::outputRows(hasAlpha, casMode, maxRows));
+        cas_remote::Request request{};
+        request.op = cas_remote::OP_STREAM_PULL;
+        request.count = maxRows;
+        const unsigned int pulled = static_cast<unsigned int>(channel.call(request).value);
+        copyRows(output, outputStride, channel.data(cas_remote::SEGMENT_OUTPUT), outputRowBytes(), outputRowBytes(), cas_remote::outputRows(hasAlpha, casMode, pulled));
+        pulledRows += pulled;
+        return pulled;
+    } catch (const std::exception&) { return 0; }
+}
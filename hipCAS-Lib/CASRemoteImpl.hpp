@@ -0,0 +1,127 @@
+#pragma once
+#include "CASBackend.hpp"
+#include "CASContext.hpp"
+#include "CASRemoteProtocol.hpp"
+#include "remote_utils.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Connection to cas-daemon with the two shared memory segments of its pixels (see CASRemoteProtocol.hpp)
+class CASRemoteChannel {
+  private:
+    int socket;
+    remote_utils::SharedMapping segments[cas_remote::SEGMENT_COUNT];
+    // engine of the daemon (OP_HELLO)
+    std::string daemonEngine;
+
+  public:
+    // connects and checks the protocol version, throws std::runtime_error when no daemon answers on socketPath
+    explicit CASRemoteChannel(const std::string& socketPath);
+    ~CASRemoteChannel();
+
+    CASRemoteChannel(const CASRemoteChannel& other) = delete;
+    CASRemoteChannel(CASRemoteChannel&& other) noexcept = delete;
+    CASRemoteChannel& operator=(CASRemoteChannel&& other) noexcept = delete;
+    CASRemoteChannel& operator=(const CASRemoteChannel& other) = delete;
+
+    // one call (with a descriptor for the daemon, -1 = none), throws std::runtime_error when the daemon is gone
+    cas_remote::Reply call(const cas_remote::Request& request, const int passedFd = -1);
+    // a segment of at least bytes (grown to the next power of two and handed to the daemon when smaller, its content is then lost), true when it was grown
+    bool reserve(const cas_remote::Segment segment, const std::size_t bytes);
+    unsigned char* data(const cas_remote::Segment segment) const { return segments[segment].data(); }
+    std::size_t capacity(const cas_remote::Segment segment) const { return segments[segment].size(); }
+    const std::string& engine() const { return daemonEngine; }
+};
+
+// Context of the remote engine: the socket of the daemon, whose one context (thread pool or device, buffer pools) serves the sessions of every process
+class CASRemoteContext final : public CASContext, public std::enable_shared_from_this<CASRemoteContext> {
+  public:
+    const std::string socketPath;
+
+    explicit CASRemoteContext(std::string socketPath);
+
+    CASBackend* createSession() override;
+};
+
+// Remote CAS engine of the client library (CAS_REMOTE): forwards the calls of a session to its session in cas-daemon over a connection of its own
+// The supplied image is copied into the input segment, the daemon sharpens it from there into the output segment, where the results are copied from
+// (CAS_sharpenImage returns the segment itself). Small whole-image calls of all clients are coalesced into batches by the daemon.
+class CASRemoteImpl final : public CASBackend {
+  private:
+    const std::shared_ptr<CASRemoteContext> context;
+    // mutable: the const queries of the engine are calls as well
+    mutable CASRemoteChannel channel;
+    const std::string engineName;
+    // supplied image, packed in the input segment
+    cas_remote::Image image{};
+    int sampleFormat{CAS_SAMPLE_SRGB8};
+
+    cas_remote::Request request(const cas_remote::Op op) const;
+    // a call whose status must be CAS_STATUS_OK, throws std::runtime_error otherwise
+    cas_remote::Reply checkedCall(const cas_remote::Request& request) const;
+    void reserve(const cas_remote::Segment segment, const std::size_t bytes);
+    void copyInput(const unsigned char* hostRgbPtr, const std::size_t inputStride);
+    void sharpenInto(cas_remote::Request request, const unsigned int width, const unsigned int height, unsigned char* output, const std::size_t outputStride);
+
+  public:
+    explicit CASRemoteImpl(std::shared_ptr<CASRemoteContext> context);
+
+    // delete move/copy ctors/operators, not useful for a DLL class
+    CASRemoteImpl(const CASRemoteImpl& other) = delete;
+    CASRemoteImpl(CASRemoteImpl&& other) noexcept = delete;
+    CASRemoteImpl& operator=(CASRemoteImpl&& other) noexcept = delete;
+    CASRemoteImpl& operator=(const CASRemoteImpl& other) = delete;
+
+    void reinitializeMemory(const bool hasAlpha, const unsigned char* hostRgbPtr, const int pixelFormat, const std::size_t inputStride, const unsigned int rows,
+                            const unsigned int cols) override;
+    void supplyFrame(const unsigned char* hostRgbPtr, const std::size_t inputStride) override;
+    const unsigned char* sharpenImage(const int casMode, const float sharpenStrength, const float contrastAdaption) override;
+    void sharpenImageInto(const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenRegionInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y, const unsigned int width,
+                           const unsigned int height, unsigned char* output, const std::size_t outputStride) override;
+    void sharpenScaledInto(const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows, const unsigned int outputCols,
+                           const unsigned int firstRow, const unsigned int rowCount, unsigned char* output, const std::size_t outputStride) override;
+    const char* name() const override { return engineName.c_str(); }
+    CASContext& sharedContext() const override { return *context; }
+    unsigned int imageRows() const override { return image.rows; }
+    unsigned int imageCols() const override { return image.cols; }
+    bool imageHasAlpha() const override { return image.hasAlpha != 0; }
+    int imageFormat() const override { return image.pixelFormat; }
+    void setTileSize(const unsigned int tileRows, const unsigned int tileCols) override;
+    std::size_t tileWorkingSetBytes() const override;
+    void setOutputFormat(const int sampleFormat) override;
+    int outputFormat() const override { return sampleFormat; }
+    void setPrecision(const int precision) override;
+    void setCacheBudget(const std::size_t bytes) override;
+    void invalidateCache() override;
+    void setSequenceMode(const unsigned int tileSize) override;
+    unsigned int setNumaNodes(const unsigned int nodeCount) override;
+    unsigned int sharpenBatch(CASImageDesc* images, const unsigned int count) override;
+};
+
+// Row stream of the remote engine (CAS_streamBegin in the client library): the rows go through the segments of a connection of its own to a CASStream of the daemon
+class CASRemoteStream {
+  private:
+    CASRemoteChannel channel;
+    const unsigned int rows, cols;
+    const bool hasAlpha;
+    const int casMode;
+    unsigned int pulledRows{0};
+
+  public:
+    // throws std::runtime_error without a daemon, std::invalid_argument when the daemon refuses the stream
+    CASRemoteStream(const unsigned int rows, const unsigned int cols, const bool hasAlpha, const int casMode, const float sharpenStrength, const float contrastAdaption);
+
+    CASRemoteStream(const CASRemoteStream& other) = delete;
+    CASRemoteStream(CASRemoteStream&& other) noexcept = delete;
+    CASRemoteStream& operator=(CASRemoteStream&& other) noexcept = delete;
+    CASRemoteStream& operator=(const CASRemoteStream& other) = delete;
+
+    // same as CASStream, 0 rows when the daemon is gone
+    unsigned int push(const unsigned char* rgbaRows, const unsigned int count, const std::size_t inputStride);
+    unsigned int pull(unsigned char* output, const unsigned int maxRows, const std::size_t outputStride);
+    bool finished() const { return pulledRows == rows; }
+    std::size_t inputRowBytes() const { return static_cast<std::size_t>(cols) * 4; }
+    std::size_t outputRowBytes() const { return CASBackend::rowBytes(hasAlpha, casMode, cols, CAS_SAMPLE_SRGB8); }
+};
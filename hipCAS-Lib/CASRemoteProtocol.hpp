@@ -0,0 +1,81 @@
+#pragma once
+#include "include/CASLibWrapper.h"
+#include <cstddef>
+#include <cstdint>
+
+// Wire protocol between the remote engine (client library) and cas-daemon, over a local stream socket
+// Every call is one Request answered by one Reply, both fixed size. The pixels never cross the socket: each connection has two shared memory segments
+// created by the client (OP_MAP passes their descriptor), the input segment holds the supplied image (or the pushed stream rows) and the output segment
+// the results of the last call (and the descriptors, inputs and outputs of a batch). Offsets and strides are in bytes from the start of a segment.
+namespace cas_remote {
+constexpr std::uint32_t protocolVersion = 2;
+
+enum Op : std::uint32_t {
+    OP_HELLO,            // version check, the reply carries the engine name of the daemon
+    OP_MAP,              // replace a segment by the one of the descriptor sent with the request (segment, bytes)
+    OP_SET,              // setting of the session of the connection (setting, value)
+    OP_SHARPEN,          // whole supplied image into the output segment
+    OP_REGION,           // rectangle (x, y, width, height) of the supplied image
+    OP_SCALED,           // supplied image resized to height x width, its rows [y, y + count)
+    OP_BATCH,            // count BatchImage descriptors at outputOffset, with their inputs and outputs in the output segment
+    OP_TILE_WORKING_SET, // tile working set of the supplied image (reply value)
+    OP_INVALIDATE_CACHE,
+    OP_STREAM_BEGIN,     // row stream of height x width pixels for this connection (image.hasAlpha, casMode and the parameters)
+    OP_STREAM_PUSH,      // count packed RGBA rows at offset 0 of the input segment, the reply value is the number accepted
+    OP_STREAM_PULL       // up to count rows packed at offset 0 of the output segment (planar: plane by plane), the reply value is the number written
+};
+
+enum Segment : std::uint32_t { SEGMENT_INPUT, SEGMENT_OUTPUT, SEGMENT_COUNT };
+
+enum Setting : std::uint32_t { SET_PRECISION, SET_OUTPUT_FORMAT, SET_TILE_SIZE, SET_CACHE_BUDGET, SET_NUMA_NODES, SET_SEQUENCE_MODE };
+
+// image supplied by the client, at offset 0 of the input segment. The version changes with every new image or frame, 0 = none:
+// the daemon uploads it to the session of the connection when a call needs it and the version differs from the uploaded one
+struct Image {
+    std::uint64_t version;
+    std::uint64_t stride;
+    std::uint32_t rows, cols;
+    std::int32_t pixelFormat, hasAlpha;
+};
+
+struct Request {
+    std::uint32_t op;
+    std::uint32_t segment; // OP_MAP
+    std::uint32_t setting; // OP_SET
+    std::int32_t casMode;
+    float sharpenStrength, contrastAdaption;
+    std::uint32_t x, y, width, height;    // OP_REGION rectangle, OP_SCALED/OP_STREAM_BEGIN size (width = columns), OP_SET tile size (height = rows)
+    std::uint32_t count;                  // OP_BATCH images, OP_SCALED/OP_STREAM_PUSH/PULL rows
+    std::uint32_t reserved;
+    std::uint64_t value;                  // OP_MAP segment bytes, OP_SET value
+    std::uint64_t outputOffset, outputStride;
+    Image image;
+};
+
+struct Reply {
+    std::int32_t status;       // CASStatus of the call
+    std::uint32_t skippedTiles; // OP_SHARPEN in sequence mode: tiles that kept their output (value: all the tiles)
+    std::uint64_t value;
+    char name[32];       // OP_HELLO: engine name of the daemon, null terminated
+};
+
+// one image of an OP_BATCH, as a CASImageDesc with offsets in the output segment (status and elapsedMs written by the daemon)
+struct BatchImage {
+    std::uint64_t inputOffset, outputOffset;
+    std::uint32_t rows, cols;
+    std::int32_t hasAlpha, casMode;
+    float sharpenStrength, contrastAdaption;
+    std::int32_t status;
+    std::uint32_t reserved;
+    double elapsedMs;
+};
+
+// rows of the input segment of an image: one per plane and row for the planar formats (stride bytes each)
+inline std::uint64_t imageRows(const Image& image) {
+    return static_cast<std::uint64_t>(image.rows) * (image.pixelFormat == CAS_FORMAT_PLANAR_RGB8 ? 3 : image.pixelFormat == CAS_FORMAT_PLANAR_RGBA8 ? 4 : 1);
+}
+// rows of an output of height rows: one per plane and row in planar mode
+inline std::uint64_t outputRows(const bool hasAlpha, const int casMode, const std::uint32_t height) {
+    return casMode == 0 ? static_cast<std::uint64_t>(height) * (hasAlpha ? 4 : 3) : height;
+}
+} // namespace cas_remote
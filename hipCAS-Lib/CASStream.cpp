@@ -0,0 +1,71 @@
+#include "CASStream.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+std::shared_ptr<CASCpuContext> CASStream::sharedContext() {
+    static std::mutex mutex;
+    static std::weak_ptr<CASCpuContext> shared;
+    std::lock_guard lock(mutex);
+    std::shared_ptr<CASCpuContext> context = shared.lock();
+    if (!context) {
+        context = std::make_shared<CASCpuContext>();
+        shared = context;
+    }
+    return context;
+}
+
+// the strips are as wide as the CPU engine's automatic tiles (a typical per-core L2 cache)
+CASStream::CASStream(const unsigned int rows, const unsigned int cols, const bool hasAlpha, const int casMode, const float sharpenStrength, const float contrastAdaption,
+                     const unsigned int chunkRows)
+    : rows(rows), cols(cols), hasAlpha(hasAlpha), casMode(casMode), sharpenStrength(sharpenStrength), contrastAdaption(contrastAdaption), windowRows(std::max(1u, chunkRows) + 2),
+      window(static_cast<std::size_t>(windowRows) * cols * 4), context(sharedContext()), function(cas_cpu::tileFunction(hasAlpha, casMode, CAS_SAMPLE_SRGB8)),
+      stripWidth(std::max(1u, cas_cpu::autoTileWidth(cols, 256 * 1024))) {}
+
+unsigned int CASStream::push(const unsigned char* rgbaRows, const unsigned int count, const std::size_t inputStride) {
+    const std::size_t rowBytes = inputRowBytes();
+    const unsigned int accepted = std::min({count, rows - nextRow, windowRows - (nextRow - firstRow)});
+    for (unsigned int i = 0; i < accepted; i++)
+        std::memcpy(window.data() + (nextRow - firstRow + i) * rowBytes, rgbaRows + i * inputStride, rowBytes);
+    nextRow += accepted;
+    return accepted;
+}
+
+// output rows whose three input rows are in the window (the row below the last image row is the zero border)
+unsigned int CASStream::readyRows() const {
+    const unsigned int completeRows = nextRow == rows ? rows : (nextRow > 0 ? nextRow - 1 : 0);
+    return completeRows - nextOutputRow;
+}
+
+unsigned int CASStream::pull(unsigned char* output, const unsigned int maxRows, const std::size_t outputStride) {
+    const unsigned int count = std::min(maxRows, readyRows());
+    if (count == 0)
+        return 0;
+    // the window is a small image whose first row is image row firstRow: its top border is only used when it is the image's top border too
+    // (otherwise the halo row above the first pulled row is in the window), and likewise for the bottom border
+    const unsigned int windowHeight = nextRow - firstRow;
+    const unsigned int rowBegin = nextOutputRow - firstRow, rowEnd = rowBegin + count;
+    const cas_cpu::OutputView casOutput{output, outputStride, rowBegin, count};
+    const cas_cpu::InputView input = cas_cpu::inputView(window.data(), CAS_FORMAT_RGBA8, inputRowBytes(), windowHeight);
+    const unsigned int strips = (cols + stripWidth - 1) / stripWidth;
+    const unsigned int bandRows = 16;
+    const unsigned int bands = (count + bandRows - 1) / bandRows;
+    context->threadPool.parallelFor(bands * strips, 1, [&](const unsigned int tileBegin, const unsigned int tileEnd) {
+        thread_local cas_cpu::TileBuffer tile;
+        for (unsigned int tileIndex = tileBegin; tileIndex < tileEnd; tileIndex++) {
+            const unsigned int bandBegin = rowBegin + (tileIndex / strips) * bandRows, colBegin = (tileIndex % strips) * stripWidth;
+            function(input, sharpenStrength, contrastAdaption, casOutput, windowHeight, cols, bandBegin, std::min(rowEnd, bandBegin + bandRows), colBegin,
+                     std::min(cols, colBegin + stripWidth), context->kernels, tile, nullptr, cas_cpu::CacheMode::None);
+        }
+    });
+    nextOutputRow += count;
+    // drop the consumed rows, keep the halo row above the next output row
+    const unsigned int keepFrom = nextOutputRow > 0 ? nextOutputRow - 1 : 0;
+    if (keepFrom > firstRow) {
+        const std::size_t rowBytes = inputRowBytes();
+        std::memmove(window.data(), window.data() + (keepFrom - firstRow) * rowBytes, (nextRow - keepFrom) * rowBytes);
+        firstRow = keepFrom;
+    }
+    return count;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "CASCpu.hpp"
+#include "CASCpuImpl.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Streaming CAS on the native CPU engine, for images too large to hold in memory:
+// the caller pushes input rows and pulls the sharpened rows in chunks, only a window of input rows is kept (memory is O(width))
+// Each output row needs the input row below it, so row y can be pulled once row y + 1 (or the last row) has been pushed.
+// The output is the same as the CPU engine's whole-image output, bit for bit.
+// The streams alive at once share one CPU context: their pulls run on its thread pool, however many streams there are.
+class CASStream {
+  private:
+    const unsigned int rows, cols;
+    const bool hasAlpha;
+    const int casMode;
+    const float sharpenStrength, contrastAdaption;
+    // input rows kept in the window: the rows of one pull plus the halo row above and below
+    const unsigned int windowRows;
+    // interleaved RGBA input rows [firstRow, nextRow), packed
+    std::vector<unsigned char> window;
+    unsigned int firstRow{0}, nextRow{0}, nextOutputRow{0};
+    const std::shared_ptr<CASCpuContext> context;
+    const cas_cpu::TileFunction function;
+    const unsigned int stripWidth;
+
+    unsigned int readyRows() const;
+    // the context of the streams, created by the first one and released with the last one
+    static std::shared_ptr<CASCpuContext> sharedContext();
+
+  public:
+    CASStream(const unsigned int rows, const unsigned int cols, const bool hasAlpha, const int casMode, const float sharpenStrength, const float contrastAdaption,
+              const unsigned int chunkRows = 64);
+
+    // delete move/copy ctors/operators, not useful for a DLL class
+    CASStream(const CASStream& other) = delete;
+    CASStream(CASStream&& other) noexcept = delete;
+    CASStream& operator=(CASStream&& other) noexcept = delete;
+    CASStream& operator=(const CASStream& other) = delete;
+
+    // copy up to count input rows (inputStride bytes apart) into the window, returns the number of rows accepted (less when the window is full: pull first)
+    unsigned int push(const unsigned char* rgbaRows, const unsigned int count, const std::size_t inputStride);
+    // sharpen up to maxRows of the rows whose input is complete into output, returns the number of rows written
+    // planar mode: the chunk is written plane by plane, row i of plane p at (p * written + i) * outputStride
+    unsigned int pull(unsigned char* output, const unsigned int maxRows, const std::size_t outputStride);
+    // whether every output row has been pulled
+    bool finished() const { return nextOutputRow == rows; }
+    // bytes of one input row without padding
+    std::size_t inputRowBytes() const { return static_cast<std::size_t>(cols) * 4; }
+    // bytes of one output row without padding
+    std::size_t outputRowBytes() const { return CASBackend::rowBytes(hasAlpha, casMode, cols, CAS_SAMPLE_SRGB8); }
+};
@@ -0,0 +1,119 @@
+#include "CASTuning.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <locale>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+unsigned int CASTuningProfile::bucket(const unsigned int rows, const unsigned int cols) {
+    const std::uint64_t pixels = static_cast<std::uint64_t>(rows) * cols;
+    return pixels ? static_cast<unsigned int>(std::bit_width(pixels - 1)) : 0;
+}
+
+std::string CASTuningProfile::defaultPath() {
+    if (const char* path = std::getenv("CAS_TUNING_PROFILE"))
+        return path;
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA"); localAppData && *localAppData)
+        return (std::filesystem::path(localAppData) / "hipCAS" / "tuning.txt").string();
+#else
+    if (const char* configHome = std::getenv("XDG_CONFIG_HOME"); configHome && *configHome)
+        return (std::filesystem::path(configHome) / "hipcas" / "tuning.txt").string();
+    if (const char* home = std::getenv("HOME"); home && *home)
+        return (std::filesystem::path(home) / ".config" / "hipcas" / "tuning.txt").string();
+#endif
+    return {};
+}
+
+// the numbers are written and read in the classic locale, whatever the locale of the application
+bool CASTuningProfile::read(const std::string& path, std::map<CASTuningKey, CASTuning>& entries) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string text;
+    while (std::getline(file, text)) {
+        if (text.empty() || text[0] == '#')
+            continue;
+        std::istringstream line(text);
+        line.imbue(std::locale::classic());
+        CASTuningKey key;
+        CASTuning tuning{};
+        int hasAlpha = 0;
+        if (line >> key.engine >> key.bucket >> hasAlpha >> key.casMode >> tuning.tileRows >> tuning.tileCols >> tuning.threads >> tuning.blockX >> tuning.blockY >>
+            tuning.megapixelsPerSecond) {
+            key.hasAlpha = hasAlpha != 0;
+            entries[key] = tuning;
+        }
+    }
+    return true;
+}
+
+void CASTuningProfile::load(const std::string& path) {
+    std::map<CASTuningKey, CASTuning> loaded;
+    if (!path.empty())
+        read(path, loaded);
+    std::lock_guard lock(mutex);
+    this->path = path;
+    entries = std::move(loaded);
+    tuned.clear();
+    changes.fetch_add(1);
+}
+
+// the temporary file has a random suffix: several processes may save at once, the last rename wins
+bool CASTuningProfile::save() const {
+    std::lock_guard lock(mutex);
+    if (path.empty())
+        return true;
+    std::map<CASTuningKey, CASTuning> merged;
+    read(path, merged);
+    for (const CASTuningKey& key : tuned)
+        merged[key] = entries.at(key);
+
+    const std::filesystem::path target(path);
+    std::error_code error;
+    if (target.has_parent_path())
+        std::filesystem::create_directories(target.parent_path(), error);
+    const std::filesystem::path temporary(path + ".tmp" + std::to_string(std::random_device{}()));
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file.imbue(std::locale::classic());
+        file << "# hipCAS tuning profile (CAS_autoTune)\n"
+             << "# engine bucket hasAlpha casMode tileRows tileCols threads blockX blockY megapixelsPerSecond\n";
+        for (const auto& [key, tuning] : merged)
+            file << key.engine << ' ' << key.bucket << ' ' << (key.hasAlpha ? 1 : 0) << ' ' << key.casMode << ' ' << tuning.tileRows << ' ' << tuning.tileCols << ' '
+                 << tuning.threads << ' ' << tuning.blockX << ' ' << tuning.blockY << ' ' << std::fixed << std::setprecision(1) << tuning.megapixelsPerSecond << '\n';
+        if (!file.flush()) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+bool CASTuningProfile::find(const CASTuningKey& key, CASTuning& tuning) const {
+    std::lock_guard lock(mutex);
+    const auto entry = entries.find(key);
+    if (entry == entries.end())
+        return false;
+    tuning = entry->second;
+    return true;
+}
+
+void CASTuningProfile::set(const CASTuningKey& key, const CASTuning& tuning) {
+    std::lock_guard lock(mutex);
+    entries[key] = tuning;
+    tuned.insert(key);
+    changes.fetch_add(1);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "include/CASLibWrapper.h"
+#include <atomic>
+#include <compare>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+// key of a tuning profile entry: engine variant, resolution bucket, alpha and casMode of the output
+struct CASTuningKey {
+    std::string engine;
+    unsigned int bucket;
+    bool hasAlpha;
+    int casMode;
+
+    auto operator<=>(const CASTuningKey&) const = default;
+};
+
+// Launch parameters tuned per image class (CAS_autoTune), shared by the sessions of a context and persisted in a text file, one entry per line:
+// engine bucket hasAlpha casMode tileRows tileCols threads blockX blockY megapixelsPerSecond
+// The file is read when the context is created; a save merges the entries tuned by this context into the current file (other processes may have written it meanwhile).
+class CASTuningProfile final {
+  private:
+    mutable std::mutex mutex;
+    std::map<CASTuningKey, CASTuning> entries;
+    // keys set by this context, written by save
+    std::set<CASTuningKey> tuned;
+    std::string path;
+    // incremented by every change, sessions cache their lookup until it moves
+    std::atomic<unsigned int> changes{0};
+
+    // entries of a profile file, false if it can not be opened; malformed lines are skipped
+    static bool read(const std::string& path, std::map<CASTuningKey, CASTuning>& entries);
+
+  public:
+    CASTuningProfile() = default;
+
+    CASTuningProfile(const CASTuningProfile& other) = delete;
+    CASTuningProfile(CASTuningProfile&& other) noexcept = delete;
+    CASTuningProfile& operator=(CASTuningProfile&& other) noexcept = delete;
+    CASTuningProfile& operator=(const CASTuningProfile& other) = delete;
+
+    // resolution bucket of an image: the exponent of the next power of two of its pixels (1080p: 21, 4K: 23)
+    static unsigned int bucket(const unsigned int rows, const unsigned int cols);
+    // the CAS_TUNING_PROFILE environment variable (empty: no file), else hipcas/tuning.txt in the configuration directory of the user, empty if there is none
+    static std::string defaultPath();
+
+    // read the entries of a profile file (a missing file leaves the profile empty), the next saves write to it; an empty path keeps the profile in memory
+    void load(const std::string& path);
+    // write the tuned entries into the profile file (through a temporary file, replaced at once), true if it is written or there is no file
+    bool save() const;
+
+    // the entry of a key, false if there is none
+    bool find(const CASTuningKey& key, CASTuning& tuning) const;
+    void set(const CASTuningKey& key, const CASTuning& tuning);
+    unsigned int version() const { return changes.load(); }
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Scalar math helpers of the native CPU CAS engine, counterparts of the half precision device functions in hip_math.hpp
+// (the sRGB transfer functions are table driven, see srgb_lut.hpp)
+namespace cpu_math {
+
+////////////////////////////////////////////////////////////////////////////////
+// Math functions
+////////////////////////////////////////////////////////////////////////////////
+
+inline float min3(const float a, const float b, const float c) { return std::min(std::min(a, b), c); }
+
+inline float max3(const float a, const float b, const float c) { return std::max(std::max(a, b), c); }
+
+// clamp to [0,1], NaN is mapped to zero (same as the device hmin/hmax based saturate)
+inline float saturate(const float x) { return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f; }
+
+// linear interpolation, same formulation as lerph (no std::fma: it is a slow library call on targets without FMA instructions)
+inline float lerp(const float v0, const float v1, const float t) { return t * v1 + (v0 - t * v0); }
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion functions
+////////////////////////////////////////////////////////////////////////////////
+
+// IEEE 754 half precision bits -> float (exact)
+inline float halfToFloat(const std::uint16_t bits) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(bits & 0x8000u) << 16, exponent = (bits >> 10) & 0x1fu, mantissa = bits & 0x3ffu;
+    // zero and subnormals: mantissa * 2^-24
+    if (exponent == 0)
+        return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(static_cast<float>(mantissa) * 5.9604644775390625e-8f));
+    // infinity and NaN keep their mantissa, normals are rebiased (127 - 15)
+    if (exponent == 31)
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// float -> IEEE 754 half precision bits, rounded to nearest even (same as __float2half)
+inline std::uint16_t floatToHalf(const float value) {
+    const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    const std::uint32_t sign = (bits >> 16) & 0x8000u, magnitude = bits & 0x7fffffffu;
+    // NaN stays a (quiet) NaN, infinity and values rounding above 65504 become infinity
+    if (magnitude > 0x7f800000u)
+        return static_cast<std::uint16_t>(sign | 0x7e00u);
+    if (magnitude >= 0x477ff000u)
+        return static_cast<std::uint16_t>(sign | 0x7c00u);
+    // below the smallest normal half: scaling by 2^24 is exact, the conversion to the integer mantissa rounds to nearest even
+    if (magnitude < 0x38800000u)
+        return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(std::nearbyint(std::bit_cast<float>(magnitude) * 16777216.0f)));
+    // drop 13 mantissa bits rounding to nearest even (a carry moves into the exponent), then rebias
+    const std::uint32_t rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u);
+    return static_cast<std::uint16_t>(sign | ((rounded - 0x38000000u) >> 13));
+}
+
+} // namespace cpu_math
@@ -0,0 +1,447 @@
+#include "cpu_utils.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#if CAS_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#elif CAS_X86
+#include <cpuid.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu_utils {
+static constexpr std::array<const char*, 4> isaNames{"scalar", "sse4.1", "avx2", "avx512"};
+
+// number of hardware threads, at least one
+unsigned int hardwareThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// threads of the CPU engine: the hardware threads, or the count of the CAS_CPU_THREADS environment variable (e.g. to measure the thread scaling)
+unsigned int selectThreadCount() {
+    const char* requested = std::getenv("CAS_CPU_THREADS");
+    const long count = requested ? std::strtol(requested, nullptr, 10) : 0;
+    return count > 0 ? static_cast<unsigned int>(std::min(count, 1024L)) : hardwareThreads();
+}
+
+#if CAS_X86
+// cpuid leaf/subleaf, regs = {eax, ebx, ecx, edx}
+static void cpuid(const unsigned int leaf, const unsigned int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    __cpuidex(reinterpret_cast<int*>(regs), leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0 register: the register states enabled by the OS
+static unsigned long long xgetbv0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+// best instruction set supported by the CPU (and enabled by the OS) for the vectorized kernels
+Isa detectIsa() {
+#if CAS_X86
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    cpuid(1, 0, regs);
+    const bool sse41 = regs[2] & (1u << 19);
+    const bool fma = regs[2] & (1u << 12);
+    // AVX state must be enabled by the OS (OSXSAVE + AVX + XCR0 SSE/AVX bits)
+    const bool osxsave = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28));
+    const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7) {
+        cpuid(7, 0, regs);
+        avx2 = (xcr0 & 0x6) == 0x6 && fma && (regs[1] & (1u << 5));
+        // AVX-512 foundation, opmask and ZMM state enabled
+        avx512 = avx2 && (regs[1] & (1u << 16)) && (xcr0 & 0xE6) == 0xE6;
+    }
+    return avx512 ? Isa::AVX512 : avx2 ? Isa::AVX2 : sse41 ? Isa::SSE41 : Isa::Scalar;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+// detected instruction set, the CAS_CPU_ISA environment variable (scalar, sse4.1, avx2, avx512) may select a lower one
+Isa selectIsa() {
+    const Isa detected = detectIsa();
+    const char* requested = std::getenv("CAS_CPU_ISA");
+    if (!requested)
+        return detected;
+    for (std::size_t i = 0; i < isaNames.size(); i++) {
+        if (std::string_view(requested) == isaNames[i])
+            return std::min(detected, static_cast<Isa>(i));
+    }
+    return detected;
+}
+
+const char* isaName(const Isa isa) { return isaNames[static_cast<std::size_t>(isa)]; }
+
+#if defined(__linux__)
+// logical processors of a sysfs cpu list, e.g. "0-15,32-47"
+static std::vector<unsigned int> parseCpuList(const std::string& list) {
+    std::vector<unsigned int> cpus;
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        const std::size_t dash = range.find('-');
+        const unsigned long first = std::strtoul(range.c_str(), nullptr, 10);
+        const unsigned long last = dash == std::string::npos ? first : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+        for (unsigned long cpu = first; cpu <= last && !range.empty(); cpu++)
+            cpus.push_back(static_cast<unsigned int>(cpu));
+    }
+    return cpus;
+}
+#endif
+
+// Linux: the cpulist of every /sys/devices/system/node/nodeN restricted to the affinity of the process, Windows: the processor mask of every node
+std::vector<NumaNode> numaNodes() {
+    std::vector<NumaNode> nodes;
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool hasAffinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    const auto usable = [&](const unsigned int cpu) { return !hasAffinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+    // node numbers may have gaps (offline or memory-only nodes)
+    for (unsigned int node = 0, missing = 0; missing < 64; node++) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string list;
+        if (!file || !std::getline(file, list)) {
+            missing++;
+            continue;
+        }
+        missing = 0;
+        NumaNode numaNode{node, {}};
+        for (const unsigned int cpu : parseCpuList(list))
+            if (usable(cpu))
+                numaNode.cpus.push_back(cpu);
+        if (!numaNode.cpus.empty())
+            nodes.push_back(std::move(numaNode));
+    }
+    if (nodes.empty() && hasAffinity) {
+        NumaNode numaNode{0, {}};
+        for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+                numaNode.cpus.push_back(cpu);
+        nodes.push_back(std::move(numaNode));
+    }
+#elif defined(_WIN32)
+    // logical processor numbers are group * 64 + bit
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode)) {
+        for (ULONG node = 0; node <= highestNode; node++) {
+            GROUP_AFFINITY affinity{};
+            if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity))
+                continue;
+            NumaNode numaNode{static_cast<unsigned int>(node), {}};
+            for (unsigned int bit = 0; bit < 64; bit++)
+                if (affinity.Mask & (KAFFINITY(1) << bit))
+                    numaNode.cpus.push_back(affinity.Group * 64u + bit);
+            if (!numaNode.cpus.empty())
+                nodes.push_back(std::move(numaNode));
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        NumaNode numaNode{0, {}};
+        for (unsigned int cpu = 0; cpu < hardwareThreads(); cpu++)
+            numaNode.cpus.push_back(cpu);
+        nodes.push_back(std::move(numaNode));
+    }
+    return nodes;
+}
+
+bool pinCurrentThread(const std::vector<unsigned int>& cpus) {
+    if (cpus.empty())
+        return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const unsigned int cpu : cpus)
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    // a thread runs in one processor group: the group of the first processor (a NUMA node never spans groups)
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(cpus.front() / 64);
+    for (const unsigned int cpu : cpus)
+        if (cpu / 64 == affinity.Group)
+            affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    return false;
+#endif
+}
+
+// the lanes hash consecutive 8-byte words of every 32 bytes, then fold into one value with the tail and the length
+std::uint64_t hashBytes(const unsigned char* data, const std::size_t bytes, const std::uint64_t seed) {
+    constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    const auto mix = [](std::uint64_t hash, const std::uint64_t word) {
+        hash = (hash ^ word) * multiplier;
+        return hash ^ (hash >> 29);
+    };
+    std::uint64_t lanes[4] = {seed, seed ^ 0x243F6A8885A308D3ull, seed ^ 0x13198A2E03707344ull, seed ^ 0xA4093822299F31D0ull};
+    std::size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+        for (std::size_t lane = 0; lane < 4; lane++) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = mix(lanes[lane], word);
+        }
+    std::uint64_t hash = mix(mix(mix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+    for (; i + 8 <= bytes; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = mix(hash, word);
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, data + i, bytes - i);
+    return mix(mix(hash, tail), bytes);
+}
+
+// queue of the current thread: its own deque for the workers of a pool, else the injection deque
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local unsigned int currentQueue = 0;
+
+// start (threadCount - 1) workers, the thread calling parallelFor is the last one
+ThreadPool::ThreadPool(const unsigned int threadCount, const std::vector<unsigned int>& affinity) {
+    const unsigned int workerCount = std::max(1u, threadCount) - 1;
+    for (unsigned int i = 0; i <= workerCount; i++)
+        queues.push_back(std::make_unique<TaskQueue>());
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.emplace_back([this, i, affinity](std::stop_token stopToken) { workerLoop(i, affinity, stopToken); });
+}
+
+// request stop and wake up all workers, jthread joins them
+ThreadPool::~ThreadPool() {
+    for (auto& worker : workers)
+        worker.request_stop();
+    taskAvailable.notify_all();
+}
+
+unsigned int ThreadPool::ownQueue() const { return currentPool == this ? currentQueue : static_cast<unsigned int>(workers.size()); }
+
+// take a task from the back of a deque (owner) or from its front (thief)
+bool ThreadPool::popTask(const unsigned int queue, const bool steal, std::function<void()>& task) {
+    TaskQueue& taskQueue = *queues[queue];
+    std::lock_guard lock(taskQueue.mutex);
+    if (taskQueue.tasks.empty())
+        return false;
+    if (steal) {
+        task = std::move(taskQueue.tasks.front());
+        taskQueue.tasks.pop_front();
+    } else {
+        task = std::move(taskQueue.tasks.back());
+        taskQueue.tasks.pop_back();
+    }
+    queuedTasks.fetch_sub(1);
+    return true;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        TaskQueue& taskQueue = *queues[ownQueue()];
+        std::lock_guard lock(taskQueue.mutex);
+        taskQueue.tasks.push_back(std::move(task));
+    }
+    queuedTasks.fetch_add(1);
+    // nobody to wake while every worker runs: a worker counts itself sleeping before it checks queuedTasks, so one of the two sees the other
+    if (sleepingWorkers.load() == 0)
+        return;
+    // a worker that just found no task holds the sleep mutex until it waits, this avoids a lost wakeup
+    { std::lock_guard lock(sleepMutex); }
+    taskAvailable.notify_one();
+}
+
+bool ThreadPool::runPendingTask() {
+    if (queuedTasks.load() == 0)
+        return false;
+    const unsigned int own = ownQueue();
+    const unsigned int queueCount = static_cast<unsigned int>(queues.size());
+    std::function<void()> task;
+    bool found = popTask(own, false, task);
+    // steal starting after the own deque, so that the thieves spread over the victims
+    for (unsigned int i = 1; i < queueCount && !found; i++)
+        found = popTask((own + i) % queueCount, true, task);
+    if (found)
+        task();
+    return found;
+}
+
+// execute tasks, sleep while there are none, until a stop is requested
+void ThreadPool::workerLoop(const unsigned int queue, const std::vector<unsigned int>& affinity, std::stop_token stopToken) {
+    if (!affinity.empty())
+        pinCurrentThread(affinity);
+    currentPool = this;
+    currentQueue = queue;
+    while (!stopToken.stop_requested()) {
+        if (runPendingTask())
+            continue;
+        std::unique_lock lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        taskAvailable.wait(lock, stopToken, [this] { return queuedTasks.load() != 0; });
+        sleepingWorkers.fetch_sub(1);
+    }
+}
+
+void ThreadPool::parallelFor(const unsigned int count, const unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& fn, const unsigned int maxThreads) {
+    const unsigned int grain = std::max(1u, grainSize);
+    const unsigned int chunks = (count + grain - 1) / grain;
+    if (chunks == 0)
+        return;
+    if (chunks == 1 || workers.empty() || maxThreads == 1) {
+        fn(0, count);
+        return;
+    }
+    // each participant grabs chunks until none are left, the helpers are regular tasks that can be stolen by any idle worker
+    std::atomic<unsigned int> nextChunk{0};
+    const auto runChunks = [&nextChunk, &fn, chunks, count, grain] {
+        unsigned int chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunks) {
+            const unsigned int begin = chunk * grain;
+            fn(begin, std::min(count, begin + grain));
+        }
+    };
+    TaskGroup group(*this);
+    const unsigned int helpers = std::min({static_cast<unsigned int>(workers.size()), chunks - 1, maxThreads ? maxThreads - 1 : chunks});
+    for (unsigned int i = 0; i < helpers; i++)
+        group.run(runChunks);
+    runChunks();
+    group.wait();
+}
+
+// a task that can not be queued (allocation failure) is not counted, so that wait() still returns
+// the exception of a task stays in the group: a pool worker has no caller to report it to, and the task must count as done for wait() to return
+void TaskGroup::run(std::function<void()> task) {
+    pendingTasks.fetch_add(1);
+    try {
+        pool.submit([this, task = std::move(task)] {
+            std::exception_ptr failure;
+            try {
+                task();
+            } catch (...) { failure = std::current_exception(); }
+            // decrement under the lock: wait() takes it before returning, so the group outlives this notification
+            std::lock_guard lock(mutex);
+            if (failure && !error)
+                error = std::move(failure);
+            if (pendingTasks.fetch_sub(1) == 1)
+                done.notify_all();
+        });
+    } catch (...) {
+        pendingTasks.fetch_sub(1);
+        throw;
+    }
+}
+
+// help with queued tasks (of any group) while some of ours are still running, then sleep until the last one signals
+void TaskGroup::waitTasks() {
+    while (pendingTasks.load() != 0) {
+        if (pool.runPendingTask())
+            continue;
+        std::unique_lock lock(mutex);
+        // short timeout: tasks queued meanwhile (e.g. subtasks of ours) are picked up again
+        done.wait_for(lock, std::chrono::microseconds(200), [this] { return pendingTasks.load() == 0; });
+    }
+    std::lock_guard lock(mutex);
+}
+
+void TaskGroup::wait() {
+    waitTasks();
+    std::exception_ptr failure;
+    {
+        std::lock_guard lock(mutex);
+        failure = std::exchange(error, nullptr);
+    }
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+// k workers per node: a pool of k + 1 threads whose "caller" is the worker running the task of run()
+NumaPools::NumaPools(const unsigned int nodeCount) {
+    std::vector<NumaNode> topology = numaNodes();
+    topology.resize(std::clamp<std::size_t>(nodeCount, 1, topology.size()));
+    firstWorker.push_back(0);
+    for (const NumaNode& node : topology) {
+        const unsigned int workerCount = static_cast<unsigned int>(node.cpus.size());
+        pools.push_back(std::make_unique<ThreadPool>(workerCount + 1, node.cpus));
+        firstWorker.push_back(firstWorker.back() + workerCount);
+    }
+}
+
+std::pair<unsigned int, unsigned int> NumaPools::band(const unsigned int node, const unsigned int count) const {
+    const auto row = [this, count](const unsigned int index) { return static_cast<unsigned int>(static_cast<unsigned long long>(count) * firstWorker[index] / threads()); };
+    return {row(node), row(node + 1)};
+}
+
+// every node task counts as done, even when fn throws: the caller waits for all of them before unwinding, they reference its state
+// a node whose task can not be queued (allocation failure) is not counted
+void NumaPools::run(const std::function<void(unsigned int, ThreadPool&)>& fn) {
+    unsigned int pending = 0;
+    std::exception_ptr error;
+    for (unsigned int node = 0; node < nodes() && !error; node++) {
+        {
+            std::lock_guard lock(mutex);
+            pending++;
+        }
+        try {
+            pools[node]->submit([this, &fn, &pending, &error, node] {
+                std::exception_ptr failure;
+                try {
+                    fn(node, *pools[node]);
+                } catch (...) { failure = std::current_exception(); }
+                // under the lock: the waiting caller owns the counter and the exception
+                std::lock_guard lock(mutex);
+                if (failure && !error)
+                    error = std::move(failure);
+                if (--pending == 0)
+                    done.notify_all();
+            });
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            pending--;
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&pending] { return pending == 0; });
+    if (error)
+        std::rethrow_exception(error);
+}
+} // namespace cpu_utils
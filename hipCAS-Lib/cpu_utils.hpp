@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CAS_X86 1
+#else
+#define CAS_X86 0
+#endif
+
+// Helper functions and classes related to the native CPU engine
+namespace cpu_utils {
+// instruction sets of the vectorized CPU kernels, ordered from the slowest to the fastest
+enum class Isa { Scalar, SSE41, AVX2, AVX512 };
+
+unsigned int hardwareThreads();
+unsigned int selectThreadCount();
+Isa detectIsa();
+Isa selectIsa();
+const char* isaName(const Isa isa);
+
+// NUMA node and the logical processors of it the process may run on
+struct NumaNode {
+    unsigned int node;
+    std::vector<unsigned int> cpus;
+};
+// NUMA nodes with at least one usable logical processor, a single node with all of them when the machine is not NUMA or its topology is unknown
+std::vector<NumaNode> numaNodes();
+// restrict the calling thread to a set of logical processors, false when it failed or is not supported
+bool pinCurrentThread(const std::vector<unsigned int>& cpus);
+
+// 64-bit hash of bytes continuing from seed (four interleaved multiply-xorshift lanes), fast enough to scan a frame at memory speed
+// it detects the changed tiles of a frame sequence, it is not meant to resist crafted collisions
+std::uint64_t hashBytes(const unsigned char* data, const std::size_t bytes, const std::uint64_t seed);
+
+// Persistent work-stealing pool of worker threads
+// Every worker owns a task deque: it pops its own tasks LIFO (cache-warm, recently split work) and steals FIFO (the oldest,
+// usually biggest tasks) from the others when it runs out. Threads outside the pool push to a shared injection deque.
+// Waiting threads (TaskGroup::wait, parallelFor) execute pending tasks instead of blocking, so tasks may spawn and wait for subtasks.
+// This is a mutex-based approximation of Chase-Lev deques: every push, pop and steal locks the deque (uncontended for the owner
+// most of the time), and a submit only takes the sleep mutex and notifies when a worker sleeps. TaskGroup::wait polls every 200 us
+// when it finds nothing to run while its tasks are still running elsewhere.
+class ThreadPool {
+  private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    // one deque per worker, the last one is the injection deque of the threads outside the pool
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::atomic<unsigned int> queuedTasks{0};
+    // workers waiting on taskAvailable, counted under sleepMutex
+    std::atomic<unsigned int> sleepingWorkers{0};
+    std::mutex sleepMutex;
+    std::condition_variable_any taskAvailable;
+    std::vector<std::jthread> workers;
+
+    unsigned int ownQueue() const;
+    bool popTask(const unsigned int queue, const bool steal, std::function<void()>& task);
+    void workerLoop(const unsigned int queue, const std::vector<unsigned int>& affinity, std::stop_token stopToken);
+
+  public:
+    // the workers are restricted to the logical processors of affinity (e.g. those of a NUMA node), empty: not pinned
+    explicit ThreadPool(const unsigned int threadCount = selectThreadCount(), const std::vector<unsigned int>& affinity = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) noexcept = delete;
+    ThreadPool& operator=(ThreadPool&& other) noexcept = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    // number of threads that execute work, including the caller
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // queue a task on the deque of the calling worker (or the injection deque)
+    void submit(std::function<void()> task);
+    // execute one queued task (own deque first, then steal), false if there was none
+    bool runPendingTask();
+
+    // run fn(begin, end) for chunks of at most grainSize items covering [0, count), blocks until all chunks are done
+    // on at most maxThreads threads, the calling one included (0 = every thread of the pool)
+    void parallelFor(const unsigned int count, const unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& fn, const unsigned int maxThreads = 0);
+};
+
+// Set of tasks that can be waited for, the waiting thread helps executing queued tasks
+// A task that throws still counts as done: the first exception is kept and rethrown by wait()
+class TaskGroup {
+  private:
+    ThreadPool& pool;
+    std::atomic<unsigned int> pendingTasks{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    // first exception of a task, guarded by mutex
+    std::exception_ptr error;
+
+    void waitTasks();
+
+  public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    // waits for the remaining tasks, they reference this group (an exception of theirs is dropped: the destructor runs when the caller already unwinds or did not wait)
+    ~TaskGroup() { waitTasks(); }
+
+    TaskGroup(const TaskGroup& other) = delete;
+    TaskGroup(TaskGroup&& other) noexcept = delete;
+    TaskGroup& operator=(TaskGroup&& other) noexcept = delete;
+    TaskGroup& operator=(const TaskGroup& other) = delete;
+
+    // queue a task of this group
+    void run(std::function<void()> task);
+    // block until every task of this group is done, then rethrow the first exception of a task (once)
+    void wait();
+};
+
+// One pool of workers pinned to each NUMA node, as many as the logical processors of the node
+// The rows of an image are split in node-local bands (proportional to the workers of each node): a band is copied, sharpened and written by
+// the workers of one node only, so the pages of the buffers first touched by them stay on the node that reads them.
+class NumaPools {
+  private:
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    // workers of the nodes before each node, the last entry is the total
+    std::vector<unsigned int> firstWorker;
+    std::mutex mutex;
+    std::condition_variable done;
+
+  public:
+    // pools of the first nodeCount (at least one) nodes of numaNodes()
+    explicit NumaPools(const unsigned int nodeCount);
+
+    NumaPools(const NumaPools& other) = delete;
+    NumaPools(NumaPools&& other) noexcept = delete;
+    NumaPools& operator=(NumaPools&& other) noexcept = delete;
+    NumaPools& operator=(const NumaPools& other) = delete;
+
+    unsigned int nodes() const { return static_cast<unsigned int>(pools.size()); }
+    unsigned int threads() const { return firstWorker.back(); }
+    // rows [first, second) of the band of a node, for an image of count rows
+    std::pair<unsigned int, unsigned int> band(const unsigned int node, const unsigned int count) const;
+    // run fn(node, pool of the node) on one worker of every node, blocks until all are done (the caller only waits), then rethrows the first exception of fn
+    void run(const std::function<void(unsigned int, ThreadPool&)>& fn);
+};
+} // namespace cpu_utils
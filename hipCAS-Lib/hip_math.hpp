@@ -114,3 +114,18 @@ inline __device__ half sRGB(const half linearColor) {
     const half sRGBOffset = __float2half(0.055f);           // Offset for the gamma correction region
     return linearColor <= sRGBThreshold ? linearColor * sRGBScale : sRGBGammaScale * powh(linearColor, sRGBGammaExponent) - sRGBOffset;
 }
+
+#ifdef CAS_SRGB_LUT
+#include "srgb_lut.hpp"
+
+// device copy of the sRGB encode table (srgb_lut.hpp) in constant memory
+__constant__ srgb_lut::EncodeTable sRGBEncodeTable = srgb_lut::encodeTable;
+
+// Convert a linear RGB value to an 8-bit sRGB value with the encode table (rounded, no powh)
+inline __device__ unsigned char sRGBToUchar(const half linearColor) {
+    return sRGBEncodeTable.values[__float2int_rn(__saturatef(__half2float(linearColor)) * (srgb_lut::encodeTableSize - 1))];
+}
+#else
+// Convert a linear RGB value to an 8-bit sRGB value
+inline __device__ unsigned char sRGBToUchar(const half linearColor) { return halfToUchar(sRGB(linearColor)); }
+#endif
\ No newline at end of file
@@ -1,16 +1,28 @@
 #include "hip_utils.hpp"
+#include "include/CASLibWrapper.h"
 #include <hip/hip_runtime.h>
 #include <utility>
 
 namespace hip_utils {
+// returns true if at least one HIP capable device is present (and the HIP runtime is usable)
+bool isDeviceAvailable() {
+    int deviceCount = 0;
+    return hipGetDeviceCount(&deviceCount) == hipSuccess && deviceCount > 0;
+}
+
 // helper method to calculate kernel grid size from given 2D dimensions and blockSize
 dim3 gridSizeCalculate(const dim3 blockSize, const int rows, const int cols) { return dim3((cols + blockSize.x - 1) / blockSize.x, (rows + blockSize.y - 1) / blockSize.y); }
 
-// simple wrapper of hipMallocArray to reduce boilerplate
-hipArray_t hipMallocArray(const std::size_t cols, const std::size_t rows) {
-    hipArray_t arr;
-    const auto channelDescriptor = hipCreateChannelDesc<uchar4>();
-    hipMallocArray(&arr, &channelDescriptor, cols, rows, hipArrayDefault);
+// simple wrapper of hipMallocArray to reduce boilerplate, nullptr when the allocation fails
+// texels: uchar4 for the 8-bit formats (expanded to RGBA), the layout of the input for the 16-bit and float formats (copied as is)
+hipArray_t hipMallocArray(const std::size_t cols, const std::size_t rows, const int pixelFormat) {
+    hipArray_t arr = nullptr;
+    const auto channelDescriptor = pixelFormat == CAS_FORMAT_RGBA16    ? hipCreateChannelDesc<ushort4>()
+                                   : pixelFormat == CAS_FORMAT_RGBA16F ? hipCreateChannelDescHalf4()
+                                   : pixelFormat == CAS_FORMAT_RGBA32F ? hipCreateChannelDesc<float4>()
+                                                                       : hipCreateChannelDesc<uchar4>();
+    if (hipMallocArray(&arr, &channelDescriptor, cols, rows, hipArrayDefault) != hipSuccess)
+        return nullptr;
     return arr;
 }
 
@@ -24,15 +36,16 @@ hipResourceDesc createResourceDescriptor(const hipArray_t hipArray) {
 
 // creates a hipTextureDesc with these properties:
 // Border addressing mode, point filtering mode,
-// sRGB to linear conversion in hardware,
-// normalized float [0,1] read mode, non-normalized coords
-hipTextureDesc createTextureDescriptor() {
+// sRGB to linear conversion in hardware (8-bit formats only, the others are linear),
+// normalized float [0,1] read mode (integer texels), non-normalized coords
+hipTextureDesc createTextureDescriptor(const int pixelFormat) {
+    const bool floatTexels = pixelFormat == CAS_FORMAT_RGBA16F || pixelFormat == CAS_FORMAT_RGBA32F;
     hipTextureDesc texDesc{};
     texDesc.addressMode[0] = hipAddressModeBorder;
     texDesc.addressMode[1] = hipAddressModeBorder;
-    texDesc.sRGB = 1; // do automatic sRGB to linear
+    texDesc.sRGB = pixelFormat == CAS_FORMAT_RGBA16 || floatTexels ? 0 : 1; // do automatic sRGB to linear
     texDesc.filterMode = hipFilterModePoint;
-    texDesc.readMode = hipReadModeNormalizedFloat; // read as float in [0,1]
+    texDesc.readMode = floatTexels ? hipReadModeElementType : hipReadModeNormalizedFloat; // read as float in [0,1]
     texDesc.normalizedCoords = 0;
     return texDesc;
 }
@@ -45,14 +58,17 @@ hipTextureObject_t createTextureObject(const hipResourceDesc& pResDesc, const hi
 }
 
 // create the hipArray and the textureObject binded to this array.
-std::pair<hipTextureObject_t, hipArray_t> createTextureData(const unsigned int rows, const unsigned int cols) {
-    const hipArray_t arr = hipMallocArray(cols, rows);
-    return std::make_pair(createTextureObject(createResourceDescriptor(arr), createTextureDescriptor()), arr);
+std::pair<hipTextureObject_t, hipArray_t> createTextureData(const unsigned int rows, const unsigned int cols, const int pixelFormat) {
+    const hipArray_t arr = hipMallocArray(cols, rows, pixelFormat);
+    return std::make_pair(createTextureObject(createResourceDescriptor(arr), createTextureDescriptor(pixelFormat)), arr);
 }
 
-// copy Host data to Device Array
-void copyDataToHipArray(const unsigned char* data, const unsigned int rows, const unsigned int cols, hipArray_t hipArray) {
-    const size_t widthBytes = cols * 4 * sizeof(unsigned char);
-    hipMemcpy2DToArray(hipArray, 0, 0, data, widthBytes, widthBytes, rows, hipMemcpyHostToDevice);
+// copy Host data to Device Array, pixelBytes: bytes of one texel, pitch: bytes between two host rows (0 = packed)
+// the copy is ordered on stream, it is complete when this returns (the host data may be released)
+void copyDataToHipArray(const unsigned char* data, const unsigned int rows, const unsigned int cols, const std::size_t pixelBytes, hipArray_t hipArray, const std::size_t pitch,
+                        hipStream_t stream) {
+    const size_t widthBytes = cols * pixelBytes;
+    hipMemcpy2DToArrayAsync(hipArray, 0, 0, data, pitch ? pitch : widthBytes, widthBytes, rows, hipMemcpyHostToDevice, stream);
+    hipStreamSynchronize(stream);
 }
 } // namespace hip_utils
\ No newline at end of file
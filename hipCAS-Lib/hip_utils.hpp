@@ -1,14 +1,17 @@
 #pragma once
+#include <cstddef>
 #include <hip/hip_runtime.h>
 #include <utility>
 
 // Helper functions related to HIP
 namespace hip_utils {
+bool isDeviceAvailable();
 dim3 gridSizeCalculate(const dim3 blockSize, const int rows, const int cols);
-hipArray_t hipMallocArray(const std::size_t cols, const std::size_t rows);
+hipArray_t hipMallocArray(const std::size_t cols, const std::size_t rows, const int pixelFormat);
 hipResourceDesc createResourceDescriptor(const hipArray_t hipArray);
-hipTextureDesc createTextureDescriptor();
+hipTextureDesc createTextureDescriptor(const int pixelFormat);
 hipTextureObject_t createTextureObject(const hipResourceDesc& pResDesc, const hipTextureDesc& pTexDesc);
-std::pair<hipTextureObject_t, hipArray_t> createTextureData(const unsigned int rows, const unsigned int cols);
-void copyDataToHipArray(const unsigned char* data, const unsigned int rows, const unsigned int cols, hipArray_t hipArray);
+std::pair<hipTextureObject_t, hipArray_t> createTextureData(const unsigned int rows, const unsigned int cols, const int pixelFormat);
+void copyDataToHipArray(const unsigned char* data, const unsigned int rows, const unsigned int cols, const std::size_t pixelBytes, hipArray_t hipArray, const std::size_t pitch = 0,
+                        hipStream_t stream = nullptr);
 } // namespace hip_utils
\ No newline at end of file
@@ -1,29 +1,290 @@
 #pragma once
 #ifdef __HIP_DEVICE_COMPILE__
 #define CAS_API
-#else
+#elif defined(_WIN32)
 #ifdef CAS_EXPORT
 #define CAS_API __declspec(dllexport)
 #else
 #define CAS_API __declspec(dllimport)
 #endif
+#else
+#define CAS_API __attribute__((visibility("default")))
 #endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
+    //status of one image of a batch or of an asynchronous job (PENDING and CANCELLED only apply to jobs)
+    enum CASStatus { CAS_STATUS_OK = 0, CAS_STATUS_INVALID_ARGUMENT = 1, CAS_STATUS_FAILED = 2, CAS_STATUS_PENDING = 3, CAS_STATUS_CANCELLED = 4 };
+
+    //precision tier of the CPU engine, see CAS_setPrecision
+    enum CASPrecision { CAS_PRECISION_EXACT = 0, CAS_PRECISION_FAST = 1 };
+
+    //input pixel formats of CAS_supplyImageFormat. The 8-bit formats are sRGB samples, BGRA8 is the memory order of a little-endian 32-bit ARGB pixel (e.g. QImage::Format_ARGB32/RGB32)
+    //GRAY8 is sharpened as R = G = B. The planar formats are one plane per channel (R, G, B then A), each one rows rows of the input stride
+    //RGBA16 (16-bit unorm), RGBA16F (fp16) and RGBA32F (fp32) are interleaved linear samples in [0,1], read without the sRGB transfer (the CPU engine clamps other values)
+    enum CASPixelFormat {
+        CAS_FORMAT_RGBA8 = 0,
+        CAS_FORMAT_BGRA8 = 1,
+        CAS_FORMAT_RGB8 = 2,
+        CAS_FORMAT_BGR8 = 3,
+        CAS_FORMAT_GRAY8 = 4,
+        CAS_FORMAT_PLANAR_RGB8 = 5,
+        CAS_FORMAT_PLANAR_RGBA8 = 6,
+        CAS_FORMAT_RGBA16 = 7,
+        CAS_FORMAT_RGBA16F = 8,
+        CAS_FORMAT_RGBA32F = 9
+    };
+
+    //sample format of the sharpened output, see CAS_setOutputFormat: 8-bit sRGB, or linear 16-bit unorm, fp16 or fp32 samples
+    enum CASSampleFormat { CAS_SAMPLE_SRGB8 = 0, CAS_SAMPLE_UNORM16 = 1, CAS_SAMPLE_HALF = 2, CAS_SAMPLE_FLOAT = 3 };
+
+    //instrumented stages (see CAS_getStats): allocation of the internal buffers, copy of the input into the engine (to the device for the HIP engine),
+    //device side conversion of the native pixel formats to RGBA (HIP engine only, the CPU tiles decode the pixels as they read them), sharpening (kernel or tile pass),
+    //copy of the output back to the host (HIP engine only, the CPU tiles write the output directly)
+    enum CASStage { CAS_STAGE_ALLOCATE = 0, CAS_STAGE_UPLOAD = 1, CAS_STAGE_CONVERT = 2, CAS_STAGE_KERNEL = 3, CAS_STAGE_DOWNLOAD = 4, CAS_STAGE_COUNT = 5 };
+
+    //runs of one stage, cumulative and last duration
+    typedef struct CASStageStats {
+        unsigned long long calls;
+        double totalMs, lastMs;
+    } CASStageStats;
+
+    //counters of a CAS instance since its creation or the last CAS_resetStats
+    typedef struct CASStats {
+        CASStageStats stages[CAS_STAGE_COUNT]; //indexed by CASStage
+        unsigned long long bytesIn;            //input bytes copied into the engine
+        unsigned long long bytesOut;           //output bytes copied back to the host (HIP engine) or written by the tiles (CPU engine)
+        unsigned long long allocations;        //internal buffer allocations, and their total size
+        unsigned long long allocatedBytes;
+        unsigned long long pixels;             //output pixels of the sharpening calls
+        unsigned long long alphaSkippedPixels; //pixels of zero alpha written as transparent without sharpening them (alpha early-out)
+        unsigned long long sequenceTiles;      //tiles of the whole image calls in sequence mode (see CAS_setSequenceMode)
+        unsigned long long skippedTiles;       //of them, the tiles left as they were in the output buffer because their input had not changed
+        unsigned long long lastSequenceTiles;  //the same for the last whole image call in sequence mode (the last frame)
+        unsigned long long lastSkippedTiles;
+    } CASStats;
+
+    //memory kinds of the buffer pools of a context: host (CPU engine images), pinned host (HIP downloads), device buffers and texture arrays (HIP engine)
+    enum CASMemoryKind { CAS_MEMORY_HOST = 0, CAS_MEMORY_PINNED = 1, CAS_MEMORY_DEVICE = 2, CAS_MEMORY_TEXTURE = 3, CAS_MEMORY_KIND_COUNT = 4 };
+
+    //counters of the buffer pool of one memory kind (CAS_getPoolStats), all zero for a kind the engine does not use
+    typedef struct CASPoolStats {
+        unsigned long long hits;         //buffers handed out again from the idle ones
+        unsigned long long misses;       //buffers that had to be allocated
+        unsigned long long idleBuffers;  //buffers kept for reuse
+        unsigned long long idleBytes;    //their bytes (size classes, not the requested sizes)
+        unsigned long long limitBytes;   //high-water limit of the idle bytes
+        unsigned long long trimmedBytes; //bytes freed instead of kept (limit reached, trimming)
+    } CASPoolStats;
+
+    //one image of a batch: input, output and parameters are set by the caller, status and elapsedMs are written by CAS_sharpenBatch
+    typedef struct CASImageDesc {
+        const unsigned char* inputImage; //interleaved RGBA, rows * cols * 4 bytes
+        unsigned char* outputImage;      //caller-owned, rows * cols * (hasAlpha ? 4 : 3) bytes, layout of casMode (see CAS_sharpenImage)
+        unsigned int rows, cols;
+        int hasAlpha;
+        int casMode;
+        float sharpenStrength, contrastAdaption;
+        int status;       //CASStatus of this image
+        double elapsedMs; //time from the start of its first piece of work to the end of its last one
+    } CASImageDesc;
+
+    //launch parameters of the sharpening calls on one image size, alpha and casMode (see CAS_autoTune), a zero field selects the engine default
+    typedef struct CASTuning {
+        unsigned int tileRows, tileCols; //CPU engine: rows and columns per tile (default 64 rows, widest strip that fits a 256KB cache)
+        unsigned int threads;            //CPU engine: threads sharpening one image (default all the threads of the engine)
+        unsigned int blockX, blockY;     //HIP engine: thread block of the kernel (default 16 x 16)
+        double megapixelsPerSecond;      //throughput measured by CAS_autoTune, 0 for the defaults
+    } CASTuning;
+
+    //completion callback of an asynchronous job: userData given to CAS_submit, ticket of the job and its final CASStatus
+    typedef void (*CASCompletionCallback)(void* userData, unsigned int ticket, int status);
+
 	//Initialize CAS instance (must be the fist function called)
+    //the HIP engine is used if a device is present, else the native CPU engine. Set the CAS_BACKEND environment variable to "gpu" or "cpu" to force one
     CAS_API void* CAS_initialize();
 
+    //shared context for concurrent serving: the engine (selected like CAS_initialize), its device or thread pool and kernels, created once. Thread safe
+    CAS_API void* CAS_createContext();
+
+    //new session of a context: a CAS instance holding the state of one image (use it with the functions taking a casImpl, release it with CAS_destroy)
+    //sessions are cheap (no thread or device initialization, the buffers are allocated by the first image) and the sessions of one context can be used
+    //by different threads at the same time without locking each other; one session is used by one thread at a time. Thread safe, nullptr on failure
+    CAS_API void* CAS_createSession(void* casContext);
+
+    //release a context handle, its sessions keep the context alive until they are destroyed
+    CAS_API void CAS_destroyContext(void* casContext);
+
+    //buffer pools of the context of an instance (shared by its sessions): the internal buffers of an image come from power-of-two size classes (texture arrays:
+    //their exact size) and go back to the pool when the instance gets an image of another size or is destroyed, so alternating between a few resolutions
+    //only allocates for the first images. CAS_getPoolStats reads the counters of a CASMemoryKind, CAS_setPoolLimit sets its high-water limit of idle bytes
+    //(1GB by default, 0 disables the reuse) and frees the idle buffers above it, CAS_trimPool frees idle buffers until at most keepBytes remain. Return a CASStatus
+    CAS_API int CAS_getPoolStats(void* casImpl, const int memoryKind, CASPoolStats* stats);
+    CAS_API int CAS_setPoolLimit(void* casImpl, const int memoryKind, const unsigned long long bytes);
+    CAS_API int CAS_trimPool(void* casImpl, const int memoryKind, const unsigned long long keepBytes);
+
     //deallocate internal memory and allocate new memory with the new specified image size
+    //an image with the same size and alpha as the previous one reuses the internal memory, only its pixels are uploaded
+    //when the memory can not be allocated the instance is left without an image (see CAS_supplyImageFormat for a status)
     CAS_API void CAS_supplyImage(void* casImpl, const unsigned char* inputImage, const int hasAlpha, const unsigned int rows, const unsigned int cols);
 
-    //sharpen the input image and return a pinned memory buffer with the sharpened RGB(A) data
+    //same as CAS_supplyImage for an image in its native layout (CASPixelFormat), read as is without a conversion to RGBA. Returns a CASStatus
+    //inputStride: bytes between the starts of two rows (of a plane for the planar formats), 0 = packed rows
+    //hasAlpha: use the alpha channel, only valid for the formats that have one (RGBA8, BGRA8, PLANAR_RGBA8), 0 ignores it (e.g. QImage::Format_RGB32)
+    CAS_API int CAS_supplyImageFormat(void* casImpl, const unsigned char* inputImage, const int pixelFormat, const unsigned int inputStride, const int hasAlpha,
+                                      const unsigned int rows, const unsigned int cols);
+
+    //next frame of a sequence (video): replaces the pixels of the supplied image, same size, alpha and pixel format, without any allocation. Returns a CASStatus
+    //inputStride: bytes between the starts of two rows in the pixel format of the supplied image (interleaved RGBA for CAS_supplyImage), 0 = packed rows
+    CAS_API int CAS_supplyFrame(void* casImpl, const unsigned char* inputFrame, const unsigned int inputStride);
+
+    //sharpen the input image and return a buffer (pinned memory for the HIP engine) with the sharpened RGB(A) data
     //casMode = 0: CAS kernel will write RGB planar data (RRRR....GGGG....BBBB....AAAA....)
     //casMode = 1: CAS kernel will write RGBA interleaved data (RGBA....RGBA....)
+    //returns nullptr when the engine fails (e.g. the output buffer can not be allocated)
     CAS_API const unsigned char* CAS_sharpenImage(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption);
     
-    //free internal memory
+    //sharpen the input image directly into a caller-owned buffer (no internal output buffer, no extra copy), returns a CASStatus
+    //outputStride: bytes between the starts of two rows, 0 = packed rows. Planar mode: row y of plane p starts at (p * rows + y) * outputStride
+    CAS_API int CAS_sharpenImageInto(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, unsigned char* outputImage,
+                                     const unsigned int outputStride);
+
+    //sharpen only the rectangle of width x height pixels at (x, y) of the input image into a caller-owned buffer, returns a CASStatus
+    //the cost scales with the area of the rectangle, its one pixel halo is read from the full image: the result equals the same rectangle of CAS_sharpenImageInto
+    //the output is laid out like a width x height image: outputStride as in CAS_sharpenImageInto, planar mode: row i of plane p starts at (p * height + i) * outputStride
+    CAS_API int CAS_sharpenRegion(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int x, const unsigned int y,
+                                  const unsigned int width, const unsigned int height, unsigned char* outputImage, const unsigned int outputStride);
+
+    //sharpen the input image and resize it to outputRows x outputCols in the same pass (CAS scaling mode, any factor up or down) into a caller-owned buffer, returns a CASStatus
+    //upscaling blends the sharpening filters of the 4 nearest source pixels (the CAS upscaling filter), downscaling averages the sharpened source pixels under each output pixel
+    //the output is laid out like an outputRows x outputCols image: outputStride as in CAS_sharpenImageInto, planar mode: row i of plane p starts at (p * outputRows + i) * outputStride
+    CAS_API int CAS_sharpenScaledInto(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows,
+                                      const unsigned int outputCols, unsigned char* outputImage, const unsigned int outputStride);
+
+    //only the rows [firstRow, firstRow + rowCount) of the image resized by CAS_sharpenScaledInto (e.g. bands of a pass that can stop between two calls), returns a CASStatus
+    //the cost scales with the rows, the result equals the same rows of CAS_sharpenScaledInto. The output is laid out like a rowCount x outputCols image
+    //(planar mode: row i of plane p starts at (p * rowCount + i) * outputStride)
+    CAS_API int CAS_sharpenScaledRows(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned int outputRows,
+                                      const unsigned int outputCols, const unsigned int firstRow, const unsigned int rowCount, unsigned char* outputImage,
+                                      const unsigned int outputStride);
+
+    //name of the engine and kernel variant in use: "hip", or "cpu-" followed by the instruction set of the CPU engine (scalar, sse4.1, avx2, avx512)
+    //the CPU engine uses all hardware threads, the CAS_CPU_THREADS environment variable (read by CAS_initialize) selects another count
+    CAS_API const char* CAS_getBackendName(void* casImpl);
+
+    //precision tier of the CPU engine (CASPrecision), exact by default. The fast tier runs the kernel in 16-bit fixed point (twice the SIMD lanes of the fp32 kernel),
+    //its output is within 1 LSB of the exact tier up to a sharpen strength of 2 and within 2 LSB above (see the README), and it has no cached mode.
+    //The HIP engine ignores it (its kernel is fp16). Returns a CASStatus
+    CAS_API int CAS_setPrecision(void* casImpl, const int precision);
+
+    //sample format of the output of CAS_sharpenImage, CAS_sharpenImageInto, CAS_sharpenRegion and CAS_submit (CASSampleFormat), 8-bit sRGB by default
+    //the linear formats skip the sRGB transfer. The layouts are unchanged with samples of 2 (UNORM16, HALF) or 4 bytes (FLOAT): output strides stay in bytes and must be multiples
+    //of the sample size, output buffers must be aligned to it. The fast precision tier only applies to 8-bit output, the HIP kernel computes in fp16 for every format. Returns a CASStatus
+    CAS_API int CAS_setOutputFormat(void* casImpl, const int sampleFormat);
+
+    //set the tile size of the CPU engine (rows and columns per tile), 0 selects the tuned size of the supplied image (see CAS_autoTune), else the default
+    //(64 rows, widest strip that fits a 256KB cache). An explicit size applies to every image, batches included
+    CAS_API void CAS_setTileSize(void* casImpl, const unsigned int tileRows, const unsigned int tileCols);
+
+    //working set in bytes of one CPU engine tile for the supplied image (sliding window rows and partials), 0 for the HIP engine
+    CAS_API unsigned long long CAS_getTileWorkingSet(void* casImpl);
+
+    //memory budget in bytes of the cached mode (0 = disabled, the default). When the intermediates of the supplied image fit (12 bytes per pixel on the HIP engine,
+    //24 on the CPU engine), the first CAS_sharpenImage (or full width CAS_sharpenRegion bands from the top to the last row) stores the per-pixel amplitude and filter sum,
+    //and the next calls only run the cheap parameter dependent stage
+    CAS_API void CAS_setCacheBudget(void* casImpl, const unsigned long long bytes);
+
+    //drop the cached intermediates (e.g. after modifying the input image in place), CAS_supplyImage does it automatically
+    //in sequence mode it also forgets the results held by the output buffers: the next frame is sharpened whole
+    CAS_API void CAS_invalidateCache(void* casImpl);
+
+    //sequence mode of the CPU engine, for mostly static frame sequences (screen captures, UI recordings): tileSize > 0 splits the supplied image in tiles of
+    //tileSize x tileSize pixels (at least 8), 0 = off (the default). Each new frame hashes every tile with its one pixel halo, and CAS_sharpenImage(Into) only sharpens
+    //the tiles that changed since the frame last written into the same output buffer with the same parameters: the other tiles keep their output. The instance remembers
+    //the last 8 output buffers (e.g. buffers circulating in a pipeline, the internal buffers of CAS_submit); a caller-owned buffer must keep that output unchanged,
+    //call CAS_invalidateCache after writing into it or freeing it. The cached mode does not apply to the whole image calls meanwhile, the HIP engine ignores it.
+    //The tile counts are in CASStats. Returns a CASStatus
+    CAS_API int CAS_setSequenceMode(void* casImpl, const unsigned int tileSize);
+
+    //benchmark the launch parameters of the engine (CPU: tile rows, tile columns, then threads; HIP: thread block) on the supplied image in casMode, with the precision
+    //and output format of the instance, and adopt the fastest one for its engine, resolution bucket (the next power of two of rows * cols), alpha and casMode.
+    //It is written to the tuning profile, loaded by the next CAS_initialize/CAS_createContext: the CAS_TUNING_PROFILE environment variable (empty = no file),
+    //else hipcas/tuning.txt in XDG_CONFIG_HOME or ~/.config (%LOCALAPPDATA%\hipCAS\tuning.txt on Windows). Without an entry the engine defaults apply.
+    //Takes a few seconds for a 4K image. Writes the winner into tuning (may be null), returns a CASStatus (FAILED for the client library or when the profile can not be written)
+    CAS_API int CAS_autoTune(void* casImpl, const int casMode, CASTuning* tuning);
+
+    //launch parameters used for the supplied image in casMode: the profile entry of its engine, resolution bucket, alpha and casMode, else all zero (defaults). Returns a CASStatus
+    CAS_API int CAS_getTuning(void* casImpl, const int casMode, CASTuning* tuning);
+
+    //NUMA nodes of this machine with at least one logical processor available to the process (1 when it is not NUMA or its topology is unknown)
+    CAS_API unsigned int CAS_getNumaNodeCount();
+
+    //NUMA mode of the CPU engine, for large frames on multi-socket machines: 0 = off (the default, one pool over all hardware threads), n = the first n nodes
+    //(clamped to CAS_getNumaNodeCount), with one worker pinned to every logical processor of each node. The rows of the supplied image are split in one band per node:
+    //the input copy, the tiles and the output writes of a band run on its node, and new internal buffers get their pages there (first touch). Applies to CAS_supplyImage(Format),
+    //CAS_supplyFrame, CAS_sharpenImage(Into) and CAS_sharpenRegion, caller-owned output buffers stay where they are. Invalidates the buffer returned by CAS_sharpenImage.
+    //Returns the threads sharpening an image in the selected mode, 0 for the HIP engine (which ignores it)
+    CAS_API unsigned int CAS_setNumaNodes(void* casImpl, const unsigned int nodeCount);
+
+    //sharpen a batch of images into their own output buffers, independent of the supplied image
+    //the CPU engine spreads the images over a work-stealing thread pool, large images are split into bands of rows
+    //returns the number of images that failed (see the status of each descriptor)
+    CAS_API unsigned int CAS_sharpenBatch(void* casImpl, CASImageDesc* images, const unsigned int count);
+
+    //streaming mode (native CPU engine, independent of any CAS instance), for images too large to be held in memory: memory use is O(cols) whatever the number of rows
+    //the output is identical to the CPU engine's CAS_sharpenImage output. Returns a stream handle, NULL for invalid arguments
+    CAS_API void* CAS_streamBegin(const unsigned int rows, const unsigned int cols, const int hasAlpha, const int casMode, const float sharpenStrength, const float contrastAdaption);
+
+    //push up to count interleaved RGBA input rows (inputStride bytes apart, 0 = packed) in image order, returns the number of rows accepted
+    //fewer rows are accepted when the internal window is full: pull the ready rows, then push the rest
+    CAS_API unsigned int CAS_streamPush(void* casStream, const unsigned char* inputRows, const unsigned int count, const unsigned int inputStride);
+
+    //pull up to maxRows sharpened rows in image order (outputStride bytes apart, 0 = packed), returns the number of rows written
+    //row y is ready once input row y + 1 (or the last row) has been pushed. Planar mode: the chunk is written plane by plane, row i of plane p at (p * pulled + i) * outputStride
+    CAS_API unsigned int CAS_streamPull(void* casStream, unsigned char* outputRows, const unsigned int maxRows, const unsigned int outputStride);
+
+    //free the stream, returns CAS_STATUS_OK if every row has been pulled
+    CAS_API int CAS_streamEnd(void* casStream);
+
+    //asynchronous sharpening: the job is queued and returns immediately, a worker thread of the instance runs the jobs in submission order. Returns a ticket, 0 for invalid arguments
+    //inputFrame: next frame of the supplied image (as CAS_supplyFrame, inputStride bytes apart, 0 = packed) uploaded by the job, NULL = the supplied image as is.
+    //It must stay valid until the job completes
+    //outputImage: caller-owned output (outputStride as CAS_sharpenImageInto). NULL = one of two internal buffers (double buffering): read it with CAS_getResult while the next job computes,
+    //then give it back with CAS_releaseResult. A job waits for a free internal buffer
+    //callback (may be NULL): called on the worker thread when the job completes or fails, by CAS_cancel when it is cancelled
+    //while jobs are pending, only the asynchronous functions (CAS_submit ... CAS_releaseResult) may be called on the instance
+    CAS_API unsigned int CAS_submit(void* casImpl, const int casMode, const float sharpenStrength, const float contrastAdaption, const unsigned char* inputFrame,
+                                    const unsigned int inputStride, unsigned char* outputImage, const unsigned int outputStride, CASCompletionCallback callback, void* userData);
+
+    //CASStatus of a job: CAS_STATUS_PENDING while it is queued or running, CAS_STATUS_INVALID_ARGUMENT for an unknown or released ticket
+    CAS_API int CAS_poll(void* casImpl, const unsigned int ticket);
+
+    //block until the job has completed (or was cancelled), returns its CASStatus
+    CAS_API int CAS_wait(void* casImpl, const unsigned int ticket);
+
+    //cancel a superseded job: a queued job is dropped (CAS_STATUS_CANCELLED), a running or completed one is not affected. Returns the CASStatus of the job
+    CAS_API int CAS_cancel(void* casImpl, const unsigned int ticket);
+
+    //internal buffer holding the result of a completed job submitted without an output (packed, layout of CAS_sharpenImage), NULL otherwise. Valid until CAS_releaseResult
+    CAS_API const unsigned char* CAS_getResult(void* casImpl, const unsigned int ticket);
+
+    //forget a completed or cancelled job and give its internal buffer back, every ticket must be released once. Returns the CASStatus of the job
+    //(CAS_STATUS_PENDING: the job has not completed and the ticket is not released)
+    CAS_API int CAS_releaseResult(void* casImpl, const unsigned int ticket);
+
+    //per stage timings, bytes moved, allocations and pixels of the instance (CASStats). They are always collected (a few clock reads and atomic adds per call) and may be
+    //read from any thread, also while asynchronous jobs run: each counter is consistent, but the set of them is not a snapshot of a single moment. Returns a CASStatus
+    CAS_API int CAS_getStats(void* casImpl, CASStats* stats);
+
+    //same counters as a one line JSON object (with the engine name), written to buffer (size bytes, null terminated when size > 0)
+    //returns the length of the whole JSON text without the terminator: a result >= size means that it was truncated
+    CAS_API unsigned int CAS_getStatsJson(void* casImpl, char* buffer, const unsigned int size);
+
+    //zero the counters
+    CAS_API void CAS_resetStats(void* casImpl);
+
+    //free internal memory, cancels the queued jobs and waits for the running one
     CAS_API void CAS_destroy(void* casImpl);
 
 #ifdef __cplusplus
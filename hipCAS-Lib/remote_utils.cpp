@@ -0,0 +1,234 @@
+#include "remote_utils.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace remote_utils {
+std::string defaultSocketPath() {
+    if (const char* path = std::getenv("CAS_DAEMON_SOCKET"); path && *path)
+        return path;
+    if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir)
+        return std::string(runtimeDir) + "/hipcas.sock";
+    // anyone can create files in /tmp: the socket goes in a directory of the user that nobody else can enter
+    const std::string directory = "/tmp/hipcas-" + std::to_string(getuid());
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+        throw std::runtime_error("cannot create " + directory + ": " + std::strerror(errno));
+    struct stat status;
+    if (lstat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode) || status.st_uid != getuid() || (status.st_mode & 0077) != 0)
+        throw std::runtime_error(directory + " is not a directory of the user only, set XDG_RUNTIME_DIR or CAS_DAEMON_SOCKET");
+    return directory + "/hipcas.sock";
+}
+
+// whether the process at the other end of a connected socket runs as the user
+static bool peerIsUser(const int fd) {
+#ifdef SO_PEERCRED
+    ucred credentials{};
+    socklen_t size = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0 || size != sizeof(credentials))
+        return false;
+    return credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// socket address of a path, false when it does not fit
+static bool socketAddress(const std::string& path, sockaddr_un& address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int connectSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+        return -1;
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    // a socket of another user could impersonate the daemon and read the images sent to it
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !peerIsUser(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listenSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+        throw std::runtime_error("socket path too long: " + path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    // a socket file left by a daemon that did not exit cleanly: nothing answers on it anymore
+    const int probe = connectSocket(path);
+    if (probe >= 0) {
+        close(probe);
+        close(fd);
+        throw std::runtime_error("a daemon already listens on " + path);
+    }
+    unlink(path.c_str());
+    const mode_t previousMask = umask(0077);
+    const bool bound = bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    umask(previousMask);
+    if (!bound || listen(fd, SOMAXCONN) != 0) {
+        const std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("cannot listen on " + path + ": " + error);
+    }
+    return fd;
+}
+
+int acceptSocket(const int listenFd) {
+    while (true) {
+        const int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0 || errno != EINTR)
+            return fd;
+    }
+}
+
+void shutdownSocket(const int fd) {
+    if (fd >= 0)
+        shutdown(fd, SHUT_RDWR);
+}
+
+void closeSocket(const int fd) {
+    if (fd >= 0)
+        close(fd);
+}
+
+bool sendAll(const int fd, const void* data, const std::size_t bytes, const int passedFd) {
+    const unsigned char* next = static_cast<const unsigned char*>(data);
+    std::size_t remaining = bytes;
+    bool passFd = passedFd >= 0;
+    while (remaining > 0) {
+        iovec vector{const_cast<unsigned char*>(next), remaining};
+        msghdr message{};
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        // the descriptor travels with the first byte sent
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        if (passFd) {
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(header), &passedFd, sizeof(int));
+        }
+        const ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        passFd = false;
+        next += sent;
+        remaining -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+bool receiveAll(const int fd, void* data, const std::size_t bytes, int* receivedFd) {
+    if (receivedFd)
+        *receivedFd = -1;
+    unsigned char* next = static_cast<unsigned char*>(data);
+    std::size_t remaining = bytes;
+    while (remaining > 0) {
+        iovec vector{next, remaining};
+        msghdr message{};
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        const ssize_t received = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+                continue;
+            int passedFd;
+            std::memcpy(&passedFd, CMSG_DATA(header), sizeof(int));
+            // a descriptor nobody asked for is not kept open
+            if (receivedFd && *receivedFd < 0)
+                *receivedFd = passedFd;
+            else
+                close(passedFd);
+        }
+        next += received;
+        remaining -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+int createSharedMemory(const std::size_t bytes) {
+#ifdef __linux__
+    const int fd = memfd_create("hipcas", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    // a unique name, unlinked at once: only the descriptor refers to the object
+    static unsigned int counter = 0;
+    const std::string name = "/hipcas-" + std::to_string(getpid()) + "-" + std::to_string(__atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        shm_unlink(name.c_str());
+#endif
+    if (fd < 0)
+        throw std::bad_alloc();
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        close(fd);
+        throw std::bad_alloc();
+    }
+#ifdef __linux__
+    // the daemon maps it too: it must not shrink under its mapping
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK);
+#endif
+    return fd;
+}
+
+bool holdsSharedMemory(const int fd, const std::size_t bytes) {
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < 0 || static_cast<unsigned long long>(status.st_size) < bytes)
+        return false;
+#ifdef __linux__
+    const int seals = fcntl(fd, F_GET_SEALS);
+    return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+    return true;
+#endif
+}
+
+bool SharedMapping::map(const int fd, const std::size_t bytes) {
+    reset();
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+        return false;
+    pointer = static_cast<unsigned char*>(mapped);
+    this->bytes = bytes;
+    return true;
+}
+
+void SharedMapping::reset() {
+    if (pointer)
+        munmap(pointer, bytes);
+    pointer = nullptr;
+    bytes = 0;
+}
+} // namespace remote_utils
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Helper functions and classes of the remote engine and cas-daemon (POSIX: local stream sockets, descriptor passing, shared memory)
+namespace remote_utils {
+// socket of the daemon: CAS_DAEMON_SOCKET, else hipcas.sock in XDG_RUNTIME_DIR, else hipcas.sock in /tmp/hipcas-<uid>, a directory created with mode 0700.
+// Throws std::runtime_error when that directory can not be created or belongs to another user or is open to others
+std::string defaultSocketPath();
+
+// connected socket to path, -1 when no daemon listens there or its process runs as another user
+int connectSocket(const std::string& path);
+// listening socket bound to path (a stale socket file is replaced), readable by the user only. Throws std::runtime_error
+int listenSocket(const std::string& path);
+// next connection of a listening socket, -1 on failure
+int acceptSocket(const int listenFd);
+// end both directions of a connection: the blocked calls on it return
+void shutdownSocket(const int fd);
+void closeSocket(const int fd);
+
+// send or receive exactly bytes, with a descriptor passed along (-1 = none; received: -1 when none came with them). False when the peer is gone
+bool sendAll(const int fd, const void* data, const std::size_t bytes, const int passedFd = -1);
+bool receiveAll(const int fd, void* data, const std::size_t bytes, int* receivedFd = nullptr);
+
+// descriptor of a new anonymous shared memory object of bytes (memfd on Linux, sealed against shrinking; an unlinked POSIX shm object elsewhere). Throws std::bad_alloc
+int createSharedMemory(const std::size_t bytes);
+// whether a shared memory descriptor of another process holds at least bytes, and can not shrink below them while it is mapped
+// (a mapping past the end of the object faults on access). On Linux the memfd must be sealed, elsewhere only its current size is checked
+bool holdsSharedMemory(const int fd, const std::size_t bytes);
+
+// Read/write shared mapping of a shared memory descriptor, unmapped when replaced or destroyed
+class SharedMapping {
+  private:
+    unsigned char* pointer{nullptr};
+    std::size_t bytes{0};
+
+  public:
+    SharedMapping() = default;
+    ~SharedMapping() { reset(); }
+
+    SharedMapping(const SharedMapping& other) = delete;
+    SharedMapping(SharedMapping&& other) noexcept = delete;
+    SharedMapping& operator=(SharedMapping&& other) noexcept = delete;
+    SharedMapping& operator=(const SharedMapping& other) = delete;
+
+    // map bytes of fd (the descriptor may be closed afterwards), false on failure (the previous mapping is gone either way)
+    bool map(const int fd, const std::size_t bytes);
+    void reset();
+
+    unsigned char* data() const { return pointer; }
+    std::size_t size() const { return bytes; }
+    // whether [offset, offset + count) lies inside the mapping (written so that it can not overflow)
+    bool contains(const unsigned long long offset, const unsigned long long count) const { return offset <= bytes && count <= bytes - offset; }
+};
+} // namespace remote_utils
@@ -0,0 +1,82 @@
+#include "srgb_lut.hpp"
+#include <utility>
+
+// Compile-time accuracy tests of the sRGB tables, the build fails if any of them does not hold
+namespace srgb_lut {
+namespace {
+constexpr bool near(const double a, const double b, const double tolerance) { return a - b <= tolerance && b - a <= tolerance; }
+
+// the constexpr pow against known values of the sRGB curve exponents
+static_assert(near(detail::constPow(0.5, 2.4), 0.18946457081379978, 1e-12));
+static_assert(near(detail::constPow(0.5, 1.0 / 2.4), 0.7491535384383408, 1e-12));
+static_assert(near(detail::constPow(0.01, 1.0 / 2.4), 0.14677992676220694, 1e-12));
+
+// decode table against reference values of the formula
+static_assert(decode(0) == 0.0f && decode(255) == 1.0f);
+static_assert(near(decode(1), 0.0003035269835488375, 1e-9));
+static_assert(near(decode(64), 0.05126945837404324, 1e-7));
+static_assert(near(decode(128), 0.21586050011389926, 1e-7));
+static_assert(near(decode(200), 0.5775804404296506, 1e-7));
+static_assert(near(decode(254), 0.9911020971138298, 1e-7));
+
+// every 8-bit code survives a decode -> encode round trip (a zero sharpen strength reproduces the input)
+constexpr bool roundTrip() {
+    for (int code = 0; code < 256; code++) {
+        if (encode(decode(static_cast<unsigned char>(code))) != code)
+            return false;
+    }
+    return true;
+}
+static_assert(roundTrip());
+
+// encode lookup against the rounded formula, on every table entry and every midpoint between two entries (the worst case of the lookup)
+// evaluated in chunks: each chunk is a separate constant evaluation, which keeps every one below the compilers' constexpr step limits
+constexpr int encodeSamples = 2 * (encodeTableSize - 1) + 1;
+constexpr int encodeChunkSize = 256;
+constexpr bool encodeChunkWithinOneLsb(const int chunk) {
+    for (int sample = chunk * encodeChunkSize; sample < (chunk + 1) * encodeChunkSize && sample < encodeSamples; sample++) {
+        const double value = static_cast<double>(sample) / (encodeSamples - 1);
+        const int expected = static_cast<int>(detail::sRGB(value) * 255.0 + 0.5);
+        const int actual = encode(static_cast<float>(value));
+        if (actual - expected > 1 || expected - actual > 1)
+            return false;
+    }
+    return true;
+}
+template <int chunk>
+constexpr bool encodeChunkValid = encodeChunkWithinOneLsb(chunk);
+template <int... chunks>
+constexpr bool encodeValid(std::integer_sequence<int, chunks...>) {
+    return (encodeChunkValid<chunks> && ...);
+}
+static_assert(encodeValid(std::make_integer_sequence<int, (encodeSamples + encodeChunkSize - 1) / encodeChunkSize>{}));
+
+// fixed point tables: the decoded values are the rounded formula, every code round trips, and the encode lookup of every Q15 value is within 1 LSB
+static_assert(decodeFixed(0) == 0 && decodeFixed(1) == 10 && decodeFixed(128) == 7073 && decodeFixed(255) == fixedOne);
+constexpr bool fixedRoundTrip() {
+    for (int code = 0; code < 256; code++) {
+        if (encodeFixed(decodeFixed(static_cast<unsigned char>(code))) != code)
+            return false;
+    }
+    return true;
+}
+static_assert(fixedRoundTrip());
+
+constexpr bool fixedEncodeChunkWithinOneLsb(const int chunk) {
+    for (int value = chunk * encodeChunkSize; value < (chunk + 1) * encodeChunkSize && value <= fixedOne; value++) {
+        const int expected = static_cast<int>(detail::sRGB(static_cast<double>(value) / fixedOne) * 255.0 + 0.5);
+        const int actual = encodeFixed(static_cast<short>(value));
+        if (actual - expected > 1 || expected - actual > 1)
+            return false;
+    }
+    return true;
+}
+template <int chunk>
+constexpr bool fixedEncodeChunkValid = fixedEncodeChunkWithinOneLsb(chunk);
+template <int... chunks>
+constexpr bool fixedEncodeValid(std::integer_sequence<int, chunks...>) {
+    return (fixedEncodeChunkValid<chunks> && ...);
+}
+static_assert(fixedEncodeValid(std::make_integer_sequence<int, (fixedOne + encodeChunkSize) / encodeChunkSize>{}));
+} // namespace
+} // namespace srgb_lut
@@ -0,0 +1,149 @@
+#pragma once
+
+// Precomputed sRGB transfer function tables, generated at compile time
+// decode: 256 entries, sRGB 8-bit code -> linear float (what the texture unit does on the device)
+// encode: 4096 entries over [0,1] linear -> sRGB 8-bit code, within 1 LSB of the rounded formula for any input (checked in srgb_lut.cpp)
+// fixed point variants of both (fast precision tier of the CPU engine): linear values in Q15, encoded through 4096 buckets of 8 values
+namespace srgb_lut {
+
+// constexpr math (std::pow is not constexpr), double precision is more than enough to build the tables
+namespace detail {
+constexpr double ln2 = 0.69314718055994530942;
+
+// natural logarithm, x > 0
+constexpr double constLog(double x) {
+    int exponent = 0;
+    while (x > 1.41421356237309505) {
+        x /= 2.0;
+        exponent++;
+    }
+    while (x < 0.70710678118654752) {
+        x *= 2.0;
+        exponent--;
+    }
+    // ln(x) = 2 * atanh((x - 1) / (x + 1)), |s| <= 0.172 converges fast
+    const double s = (x - 1.0) / (x + 1.0), s2 = s * s;
+    double term = s, sum = 0.0;
+    for (int k = 1; k < 24; k += 2) {
+        sum += term / k;
+        term *= s2;
+    }
+    return 2.0 * sum + exponent * ln2;
+}
+
+// exponential, range reduced to |r| <= ln2 / 2
+constexpr double constExp(const double x) {
+    const int k = static_cast<int>(x / ln2 + (x < 0.0 ? -0.5 : 0.5));
+    const double r = x - k * ln2;
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 16; n++) {
+        term *= r / n;
+        sum += term;
+    }
+    for (int i = 0; i < k; i++)
+        sum *= 2.0;
+    for (int i = 0; i > k; i--)
+        sum /= 2.0;
+    return sum;
+}
+
+constexpr double constPow(const double base, const double exponent) { return base <= 0.0 ? 0.0 : constExp(exponent * constLog(base)); }
+
+// reference sRGB transfer functions
+constexpr double linear(const double sRGBColor) { return sRGBColor <= 0.04045 ? sRGBColor / 12.92 : constPow((sRGBColor + 0.055) / 1.055, 2.4); }
+constexpr double sRGB(const double linearColor) { return linearColor <= 0.0031308 ? linearColor * 12.92 : 1.055 * constPow(linearColor, 1.0 / 2.4) - 0.055; }
+} // namespace detail
+
+constexpr int encodeTableSize = 4096;
+
+// plain arrays (no std::array) so that device code can read them directly
+struct DecodeTable {
+    float values[256];
+};
+struct EncodeTable {
+    unsigned char values[encodeTableSize];
+};
+
+constexpr DecodeTable makeDecodeTable() {
+    DecodeTable table{};
+    for (int code = 0; code < 256; code++)
+        table.values[code] = static_cast<float>(detail::linear(code / 255.0));
+    return table;
+}
+
+// the entry of value v is round(sRGB(v) * 255): the number of codes whose lower rounding boundary (decoded) is <= v
+// only 255 boundaries have to be decoded, which keeps the compile time evaluation cheap
+constexpr EncodeTable makeEncodeTable() {
+    double boundaries[256]{};
+    for (int code = 1; code < 256; code++)
+        boundaries[code] = detail::linear((code - 0.5) / 255.0);
+    EncodeTable table{};
+    int code = 0;
+    for (int i = 0; i < encodeTableSize; i++) {
+        const double value = static_cast<double>(i) / (encodeTableSize - 1);
+        while (code < 255 && boundaries[code + 1] <= value)
+            code++;
+        table.values[i] = static_cast<unsigned char>(code);
+    }
+    return table;
+}
+
+// Q15 fixed point linear values: 1.0 = fixedOne
+constexpr int fixedOne = 32767;
+// the fixed point encode table is indexed by value >> fixedEncodeShift
+constexpr int fixedEncodeShift = 3;
+static_assert((fixedOne >> fixedEncodeShift) == encodeTableSize - 1);
+
+struct FixedDecodeTable {
+    short values[256];
+};
+
+constexpr FixedDecodeTable makeFixedDecodeTable() {
+    FixedDecodeTable table{};
+    for (int code = 0; code < 256; code++)
+        table.values[code] = static_cast<short>(detail::linear(code / 255.0) * fixedOne + 0.5);
+    return table;
+}
+
+// same construction as makeEncodeTable at the center of each bucket, then the bucket of every decoded code is set to that code so that decode -> encode
+// round trips (the decoded codes are at least 9.9 values apart, more than a bucket)
+constexpr EncodeTable makeFixedEncodeTable(const FixedDecodeTable& decoded) {
+    double boundaries[256]{};
+    for (int code = 1; code < 256; code++)
+        boundaries[code] = detail::linear((code - 0.5) / 255.0);
+    EncodeTable table{};
+    int code = 0;
+    for (int i = 0; i < encodeTableSize; i++) {
+        const double value = ((i << fixedEncodeShift) + ((1 << fixedEncodeShift) - 1) / 2.0) / fixedOne;
+        while (code < 255 && boundaries[code + 1] <= value)
+            code++;
+        table.values[i] = static_cast<unsigned char>(code);
+    }
+    for (code = 0; code < 256; code++)
+        table.values[decoded.values[code] >> fixedEncodeShift] = static_cast<unsigned char>(code);
+    return table;
+}
+
+inline constexpr DecodeTable decodeTable = makeDecodeTable();
+inline constexpr EncodeTable encodeTable = makeEncodeTable();
+inline constexpr FixedDecodeTable fixedDecodeTable = makeFixedDecodeTable();
+inline constexpr EncodeTable fixedEncodeTable = makeFixedEncodeTable(fixedDecodeTable);
+
+// index of a linear value in the encode table, values outside [0,1] (and NaN) are clamped
+constexpr int encodeIndex(const float linearColor) {
+    const float clamped = linearColor > 0.0f ? (linearColor < 1.0f ? linearColor : 1.0f) : 0.0f;
+    return static_cast<int>(clamped * (encodeTableSize - 1) + 0.5f);
+}
+
+// sRGB 8-bit code -> linear
+constexpr float decode(const unsigned char sRGBCode) { return decodeTable.values[sRGBCode]; }
+
+// linear -> sRGB 8-bit code (rounded)
+constexpr unsigned char encode(const float linearColor) { return encodeTable.values[encodeIndex(linearColor)]; }
+
+// sRGB 8-bit code -> Q15 linear
+constexpr short decodeFixed(const unsigned char sRGBCode) { return fixedDecodeTable.values[sRGBCode]; }
+
+// Q15 linear in [0, fixedOne] -> sRGB 8-bit code
+constexpr unsigned char encodeFixed(const short linearColor) { return fixedEncodeTable.values[linearColor >> fixedEncodeShift]; }
+} // namespace srgb_lut
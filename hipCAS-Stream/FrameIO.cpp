@@ -0,0 +1,234 @@
+#include "CASLibWrapper.h"
+#include "FrameIO.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+// longest accepted Y4M header line
+constexpr std::size_t maxHeaderLength = 4096;
+
+// read a line up to the newline (excluded), false at the end of the stream before any character
+bool readLine(std::FILE* file, std::string& line) {
+    line.clear();
+    int c;
+    while ((c = std::getc(file)) != EOF && c != '\n') {
+        if (line.size() == maxHeaderLength)
+            throw std::runtime_error("Y4M header line too long");
+        line.push_back(static_cast<char>(c));
+    }
+    if (c == EOF && line.empty())
+        return false;
+    if (c == EOF)
+        throw std::runtime_error("truncated Y4M header");
+    return true;
+}
+
+int toFixed(const double value) { return static_cast<int>(std::lround(value * 65536.0)); }
+unsigned char clampByte(const int value) { return static_cast<unsigned char>(std::clamp(value, 0, 255)); }
+
+// dimensions of the chroma planes
+unsigned int chromaWidth(const FrameFormat& format) {
+    switch (format.chroma) {
+    case Chroma::C420:
+    case Chroma::C422: return (format.width + 1) / 2;
+    case Chroma::Mono: return 0;
+    default: return format.width;
+    }
+}
+unsigned int chromaHeight(const FrameFormat& format) { return format.chroma == Chroma::C420 ? (format.height + 1) / 2 : format.chroma == Chroma::Mono ? 0 : format.height; }
+} // namespace
+
+std::size_t FrameFormat::streamFrameBytes() const {
+    const std::size_t pixels = static_cast<std::size_t>(width) * height;
+    if (!y4m)
+        return pixels * (hasAlpha ? 4 : 3);
+    const std::size_t chromaPlane = static_cast<std::size_t>(chromaWidth(*this)) * chromaHeight(*this);
+    return pixels * (chroma == Chroma::C444Alpha ? 2 : 1) + 2 * chromaPlane;
+}
+
+int FrameFormat::inputPixelFormat() const { return !y4m && !hasAlpha ? CAS_FORMAT_RGB8 : CAS_FORMAT_RGBA8; }
+
+FrameFormat FrameFormat::raw(const unsigned int width, const unsigned int height, const bool hasAlpha) {
+    FrameFormat format;
+    format.width = width;
+    format.height = height;
+    format.hasAlpha = hasAlpha;
+    return format;
+}
+
+// "YUV4MPEG2 W<width> H<height> [C<colorspace>] [other tags]", the colorspace defaults to 420jpeg
+// all 4:2:0 sitings are handled alike (chroma replicated over its 2x2 block), only 8-bit samples are supported
+FrameFormat FrameFormat::readY4mHeader(std::FILE* file) {
+    std::string header;
+    if (!readLine(file, header) || !header.starts_with("YUV4MPEG2"))
+        throw std::runtime_error("input is not a Y4M stream (use --raw for raw frames)");
+    FrameFormat format;
+    format.y4m = true;
+    format.y4mHeader = header;
+    std::string_view tags(header);
+    tags.remove_prefix(std::string_view("YUV4MPEG2").size());
+    while (!tags.empty()) {
+        const std::size_t end = std::min(tags.find(' '), tags.size());
+        const std::string_view tag = tags.substr(0, end);
+        tags.remove_prefix(std::min(end + 1, tags.size()));
+        if (tag.empty())
+            continue;
+        const std::string value(tag.substr(1));
+        if (tag[0] == 'W')
+            format.width = static_cast<unsigned int>(std::stoul(value));
+        else if (tag[0] == 'H')
+            format.height = static_cast<unsigned int>(std::stoul(value));
+        else if (tag[0] == 'C') {
+            if (value.starts_with("420"))
+                format.chroma = Chroma::C420;
+            else if (value == "422")
+                format.chroma = Chroma::C422;
+            else if (value == "444")
+                format.chroma = Chroma::C444;
+            else if (value == "444alpha")
+                format.chroma = Chroma::C444Alpha;
+            else if (value == "mono")
+                format.chroma = Chroma::Mono;
+            else
+                throw std::runtime_error("unsupported Y4M colorspace C" + value);
+        } else if (tag == "XCOLORRANGE=FULL")
+            format.fullRange = true;
+    }
+    if (format.width == 0 || format.height == 0)
+        throw std::runtime_error("Y4M header without frame size");
+    format.hasAlpha = format.chroma == Chroma::C444Alpha;
+    return format;
+}
+
+YuvConverter::YuvConverter(const bool bt709, const bool fullRange) {
+    const double kr = bt709 ? 0.2126 : 0.299, kb = bt709 ? 0.0722 : 0.114, kg = 1.0 - kr - kb;
+    const double lumaRange = fullRange ? 255.0 : 219.0, chromaRange = fullRange ? 255.0 : 224.0;
+    yOffset = fullRange ? 0 : 16;
+    yScale = toFixed(255.0 / lumaRange);
+    const double chromaScale = 255.0 / chromaRange;
+    crToR = toFixed(2.0 * (1.0 - kr) * chromaScale);
+    cbToB = toFixed(2.0 * (1.0 - kb) * chromaScale);
+    cbToG = toFixed(2.0 * (1.0 - kb) * kb / kg * chromaScale);
+    crToG = toFixed(2.0 * (1.0 - kr) * kr / kg * chromaScale);
+    rToY = toFixed(kr * lumaRange / 255.0);
+    gToY = toFixed(kg * lumaRange / 255.0);
+    bToY = toFixed(kb * lumaRange / 255.0);
+    const double cbNorm = chromaRange / 255.0 / (2.0 * (1.0 - kb)), crNorm = chromaRange / 255.0 / (2.0 * (1.0 - kr));
+    rToCb = toFixed(-kr * cbNorm);
+    gToCb = toFixed(-kg * cbNorm);
+    bToCb = toFixed((1.0 - kb) * cbNorm);
+    rToCr = toFixed((1.0 - kr) * crNorm);
+    gToCr = toFixed(-kg * crNorm);
+    bToCr = toFixed(-kb * crNorm);
+}
+
+void YuvConverter::toRgb(const int y, const int cb, const int cr, unsigned char* rgb) const {
+    const int luma = (y - yOffset) * yScale + 32768, u = cb - 128, v = cr - 128;
+    rgb[0] = clampByte((luma + crToR * v) >> 16);
+    rgb[1] = clampByte((luma - cbToG * u - crToG * v) >> 16);
+    rgb[2] = clampByte((luma + cbToB * u) >> 16);
+}
+
+int YuvConverter::luma(const int r, const int g, const int b) const { return clampByte(yOffset + ((rToY * r + gToY * g + bToY * b + 32768) >> 16)); }
+
+// round the average of count chroma differences and move it around 128
+unsigned char YuvConverter::chroma(const int fixedSum, const int count) {
+    const int divisor = count * 65536;
+    return clampByte((fixedSum + 128 * divisor + divisor / 2) / divisor);
+}
+
+FrameReader::FrameReader(std::FILE* file, const FrameFormat& format, const YuvConverter& converter)
+    : file(file), format(format), converter(converter), staging(format.y4m ? format.streamFrameBytes() : 0) {}
+
+bool FrameReader::read(unsigned char* frame, std::string& frameParameters) {
+    const std::size_t pixels = static_cast<std::size_t>(format.width) * format.height;
+    frameParameters.clear();
+    if (format.y4m) {
+        if (!readLine(file, frameParameters))
+            return false;
+        if (!frameParameters.starts_with("FRAME"))
+            throw std::runtime_error("malformed Y4M frame header");
+        frameParameters.erase(0, std::string_view("FRAME").size());
+    }
+    // raw frames are read in place, Y4M frames through the staging buffer
+    unsigned char* destination = staging.empty() ? frame : staging.data();
+    const std::size_t bytes = format.streamFrameBytes();
+    const std::size_t read = std::fread(destination, 1, bytes, file);
+    if (read == 0 && !format.y4m)
+        return false;
+    if (read != bytes)
+        throw std::runtime_error("truncated frame");
+    if (staging.empty())
+        return true;
+    // Y4M: convert the planes to interleaved RGBA
+    const unsigned int cw = chromaWidth(format), chromaShiftX = cw < format.width ? 1 : 0, chromaShiftY = chromaHeight(format) < format.height ? 1 : 0;
+    const unsigned char* yPlane = staging.data();
+    const unsigned char* cbPlane = yPlane + pixels;
+    const unsigned char* crPlane = cbPlane + static_cast<std::size_t>(cw) * chromaHeight(format);
+    const unsigned char* alphaPlane = crPlane + static_cast<std::size_t>(cw) * chromaHeight(format);
+    for (unsigned int y = 0; y < format.height; y++) {
+        const std::size_t rowOffset = static_cast<std::size_t>(y) * format.width, chromaRow = static_cast<std::size_t>(y >> chromaShiftY) * cw;
+        for (unsigned int x = 0; x < format.width; x++) {
+            const std::size_t i = rowOffset + x;
+            const int cb = format.chroma == Chroma::Mono ? 128 : cbPlane[chromaRow + (x >> chromaShiftX)];
+            const int cr = format.chroma == Chroma::Mono ? 128 : crPlane[chromaRow + (x >> chromaShiftX)];
+            converter.toRgb(yPlane[i], cb, cr, frame + i * 4);
+            frame[i * 4 + 3] = format.hasAlpha ? alphaPlane[i] : 255;
+        }
+    }
+    return true;
+}
+
+FrameWriter::FrameWriter(std::FILE* file, const FrameFormat& format, const YuvConverter& converter)
+    : file(file), format(format), converter(converter), staging(format.y4m ? format.streamFrameBytes() : 0) {}
+
+void FrameWriter::writeHeader() {
+    if (format.y4m && (std::fputs(format.y4mHeader.c_str(), file) == EOF || std::fputc('\n', file) == EOF))
+        throw std::runtime_error("write error");
+}
+
+void FrameWriter::write(const unsigned char* pixels, const std::string& frameParameters) {
+    if (!format.y4m) {
+        if (std::fwrite(pixels, 1, format.sharpenedFrameBytes(), file) != format.sharpenedFrameBytes())
+            throw std::runtime_error("write error");
+        return;
+    }
+    const std::size_t pixelCount = static_cast<std::size_t>(format.width) * format.height;
+    const unsigned int channels = format.hasAlpha ? 4 : 3;
+    const unsigned int cw = chromaWidth(format), ch = chromaHeight(format);
+    const unsigned int blockWidth = cw < format.width ? 2 : 1, blockHeight = ch < format.height ? 2 : 1;
+    unsigned char* yPlane = staging.data();
+    unsigned char* cbPlane = yPlane + pixelCount;
+    unsigned char* crPlane = cbPlane + static_cast<std::size_t>(cw) * ch;
+    unsigned char* alphaPlane = crPlane + static_cast<std::size_t>(cw) * ch;
+    for (std::size_t i = 0; i < pixelCount; i++) {
+        const unsigned char* p = pixels + i * channels;
+        yPlane[i] = static_cast<unsigned char>(converter.luma(p[0], p[1], p[2]));
+        if (format.hasAlpha)
+            alphaPlane[i] = p[3];
+    }
+    // chroma of each subsampled block: average of the chroma of its pixels (edge blocks of odd sizes have fewer pixels)
+    for (unsigned int cy = 0; cy < ch; cy++) {
+        for (unsigned int cx = 0; cx < cw; cx++) {
+            int cbSum = 0, crSum = 0, count = 0;
+            for (unsigned int y = cy * blockHeight; y < std::min((cy + 1) * blockHeight, format.height); y++) {
+                for (unsigned int x = cx * blockWidth; x < std::min((cx + 1) * blockWidth, format.width); x++) {
+                    const unsigned char* p = pixels + (static_cast<std::size_t>(y) * format.width + x) * channels;
+                    cbSum += converter.cb(p[0], p[1], p[2]);
+                    crSum += converter.cr(p[0], p[1], p[2]);
+                    count++;
+                }
+            }
+            cbPlane[static_cast<std::size_t>(cy) * cw + cx] = YuvConverter::chroma(cbSum, count);
+            crPlane[static_cast<std::size_t>(cy) * cw + cx] = YuvConverter::chroma(crSum, count);
+        }
+    }
+    if (std::fputs("FRAME", file) == EOF || std::fputs(frameParameters.c_str(), file) == EOF || std::fputc('\n', file) == EOF ||
+        std::fwrite(staging.data(), 1, staging.size(), file) != staging.size())
+        throw std::runtime_error("write error");
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// chroma subsampling of a Y4M stream
+enum class Chroma { C420, C422, C444, C444Alpha, Mono };
+
+struct FrameFormat {
+    unsigned int width = 0, height = 0;
+    // Y4M (planar YCbCr) stream, else raw interleaved RGB24 / RGBA frames
+    bool y4m = false;
+    // the frames carry an alpha channel (raw RGBA, Y4M 444alpha), sharpened as RGBA
+    bool hasAlpha = false;
+    Chroma chroma = Chroma::C420;
+    // stream header line of a Y4M input (without the newline), written unchanged to the output
+    std::string y4mHeader;
+    // the Y4M header declares full range samples (XCOLORRANGE=FULL)
+    bool fullRange = false;
+
+    // bytes of one frame in the stream (without the Y4M frame header)
+    std::size_t streamFrameBytes() const;
+    // pixel format (CASPixelFormat) and bytes of one frame handed to the library: raw frames as stored (RGB24 is read natively), Y4M frames converted to RGBA
+    int inputPixelFormat() const;
+    std::size_t inputFrameBytes() const { return static_cast<std::size_t>(width) * height * (!y4m && !hasAlpha ? 3 : 4); }
+    // bytes of the interleaved RGB(A) output of the library for one frame
+    std::size_t sharpenedFrameBytes() const { return static_cast<std::size_t>(width) * height * (hasAlpha ? 4 : 3); }
+
+    // raw interleaved frames of the given size
+    static FrameFormat raw(const unsigned int width, const unsigned int height, const bool hasAlpha);
+    // parse the stream header of a Y4M input, throws std::runtime_error if it is not a supported Y4M stream
+    static FrameFormat readY4mHeader(std::FILE* file);
+};
+
+// BT.601 / BT.709 YCbCr <-> sRGB conversion in 16.16 fixed point, limited (16-235/240) or full range
+class YuvConverter final {
+  private:
+    int yOffset;
+    // YCbCr -> RGB
+    int yScale, crToR, cbToG, crToG, cbToB;
+    // RGB -> YCbCr
+    int rToY, gToY, bToY, rToCb, gToCb, bToCb, rToCr, gToCr, bToCr;
+
+  public:
+    YuvConverter(const bool bt709, const bool fullRange);
+
+    void toRgb(const int y, const int cb, const int cr, unsigned char* rgb) const;
+    int luma(const int r, const int g, const int b) const;
+    // chroma differences, 16.16 fixed point around zero (averaged over the subsampled block before rounding)
+    int cb(const int r, const int g, const int b) const { return rToCb * r + gToCb * g + bToCb * b; }
+    int cr(const int r, const int g, const int b) const { return rToCr * r + gToCr * g + bToCr * b; }
+    static unsigned char chroma(const int fixedSum, const int count);
+};
+
+// Reads the frames of a stream in the input pixel format of the library (see FrameFormat::inputPixelFormat)
+class FrameReader final {
+  private:
+    std::FILE* const file;
+    const FrameFormat format;
+    const YuvConverter converter;
+    // one frame as stored in the stream (Y4M planes), allocated once
+    std::vector<unsigned char> staging;
+
+  public:
+    FrameReader(std::FILE* file, const FrameFormat& format, const YuvConverter& converter);
+
+    const FrameFormat& frameFormat() const { return format; }
+    // read the next frame into frame (inputFrameBytes) and its Y4M frame parameters, false at the end of the stream
+    // throws std::runtime_error for a truncated or malformed frame
+    bool read(unsigned char* frame, std::string& frameParameters);
+};
+
+// Converts the sharpened RGB(A) frames back to the stream format and writes them
+class FrameWriter final {
+  private:
+    std::FILE* const file;
+    const FrameFormat format;
+    const YuvConverter converter;
+    std::vector<unsigned char> staging;
+
+  public:
+    FrameWriter(std::FILE* file, const FrameFormat& format, const YuvConverter& converter);
+
+    // Y4M stream header, nothing for raw frames. Throws std::runtime_error on write errors (e.g. closed pipe)
+    void writeHeader();
+    // write one sharpened frame (interleaved RGB or RGBA), throws std::runtime_error on write errors
+    void write(const unsigned char* pixels, const std::string& frameParameters);
+};
@@ -0,0 +1,157 @@
+#include "CASLibWrapper.h"
+#include "StreamPipeline.hpp"
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Frame {
+    std::vector<unsigned char> pixels;
+    // Y4M frame parameters, passed through to the output
+    std::string parameters;
+};
+
+// busy time of a stage, each stage runs on a single thread
+class StageTimer {
+  private:
+    Clock::duration busy{};
+
+  public:
+    template <class F>
+    auto measure(F&& work) {
+        const auto start = Clock::now();
+        auto result = work();
+        busy += Clock::now() - start;
+        return result;
+    }
+    double seconds() const { return std::chrono::duration<double>(busy).count(); }
+};
+} // namespace
+
+StreamStats StreamPipeline::run(FrameReader& reader, FrameWriter& writer) {
+    const FrameFormat& format = reader.frameFormat();
+    // frames in the queue plus the one each side is working on: in sequence mode an output buffer that comes back after more frames than the library
+    // remembers would be sharpened whole every time
+    const std::size_t queueCapacity = options.sequenceTile > 0 ? std::min(options.queueCapacity, StreamOptions::maxSequenceQueue) : options.queueCapacity;
+    const std::size_t frameCount = queueCapacity + 2;
+    std::vector<Frame> inputFrames(frameCount), outputFrames(frameCount);
+    // full frames flow forward, empty ones flow back to their producer; nullptr marks the end of the sequence
+    SpscQueue<Frame*> readQueue(frameCount), freeInputs(frameCount), sharpenQueue(frameCount), freeOutputs(frameCount);
+    for (std::size_t i = 0; i < frameCount; i++) {
+        inputFrames[i].pixels.resize(format.inputFrameBytes());
+        outputFrames[i].pixels.resize(format.sharpenedFrameBytes());
+        freeInputs.push(&inputFrames[i]);
+        freeOutputs.push(&outputFrames[i]);
+    }
+    // set by the stage that fails first, the reader stops and the other stages drain the frames in flight
+    std::atomic<bool> failed{false};
+    std::string readError, sharpenError, writeError;
+    StageTimer readTimer, sharpenTimer, writeTimer;
+    StreamStats stats;
+    const auto start = Clock::now();
+
+    std::jthread readStage([&] {
+        try {
+            while (!failed) {
+                Frame* frame = freeInputs.pop();
+                if (failed || !readTimer.measure([&] { return reader.read(frame->pixels.data(), frame->parameters); }))
+                    break;
+                readQueue.push(frame);
+            }
+        } catch (const std::exception& e) {
+            readError = e.what();
+            failed = true;
+        }
+        readQueue.push(nullptr);
+    });
+
+    std::jthread writeStage([&] {
+        try {
+            writeTimer.measure([&] {
+                writer.writeHeader();
+                return true;
+            });
+        } catch (const std::exception& e) {
+            writeError = e.what();
+            failed = true;
+        }
+        while (Frame* frame = sharpenQueue.pop()) {
+            if (!failed) {
+                try {
+                    writeTimer.measure([&] {
+                        writer.write(frame->pixels.data(), frame->parameters);
+                        return true;
+                    });
+                    stats.frames++;
+                } catch (const std::exception& e) {
+                    writeError = e.what();
+                    failed = true;
+                }
+            }
+            freeOutputs.push(frame);
+        }
+    });
+
+    // sharpen stage, on this thread: the first frame allocates the buffers of the CAS instance, the next ones only replace the pixels
+    void* casObj = CAS_initialize();
+    if (!casObj) {
+        sharpenError = "failed to initialize CAS";
+        failed = true;
+    } else if (options.sequenceTile > 0 && CAS_setSequenceMode(casObj, options.sequenceTile) != CAS_STATUS_OK) {
+        sharpenError = "invalid sequence tile size";
+        failed = true;
+    }
+    bool firstFrame = true;
+    // kept across iterations when a frame fails, each queue has a single producer
+    Frame* output = nullptr;
+    while (Frame* input = readQueue.pop()) {
+        if (!failed) {
+            if (!output)
+                output = freeOutputs.pop();
+            const int status = sharpenTimer.measure([&] {
+                // raw RGB24 frames are supplied as they are read, without an expansion to RGBA
+                const int supplied = firstFrame ? CAS_supplyImageFormat(casObj, input->pixels.data(), format.inputPixelFormat(), 0, format.hasAlpha, format.height, format.width)
+                                                : CAS_supplyFrame(casObj, input->pixels.data(), 0);
+                if (supplied != CAS_STATUS_OK)
+                    return static_cast<int>(CAS_STATUS_FAILED);
+                // casMode 1: interleaved RGB(A), the layout of the raw output and of the Y4M conversion
+                return CAS_sharpenImageInto(casObj, 1, options.sharpenStrength, options.contrastAdaption, output->pixels.data(), 0);
+            });
+            firstFrame = false;
+            if (status == CAS_STATUS_OK) {
+                output->parameters = input->parameters;
+                sharpenQueue.push(output);
+                output = nullptr;
+            } else {
+                sharpenError = "failed to sharpen a frame";
+                failed = true;
+            }
+        }
+        freeInputs.push(input);
+    }
+    sharpenQueue.push(nullptr);
+    readStage.join();
+    writeStage.join();
+    if (casObj) {
+        CASStats casStats;
+        if (CAS_getStats(casObj, &casStats) == CAS_STATUS_OK) {
+            stats.sequenceTiles = casStats.sequenceTiles;
+            stats.skippedTiles = casStats.skippedTiles;
+        }
+        CAS_destroy(casObj);
+    }
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.readSeconds = readTimer.seconds();
+    stats.sharpenSeconds = sharpenTimer.seconds();
+    stats.writeSeconds = writeTimer.seconds();
+    stats.error = !readError.empty() ? "read: " + readError : !sharpenError.empty() ? "sharpen: " + sharpenError : !writeError.empty() ? "write: " + writeError : "";
+    return stats;
+}
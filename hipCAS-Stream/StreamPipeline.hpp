@@ -0,0 +1,40 @@
+#pragma once
+#include "FrameIO.hpp"
+#include <cstddef>
+#include <string>
+
+struct StreamOptions {
+    float sharpenStrength = 1.0f;
+    float contrastAdaption = 1.0f;
+    // the library remembers the last 8 output buffers in sequence mode (CAS_setSequenceMode): the queue plus the frame of each side must fit in them
+    static constexpr std::size_t maxSequenceQueue = 6;
+
+    // frames in flight between two stages, at most maxSequenceQueue in sequence mode
+    std::size_t queueCapacity = 4;
+    // tile size of the sequence mode (CAS_setSequenceMode), 0 = every frame is sharpened whole
+    unsigned int sequenceTile = 0;
+};
+
+struct StreamStats {
+    unsigned long long frames = 0;
+    double seconds = 0.0;
+    // time spent working in each stage (waiting on the queues excluded)
+    double readSeconds = 0.0, sharpenSeconds = 0.0, writeSeconds = 0.0;
+    // sequence mode: tiles of all the frames, and those left unchanged
+    unsigned long long sequenceTiles = 0, skippedTiles = 0;
+    // first error of any stage, empty on success
+    std::string error;
+};
+
+// Frame sequence pipeline: read -> sharpen -> write, one thread per stage connected by lock-free SPSC queues
+// the frame buffers are allocated once and circulate between the stages, the CAS instance keeps its buffers across frames (CAS_supplyFrame)
+class StreamPipeline final {
+  private:
+    const StreamOptions options;
+
+  public:
+    explicit StreamPipeline(const StreamOptions& options) : options(options) {}
+
+    // process every frame of the reader, blocks until the last one is written or a stage fails
+    StreamStats run(FrameReader& reader, FrameWriter& writer);
+};
@@ -0,0 +1,136 @@
+#include "FrameIO.hpp"
+#include "StreamPipeline.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#endif
+
+static void printUsage() {
+    std::fputs("Usage: cas-stream [options]\n"
+               "Sharpen a sequence of frames with Contrast Adaptive Sharpening (hipCAS), e.g. between two ffmpeg processes:\n"
+               "  ffmpeg -i in.mp4 -f yuv4mpegpipe - | cas-stream -s 0.5 | ffmpeg -i - out.mp4\n"
+               "  ffmpeg -i in.mp4 -f rawvideo -pix_fmt rgb24 - | cas-stream --raw 1920x1080 | ffmpeg -f rawvideo -pix_fmt rgb24 -s 1920x1080 -i - out.mp4\n\n"
+               "Options:\n"
+               "  -s, --sharpen <value>    Sharpen strength (0-10, default 1).\n"
+               "  -c, --contrast <value>   Contrast adaption (0-1, default 1).\n"
+               "  -i, --input <file>       Input file (default: standard input).\n"
+               "  -o, --output <file>      Output file (default: standard output).\n"
+               "  --raw <width>x<height>   Raw interleaved frames of this size instead of a Y4M stream.\n"
+               "  --pix-fmt <rgb24|rgba>   Pixel format of the raw frames (default rgb24).\n"
+               "  --matrix <601|709>       YCbCr matrix of the Y4M stream (default 601).\n"
+               "  --range <limited|full>   YCbCr range of the Y4M stream (default: limited, unless the header says full).\n"
+               "  --queue <count>          Frames in flight between two stages (default 4, at most 6 with --sequence).\n"
+               "  --sequence <tile size>   Only re-sharpen the tiles that changed since the previous frames (screen captures; 0 = off, the default).\n"
+               "  --quiet                  Do not print the statistics.\n"
+               "  -h, --help               Show this help.\n",
+               stderr);
+}
+
+int main(int argc, char* argv[]) {
+    StreamOptions options;
+    const char* inputPath = nullptr;
+    const char* outputPath = nullptr;
+    unsigned int rawWidth = 0, rawHeight = 0;
+    bool rawAlpha = false, bt709 = false, quiet = false;
+    int range = -1;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg(argv[i]);
+        // options with a value
+        const auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value of %s\n", argv[i]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "-s" || arg == "--sharpen")
+            options.sharpenStrength = std::clamp(std::strtof(value().data(), nullptr), 0.0f, 10.0f);
+        else if (arg == "-c" || arg == "--contrast")
+            options.contrastAdaption = std::clamp(std::strtof(value().data(), nullptr), 0.0f, 1.0f);
+        else if (arg == "-i" || arg == "--input")
+            inputPath = value().data();
+        else if (arg == "-o" || arg == "--output")
+            outputPath = value().data();
+        else if (arg == "--raw") {
+            if (std::sscanf(value().data(), "%ux%u", &rawWidth, &rawHeight) != 2 || rawWidth == 0 || rawHeight == 0) {
+                std::fputs("--raw expects <width>x<height>\n", stderr);
+                return 2;
+            }
+        } else if (arg == "--pix-fmt") {
+            const std::string_view format = value();
+            if (format != "rgb24" && format != "rgba") {
+                std::fputs("--pix-fmt expects rgb24 or rgba\n", stderr);
+                return 2;
+            }
+            rawAlpha = format == "rgba";
+        } else if (arg == "--matrix")
+            bt709 = value() == "709";
+        else if (arg == "--range")
+            range = value() == "full" ? 1 : 0;
+        else if (arg == "--queue")
+            options.queueCapacity = static_cast<std::size_t>(std::max(1, std::atoi(value().data())));
+        else if (arg == "--sequence")
+            options.sequenceTile = static_cast<unsigned int>(std::max(0, std::atoi(value().data())));
+        else if (arg == "--quiet")
+            quiet = true;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::FILE* input = inputPath && std::string_view(inputPath) != "-" ? std::fopen(inputPath, "rb") : stdin;
+    std::FILE* output = outputPath && std::string_view(outputPath) != "-" ? std::fopen(outputPath, "wb") : stdout;
+    if (!input || !output) {
+        std::fprintf(stderr, "can not open %s\n", !input ? inputPath : outputPath);
+        return 1;
+    }
+#ifdef _WIN32
+    // frames are binary data, no newline translation on the standard streams
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#else
+    // a closed output pipe is reported as a write error instead of terminating the process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    StreamStats stats;
+    try {
+        const FrameFormat format = rawWidth ? FrameFormat::raw(rawWidth, rawHeight, rawAlpha) : FrameFormat::readY4mHeader(input);
+        const YuvConverter converter(bt709, range < 0 ? format.fullRange : range == 1);
+        FrameReader reader(input, format, converter);
+        FrameWriter writer(output, format, converter);
+        stats = StreamPipeline(options).run(reader, writer);
+    } catch (const std::exception& e) { stats.error = e.what(); }
+    if (std::fflush(output) != 0 && stats.error.empty())
+        stats.error = "write: write error";
+    if (input != stdin)
+        std::fclose(input);
+    if (output != stdout)
+        std::fclose(output);
+
+    // statistics go to stderr, stdout carries the frames
+    if (!quiet) {
+        std::fprintf(stderr, "%llu frames in %.2f s: %.1f fps\n", stats.frames, stats.seconds, stats.frames / std::max(stats.seconds, 1e-9));
+        std::fprintf(stderr, "busy time per stage: read %.2f s, sharpen %.2f s, write %.2f s\n", stats.readSeconds, stats.sharpenSeconds, stats.writeSeconds);
+        if (stats.sequenceTiles > 0)
+            std::fprintf(stderr, "unchanged tiles: %llu of %llu (%.1f%%)\n", stats.skippedTiles, stats.sequenceTiles, 100.0 * stats.skippedTiles / stats.sequenceTiles);
+    }
+    if (!stats.error.empty()) {
+        std::fprintf(stderr, "cas-stream: %s\n", stats.error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring buffer, connects two pipeline stages (one thread on each side)
+// the producer only writes tail and the consumer only writes head, each side keeps a copy of the other index to touch the shared cache line only when needed
+// push blocks while the ring is full and pop while it is empty (spin then futex wait through std::atomic::wait, no mutex)
+template <class T>
+class SpscQueue final {
+  private:
+    static constexpr std::size_t cacheLine = 64;
+
+    std::vector<T> slots;
+    const std::size_t mask;
+    // next slot to pop, written by the consumer
+    alignas(cacheLine) std::atomic<std::size_t> head{0};
+    std::size_t cachedTail{0};
+    // next slot to push, written by the producer
+    alignas(cacheLine) std::atomic<std::size_t> tail{0};
+    std::size_t cachedHead{0};
+
+  public:
+    // the capacity is rounded up to a power of two
+    explicit SpscQueue(const std::size_t capacity) : slots(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)), mask(slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+    SpscQueue(SpscQueue&&) = delete;
+    SpscQueue& operator=(SpscQueue&&) = delete;
+
+    // producer side, false if the ring is full
+    bool tryPush(const T& item) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == slots.size())
+                return false;
+        }
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        tail.notify_one();
+        return true;
+    }
+
+    void push(const T& item) {
+        while (!tryPush(item))
+            head.wait(cachedHead, std::memory_order_acquire);
+    }
+
+    // consumer side, false if the ring is empty
+    bool tryPop(T& item) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+        item = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        head.notify_one();
+        return true;
+    }
+
+    T pop() {
+        T item;
+        while (!tryPop(item))
+            tail.wait(cachedTail, std::memory_order_acquire);
+        return item;
+    }
+};
@@ -0,0 +1,518 @@
+#include "CASLibWrapper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+// interleaved RGBA input of a test
+struct TestImage {
+    unsigned int rows, cols;
+    bool hasAlpha;
+    std::vector<unsigned char> pixels;
+};
+
+struct Parameters {
+    int casMode;
+    float sharpenStrength;
+    float contrastAdaption;
+};
+
+// odd sizes, single rows and columns, and images of several tiles
+constexpr unsigned int testSizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {2, 3}, {5, 3}, {17, 33}, {63, 65}, {130, 67}, {67, 257}, {257, 131}, {515, 301}};
+
+std::atomic<int> checks{0}, failures{0};
+
+unsigned int channels(const bool hasAlpha) { return hasAlpha ? 4u : 3u; }
+
+std::size_t outputBytes(const TestImage& image) { return static_cast<std::size_t>(image.rows) * image.cols * channels(image.hasAlpha); }
+
+std::string describe(const TestImage& image, const Parameters& parameters) {
+    char text[128];
+    std::snprintf(text, sizeof(text), "%ux%u%s mode %d strength %.2f adaption %.2f", image.cols, image.rows, image.hasAlpha ? " alpha" : "", parameters.casMode,
+                  parameters.sharpenStrength, parameters.contrastAdaption);
+    return text;
+}
+
+bool expect(const bool condition, const std::string& what) {
+    checks++;
+    if (!condition) {
+        failures++;
+        std::fprintf(stderr, "FAIL %s\n", what.c_str());
+    }
+    return condition;
+}
+
+// byte by byte, reports the first difference
+bool expectEqual(const std::vector<unsigned char>& actual, const std::vector<unsigned char>& expected, const std::string& what) {
+    if (actual.size() != expected.size())
+        return expect(false, what + ": " + std::to_string(actual.size()) + " bytes instead of " + std::to_string(expected.size()));
+    const auto difference = std::mismatch(actual.begin(), actual.end(), expected.begin());
+    if (difference.first == actual.end())
+        return expect(true, what);
+    return expect(false, what + ": byte " + std::to_string(difference.first - actual.begin()) + " is " + std::to_string(*difference.first) + " instead of " +
+                             std::to_string(*difference.second));
+}
+
+// smooth gradients with noise (so that the contrast adaption varies over the image), and some fully transparent pixels for the alpha early-out
+TestImage randomImage(std::mt19937& random, const unsigned int rows, const unsigned int cols, const bool hasAlpha) {
+    TestImage image{rows, cols, hasAlpha, std::vector<unsigned char>(static_cast<std::size_t>(rows) * cols * 4)};
+    std::uniform_int_distribution<int> noise(-48, 48), byte(0, 255);
+    const int amplitude = byte(random) % 4;
+    for (unsigned int y = 0; y < rows; y++) {
+        for (unsigned int x = 0; x < cols; x++) {
+            unsigned char* pixel = image.pixels.data() + (static_cast<std::size_t>(y) * cols + x) * 4;
+            const int gradient = static_cast<int>(x * 200 / cols + y * 55 / rows);
+            for (int c = 0; c < 3; c++)
+                pixel[c] = static_cast<unsigned char>(std::clamp(gradient + c * 20 + noise(random) * amplitude, 0, 255));
+            const int alpha = byte(random);
+            pixel[3] = static_cast<unsigned char>(alpha < 24 ? 0 : alpha);
+        }
+    }
+    return image;
+}
+
+Parameters randomParameters(std::mt19937& random) {
+    constexpr float strengths[] = {0.0f, 0.35f, 1.0f, 2.5f, 10.0f};
+    constexpr float adaptions[] = {0.0f, 0.5f, 1.0f};
+    return Parameters{static_cast<int>(random() % 2), strengths[random() % 5], adaptions[random() % 3]};
+}
+
+// sessions of the reference results
+void* referenceContext = nullptr;
+
+// CAS_sharpenImage of a new session
+std::vector<unsigned char> sharpenReference(const TestImage& image, const Parameters& parameters) {
+    void* cas = CAS_createSession(referenceContext);
+    CAS_supplyImage(cas, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+    const unsigned char* output = CAS_sharpenImage(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption);
+    std::vector<unsigned char> result = output ? std::vector<unsigned char>(output, output + outputBytes(image)) : std::vector<unsigned char>();
+    CAS_destroy(cas);
+    return result;
+}
+
+// the rectangle of a whole output (layout of CAS_sharpenImage), packed like a width x height output
+std::vector<unsigned char> cropOutput(const std::vector<unsigned char>& output, const TestImage& image, const int casMode, const unsigned int x, const unsigned int y,
+                                      const unsigned int width, const unsigned int height) {
+    const unsigned int planes = casMode == 0 ? channels(image.hasAlpha) : 1;
+    const unsigned int pixelBytes = casMode == 0 ? 1 : channels(image.hasAlpha);
+    std::vector<unsigned char> cropped;
+    for (unsigned int p = 0; p < planes; p++)
+        for (unsigned int i = 0; i < height; i++) {
+            const unsigned char* row = output.data() + ((static_cast<std::size_t>(p) * image.rows + y + i) * image.cols + x) * pixelBytes;
+            cropped.insert(cropped.end(), row, row + static_cast<std::size_t>(width) * pixelBytes);
+        }
+    return cropped;
+}
+
+// rows of rowBytes outputStride bytes apart (planes of rows rows each), packed
+std::vector<unsigned char> packRows(const std::vector<unsigned char>& output, const unsigned int planes, const unsigned int rows, const std::size_t rowBytes,
+                                    const std::size_t outputStride) {
+    std::vector<unsigned char> packed;
+    for (unsigned int r = 0; r < planes * rows; r++)
+        packed.insert(packed.end(), output.begin() + r * outputStride, output.begin() + r * outputStride + rowBytes);
+    return packed;
+}
+
+std::vector<TestImage> testImages(std::mt19937& random) {
+    std::vector<TestImage> images;
+    for (const auto& size : testSizes)
+        for (const bool hasAlpha : {false, true})
+            images.push_back(randomImage(random, size[0], size[1], hasAlpha));
+    return images;
+}
+
+// cached mode: re-sharpening with other parameters, bands that fill the cache, a new image of the same size
+void testCache(std::mt19937& random, const std::vector<TestImage>& images) {
+    for (const TestImage& image : images) {
+        void* cas = CAS_createSession(referenceContext);
+        CAS_setCacheBudget(cas, 1ull << 32);
+        CAS_supplyImage(cas, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+        for (int call = 0; call < 3; call++) {
+            const Parameters parameters = randomParameters(random);
+            const unsigned char* output = CAS_sharpenImage(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption);
+            expectEqual(output ? std::vector<unsigned char>(output, output + outputBytes(image)) : std::vector<unsigned char>(), sharpenReference(image, parameters),
+                        "cache call " + std::to_string(call) + " " + describe(image, parameters));
+        }
+
+        // full width bands from the top fill the cache of the next whole image call
+        const TestImage next = randomImage(random, image.rows, image.cols, image.hasAlpha);
+        CAS_supplyImage(cas, next.pixels.data(), next.hasAlpha, next.rows, next.cols);
+        const Parameters bandParameters = randomParameters(random);
+        const std::vector<unsigned char> bandReference = sharpenReference(next, bandParameters);
+        for (unsigned int y = 0; y < next.rows;) {
+            const unsigned int band = std::min(next.rows - y, 1 + static_cast<unsigned int>(random() % 40));
+            std::vector<unsigned char> output(static_cast<std::size_t>(band) * next.cols * channels(next.hasAlpha));
+            const int status = CAS_sharpenRegion(cas, bandParameters.casMode, bandParameters.sharpenStrength, bandParameters.contrastAdaption, 0, y, next.cols, band,
+                                                 output.data(), 0);
+            expect(status == CAS_STATUS_OK, "cache band status " + describe(next, bandParameters));
+            expectEqual(output, cropOutput(bandReference, next, bandParameters.casMode, 0, y, next.cols, band),
+                        "cache band at row " + std::to_string(y) + " " + describe(next, bandParameters));
+            y += band;
+        }
+        const Parameters parameters = randomParameters(random);
+        const unsigned char* output = CAS_sharpenImage(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption);
+        expectEqual(output ? std::vector<unsigned char>(output, output + outputBytes(next)) : std::vector<unsigned char>(), sharpenReference(next, parameters),
+                    "cache after bands " + describe(next, parameters));
+        CAS_destroy(cas);
+    }
+}
+
+// regions at the borders, single pixels and random rectangles, with padded output rows and small tiles
+void testRegions(std::mt19937& random, const std::vector<TestImage>& images) {
+    for (const TestImage& image : images) {
+        const Parameters parameters = randomParameters(random);
+        const std::vector<unsigned char> reference = sharpenReference(image, parameters);
+        void* cas = CAS_createSession(referenceContext);
+        if (random() % 2)
+            CAS_setTileSize(cas, 8, 16);
+        CAS_supplyImage(cas, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+        const unsigned int lastRow = image.rows - 1, lastCol = image.cols - 1;
+        std::vector<std::vector<unsigned int>> rects = {{0, 0, image.cols, image.rows}, {0, 0, 1, 1},       {lastCol, lastRow, 1, 1}, {0, 0, image.cols, 1},
+                                                        {0, lastRow, image.cols, 1},     {0, 0, 1, image.rows}, {lastCol, 0, 1, image.rows}};
+        for (int i = 0; i < 4; i++) {
+            const unsigned int x = random() % image.cols, y = random() % image.rows;
+            rects.push_back({x, y, 1 + static_cast<unsigned int>(random() % (image.cols - x)), 1 + static_cast<unsigned int>(random() % (image.rows - y))});
+        }
+        for (const auto& rect : rects) {
+            const unsigned int x = rect[0], y = rect[1], width = rect[2], height = rect[3];
+            const unsigned int planes = parameters.casMode == 0 ? channels(image.hasAlpha) : 1;
+            const std::size_t rowBytes = static_cast<std::size_t>(width) * (parameters.casMode == 0 ? 1 : channels(image.hasAlpha));
+            const std::size_t stride = rowBytes + random() % 8;
+            std::vector<unsigned char> output(planes * height * stride);
+            const int status = CAS_sharpenRegion(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption, x, y, width, height, output.data(),
+                                                 static_cast<unsigned int>(stride));
+            const std::string what = "region " + std::to_string(width) + "x" + std::to_string(height) + " at " + std::to_string(x) + "," + std::to_string(y) + " " +
+                                     describe(image, parameters);
+            if (expect(status == CAS_STATUS_OK, what + " status"))
+                expectEqual(packRows(output, planes, height, rowBytes, stride), cropOutput(reference, image, parameters.casMode, x, y, width, height), what);
+        }
+        CAS_destroy(cas);
+    }
+}
+
+// bands of CAS_sharpenScaledRows against the whole CAS_sharpenScaledInto output, upscaled and downscaled
+void testScaledRows(std::mt19937& random, const std::vector<TestImage>& images) {
+    for (const TestImage& image : images) {
+        void* cas = CAS_createSession(referenceContext);
+        CAS_supplyImage(cas, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+        const unsigned int sizes[][2] = {{image.rows * 2 + 1, image.cols * 3 / 2 + 1}, {std::max(1u, image.rows / 3), std::max(1u, image.cols / 2)}};
+        for (const auto& size : sizes) {
+            const Parameters parameters = randomParameters(random);
+            const unsigned int outputRows = size[0], outputCols = size[1];
+            const unsigned int planes = parameters.casMode == 0 ? channels(image.hasAlpha) : 1;
+            const std::size_t rowBytes = static_cast<std::size_t>(outputCols) * (parameters.casMode == 0 ? 1 : channels(image.hasAlpha));
+            std::vector<unsigned char> whole(planes * outputRows * rowBytes);
+            const int status = CAS_sharpenScaledInto(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption, outputRows, outputCols, whole.data(), 0);
+            const std::string what = "scaled " + std::to_string(outputCols) + "x" + std::to_string(outputRows) + " " + describe(image, parameters);
+            if (!expect(status == CAS_STATUS_OK, what + " status"))
+                continue;
+            for (unsigned int y = 0; y < outputRows;) {
+                const unsigned int band = std::min(outputRows - y, 1 + static_cast<unsigned int>(random() % 50));
+                std::vector<unsigned char> output(planes * band * rowBytes);
+                const int bandStatus = CAS_sharpenScaledRows(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption, outputRows, outputCols, y,
+                                                             band, output.data(), 0);
+                std::vector<unsigned char> expected;
+                for (unsigned int p = 0; p < planes; p++)
+                    expected.insert(expected.end(), whole.begin() + (p * outputRows + y) * rowBytes, whole.begin() + (p * outputRows + y + band) * rowBytes);
+                if (expect(bandStatus == CAS_STATUS_OK, what + " band status"))
+                    expectEqual(output, expected, what + " band at row " + std::to_string(y));
+                y += band;
+            }
+        }
+        CAS_destroy(cas);
+    }
+}
+
+// rows pushed and pulled in random chunks, with padded input and output rows
+void testStreams(std::mt19937& random, const std::vector<TestImage>& images) {
+    for (const TestImage& image : images) {
+        const Parameters parameters = randomParameters(random);
+        const unsigned int pixelBytes = parameters.casMode == 0 ? 1 : channels(image.hasAlpha);
+        const unsigned int planes = parameters.casMode == 0 ? channels(image.hasAlpha) : 1;
+        const std::size_t inputStride = image.cols * 4 + random() % 8 * 4, outputStride = image.cols * pixelBytes + random() % 8;
+        std::vector<unsigned char> input(image.rows * inputStride);
+        for (unsigned int y = 0; y < image.rows; y++)
+            std::memcpy(input.data() + y * inputStride, image.pixels.data() + static_cast<std::size_t>(y) * image.cols * 4, image.cols * 4);
+        void* stream = CAS_streamBegin(image.rows, image.cols, image.hasAlpha, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption);
+        if (!expect(stream != nullptr, "stream begin " + describe(image, parameters)))
+            continue;
+        std::vector<unsigned char> output(outputBytes(image));
+        unsigned int pushed = 0, pulled = 0;
+        while (pulled < image.rows) {
+            const unsigned int count = std::min(image.rows - pushed, 1 + static_cast<unsigned int>(random() % 24));
+            pushed += CAS_streamPush(stream, input.data() + pushed * inputStride, count, static_cast<unsigned int>(inputStride));
+            std::vector<unsigned char> chunk(planes * image.rows * outputStride);
+            const unsigned int rows = CAS_streamPull(stream, chunk.data(), 1 + static_cast<unsigned int>(random() % 32), static_cast<unsigned int>(outputStride));
+            // planar chunks are written plane by plane
+            for (unsigned int p = 0; p < planes; p++)
+                for (unsigned int i = 0; i < rows; i++)
+                    std::memcpy(output.data() + (static_cast<std::size_t>(p) * image.rows + pulled + i) * image.cols * pixelBytes, chunk.data() + (p * rows + i) * outputStride,
+                                static_cast<std::size_t>(image.cols) * pixelBytes);
+            pulled += rows;
+            if (!expect(rows > 0 || pushed < image.rows, "stream progress " + describe(image, parameters)))
+                break;
+        }
+        expect(CAS_streamEnd(stream) == CAS_STATUS_OK, "stream end " + describe(image, parameters));
+        expectEqual(output, sharpenReference(image, parameters), "stream " + describe(image, parameters));
+    }
+}
+
+// frames with a few changed rectangles sharpened into circulating output buffers: the skipped tiles must keep the right output
+void testSequence(std::mt19937& random) {
+    constexpr unsigned int sizes[][3] = {{96, 130, 8}, {67, 201, 16}, {257, 129, 64}};
+    for (const auto& size : sizes) {
+        for (const bool hasAlpha : {false, true}) {
+            TestImage frame = randomImage(random, size[0], size[1], hasAlpha);
+            void* cas = CAS_createSession(referenceContext);
+            CAS_supplyImage(cas, frame.pixels.data(), frame.hasAlpha, frame.rows, frame.cols);
+            if (!expect(CAS_setSequenceMode(cas, size[2]) == CAS_STATUS_OK, "sequence mode " + std::to_string(size[2]))) {
+                CAS_destroy(cas);
+                continue;
+            }
+            Parameters parameters = randomParameters(random);
+            std::vector<std::vector<unsigned char>> buffers(3, std::vector<unsigned char>(outputBytes(frame)));
+            for (int index = 0; index < 16; index++) {
+                // changed rectangles (none in some frames), new parameters once
+                const int changes = static_cast<int>(random() % 3);
+                for (int change = 0; change < changes; change++) {
+                    const unsigned int x = random() % frame.cols, y = random() % frame.rows;
+                    const unsigned int width = std::min(frame.cols - x, 1 + static_cast<unsigned int>(random() % 20));
+                    const unsigned int height = std::min(frame.rows - y, 1 + static_cast<unsigned int>(random() % 20));
+                    for (unsigned int i = y; i < y + height; i++)
+                        for (unsigned int j = x * 4; j < (x + width) * 4; j++)
+                            frame.pixels[static_cast<std::size_t>(i) * frame.cols * 4 + j] = static_cast<unsigned char>(random());
+                }
+                if (index == 10)
+                    parameters = randomParameters(random);
+                std::vector<unsigned char>& output = buffers[index % buffers.size()];
+                // a buffer written by the caller is announced with CAS_invalidateCache
+                if (index == 12) {
+                    std::fill(output.begin(), output.end(), 0x5A);
+                    CAS_invalidateCache(cas);
+                }
+                CAS_supplyFrame(cas, frame.pixels.data(), 0);
+                const int status = CAS_sharpenImageInto(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption, output.data(), 0);
+                const std::string what = "sequence frame " + std::to_string(index) + " tile " + std::to_string(size[2]) + " " + describe(frame, parameters);
+                if (expect(status == CAS_STATUS_OK, what + " status"))
+                    expectEqual(output, sharpenReference(frame, parameters), what);
+            }
+            CASStats stats{};
+            CAS_getStats(cas, &stats);
+            expect(stats.skippedTiles > 0 && stats.skippedTiles < stats.sequenceTiles,
+                   "sequence tiles skipped " + std::to_string(stats.skippedTiles) + " of " + std::to_string(stats.sequenceTiles));
+            CAS_destroy(cas);
+        }
+    }
+}
+
+// fast precision tier against the exact scalar kernel: identical at a zero strength, within 1 LSB up to a strength of 2 and within 2 LSB above
+void testFastTier(const std::vector<TestImage>& images) {
+    // CAS_CPU_ISA is read when a context is created
+    const char* isa = std::getenv("CAS_CPU_ISA");
+    const std::string previousIsa = isa ? isa : "";
+    setenv("CAS_CPU_ISA", "scalar", 1);
+    void* scalarContext = CAS_createContext();
+    if (isa)
+        setenv("CAS_CPU_ISA", previousIsa.c_str(), 1);
+    else
+        unsetenv("CAS_CPU_ISA");
+    void* exact = scalarContext ? CAS_createSession(scalarContext) : nullptr;
+    void* fast = CAS_createSession(referenceContext);
+    if (expect(exact && fast && CAS_setPrecision(fast, CAS_PRECISION_FAST) == CAS_STATUS_OK, "fast tier sessions")) {
+        for (const TestImage& image : images) {
+            CAS_supplyImage(exact, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+            CAS_supplyImage(fast, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+            for (const float strength : {0.0f, 0.5f, 1.0f, 2.0f, 5.0f, 10.0f}) {
+                for (const float adaption : {0.0f, 0.5f, 1.0f}) {
+                    const Parameters parameters{image.rows % 2 ? 1 : 0, strength, adaption};
+                    std::vector<unsigned char> exactOutput(outputBytes(image)), fastOutput(outputBytes(image));
+                    const int exactStatus = CAS_sharpenImageInto(exact, parameters.casMode, strength, adaption, exactOutput.data(), 0);
+                    const int fastStatus = CAS_sharpenImageInto(fast, parameters.casMode, strength, adaption, fastOutput.data(), 0);
+                    if (!expect(exactStatus == CAS_STATUS_OK && fastStatus == CAS_STATUS_OK, "fast tier status " + describe(image, parameters)))
+                        continue;
+                    int difference = 0;
+                    for (std::size_t i = 0; i < fastOutput.size(); i++)
+                        difference = std::max(difference, std::abs(fastOutput[i] - exactOutput[i]));
+                    const int bound = strength == 0.0f ? 0 : strength <= 2.0f ? 1 : 2;
+                    expect(difference <= bound, "fast tier " + describe(image, parameters) + ": " + std::to_string(difference) + " LSB from the exact tier, bound " +
+                                                    std::to_string(bound));
+                }
+            }
+        }
+    }
+    if (fast)
+        CAS_destroy(fast);
+    if (exact)
+        CAS_destroy(exact);
+    if (scalarContext)
+        CAS_destroyContext(scalarContext);
+}
+
+// functions of the client library (CAS_REMOTE build) used by the daemon test, loaded next to the local one: RTLD_DEEPBIND resolves its own symbols first
+struct ClientLibrary {
+    void* handle{nullptr};
+    decltype(&CAS_initialize) initialize{nullptr};
+    decltype(&CAS_supplyImage) supplyImage{nullptr};
+    decltype(&CAS_sharpenImage) sharpenImage{nullptr};
+    decltype(&CAS_sharpenRegion) sharpenRegion{nullptr};
+    decltype(&CAS_destroy) destroy{nullptr};
+
+    template <class F>
+    bool load(F& function, const char* name) {
+        function = reinterpret_cast<F>(dlsym(handle, name));
+        return function != nullptr;
+    }
+
+    bool open(const char* path) {
+        handle = dlopen(path, RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND);
+        return handle && load(initialize, "CAS_initialize") && load(supplyImage, "CAS_supplyImage") && load(sharpenImage, "CAS_sharpenImage") &&
+               load(sharpenRegion, "CAS_sharpenRegion") && load(destroy, "CAS_destroy");
+    }
+};
+
+// the results of a cas-daemon through the client library: whole images, regions, and small images of concurrent clients (coalesced in batches)
+void testDaemon(std::mt19937& random, const std::vector<TestImage>& images, const char* daemonPath, const char* clientPath) {
+    ClientLibrary client;
+    if (!client.open(clientPath)) {
+        const char* error = dlerror();
+        expect(false, std::string("load ") + clientPath + ": " + (error ? error : "missing function"));
+        return;
+    }
+    char directory[] = "/tmp/cas-test-XXXXXX";
+    if (!expect(mkdtemp(directory) != nullptr, "temporary directory"))
+        return;
+    const std::string socketPath = std::string(directory) + "/daemon.sock";
+    const pid_t daemon = fork();
+    if (daemon == 0) {
+        execl(daemonPath, daemonPath, "--socket", socketPath.c_str(), "--quiet", static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    setenv("CAS_DAEMON_SOCKET", socketPath.c_str(), 1);
+    // the daemon listens once its context is created
+    void* cas = nullptr;
+    for (int attempt = 0; daemon > 0 && attempt < 500 && !(cas = client.initialize()); attempt++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (expect(cas != nullptr, std::string("connect to ") + daemonPath)) {
+        for (const TestImage& image : images) {
+            const Parameters parameters = randomParameters(random);
+            const std::vector<unsigned char> reference = sharpenReference(image, parameters);
+            client.supplyImage(cas, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+            const unsigned char* output = client.sharpenImage(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption);
+            expectEqual(output ? std::vector<unsigned char>(output, output + outputBytes(image)) : std::vector<unsigned char>(), reference,
+                        "daemon " + describe(image, parameters));
+            const unsigned int x = random() % image.cols, y = random() % image.rows;
+            const unsigned int width = image.cols - x, height = image.rows - y;
+            std::vector<unsigned char> region(static_cast<std::size_t>(width) * height * channels(image.hasAlpha));
+            const int status = client.sharpenRegion(cas, parameters.casMode, parameters.sharpenStrength, parameters.contrastAdaption, x, y, width, height, region.data(), 0);
+            if (expect(status == CAS_STATUS_OK, "daemon region status " + describe(image, parameters)))
+                expectEqual(region, cropOutput(reference, image, parameters.casMode, x, y, width, height), "daemon region " + describe(image, parameters));
+        }
+        client.destroy(cas);
+
+        // small whole images of several clients at once
+        std::vector<TestImage> small;
+        std::vector<Parameters> parameters;
+        std::vector<std::vector<unsigned char>> references;
+        for (int i = 0; i < 32; i++) {
+            small.push_back(randomImage(random, 1 + random() % 96, 1 + random() % 96, random() % 2));
+            parameters.push_back(randomParameters(random));
+            references.push_back(sharpenReference(small.back(), parameters.back()));
+        }
+        std::vector<std::jthread> clients;
+        for (unsigned int c = 0; c < 4; c++) {
+            clients.emplace_back([&, c] {
+                void* session = client.initialize();
+                if (!expect(session != nullptr, "daemon client " + std::to_string(c)))
+                    return;
+                for (std::size_t i = c; i < small.size(); i += 4) {
+                    const TestImage& image = small[i];
+                    client.supplyImage(session, image.pixels.data(), image.hasAlpha, image.rows, image.cols);
+                    const unsigned char* output = client.sharpenImage(session, parameters[i].casMode, parameters[i].sharpenStrength, parameters[i].contrastAdaption);
+                    expectEqual(output ? std::vector<unsigned char>(output, output + outputBytes(image)) : std::vector<unsigned char>(), references[i],
+                                "daemon concurrent " + describe(image, parameters[i]));
+                }
+                client.destroy(session);
+            });
+        }
+        clients.clear();
+    }
+    if (daemon > 0) {
+        kill(daemon, SIGTERM);
+        int status = 0;
+        waitpid(daemon, &status, 0);
+        expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "daemon exit status");
+    }
+    unlink(socketPath.c_str());
+    rmdir(directory);
+}
+
+void printUsage() {
+    std::fputs("Usage: cas-test [options]\n"
+               "Compare the cached mode, regions, scaled row bands, streams and the sequence mode of hipCAS with CAS_sharpenImage on random images,\n"
+               "and the fast precision tier with the exact scalar kernel.\n\n"
+               "Options:\n"
+               "  --seed <value>                     Seed of the random images (default 1).\n"
+               "  --daemon <cas-daemon> <client>     Compare the results of a cas-daemon started on a temporary socket, through the client library instead.\n"
+               "  -h, --help                         Show this help.\n",
+               stderr);
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned int seed = 1;
+    const char* daemonPath = nullptr;
+    const char* clientPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg(argv[i]);
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "--seed" && i + 1 < argc)
+            seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--daemon" && i + 2 < argc) {
+            daemonPath = argv[++i];
+            clientPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            printUsage();
+            return 2;
+        }
+    }
+
+    referenceContext = CAS_createContext();
+    void* probe = referenceContext ? CAS_createSession(referenceContext) : nullptr;
+    if (!probe) {
+        std::fputs("cas-test: failed to initialize CAS\n", stderr);
+        return 1;
+    }
+    std::printf("engine %s, seed %u\n", CAS_getBackendName(probe), seed);
+    CAS_destroy(probe);
+
+    std::mt19937 random(seed);
+    const std::vector<TestImage> images = testImages(random);
+    if (daemonPath)
+        testDaemon(random, images, daemonPath, clientPath);
+    else {
+        testCache(random, images);
+        testRegions(random, images);
+        testScaledRows(random, images);
+        testStreams(random, images);
+        testSequence(random);
+        testFastTier(images);
+    }
+    CAS_destroyContext(referenceContext);
+    std::printf("%d checks, %d failed\n", checks.load(), failures.load());
+    return failures.load() == 0 ? 0 : 1;
+}